@@ -43,18 +43,47 @@
 #include <stdlib.h>
 #include <functional>
 #include <string.h>
+#include <time.h>
+#include <errno.h>
 
 #include "adis16448.hpp"
 
 using namespace upm;
 
+// Burst output: the command word, then DIAG_STAT, the three gyro,
+// accel and magnetometer words, BARO_OUT, TEMP_OUT, and the CRC if
+// enabled
+#define BURST_CMD (GLOB_CMD << 8)
+#define BURST_WORDS 13
+#define BURST_CRC_WORDS 14
+
 ////////////////////////////////////////////////////////////////////////////
 // Constructor with configurable CS, DR, and RST
 ////////////////////////////////////////////////////////////////////////////
 // RST - Hardware reset pin
+// DR - Data ready pin connected to DIO1, -1 if not used
 ////////////////////////////////////////////////////////////////////////////
-ADIS16448::ADIS16448(int bus, int rst)
+ADIS16448::ADIS16448(int bus, int rst, int dr)
 {
+        _dr = NULL;
+        _burstCRC = false;
+        _streaming = false;
+        _frameHead = 0;
+        _frameCount = 0;
+        _sequence = 0;
+        _droppedFrames = 0;
+        _crcErrors = 0;
+
+        pthread_condattr_t condAttrib;
+        pthread_condattr_init(&condAttrib);
+        pthread_condattr_setclock(&condAttrib, CLOCK_MONOTONIC);
+
+        pthread_mutex_init(&_spiLock, NULL);
+        pthread_mutex_init(&_frameLock, NULL);
+        pthread_cond_init(&_frameCond, &condAttrib);
+
+        pthread_condattr_destroy(&condAttrib);
+
 // Configure I/O
         //Initialize RST pin
         if ( !(_rst = mraa_gpio_init(rst)) ) 
@@ -73,6 +102,18 @@ ADIS16448::ADIS16448(int bus, int rst)
             return;
           }
         configSPI();
+
+        // Initialize the optional data ready pin
+        if (dr >= 0)
+          {
+            if ( !(_dr = mraa_gpio_init(dr)) )
+              {
+                throw std::invalid_argument(std::string(__FUNCTION__) +
+                                            ": mraa_gpio_init(dr) failed, invalid pin?");
+                return;
+              }
+            mraa_gpio_dir(_dr, MRAA_GPIO_IN);
+          }
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -81,6 +122,10 @@ ADIS16448::ADIS16448(int bus, int rst)
 ////////////////////////////////////////////////////////////////////////////
 ADIS16448::~ADIS16448()
 {
+	stopStreaming();
+	if (_dr)
+		mraa_gpio_close(_dr);
+
 // Close SPI bus
 	mraa_result_t error;
 	error = mraa_spi_stop(_spi);
@@ -94,6 +139,10 @@ ADIS16448::~ADIS16448()
 	{
 		mraa_result_print(error);
 	}
+
+	pthread_cond_destroy(&_frameCond);
+	pthread_mutex_destroy(&_frameLock);
+	pthread_mutex_destroy(&_spiLock);
 }
 
 ////////////////////////////////////////////////////////////////////////////
@@ -138,21 +187,17 @@ void ADIS16448::configSPI() {
 ////////////////////////////////////////////////////////////////////////////////////////////
 int16_t ADIS16448::regRead(uint8_t regAddr)
 {
-	configSPI(); //Set up SPI (useful when multiple SPI devices present on bus)
+	pthread_mutex_lock(&_spiLock);
 // Write register address to be read
-	uint8_t buf[2]; //Allocate write buffer
-	memset(buf, 0, sizeof(uint8_t)*2); //Initialize buffer and write 0s
-	buf[1] = regAddr; //Write the user-requested register address to the buffer
-	mraa_spi_write_buf(_spi, buf, 2); //Write the buffer onto the SPI port
+	mraa_spi_write_word(_spi, (regAddr & 0x7F) << 8); //Address in the upper byte
 
 	usleep(20); //Delay to not violate read rate (210us)
 
 // Read data from register requested
-	buf[1] = 0; //Clear contents of write buffer
-	uint8_t* x = mraa_spi_write_buf(_spi, buf, 2); //Write 0x0000 to SPI and read data requested above
-	int16_t _dataOut = (x[1] << 8) | (x[0] & 0xFF);; //Concatenate upper and lower bytes
+	int16_t _dataOut = mraa_spi_write_word(_spi, 0x0000); //Write 0x0000 to SPI and read data requested above
 
 	usleep(20); //delay to not violate read rate (210us)
+	pthread_mutex_unlock(&_spiLock);
 	return(_dataOut);
 }
 ////////////////////////////////////////////////////////////////////////////
@@ -163,29 +208,22 @@ int16_t ADIS16448::regRead(uint8_t regAddr)
 ////////////////////////////////////////////////////////////////////////////
 void ADIS16448::regWrite(uint8_t regAddr,uint16_t regData)
 {
-	configSPI();
 // Separate the 16 bit command word into two bytes
 	uint16_t addr = (((regAddr & 0x7F) | 0x80) << 8); //Check that the address is 7 bits, flip the sign bit
 	uint16_t lowWord = (addr | (regData & 0xFF));
 	uint16_t highWord = ((addr | 0x100) | ((regData >> 8) & 0xFF));
+
+	pthread_mutex_lock(&_spiLock);
 // Write the low byte to the SPI bus
-	uint8_t lbuf[2]; //Allocate write buffer
-	memset(lbuf, 0, sizeof(uint8_t)*2); //Fill low buffer with 0's
-	lbuf[0] = (lowWord >> 8);
-	lbuf[1] = (lowWord);
-	mraa_spi_write_buf(_spi, lbuf, 2); //Write the buffer to the SPI port
+	mraa_spi_write_word(_spi, lowWord);
 
 	usleep(20);
 
 // Write the high byte to the SPI bus
-	uint8_t hbuf[2]; //Allocate write buffer
-	memset(hbuf, 0, sizeof(uint8_t)*2); //Fill high buffer with 0's
-	hbuf[0] = (highWord >> 8);
-	hbuf[1] = (highWord);
-	mraa_spi_write_buf(_spi, hbuf, 2); //Write the buffer to the SPI port
+	mraa_spi_write_word(_spi, highWord);
 
 	usleep(20);
-
+	pthread_mutex_unlock(&_spiLock);
 }
 /////////////////////////////////////////////////////////////////////////////////////////
 // Converts accelerometer data output from the sensorRead() function and returns
@@ -245,3 +283,271 @@ float ADIS16448::magnetometerScale(int16_t sensorData)
 	float finalData = (sensorData * 0.0001429); //multiply by sensor resolution (142.9uGa LSB/dps)
 	return finalData;
 }
+
+////////////////////////////////////////////////////////////////////////////
+// Enables or disables the CRC-16 appended to burst reads (MSC_CTRL[4])
+////////////////////////////////////////////////////////////////////////////
+void ADIS16448::enableBurstCRC(bool enable)
+{
+	uint16_t msc = regRead(MSC_CTRL);
+
+	if (enable)
+		msc |= MSC_CTRL_BURST_CRC;
+	else
+		msc &= ~MSC_CTRL_BURST_CRC;
+
+	regWrite(MSC_CTRL, msc);
+	_burstCRC = enable;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Computes the burst CRC-16 (CCITT polynomial, LSB first, initial value
+// 0xFFFF) over XGYRO_OUT through TEMP_OUT, low byte of each word first.
+////////////////////////////////////////////////////////////////////////////
+// burst - the burst output words, starting at DIAG_STAT
+// return - CRC in the byte order it is read from the device
+////////////////////////////////////////////////////////////////////////////
+uint16_t ADIS16448::checksum(const uint16_t* burst)
+{
+	uint16_t crc = 0xFFFF;
+
+	for (int i = 1; i < 12; i++)
+	{
+		uint8_t bytes[2] = { (uint8_t)(burst[i] & 0xFF), (uint8_t)(burst[i] >> 8) };
+		for (int j = 0; j < 2; j++)
+		{
+			uint8_t data = bytes[j];
+			for (int bit = 0; bit < 8; bit++, data >>= 1)
+			{
+				if ((crc ^ data) & 0x0001)
+					crc = (crc >> 1) ^ 0x1021;
+				else
+					crc >>= 1;
+			}
+		}
+	}
+
+	crc = ~crc;
+	return (crc << 8) | (crc >> 8);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Reads all outputs with one burst mode SPI transaction. The device
+// clocks the burst out as long as SCLK keeps running after the 0x3E00
+// command, so no stall time is needed between the words.
+////////////////////////////////////////////////////////////////////////////
+// frame - frame to fill in
+// return - false if the CRC is enabled and did not match
+////////////////////////////////////////////////////////////////////////////
+bool ADIS16448::burstRead(ADIS16448_FRAME_T* frame)
+{
+	uint16_t tx[BURST_CRC_WORDS];
+	uint16_t rx[BURST_CRC_WORDS];
+	int words = _burstCRC ? BURST_CRC_WORDS : BURST_WORDS;
+	struct timespec now;
+
+	memset(tx, 0, sizeof(tx));
+	tx[0] = BURST_CMD;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	pthread_mutex_lock(&_spiLock);
+	mraa_result_t rv = mraa_spi_transfer_buf_word(_spi, tx, rx, words * 2);
+	pthread_mutex_unlock(&_spiLock);
+
+	if (rv != MRAA_SUCCESS)
+	  {
+	    throw std::runtime_error(std::string(__FUNCTION__) +
+	                             ": mraa_spi_transfer_buf_word() failed");
+	    return false;
+	  }
+
+	// rx[0] was clocked out while the command was sent
+	const uint16_t* burst = &rx[1];
+
+	frame->timestamp = ((uint64_t)now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+	frame->sequence = 0;
+	frame->diagStat = burst[0];
+	for (int i = 0; i < 3; i++)
+	  {
+	    frame->gyro[i] = (int16_t)burst[1 + i];
+	    frame->accel[i] = (int16_t)burst[4 + i];
+	    frame->mag[i] = (int16_t)burst[7 + i];
+	  }
+	frame->baro = burst[10];
+	frame->temp = (int16_t)burst[11];
+
+	if (_burstCRC)
+		return checksum(burst) == burst[12];
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Called from the GPIO ISR thread on every data ready pulse
+////////////////////////////////////////////////////////////////////////////
+void ADIS16448::dataReadyISR(void* ctx)
+{
+	ADIS16448* This = (ADIS16448*)ctx;
+	ADIS16448_FRAME_T frame;
+	bool valid;
+
+	try
+	  {
+	    valid = This->burstRead(&frame);
+	  }
+	catch (std::runtime_error& e)
+	  {
+	    std::cerr << __FUNCTION__ << ": " << e.what() << std::endl;
+	    return;
+	  }
+
+	pthread_mutex_lock(&This->_frameLock);
+
+	if (!valid)
+	  {
+	    This->_crcErrors++;
+	    pthread_mutex_unlock(&This->_frameLock);
+	    return;
+	  }
+
+	int size = This->_frames.size();
+	if (This->_frameCount == size)
+	  {
+	    // drop the oldest
+	    This->_frameHead = (This->_frameHead + 1) % size;
+	    This->_frameCount--;
+	    This->_droppedFrames++;
+	  }
+
+	frame.sequence = This->_sequence++;
+	This->_frames[(This->_frameHead + This->_frameCount) % size] = frame;
+	This->_frameCount++;
+
+	pthread_cond_broadcast(&This->_frameCond);
+	pthread_mutex_unlock(&This->_frameLock);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Starts burst reads paced by the DIO1 data ready output
+////////////////////////////////////////////////////////////////////////////
+// depth - number of frames to queue
+////////////////////////////////////////////////////////////////////////////
+void ADIS16448::startStreaming(int depth)
+{
+	if (!_dr)
+	  {
+	    throw std::runtime_error(std::string(__FUNCTION__) +
+	                             ": no data ready pin was configured");
+	    return;
+	  }
+
+	if (_streaming)
+		return;
+
+	// data ready on DIO1, active high
+	uint16_t msc = regRead(MSC_CTRL);
+	msc &= ~MSC_CTRL_DR_DIO2;
+	msc |= (MSC_CTRL_DR_EN | MSC_CTRL_DR_POL);
+	regWrite(MSC_CTRL, msc);
+
+	pthread_mutex_lock(&_frameLock);
+	_frames.resize(depth > 0 ? depth : 1);
+	_frameHead = 0;
+	_frameCount = 0;
+	_sequence = 0;
+	_droppedFrames = 0;
+	_crcErrors = 0;
+	_streaming = true;
+	pthread_mutex_unlock(&_frameLock);
+
+	if (mraa_gpio_isr(_dr, MRAA_GPIO_EDGE_RISING, &dataReadyISR, this) != MRAA_SUCCESS)
+	  {
+	    _streaming = false;
+	    throw std::runtime_error(std::string(__FUNCTION__) +
+	                             ": mraa_gpio_isr() failed");
+	    return;
+	  }
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Stops streaming, and wakes up anyone waiting in getFrame()
+////////////////////////////////////////////////////////////////////////////
+void ADIS16448::stopStreaming()
+{
+	if (!_streaming)
+		return;
+
+	mraa_gpio_isr_exit(_dr);
+
+	pthread_mutex_lock(&_frameLock);
+	_streaming = false;
+	pthread_cond_broadcast(&_frameCond);
+	pthread_mutex_unlock(&_frameLock);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// Gets the oldest queued frame
+////////////////////////////////////////////////////////////////////////////
+// frame - frame to fill in
+// timeoutMs - time to wait in milliseconds, -1 to wait forever
+// return - true if a frame was returned
+////////////////////////////////////////////////////////////////////////////
+bool ADIS16448::getFrame(ADIS16448_FRAME_T* frame, int timeoutMs)
+{
+	struct timespec abstime;
+
+	if (timeoutMs >= 0)
+	  {
+	    clock_gettime(CLOCK_MONOTONIC, &abstime);
+	    abstime.tv_sec += timeoutMs / 1000;
+	    abstime.tv_nsec += (timeoutMs % 1000) * 1000000;
+	    if (abstime.tv_nsec >= 1000000000)
+	      {
+	        abstime.tv_sec++;
+	        abstime.tv_nsec -= 1000000000;
+	      }
+	  }
+
+	pthread_mutex_lock(&_frameLock);
+
+	while (!_frameCount && _streaming)
+	  {
+	    if (timeoutMs < 0)
+	      pthread_cond_wait(&_frameCond, &_frameLock);
+	    else if (pthread_cond_timedwait(&_frameCond, &_frameLock, &abstime)
+	             == ETIMEDOUT)
+	      break;
+	  }
+
+	bool rv = false;
+	if (_frameCount)
+	  {
+	    *frame = _frames[_frameHead];
+	    _frameHead = (_frameHead + 1) % _frames.size();
+	    _frameCount--;
+	    rv = true;
+	  }
+
+	pthread_mutex_unlock(&_frameLock);
+
+	return rv;
+}
+
+unsigned int ADIS16448::getDroppedFrames()
+{
+	pthread_mutex_lock(&_frameLock);
+	unsigned int rv = _droppedFrames;
+	pthread_mutex_unlock(&_frameLock);
+
+	return rv;
+}
+
+unsigned int ADIS16448::getCRCErrors()
+{
+	pthread_mutex_lock(&_frameLock);
+	unsigned int rv = _crcErrors;
+	pthread_mutex_unlock(&_frameLock);
+
+	return rv;
+}
@@ -37,6 +37,8 @@
 //
 //////////////////////////////////////////////////////////////////////////////////////
 #include <string>
+#include <vector>
+#include <pthread.h>
 #include <mraa/spi.h>
 #include <mraa/gpio.h>
 
@@ -82,7 +84,31 @@
 #define PROD_ID 0x56 //Product identifier
 #define SERIAL_NUM 0x58 //Lot-specific serial number
 
+// MSC_CTRL bits
+#define MSC_CTRL_DR_DIO2 0x0001 //Data ready on DIO2 rather than DIO1
+#define MSC_CTRL_DR_POL 0x0002 //Data ready active high
+#define MSC_CTRL_DR_EN 0x0004 //Data ready enable
+#define MSC_CTRL_BURST_CRC 0x0010 //Append a CRC-16 to burst reads
+
 namespace upm {
+    /**
+     * One burst read of all output registers.  The sensor words are
+     * raw, use the ADIS16448 scale methods to convert them.
+     */
+    typedef struct {
+        // CLOCK_MONOTONIC time at which the read was started, in
+        // microseconds
+        uint64_t timestamp;
+        // frame number since streaming was started
+        uint32_t sequence;
+        uint16_t diagStat;
+        int16_t gyro[3];
+        int16_t accel[3];
+        int16_t mag[3];
+        uint16_t baro;
+        int16_t temp;
+    } ADIS16448_FRAME_T;
+
  /**
   * @brief ADIS16448 Accelerometer
   * @defgroup adis16448 libupm-adis16448
@@ -102,6 +128,12 @@ namespace upm {
   *
   * This is an industrial-grade accelerometer by Analog Devices.
   *
+  * Besides reading single registers, all outputs can be read in one
+  * SPI transaction using the device's burst mode, optionally
+  * verified by a CRC-16.  If the DIO1 data ready output is connected
+  * to a GPIO, bursts can be paced by it, and the resulting frames
+  * queued for retrieval with getFrame().
+  *
   * @snippet adis16448.cxx Interesting
   */
     class ADIS16448{
@@ -109,9 +141,15 @@ namespace upm {
         public:
 
         /**
-         * Constructor with configurable HW Reset
+         * Constructor with configurable HW Reset and optional data
+         * ready pin
+         *
+         * @param bus SPI bus to use
+         * @param rst GPIO pin connected to RST
+         * @param dr GPIO pin connected to DIO1, or -1 if not connected.
+         * This is required for startStreaming().
          */
-        ADIS16448(int bus, int rst);
+        ADIS16448(int bus, int rst, int dr=-1);
 
         /**
          * Destructor
@@ -163,11 +201,89 @@ namespace upm {
          */
         float magnetometerScale(int16_t sensorData);
 
+        /**
+         * Enables or disables the CRC-16 at the end of burst reads.
+         * Requires a device firmware supporting it.
+         *
+         * @param enable true to verify burst reads with a CRC
+         */
+        void enableBurstCRC(bool enable);
+
+        /**
+         * Reads all outputs in a single SPI transaction using burst
+         * mode.
+         *
+         * @param frame Pointer to the frame to fill in
+         * @return false if the CRC is enabled and did not match
+         */
+        bool burstRead(ADIS16448_FRAME_T* frame);
+
+        /**
+         * Starts reading a burst on every data ready pulse from DIO1,
+         * up to 819.2 times a second.  Frames that fail their CRC are
+         * discarded.  The data ready output is enabled on DIO1,
+         * active high.
+         *
+         * @param depth Number of frames to queue.  When the queue is
+         * full, the oldest frame is dropped.
+         */
+        void startStreaming(int depth=64);
+
+        /**
+         * Stops streaming started by startStreaming()
+         */
+        void stopStreaming();
+
+        /**
+         * Gets the oldest queued frame, waiting for one if needed
+         *
+         * @param frame Pointer to the frame to fill in
+         * @param timeoutMs Time to wait in milliseconds, -1 to wait
+         * forever
+         * @return true if a frame was returned, false on timeout or
+         * if streaming is stopped
+         */
+        bool getFrame(ADIS16448_FRAME_T* frame, int timeoutMs=-1);
+
+        /**
+         * Returns the number of frames dropped because the queue was
+         * full, since streaming was started
+         */
+        unsigned int getDroppedFrames();
+
+        /**
+         * Returns the number of bursts with a bad CRC, since
+         * streaming was started
+         */
+        unsigned int getCRCErrors();
+
         private:
 
         mraa_spi_context _spi;
         mraa_gpio_context _rst;
+        mraa_gpio_context _dr;
+
+        // register and burst transactions must not interleave
+        pthread_mutex_t _spiLock;
+        bool _burstCRC;
+
+        // frame queue filled from the data ready ISR
+        bool _streaming;
+        std::vector<ADIS16448_FRAME_T> _frames;
+        int _frameHead;
+        int _frameCount;
+        uint32_t _sequence;
+        unsigned int _droppedFrames;
+        unsigned int _crcErrors;
+        pthread_mutex_t _frameLock;
+        pthread_cond_t _frameCond;
+
+        uint16_t checksum(const uint16_t* burst);
+        static void dataReadyISR(void* ctx);
 
+        // disable copying, the object owns an ISR
+        ADIS16448(const ADIS16448&) = delete;
+        ADIS16448& operator=(const ADIS16448&) = delete;
     };
 }
 
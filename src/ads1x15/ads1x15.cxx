@@ -25,9 +25,11 @@
 
 #include "ads1x15.hpp"
 #include "mraa/i2c.hpp"
+#include "mraa/gpio.hpp"
 
 #include <unistd.h>
 #include <syslog.h>
+#include <time.h>
 
 using namespace upm;
 
@@ -50,9 +52,20 @@ ADS1X15::ADS1X15(int bus, uint8_t address){
      m_bitShift = 0;
      m_conversionDelay = .001;
      m_config_reg = 0x0000;
+
+     m_scanGpio = 0;
+     m_scanIndex = 0;
+     m_scanOverruns = 0;
+     pthread_mutex_init(&m_scanLock, NULL);
 }
 
-ADS1X15::~ADS1X15(){}
+ADS1X15::~ADS1X15(){
+     if(m_scanGpio){
+          m_scanGpio->isrExit();
+          delete m_scanGpio;
+     }
+     pthread_mutex_destroy(&m_scanLock);
+}
 
 float
 ADS1X15::getSample(ADSMUXMODE mode){
@@ -64,8 +77,12 @@ ADS1X15::getSample(ADSMUXMODE mode){
 float
 ADS1X15::getLastSample(int reg){
      uint16_t value = i2c->readWordReg(reg);
+     return convertSample(swapWord(value));
+}
+
+float
+ADS1X15::convertSample(uint16_t value){
      bool neg = false;
-     value = swapWord(value);
      if(value & 0x8000){
           neg = true;
           value = ~value;
@@ -157,6 +174,135 @@ ADS1X15::setThresh(ADSTHRESH reg, float value){
      }
 }
 
+void
+ADS1X15::startScan(const std::vector<ADSMUXMODE> &modes, int gpio,
+                   unsigned int ringSize){
+     if(modes.empty() || !ringSize)
+          throw std::invalid_argument(std::string(__FUNCTION__) + ": no inputs or empty ring");
+
+     stopScan();
+
+     pthread_mutex_lock(&m_scanLock);
+     m_scanModes = modes;
+     m_scanRings.assign(modes.size(), SCANRING());
+     for(unsigned int i = 0; i < m_scanRings.size(); i++){
+          m_scanRings[i].samples.resize(ringSize);
+          m_scanRings[i].head = 0;
+          m_scanRings[i].count = 0;
+     }
+     m_scanIndex = 0;
+     m_scanOverruns = 0;
+     pthread_mutex_unlock(&m_scanLock);
+
+     // ALERT/RDY pulses low at the end of each conversion.  The
+     // scan runs in single shot mode: in continuous mode a MUX change
+     // only takes effect after the conversion in progress, so results
+     // could not be matched to their inputs.
+     setThresh(CONVERSION_RDY);
+     updateConfigRegister((m_config_reg
+                           & ~(ADS1X15_MUX_MASK | ADS1X15_MODE_MASK
+                               | ADS1X15_CMODE_MASK | ADS1X15_CPOL_MASK
+                               | ADS1X15_CLAT_MASK | ADS1X15_CQUE_MASK))
+                          | m_scanModes[0] | ADS1X15_MODE_SINGLE
+                          | CQUE_1CONV);
+
+     m_scanGpio = new mraa::Gpio(gpio);
+     m_scanGpio->dir(mraa::DIR_IN);
+     if(m_scanGpio->isr(mraa::EDGE_FALLING, &scanISR, this) != mraa::SUCCESS){
+          delete m_scanGpio;
+          m_scanGpio = 0;
+          throw std::runtime_error(std::string(__FUNCTION__) + ": Gpio.isr() failed");
+     }
+
+     // start the first conversion, the ISR starts the following ones
+     updateConfigRegister(m_config_reg | ADS1X15_OS_SINGLE, true);
+}
+
+void
+ADS1X15::stopScan(){
+     if(!m_scanGpio) return;
+
+     m_scanGpio->isrExit();
+     delete m_scanGpio;
+     m_scanGpio = 0;
+
+     setContinuous(false);
+     setCompQue(CQUE_NONE);
+}
+
+unsigned int
+ADS1X15::scanAvailable(unsigned int index){
+     unsigned int count = 0;
+     pthread_mutex_lock(&m_scanLock);
+     if(index < m_scanRings.size()) count = m_scanRings[index].count;
+     pthread_mutex_unlock(&m_scanLock);
+     return count;
+}
+
+std::vector<ADS1X15::ADSSCANSAMPLE>
+ADS1X15::readScan(unsigned int index, unsigned int max){
+     std::vector<ADSSCANSAMPLE> out;
+
+     pthread_mutex_lock(&m_scanLock);
+     if(index < m_scanRings.size()){
+          SCANRING &ring = m_scanRings[index];
+          unsigned int size = ring.samples.size();
+          unsigned int n = ring.count;
+          if(max && max < n) n = max;
+
+          // oldest sample first
+          unsigned int tail = (ring.head + size - ring.count) % size;
+          out.reserve(n);
+          for(unsigned int i = 0; i < n; i++)
+               out.push_back(ring.samples[(tail + i) % size]);
+          ring.count -= n;
+     }
+     pthread_mutex_unlock(&m_scanLock);
+
+     return out;
+}
+
+unsigned int
+ADS1X15::getScanOverruns(){
+     pthread_mutex_lock(&m_scanLock);
+     unsigned int overruns = m_scanOverruns;
+     pthread_mutex_unlock(&m_scanLock);
+     return overruns;
+}
+
+void
+ADS1X15::scanISR(void *ctx){
+     ((ADS1X15 *)ctx)->scanHandler();
+}
+
+void
+ADS1X15::scanHandler(){
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+
+     // the result belongs to the input selected for this conversion
+     uint16_t raw = swapWord(i2c->readWordReg(ADS1X15_REG_POINTER_CONVERT));
+     float value = convertSample(raw);
+
+     unsigned int index = m_scanIndex;
+
+     // select the next input and start its conversion
+     m_scanIndex = (m_scanIndex + 1) % m_scanModes.size();
+     uint16_t config = (m_config_reg & ~(ADS1X15_MUX_MASK | ADS1X15_OS_MASK))
+          | m_scanModes[m_scanIndex] | ADS1X15_OS_SINGLE;
+     i2c->writeWordReg(ADS1X15_REG_POINTER_CONFIG, swapWord(config));
+
+     pthread_mutex_lock(&m_scanLock);
+     SCANRING &ring = m_scanRings[index];
+     unsigned int size = ring.samples.size();
+     ring.samples[ring.head].timestamp = (uint64_t)now.tv_sec * 1000000
+          + now.tv_nsec / 1000;
+     ring.samples[ring.head].value = value;
+     ring.head = (ring.head + 1) % size;
+     if(ring.count < size) ring.count++;
+     else m_scanOverruns++;
+     pthread_mutex_unlock(&m_scanLock);
+}
 
 //Private functions
 void
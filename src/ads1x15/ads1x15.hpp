@@ -26,8 +26,11 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <stdint.h>
+#include <pthread.h>
 
-namespace mraa {class I2c;}
+namespace mraa {class I2c; class Gpio;}
 
 /*=========================================================================
     I2C ADDRESS/BITS
@@ -208,6 +211,19 @@ namespace upm {
                SPS_DEFAULT     = 0x0080
             } ADSSAMPLERATE;
 
+            /**
+             * @struct ADSSCANSAMPLE
+             * @brief A sample collected by the scan engine.
+             *
+             * @var ADSSCANSAMPLE::timestamp Time the conversion ready
+             * signal was handled, in microseconds (CLOCK_MONOTONIC).
+             * @var ADSSCANSAMPLE::value The sample, in volts.
+             */
+            typedef struct ADSSCANSAMPLE {
+               uint64_t timestamp;
+               float    value;
+            } ADSSCANSAMPLE;
+
             /**
              * ADS1X15 constructor
              *
@@ -406,6 +422,63 @@ namespace upm {
              */
             void setThresh(ADSTHRESH reg = THRESH_DEFAULT , float value = 0.0);
 
+            /**
+             * Start scanning a list of inputs.  ALERT/RDY is
+             * configured as an active low conversion ready signal,
+             * which must be connected to a GPIO.  On each conversion,
+             * the result is read and stored with a timestamp in the
+             * ring buffer of its input, and a single shot conversion
+             * of the next input in the list is started.  The inputs
+             * are sampled round robin at somewhat less than the
+             * configured sample rate divided by the number of inputs,
+             * as each conversion waits for the previous result to be
+             * read.
+             *
+             * While scanning, the device should not be accessed
+             * otherwise, except through the scan methods.
+             *
+             * @param modes The inputs to scan, in order.
+             * @param gpio The GPIO pin ALERT/RDY is connected to.
+             * @param ringSize The number of samples kept per input.
+             * Once a ring is full, its oldest samples are overwritten.
+             */
+            void startScan(const std::vector<ADSMUXMODE> &modes, int gpio,
+                           unsigned int ringSize = 256);
+
+            /**
+             * Stop scanning, and return the device to single shot
+             * mode.  Samples remaining in the ring buffers can still
+             * be read.
+             */
+            void stopScan();
+
+            /**
+             * Returns the number of samples waiting for an input.
+             *
+             * @param index The position of the input in the list
+             * passed to startScan().
+             */
+            unsigned int scanAvailable(unsigned int index);
+
+            /**
+             * Removes and returns the oldest samples collected for an
+             * input.
+             *
+             * @param index The position of the input in the list
+             * passed to startScan().
+             * @param max The maximum number of samples to return, 0
+             * for all of them.
+             * @return The samples, oldest first.
+             */
+            std::vector<ADSSCANSAMPLE> readScan(unsigned int index,
+                                                unsigned int max = 0);
+
+            /**
+             * Returns the number of samples overwritten because a ring
+             * buffer was full, since the scan was started.
+             */
+            unsigned int getScanOverruns();
+
         protected:
             std::string m_name;
             float m_conversionDelay;
@@ -418,7 +491,26 @@ namespace upm {
             void getCurrentConfig();
             void updateConfigRegister(uint16_t update, bool read = false);
             uint16_t swapWord(uint16_t value);
+            float convertSample(uint16_t value);
 
             mraa::I2c* i2c;
 
+        private:
+            // scan engine state, the rings are protected by m_scanLock
+            typedef struct {
+               std::vector<ADSSCANSAMPLE> samples;
+               unsigned int head;
+               unsigned int count;
+            } SCANRING;
+
+            mraa::Gpio* m_scanGpio;
+            std::vector<ADSMUXMODE> m_scanModes;
+            std::vector<SCANRING> m_scanRings;
+            unsigned int m_scanIndex;
+            unsigned int m_scanOverruns;
+            pthread_mutex_t m_scanLock;
+
+            static void scanISR(void *ctx);
+            void scanHandler();
+
     };}
@@ -24,12 +24,19 @@ JAVA_JNI_LOADLIBRARY(javaupm_ads1x15)
 /* END Python syntax */
 
 /* BEGIN Common SWIG syntax ------------------------------------------------- */
+%include "std_vector.i"
+
 %{
 #include "ads1x15.hpp"
 #include "ads1015.hpp"
 #include "ads1115.hpp"
 %}
 %include "ads1x15.hpp"
+
+/* scan inputs for startScan(), and the samples returned by readScan() */
+%template(ADSMuxModeVector) std::vector<upm::ADS1X15::ADSMUXMODE>;
+%template(ADSScanSampleVector) std::vector<upm::ADS1X15::ADSSCANSAMPLE>;
+
 %include "ads1115.hpp"
 %include "ads1015.hpp"
 /* END Common SWIG syntax */
@@ -0,0 +1,431 @@
+/*
+ * Author: agent <agent@local>
+ * Copyright (c) 2026 agent.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include "aiocapture.h"
+
+static uint64_t _now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static void _sleep_until_us(uint64_t deadline)
+{
+    struct timespec ts;
+    ts.tv_sec = deadline / 1000000;
+    ts.tv_nsec = (deadline % 1000000) * 1000;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)
+           == EINTR)
+        ;
+}
+
+static void *_capture_thread(void *ctx)
+{
+    aiocapture_context dev = (aiocapture_context)ctx;
+    assert(dev != NULL);
+
+    uint32_t sequence = 0;
+    uint64_t deadline = _now_us() + dev->period_us;
+
+    while (__atomic_load_n(&dev->running, __ATOMIC_ACQUIRE))
+    {
+        // The fill buffer is only ever touched by this thread, the
+        // reader copies out of the other one under the lock.
+        uint16_t *block = dev->blocks[dev->fill];
+        unsigned int missed = 0;
+        uint64_t first = 0;
+        uint64_t last = 0;
+        double lateSum = 0.0;
+        double lateSumSq = 0.0;
+        uint64_t lateMax = 0;
+        unsigned int i;
+
+        for (i = 0; i < dev->block_size; i++)
+        {
+            _sleep_until_us(deadline);
+
+            if (!__atomic_load_n(&dev->running, __ATOMIC_ACQUIRE))
+                return NULL;
+
+            uint64_t now = _now_us();
+            int val = mraa_aio_read(dev->aio);
+
+            if (val < 0)
+            {
+                printf("%s: mraa_aio_read() failed.\n", __FUNCTION__);
+
+                pthread_mutex_lock(&dev->lock);
+                dev->failed = true;
+                pthread_cond_broadcast(&dev->cond);
+                pthread_mutex_unlock(&dev->lock);
+
+                return NULL;
+            }
+
+            block[i] = (uint16_t)val;
+
+            if (i == 0)
+                first = now;
+            last = now;
+
+            uint64_t late = (now > deadline) ? now - deadline : 0;
+            lateSum += (double)late;
+            lateSumSq += (double)late * (double)late;
+            if (late > lateMax)
+                lateMax = late;
+
+            deadline += dev->period_us;
+
+            // If we have fallen a full period or more behind, skip
+            // ahead rather than taking a burst of back to back
+            // samples, which would distort the waveform.
+            now = _now_us();
+            if (now >= deadline + dev->period_us)
+            {
+                uint64_t skipped = (now - deadline) / dev->period_us;
+                deadline += skipped * dev->period_us;
+                missed += skipped;
+            }
+        }
+
+        AIOCAPTURE_TIMING_T timing;
+        double mean = lateSum / dev->block_size;
+        double var = (lateSumSq / dev->block_size) - (mean * mean);
+
+        timing.timestamp = first;
+        timing.sequence = sequence++;
+        timing.count = dev->block_size;
+        timing.rate = (last > first)
+            ? (float)((double)(dev->block_size - 1) * 1000000.0
+                      / (double)(last - first))
+            : 0.0;
+        timing.jitter = (var > 0.0) ? (float)sqrt(var) : 0.0;
+        timing.max_late = (float)lateMax;
+        timing.missed = missed;
+
+        pthread_mutex_lock(&dev->lock);
+
+        if (dev->ready)
+            dev->overruns++;
+
+        dev->timing[dev->fill] = timing;
+        dev->ready = true;
+        dev->fill ^= 1;
+
+        pthread_cond_broadcast(&dev->cond);
+        pthread_mutex_unlock(&dev->lock);
+    }
+
+    return NULL;
+}
+
+aiocapture_context aiocapture_init_aio(mraa_aio_context aio)
+{
+    if (!aio)
+    {
+        printf("%s: aio context is NULL\n", __FUNCTION__);
+        return NULL;
+    }
+
+    aiocapture_context dev =
+        (aiocapture_context)malloc(sizeof(struct _aiocapture_context));
+
+    if (!dev)
+        return NULL;
+
+    // zero out context
+    memset((void *)dev, 0, sizeof(struct _aiocapture_context));
+
+    dev->aio = aio;
+
+    pthread_mutex_init(&dev->lock, NULL);
+
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&dev->cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
+    return dev;
+}
+
+aiocapture_context aiocapture_init(int pin)
+{
+    // make sure MRAA is initialized
+    int mraa_rv;
+    if ((mraa_rv = mraa_init()) != MRAA_SUCCESS)
+    {
+        printf("%s: mraa_init() failed (%d).\n", __FUNCTION__, mraa_rv);
+        return NULL;
+    }
+
+    mraa_aio_context aio = mraa_aio_init(pin);
+    if (!aio)
+    {
+        printf("%s: mraa_aio_init() failed.\n", __FUNCTION__);
+        return NULL;
+    }
+
+    aiocapture_context dev = aiocapture_init_aio(aio);
+    if (!dev)
+    {
+        mraa_aio_close(aio);
+        return NULL;
+    }
+
+    dev->owns_aio = true;
+
+    return dev;
+}
+
+void aiocapture_close(aiocapture_context dev)
+{
+    assert(dev != NULL);
+
+    aiocapture_stop(dev);
+
+    if (dev->owns_aio)
+        mraa_aio_close(dev->aio);
+
+    free(dev->blocks[0]);
+    free(dev->blocks[1]);
+
+    pthread_cond_destroy(&dev->cond);
+    pthread_mutex_destroy(&dev->lock);
+
+    free(dev);
+}
+
+upm_result_t aiocapture_start(const aiocapture_context dev,
+                              unsigned int period_us,
+                              unsigned int block_size)
+{
+    assert(dev != NULL);
+
+    if (__atomic_load_n(&dev->running, __ATOMIC_ACQUIRE))
+        aiocapture_stop(dev);
+
+    if (!period_us || !block_size)
+    {
+        printf("%s: period_us and block_size must be non-zero\n",
+               __FUNCTION__);
+        return UPM_ERROR_INVALID_PARAMETER;
+    }
+
+    if (block_size != dev->block_size)
+    {
+        int i;
+        for (i = 0; i < 2; i++)
+        {
+            free(dev->blocks[i]);
+            dev->blocks[i] = (uint16_t *)malloc(block_size
+                                                * sizeof(uint16_t));
+        }
+
+        if (!dev->blocks[0] || !dev->blocks[1])
+        {
+            printf("%s: block allocation failed\n", __FUNCTION__);
+            free(dev->blocks[0]);
+            free(dev->blocks[1]);
+            dev->blocks[0] = dev->blocks[1] = NULL;
+            dev->block_size = 0;
+            return UPM_ERROR_NO_RESOURCES;
+        }
+    }
+
+    dev->period_us = period_us;
+    dev->block_size = block_size;
+    dev->fill = 0;
+    dev->ready = false;
+    dev->failed = false;
+    dev->overruns = 0;
+
+    __atomic_store_n(&dev->running, true, __ATOMIC_RELEASE);
+
+    if (pthread_create(&dev->thread, NULL, _capture_thread, dev))
+    {
+        printf("%s: pthread_create() failed\n", __FUNCTION__);
+        __atomic_store_n(&dev->running, false, __ATOMIC_RELEASE);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+
+    return UPM_SUCCESS;
+}
+
+void aiocapture_stop(const aiocapture_context dev)
+{
+    assert(dev != NULL);
+
+    if (!__atomic_load_n(&dev->running, __ATOMIC_ACQUIRE))
+        return;
+
+    // wake up any reader so it notices we have stopped
+    pthread_mutex_lock(&dev->lock);
+    __atomic_store_n(&dev->running, false, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&dev->cond);
+    pthread_mutex_unlock(&dev->lock);
+
+    pthread_join(dev->thread, NULL);
+}
+
+upm_result_t aiocapture_get_block(const aiocapture_context dev,
+                                  uint16_t *samples,
+                                  AIOCAPTURE_TIMING_T *timing,
+                                  int timeout_ms)
+{
+    assert(dev != NULL);
+
+    struct timespec abstime;
+    if (timeout_ms > 0)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &abstime);
+        abstime.tv_sec += timeout_ms / 1000;
+        abstime.tv_nsec += (timeout_ms % 1000) * 1000000;
+        if (abstime.tv_nsec >= 1000000000)
+        {
+            abstime.tv_sec++;
+            abstime.tv_nsec -= 1000000000;
+        }
+    }
+
+    upm_result_t rv = UPM_SUCCESS;
+
+    pthread_mutex_lock(&dev->lock);
+
+    while (!dev->ready && !dev->failed
+           && __atomic_load_n(&dev->running, __ATOMIC_ACQUIRE))
+    {
+        if (timeout_ms == 0)
+            break;
+        else if (timeout_ms < 0)
+            pthread_cond_wait(&dev->cond, &dev->lock);
+        else if (pthread_cond_timedwait(&dev->cond, &dev->lock, &abstime)
+                 == ETIMEDOUT)
+            break;
+    }
+
+    if (dev->ready)
+    {
+        // the ready block is always the one not being filled
+        int idx = dev->fill ^ 1;
+
+        memcpy(samples, dev->blocks[idx],
+               dev->block_size * sizeof(uint16_t));
+        if (timing)
+            *timing = dev->timing[idx];
+
+        dev->ready = false;
+    }
+    else if (dev->failed)
+        rv = UPM_ERROR_OPERATION_FAILED;
+    else if (!__atomic_load_n(&dev->running, __ATOMIC_ACQUIRE))
+        rv = UPM_ERROR_NO_RESOURCES;
+    else
+        rv = UPM_ERROR_TIMED_OUT;
+
+    pthread_mutex_unlock(&dev->lock);
+
+    return rv;
+}
+
+upm_result_t aiocapture_capture(const aiocapture_context dev,
+                                unsigned int period_us,
+                                uint16_t *samples, unsigned int count,
+                                AIOCAPTURE_TIMING_T *timing)
+{
+    assert(dev != NULL);
+
+    upm_result_t rv;
+    if ((rv = aiocapture_start(dev, period_us, count)))
+        return rv;
+
+    rv = aiocapture_get_block(dev, samples, timing, -1);
+
+    aiocapture_stop(dev);
+
+    return rv;
+}
+
+uint32_t aiocapture_get_overruns(const aiocapture_context dev)
+{
+    assert(dev != NULL);
+
+    pthread_mutex_lock(&dev->lock);
+    uint32_t rv = dev->overruns;
+    pthread_mutex_unlock(&dev->lock);
+
+    return rv;
+}
+
+void aiocapture_compute_stats(const uint16_t *samples, unsigned int count,
+                              AIOCAPTURE_STATS_T *stats)
+{
+    assert(stats != NULL);
+
+    memset((void *)stats, 0, sizeof(AIOCAPTURE_STATS_T));
+
+    if (!samples || !count)
+        return;
+
+    // Keep these loops free of branches so the compiler can
+    // vectorize them.  A 16 bit sample squared fits in 32 bits, so
+    // the 64 bit sums cannot overflow for any realistic block size.
+    uint64_t sum = 0;
+    uint64_t sumSq = 0;
+    uint16_t minVal = samples[0];
+    uint16_t maxVal = samples[0];
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+    {
+        uint32_t s = samples[i];
+        sum += s;
+        sumSq += s * s;
+        minVal = (samples[i] < minVal) ? samples[i] : minVal;
+        maxVal = (samples[i] > maxVal) ? samples[i] : maxVal;
+    }
+
+    double mean = (double)sum / count;
+    double meanSq = (double)sumSq / count;
+    double var = meanSq - (mean * mean);
+
+    stats->count = count;
+    stats->mean = (float)mean;
+    stats->mean_square = (float)meanSq;
+    stats->rms = (float)sqrt(meanSq);
+    stats->ac_rms = (var > 0.0) ? (float)sqrt(var) : 0.0;
+    stats->min = minVal;
+    stats->max = maxVal;
+}
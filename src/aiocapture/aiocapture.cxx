@@ -0,0 +1,114 @@
+/*
+ * Author: agent <agent@local>
+ * Copyright (c) 2026 agent.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <string.h>
+
+#include "aiocapture.hpp"
+
+using namespace upm;
+using namespace std;
+
+AIOCapture::AIOCapture(int pin) :
+    m_aiocapture(aiocapture_init(pin))
+{
+    if (!m_aiocapture)
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": aiocapture_init() failed");
+
+    memset(&m_timing, 0, sizeof(m_timing));
+}
+
+AIOCapture::~AIOCapture()
+{
+    aiocapture_close(m_aiocapture);
+}
+
+void AIOCapture::start(unsigned int periodUs, unsigned int blockSize)
+{
+    if (!periodUs || !blockSize)
+        throw std::invalid_argument(string(__FUNCTION__)
+                                    + ": periodUs and blockSize must be "
+                                    + "non-zero");
+
+    if (aiocapture_start(m_aiocapture, periodUs, blockSize))
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": aiocapture_start() failed");
+}
+
+void AIOCapture::stop()
+{
+    aiocapture_stop(m_aiocapture);
+}
+
+std::vector<uint16_t> AIOCapture::getBlock(int timeoutMs)
+{
+    std::vector<uint16_t> v(m_aiocapture->block_size);
+
+    upm_result_t rv = aiocapture_get_block(m_aiocapture, v.data(),
+                                           &m_timing, timeoutMs);
+
+    if (rv == UPM_ERROR_TIMED_OUT)
+        return std::vector<uint16_t>();
+    else if (rv)
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": aiocapture_get_block() failed");
+
+    return v;
+}
+
+std::vector<uint16_t> AIOCapture::capture(unsigned int periodUs,
+                                          unsigned int count)
+{
+    if (!periodUs || !count)
+        throw std::invalid_argument(string(__FUNCTION__)
+                                    + ": periodUs and count must be "
+                                    + "non-zero");
+
+    std::vector<uint16_t> v(count);
+
+    if (aiocapture_capture(m_aiocapture, periodUs, v.data(), count,
+                           &m_timing))
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": aiocapture_capture() failed");
+
+    return v;
+}
+
+unsigned int AIOCapture::getOverruns()
+{
+    return aiocapture_get_overruns(m_aiocapture);
+}
+
+AIOCAPTURE_STATS_T AIOCapture::computeStats(const std::vector<uint16_t>
+                                            &samples)
+{
+    AIOCAPTURE_STATS_T stats;
+
+    aiocapture_compute_stats(samples.data(), samples.size(), &stats);
+
+    return stats;
+}
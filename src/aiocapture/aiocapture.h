@@ -0,0 +1,225 @@
+/*
+ * Author: agent <agent@local>
+ * Copyright (c) 2026 agent.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <upm.h>
+
+#include <mraa/aio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * @file aiocapture.h
+     * @library aiocapture
+     * @brief C API for paced analog (AIO) waveform capture
+     *
+     * @include aiocapture.c
+     */
+
+    /**
+     * Timing of a captured block.  All times are in microseconds.
+     */
+    typedef struct {
+        // CLOCK_MONOTONIC time at which the first sample was taken
+        uint64_t timestamp;
+        // number of blocks completed since capture was started, the
+        // first block is 0
+        uint32_t sequence;
+        // number of samples in the block
+        unsigned int count;
+        // sample rate actually achieved over the block, in Hz
+        float rate;
+        // standard deviation of the sample times from their deadlines
+        float jitter;
+        // worst lateness of a single sample relative to its deadline
+        float max_late;
+        // number of sample periods skipped because the capture thread
+        // fell a full period or more behind
+        unsigned int missed;
+    } AIOCAPTURE_TIMING_T;
+
+    /**
+     * Statistics of a block of samples, in raw ADC counts.
+     */
+    typedef struct {
+        unsigned int count;
+        float mean;
+        // mean of the squared samples
+        float mean_square;
+        // root mean square, including any DC component
+        float rms;
+        // root mean square with the mean removed (standard deviation)
+        float ac_rms;
+        uint16_t min;
+        uint16_t max;
+    } AIOCAPTURE_STATS_T;
+
+    /**
+     * Device context
+     */
+    typedef struct _aiocapture_context {
+        mraa_aio_context        aio;
+        // true if we opened the aio context and must close it
+        bool                    owns_aio;
+
+        pthread_t               thread;
+        bool                    running;
+        unsigned int            period_us;
+        unsigned int            block_size;
+
+        // The capture thread fills blocks[fill], and when it is full,
+        // publishes it as the ready block and switches to the other.
+        uint16_t                *blocks[2];
+        AIOCAPTURE_TIMING_T     timing[2];
+        int                     fill;
+        bool                    ready;
+        // set if an aio read failed, which stops the capture
+        bool                    failed;
+
+        // ready blocks that were replaced before being read
+        uint32_t                overruns;
+
+        pthread_mutex_t         lock;
+        pthread_cond_t          cond;
+    } *aiocapture_context;
+
+    /**
+     * Initialize a capture engine on an analog pin.
+     *
+     * @param pin The analog pin to capture.
+     * @return The device context, or NULL if an error occurred.
+     */
+    aiocapture_context aiocapture_init(int pin);
+
+    /**
+     * Initialize a capture engine on an already open AIO context.
+     * This is intended for drivers that own their AIO context.  The
+     * context is not closed by aiocapture_close().
+     *
+     * @param aio An initialized MRAA AIO context.
+     * @return The device context, or NULL if an error occurred.
+     */
+    aiocapture_context aiocapture_init_aio(mraa_aio_context aio);
+
+    /**
+     * Stop any capture in progress and free the context.
+     *
+     * @param dev The device context.
+     */
+    void aiocapture_close(aiocapture_context dev);
+
+    /**
+     * Start capturing.  A dedicated thread reads the pin once per
+     * period, sleeping until absolute deadlines (clock_nanosleep()
+     * with TIMER_ABSTIME) so that scheduling delays do not accumulate
+     * into the sample rate.  Samples are collected into blocks of
+     * block_size samples, which are retrieved with
+     * aiocapture_get_block() while the thread fills the other
+     * buffer.
+     *
+     * @param dev The device context.
+     * @param period_us The sample period in microseconds.
+     * @param block_size The number of samples per block.
+     * @return UPM result.
+     */
+    upm_result_t aiocapture_start(const aiocapture_context dev,
+                                  unsigned int period_us,
+                                  unsigned int block_size);
+
+    /**
+     * Stop capturing.
+     *
+     * @param dev The device context.
+     */
+    void aiocapture_stop(const aiocapture_context dev);
+
+    /**
+     * Retrieve the most recently completed block.  Only one thread
+     * should be retrieving blocks at a time.
+     *
+     * @param dev The device context.
+     * @param samples An array of at least block_size elements in
+     * which the samples will be stored.
+     * @param timing A pointer to an AIOCAPTURE_TIMING_T in which the
+     * block timing will be stored, or NULL.
+     * @param timeout_ms The maximum number of milliseconds to wait
+     * for a block.  0 means don't wait, a negative value means wait
+     * forever (or until the capture is stopped).
+     * @return UPM_SUCCESS if a block was returned, UPM_ERROR_TIMED_OUT
+     * if none was available, UPM_ERROR_OPERATION_FAILED if an AIO read
+     * failed, or UPM_ERROR_NO_RESOURCES if capture is not running.
+     */
+    upm_result_t aiocapture_get_block(const aiocapture_context dev,
+                                      uint16_t *samples,
+                                      AIOCAPTURE_TIMING_T *timing,
+                                      int timeout_ms);
+
+    /**
+     * Capture a single block of samples.  This starts a capture,
+     * waits for the first block, and stops the capture again.
+     *
+     * @param dev The device context.
+     * @param period_us The sample period in microseconds.
+     * @param samples An array in which the samples will be stored.
+     * @param count The number of samples to capture.
+     * @param timing A pointer to an AIOCAPTURE_TIMING_T in which the
+     * block timing will be stored, or NULL.
+     * @return UPM result.
+     */
+    upm_result_t aiocapture_capture(const aiocapture_context dev,
+                                    unsigned int period_us,
+                                    uint16_t *samples, unsigned int count,
+                                    AIOCAPTURE_TIMING_T *timing);
+
+    /**
+     * Return the number of completed blocks that were replaced by a
+     * newer block before they were retrieved.  This is reset by
+     * aiocapture_start().
+     *
+     * @param dev The device context.
+     * @return The number of blocks lost.
+     */
+    uint32_t aiocapture_get_overruns(const aiocapture_context dev);
+
+    /**
+     * Compute the mean, mean square, RMS, AC RMS, minimum and maximum
+     * of a block of samples.
+     *
+     * @param samples An array of samples.
+     * @param count The number of samples.
+     * @param stats A pointer to an AIOCAPTURE_STATS_T in which the
+     * results will be stored.
+     */
+    void aiocapture_compute_stats(const uint16_t *samples,
+                                  unsigned int count,
+                                  AIOCAPTURE_STATS_T *stats);
+
+#ifdef __cplusplus
+}
+#endif
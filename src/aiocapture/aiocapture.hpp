@@ -0,0 +1,202 @@
+/*
+ * Author: agent <agent@local>
+ * Copyright (c) 2026 agent.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "aiocapture.h"
+
+namespace upm {
+
+  /**
+   * @brief Paced Analog Waveform Capture
+   * @defgroup aiocapture libupm-aiocapture
+   * @ingroup analog
+   */
+
+  /**
+   * @library aiocapture
+   * @comname Paced analog (AIO) waveform capture engine
+   * @con analog
+   *
+   * @brief API for paced analog waveform capture
+   *
+   * This module samples an analog pin from a dedicated thread at a
+   * fixed rate.  The thread sleeps until absolute deadlines, so
+   * time spent reading the pin and scheduling delays do not
+   * stretch the sample period the way a read followed by usleep()
+   * does.  Samples are collected into double buffered blocks: the
+   * thread fills one while the application processes the other.
+   *
+   * Each block is accompanied by the rate that was actually
+   * achieved and the timing jitter, so that callers can judge
+   * whether the capture is good enough for waveform analysis such
+   * as RMS measurement.
+   */
+
+  class AIOCapture {
+  public:
+
+    /**
+     * AIOCapture constructor
+     *
+     * @param pin The analog pin to capture.
+     */
+    AIOCapture(int pin);
+
+    /**
+     * AIOCapture Destructor
+     */
+    ~AIOCapture();
+
+    /**
+     * Start capturing in the background.
+     *
+     * @param periodUs The sample period in microseconds.
+     * @param blockSize The number of samples per block.
+     */
+    void start(unsigned int periodUs, unsigned int blockSize);
+
+    /**
+     * Stop capturing.
+     */
+    void stop();
+
+    /**
+     * Retrieve the most recently completed block.  The timing of
+     * the block can then be queried with getRate(), getJitter() and
+     * friends.
+     *
+     * @param timeoutMs The maximum number of milliseconds to wait.
+     * 0 means don't wait, a negative value means wait until a
+     * block is available.  Default -1.
+     * @return The samples, or an empty vector if no block became
+     * available within the timeout.
+     */
+    std::vector<uint16_t> getBlock(int timeoutMs=-1);
+
+    /**
+     * Capture a single block of samples and return it.  Any
+     * background capture in progress is stopped.
+     *
+     * @param periodUs The sample period in microseconds.
+     * @param count The number of samples to capture.
+     * @return The samples.
+     */
+    std::vector<uint16_t> capture(unsigned int periodUs,
+                                  unsigned int count);
+
+    /**
+     * Return the number of blocks that were replaced by a newer
+     * block before they were retrieved.
+     *
+     * @return The number of blocks lost.
+     */
+    unsigned int getOverruns();
+
+    /**
+     * Return the CLOCK_MONOTONIC time, in microseconds, of the first
+     * sample of the last block retrieved.
+     *
+     * @return The timestamp in microseconds.
+     */
+    uint64_t getTimestamp()
+    {
+      return m_timing.timestamp;
+    };
+
+    /**
+     * Return the sequence number of the last block retrieved.
+     *
+     * @return The block sequence number.
+     */
+    unsigned int getSequence()
+    {
+      return m_timing.sequence;
+    };
+
+    /**
+     * Return the sample rate achieved over the last block retrieved.
+     *
+     * @return The sample rate in Hz.
+     */
+    float getRate()
+    {
+      return m_timing.rate;
+    };
+
+    /**
+     * Return the standard deviation of the sample times of the last
+     * block retrieved from their deadlines.
+     *
+     * @return The jitter in microseconds.
+     */
+    float getJitter()
+    {
+      return m_timing.jitter;
+    };
+
+    /**
+     * Return the worst lateness of a sample in the last block
+     * retrieved.
+     *
+     * @return The lateness in microseconds.
+     */
+    float getMaxLateness()
+    {
+      return m_timing.max_late;
+    };
+
+    /**
+     * Return the number of sample periods that were skipped in the
+     * last block retrieved because the capture thread fell behind.
+     *
+     * @return The number of missed samples.
+     */
+    unsigned int getMissed()
+    {
+      return m_timing.missed;
+    };
+
+    /**
+     * Compute the mean, mean square, RMS, AC RMS, minimum and
+     * maximum of a block of samples.
+     *
+     * @param samples The samples.
+     * @return The statistics, in raw ADC counts.
+     */
+    static AIOCAPTURE_STATS_T computeStats(const std::vector<uint16_t>
+                                           &samples);
+
+  protected:
+    aiocapture_context m_aiocapture;
+    AIOCAPTURE_TIMING_T m_timing;
+
+  private:
+    /* Disable implicit copy and assignment operators */
+    AIOCapture(const AIOCapture&) = delete;
+    AIOCapture &operator=(const AIOCapture&) = delete;
+  };
+}
@@ -0,0 +1,22 @@
+%include "../common_top.i"
+
+/* BEGIN Java syntax  ------------------------------------------------------- */
+#ifdef SWIGJAVA
+JAVA_JNI_LOADLIBRARY(javaupm_aiocapture)
+#endif
+/* END Java syntax */
+
+/* BEGIN Common SWIG syntax ------------------------------------------------- */
+%include "../upm_vectortypes.i"
+
+namespace std {
+  %template(uint16Vector) vector<uint16_t>;
+}
+
+%{
+#include "aiocapture.h"
+#include "aiocapture.hpp"
+%}
+%include "aiocapture.h"
+%include "aiocapture.hpp"
+/* END Common SWIG syntax */
@@ -37,10 +37,12 @@ APDS9930::APDS9930(int device)
                                     ": mraa_iio_init() failed, invalid device?");
         return;
     }
+    m_capture = new IIOCapture(device);
 }
 
 APDS9930::~APDS9930()
 {
+    delete m_capture;
     if (m_iio)
         mraa_iio_close(m_iio);
 }
@@ -49,7 +51,7 @@ int
 APDS9930::getAmbient()
 {
     int iio_value = 0;
-    mraa_iio_read_int(m_iio, "in_illuminance_input", &iio_value);
+    m_capture->readAttribute("in_illuminance_input", &iio_value);
     return iio_value;
 }
 
@@ -57,7 +59,7 @@ int
 APDS9930::getProximity()
 {
     int iio_value = 0;
-    mraa_iio_read_int(m_iio, "in_proximity_raw", &iio_value);
+    m_capture->readAttribute("in_proximity_raw", &iio_value);
     return iio_value;
 }
 
@@ -26,6 +26,8 @@
 #include <string>
 #include <mraa/iio.h>
 
+#include "iiocapture.hpp"
+
 namespace upm
 {
 /**
@@ -89,5 +91,6 @@ class APDS9930
 
   private:
     mraa_iio_context m_iio;
+    IIOCapture* m_capture;
 };
 }
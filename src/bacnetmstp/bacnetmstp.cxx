@@ -34,6 +34,9 @@
 #include "client.h"
 #include "txbuf.h"
 #include "mstpdef.h"
+#include "rpm.h"
+#include "dcc.h"
+#include "bacdcode.h"
 
 using namespace upm;
 using namespace std;
@@ -41,6 +44,67 @@ using namespace std;
 // our singleton instance
 BACNETMSTP* BACNETMSTP::m_instance = 0;
 
+// Worst case encoded sizes used to pack readPropertyMultiple requests
+// so that neither the request nor the reply needs to be segmented.
+
+// ReadAccessSpecification: object identifier + opening tag
+static const unsigned RPM_OBJECT_SPEC_BYTES = 6;
+// ... and its closing tag
+static const unsigned RPM_OBJECT_END_BYTES = 1;
+// property identifier + optional array index
+static const unsigned RPM_PROPERTY_REF_BYTES = 10;
+// complex ack header: PDU type, invoke ID, service choice
+static const unsigned RPM_ACK_HEADER_BYTES = 3;
+// ReadAccessResult: object identifier + opening and closing tags
+static const unsigned RPM_OBJECT_RESULT_BYTES = 7;
+// a scalar value (tag + 4 bytes) or an access error (2 enums)
+static const unsigned RPM_SCALAR_BYTES = 6;
+// character strings are typically limited to 63 characters
+static const unsigned RPM_STRING_BYTES = 66;
+
+// estimate the size of the reply to a single property reference
+static unsigned rpmReplyEstimate(const BACNETMSTP::RPM_ENTRY_T& entry)
+{
+  // the property reference is echoed back, and the value (or access
+  // error) is enclosed in an opening and closing tag.
+  unsigned bytes = RPM_PROPERTY_REF_BYTES + 2;
+
+  switch (entry.objProperty)
+    {
+    case PROP_STATE_TEXT:
+    case PROP_OBJECT_LIST:
+    case PROP_PRIORITY_ARRAY:
+      // whole arrays can be any size, so we make sure they are sent
+      // in a request of their own.  Element 0 is the array size.
+      if (entry.arrayIndex == BACNET_ARRAY_ALL)
+        return MAX_APDU;
+      else if (entry.arrayIndex == 0 ||
+               entry.objProperty == PROP_PRIORITY_ARRAY)
+        bytes += RPM_SCALAR_BYTES;
+      else
+        bytes += RPM_STRING_BYTES;
+      break;
+
+    case PROP_OBJECT_NAME:
+    case PROP_DESCRIPTION:
+    case PROP_LOCATION:
+    case PROP_ACTIVE_TEXT:
+    case PROP_INACTIVE_TEXT:
+    case PROP_VENDOR_NAME:
+    case PROP_MODEL_NAME:
+    case PROP_FIRMWARE_REVISION:
+    case PROP_APPLICATION_SOFTWARE_VERSION:
+      bytes += RPM_STRING_BYTES;
+      break;
+
+    default:
+      bytes += RPM_SCALAR_BYTES;
+      break;
+    }
+
+  return bytes;
+}
+
 BACNETMSTP::BACNETMSTP()
 {
   // set defaults here
@@ -62,6 +126,9 @@ BACNETMSTP::BACNETMSTP()
   m_targetAddress = {0};
   m_invokeID = 0;
   m_errorDetected = false;
+  m_rpmPending.clear();
+
+  m_command.cmd = BACCMD_NONE;
 
   setDebug(false);
 }
@@ -103,8 +170,7 @@ void BACNETMSTP::handlerError(BACNET_ADDRESS* src,
   if (instance()->m_debugging)
     cerr << __FUNCTION__ << ": entered" << endl;
 
-  if (address_match(&(instance()->m_targetAddress), src) &&
-      (invoke_id == instance()->m_invokeID))
+  if (instance()->isPendingTransaction(src, invoke_id))
     {
       instance()->m_errorType = BACERR_TYPE_ERROR;
       instance()->m_errorClass = error_class;
@@ -127,8 +193,7 @@ void BACNETMSTP::handlerAbort(BACNET_ADDRESS* src,
   if (instance()->m_debugging)
     cerr << __FUNCTION__ << ": entered" << endl;
 
-  if (address_match(&(instance()->m_targetAddress), src) &&
-      (invoke_id == instance()->m_invokeID))
+  if (instance()->isPendingTransaction(src, invoke_id))
     {
       instance()->m_errorType = BACERR_TYPE_ABORT;
       instance()->m_abortReason = abort_reason;
@@ -146,8 +211,7 @@ void BACNETMSTP::handlerReject(BACNET_ADDRESS* src,
   if (instance()->m_debugging)
     cerr << __FUNCTION__ << ": entered" << endl;
 
-  if (address_match(&(instance()->m_targetAddress), src) &&
-      (invoke_id == instance()->m_invokeID))
+  if (instance()->isPendingTransaction(src, invoke_id))
     {
       instance()->m_errorType = BACERR_TYPE_REJECT;
       instance()->m_rejectReason = reject_reason;
@@ -228,6 +292,195 @@ void BACNETMSTP::handlerReadPropertyAck(uint8_t* service_request,
          << " data elements." << endl;
 }
 
+void BACNETMSTP::handlerReadPropertyMultipleAck(uint8_t* service_request,
+                                                uint16_t service_len,
+                                                BACNET_ADDRESS* src,
+                                                BACNET_CONFIRMED_SERVICE_ACK_DATA* service_data)
+{
+  if (instance()->m_command.cmd != BACCMD_READ_PROPERTY_MULTIPLE ||
+      !address_match(&(instance()->m_targetAddress), src))
+    return;
+
+  // find the request this ack belongs to
+  for (size_t i=0; i<instance()->m_rpmPending.size(); i++)
+    {
+      RPM_PENDING_T& pending = instance()->m_rpmPending[i];
+
+      if (pending.invokeID == service_data->invoke_id)
+        {
+          if (instance()->m_debugging)
+            cerr << __FUNCTION__ << ": got readPropMultiple ack, invokeID = "
+                 << (int)pending.invokeID << endl;
+
+          instance()->decodeReadPropertyMultipleAck(service_request,
+                                                    service_len,
+                                                    pending.first,
+                                                    pending.count);
+          break;
+        }
+    }
+}
+
+void BACNETMSTP::decodeReadPropertyMultipleAck(uint8_t* apdu, int apdu_len,
+                                               int first, int count)
+{
+  RPM_ENTRY_T* entries = m_command.readPropMultipleArgs.entries;
+  int last = first + count;
+
+  // the results come back in the same order the entries were
+  // requested in, so we just walk forward through our part of the
+  // table matching them up.
+  int next = first;
+
+  while (apdu_len > 0)
+    {
+      BACNET_OBJECT_TYPE objType;
+      uint32_t objInstance;
+
+      int len = rpm_ack_decode_object_id(apdu, apdu_len,
+                                         &objType, &objInstance);
+      if (len <= 0)
+        break;
+
+      apdu += len;
+      apdu_len -= len;
+
+      while (apdu_len > 0)
+        {
+          BACNET_PROPERTY_ID objProperty;
+          uint32_t arrayIndex;
+
+          len = rpm_ack_decode_object_property(apdu, apdu_len,
+                                               &objProperty, &arrayIndex);
+          if (len <= 0)
+            {
+              cerr << __FUNCTION__ << ": decode property failed" << endl;
+              return;
+            }
+
+          apdu += len;
+          apdu_len -= len;
+
+          RPM_ENTRY_T* entry = 0;
+          for (int i=next; i<last; i++)
+            {
+              if (entries[i].objType == objType &&
+                  entries[i].objInstance == objInstance &&
+                  entries[i].objProperty == objProperty &&
+                  entries[i].arrayIndex == arrayIndex)
+                {
+                  entry = &entries[i];
+                  next = i + 1;
+                  break;
+                }
+            }
+
+          if (apdu_len > 0 && decode_is_opening_tag_number(apdu, 4))
+            {
+              // propertyValue
+              apdu++;
+              apdu_len--;
+
+              bool firstValue = true;
+              while (apdu_len > 0 && !decode_is_closing_tag_number(apdu, 4))
+                {
+                  BACNET_APPLICATION_DATA_VALUE value;
+                  memset((void *)&value, 0, sizeof(value));
+
+                  if (IS_CONTEXT_SPECIFIC(*apdu))
+                    len = bacapp_decode_context_data(apdu, apdu_len, &value,
+                                                     objProperty);
+                  else
+                    len = bacapp_decode_application_data(apdu, apdu_len,
+                                                         &value);
+
+                  if (len <= 0)
+                    {
+                      cerr << __FUNCTION__ << ": decode app data failed"
+                           << endl;
+                      return;
+                    }
+
+                  // we only keep the first element of an array
+                  if (entry && firstValue)
+                    {
+                      entry->value = value;
+                      entry->value.next = 0;
+                      entry->valid = true;
+                    }
+
+                  firstValue = false;
+                  apdu += len;
+                  apdu_len -= len;
+                }
+
+              // skip the closing tag
+              if (apdu_len > 0)
+                {
+                  apdu++;
+                  apdu_len--;
+                }
+            }
+          else if (apdu_len > 0 && decode_is_opening_tag_number(apdu, 5))
+            {
+              // propertyAccessError - an error class and code
+              apdu++;
+              apdu_len--;
+
+              uint32_t errorValues[2] = {0, 0};
+              for (int i=0; i<2; i++)
+                {
+                  uint8_t tagNumber = 0;
+                  uint32_t lenValue = 0;
+
+                  len = decode_tag_number_and_value(apdu, &tagNumber,
+                                                    &lenValue);
+                  apdu += len;
+                  apdu_len -= len;
+
+                  len = decode_enumerated(apdu, lenValue, &errorValues[i]);
+                  apdu += len;
+                  apdu_len -= len;
+                }
+
+              if (entry)
+                {
+                  entry->valid = false;
+                  entry->errorClass = (BACNET_ERROR_CLASS)errorValues[0];
+                  entry->errorCode = (BACNET_ERROR_CODE)errorValues[1];
+                }
+
+              if (m_debugging)
+                cerr << __FUNCTION__ << ": property "
+                     << bactext_property_name(objProperty) << ": "
+                     << bactext_error_class_name((int)errorValues[0])
+                     << ": " << bactext_error_code_name((int)errorValues[1])
+                     << endl;
+
+              // skip the closing tag
+              if (apdu_len > 0 && decode_is_closing_tag_number(apdu, 5))
+                {
+                  apdu++;
+                  apdu_len--;
+                }
+            }
+          else
+            {
+              cerr << __FUNCTION__ << ": malformed result" << endl;
+              return;
+            }
+
+          // end of the results for this object?
+          if (apdu_len > 0 && decode_is_closing_tag_number(apdu, 1))
+            {
+              apdu++;
+              apdu_len--;
+              break;
+            }
+        }
+    }
+}
+
 void BACNETMSTP::handlerWritePropertyAck(BACNET_ADDRESS* src,
                                          uint8_t invoke_id)
 {
@@ -267,12 +520,17 @@ void BACNETMSTP::initServiceHandlers()
   apdu_set_confirmed_ack_handler(SERVICE_CONFIRMED_READ_PROPERTY,
                                  handlerReadPropertyAck);
 
+  // handle the data coming back from confirmed readPropMultiple requests
+  apdu_set_confirmed_ack_handler(SERVICE_CONFIRMED_READ_PROP_MULTIPLE,
+                                 handlerReadPropertyMultipleAck);
+
   // handle the simple ack for confirmed writeProp requests
   apdu_set_confirmed_simple_ack_handler(SERVICE_CONFIRMED_WRITE_PROPERTY,
                                         handlerWritePropertyAck);
 
   // handle any errors coming back
   apdu_set_error_handler(SERVICE_CONFIRMED_READ_PROPERTY, handlerError);
+  apdu_set_error_handler(SERVICE_CONFIRMED_READ_PROP_MULTIPLE, handlerError);
   apdu_set_abort_handler(handlerAbort);
   apdu_set_reject_handler(handlerReject);
 }
@@ -399,6 +657,13 @@ bool BACNETMSTP::dispatchRequest()
       targetDeviceInstanceID = m_command.writePropArgs.targetDeviceInstanceID;
       break;
 
+    case BACCMD_READ_PROPERTY_MULTIPLE:
+      targetDeviceInstanceID =
+        m_command.readPropMultipleArgs.targetDeviceInstanceID;
+      m_command.readPropMultipleArgs.nextEntry = 0;
+      m_rpmPending.clear();
+      break;
+
     case BACCMD_NONE:
       {
         m_errorType = BACERR_TYPE_UPM;
@@ -470,8 +735,15 @@ bool BACNETMSTP::dispatchRequest()
 
       if (found)
         {
+          // readPropertyMultiple may need several requests, which
+          // are handled separately.
+          if (m_command.cmd == BACCMD_READ_PROPERTY_MULTIPLE)
+            {
+              if (serviceReadPropertyMultiple(max_apdu))
+                break;
+            }
           // address is bound, and we have not sent our request yet.  Make it so.
-          if (m_invokeID == 0)
+          else if (m_invokeID == 0)
             {
               switch (m_command.cmd)
                 {
@@ -572,9 +844,184 @@ bool BACNETMSTP::dispatchRequest()
       last_seconds = current_seconds;
     }
 
+  // on error, release any readPropertyMultiple requests still in flight
+  for (size_t i=0; i<m_rpmPending.size(); i++)
+    tsm_free_invoke_id(m_rpmPending[i].invokeID);
+  m_rpmPending.clear();
+
   return m_errorDetected;
 }
 
+bool BACNETMSTP::isPendingTransaction(BACNET_ADDRESS* src, uint8_t invoke_id)
+{
+  if (!address_match(&m_targetAddress, src))
+    return false;
+
+  if (m_command.cmd == BACCMD_READ_PROPERTY_MULTIPLE)
+    {
+      for (size_t i=0; i<m_rpmPending.size(); i++)
+        if (m_rpmPending[i].invokeID == invoke_id)
+          return true;
+
+      return false;
+    }
+
+  return (invoke_id == m_invokeID);
+}
+
+bool BACNETMSTP::serviceReadPropertyMultiple(unsigned max_apdu)
+{
+  READ_PROPERTY_MULTIPLE_ARGS_T& args = m_command.readPropMultipleArgs;
+
+  // reap completed transactions.  The ack handler has already stored
+  // the results by the time the TSM frees the invoke ID.
+  vector<RPM_PENDING_T>::iterator it = m_rpmPending.begin();
+  while (it != m_rpmPending.end())
+    {
+      if (tsm_invoke_id_free(it->invokeID))
+        {
+          if (m_debugging)
+            cerr << __FUNCTION__ << ": Success, invokeID = "
+                 << (int)it->invokeID << endl;
+
+          it = m_rpmPending.erase(it);
+        }
+      else if (tsm_invoke_id_failed(it->invokeID))
+        {
+          // transaction state machine failed, most likely timeout
+          tsm_free_invoke_id(it->invokeID);
+          m_rpmPending.erase(it);
+
+          m_errorType = BACERR_TYPE_UPM;
+          m_upmErrorString = string(__FUNCTION__) +
+            ": TSM Timed Out.";
+
+          if (m_debugging)
+            cerr << m_upmErrorString << endl;
+
+          m_errorDetected = true;
+
+          return true;
+        }
+      else
+        it++;
+    }
+
+  // We are allowed to send up to maxInfoFrames frames each time we
+  // hold the token, so we keep that many requests outstanding.
+  size_t window = (m_maxInfoFrames > 1) ? m_maxInfoFrames : 1;
+
+  while (args.nextEntry < args.numEntries && m_rpmPending.size() < window)
+    {
+      int count = 0;
+      uint8_t invokeID = sendReadPropertyMultiple(max_apdu, args.nextEntry,
+                                                  &count);
+
+      // no free invoke IDs, try again later
+      if (!invokeID)
+        break;
+
+      RPM_PENDING_T pending = { invokeID, args.nextEntry, count };
+      m_rpmPending.push_back(pending);
+
+      args.nextEntry += count;
+    }
+
+  return (args.nextEntry >= args.numEntries && m_rpmPending.empty());
+}
+
+uint8_t BACNETMSTP::sendReadPropertyMultiple(unsigned max_apdu, int first,
+                                             int* count)
+{
+  RPM_ENTRY_T* entries = m_command.readPropMultipleArgs.entries;
+  int numEntries = m_command.readPropMultipleArgs.numEntries;
+
+  *count = 0;
+
+  if (!dcc_communication_enabled())
+    return 0;
+
+  uint8_t invokeID = tsm_next_free_invokeID();
+  if (!invokeID)
+    return 0;
+
+  // both our request and the reply must fit in an unsegmented APDU
+  unsigned budget = (max_apdu < MAX_APDU) ? max_apdu : MAX_APDU;
+
+  BACNET_ADDRESS myAddress;
+  BACNET_NPDU_DATA npduData;
+  uint8_t *pdu = Handler_Transmit_Buffer;
+
+  datalink_get_my_address(&myAddress);
+  npdu_encode_npdu_data(&npduData, true, MESSAGE_PRIORITY_NORMAL);
+  int pduLen = npdu_encode_pdu(&pdu[0], &m_targetAddress, &myAddress,
+                               &npduData);
+
+  uint8_t *apdu = &pdu[pduLen];
+  unsigned apduLen = rpm_encode_apdu_init(apdu, invokeID);
+  unsigned replyLen = RPM_ACK_HEADER_BYTES;
+
+  int i;
+  for (i=first; i<numEntries; i++)
+    {
+      // consecutive entries for the same object share one
+      // ReadAccessSpecification
+      bool newObject = (i == first ||
+                        entries[i].objType != entries[i-1].objType ||
+                        entries[i].objInstance != entries[i-1].objInstance);
+
+      unsigned requestBytes = RPM_PROPERTY_REF_BYTES;
+      unsigned replyBytes = rpmReplyEstimate(entries[i]);
+
+      if (newObject)
+        {
+          requestBytes += RPM_OBJECT_SPEC_BYTES + RPM_OBJECT_END_BYTES;
+          replyBytes += RPM_OBJECT_RESULT_BYTES;
+        }
+
+      // we always send at least one entry.  If its reply turns out
+      // to be too big, the device will tell us.
+      if (i > first && (apduLen + requestBytes > budget ||
+                        replyLen + replyBytes > budget))
+        break;
+
+      if (newObject)
+        {
+          if (i > first)
+            apduLen += rpm_encode_apdu_object_end(&apdu[apduLen]);
+
+          apduLen += rpm_encode_apdu_object_begin(&apdu[apduLen],
+                                                  entries[i].objType,
+                                                  entries[i].objInstance);
+        }
+
+      apduLen += rpm_encode_apdu_object_property(&apdu[apduLen],
+                                                 entries[i].objProperty,
+                                                 entries[i].arrayIndex);
+      replyLen += replyBytes;
+    }
+
+  apduLen += rpm_encode_apdu_object_end(&apdu[apduLen]);
+  pduLen += apduLen;
+
+  *count = i - first;
+
+  tsm_set_confirmed_unsegmented_transaction(invokeID, &m_targetAddress,
+                                            &npduData, &pdu[0],
+                                            (uint16_t)pduLen);
+
+  // if this fails, the TSM will retry it for us
+  if (datalink_send_pdu(&m_targetAddress, &npduData, &pdu[0], pduLen) <= 0)
+    syslog(LOG_WARNING, "%s: datalink_send_pdu() failed",
+           string(__FUNCTION__).c_str());
+
+  if (m_debugging)
+    cerr << __FUNCTION__ << ": sent " << *count << " entries in "
+         << apduLen << " bytes, invokeID = " << (int)invokeID << endl;
+
+  return invokeID;
+}
+
 bool BACNETMSTP::readProperty(uint32_t targetDeviceInstanceID,
                               BACNET_OBJECT_TYPE objType,
                               uint32_t objInstance,
@@ -647,6 +1094,54 @@ bool BACNETMSTP::writeProperty(uint32_t targetDeviceInstanceID,
   return error;
 }
 
+bool BACNETMSTP::readPropertyMultiple(uint32_t targetDeviceInstanceID,
+                                      RPM_ENTRY_T* entries, int numEntries)
+{
+  if (!entries || numEntries < 0)
+    {
+      throw invalid_argument(string(__FUNCTION__)
+                             + ": entries must be a valid table");
+    }
+
+  // some sanity checking, and reset the results
+  for (int i=0; i<numEntries; i++)
+    {
+      if (entries[i].objInstance >= BACNET_MAX_INSTANCE)
+        {
+          throw out_of_range(string(__FUNCTION__)
+                             + ": objInstance must be less than "
+                             + to_string(BACNET_MAX_INSTANCE));
+        }
+
+      entries[i].valid = false;
+      entries[i].errorClass = ERROR_CLASS_SERVICES;
+      entries[i].errorCode = ERROR_CODE_OTHER;
+      memset((void *)&entries[i].value, 0, sizeof(entries[i].value));
+    }
+
+  if (!numEntries)
+    return false;
+
+  // fill in the command structure and dispatch
+  m_command.cmd = BACCMD_READ_PROPERTY_MULTIPLE;
+  m_command.readPropMultipleArgs.targetDeviceInstanceID =
+    targetDeviceInstanceID;
+  m_command.readPropMultipleArgs.entries = entries;
+  m_command.readPropMultipleArgs.numEntries = numEntries;
+  m_command.readPropMultipleArgs.nextEntry = 0;
+
+  if (m_debugging)
+    cerr << __FUNCTION__  << ": calling dispatchRequest()..." << endl;
+
+  // send it off
+  bool error = dispatchRequest();
+
+  // clear the command to avoid accidental re-calls
+  m_command.cmd = BACCMD_NONE;
+
+  return error;
+}
+
 BACNET_APPLICATION_DATA_VALUE BACNETMSTP::getData(int index)
 {
   return m_returnedValue.at(index);
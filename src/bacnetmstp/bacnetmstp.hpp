@@ -81,8 +81,8 @@ namespace upm {
    * implement your own BACnet MS/TP driver, please look at the E50HX
    * driver to see how this class can be used.
    *
-   * Currently, only readProperty and writeProperty BACnet requests
-   * are supported.  In the future, any other BACnet requests could be
+   * Currently, only readProperty, readPropertyMultiple and
+   * writeProperty BACnet requests are supported.  In the future, any other BACnet requests could be
    * supported as well.  readProperty and writeProperty should provide
    * most of what you will need when communicating with BACnet
    * devices.  Since the source code is open, feel free to add other
@@ -119,9 +119,28 @@ namespace upm {
     typedef enum {
       BACCMD_NONE                     = 0,
       BACCMD_READ_PROPERTY,
-      BACCMD_WRITE_PROPERTY
+      BACCMD_WRITE_PROPERTY,
+      BACCMD_READ_PROPERTY_MULTIPLE
     } BACCMD_TYPE_T;
 
+    // One row of a readPropertyMultiple() table.  The caller fills
+    // in the object/property to read, and the result fields are
+    // filled in when the request completes.
+    typedef struct {
+      BACNET_OBJECT_TYPE objType;
+      uint32_t objInstance;
+      BACNET_PROPERTY_ID objProperty;
+      uint32_t arrayIndex;
+
+      // true if value contains the data returned by the device
+      bool valid;
+      // if !valid, the property access error reported by the device
+      BACNET_ERROR_CLASS errorClass;
+      BACNET_ERROR_CODE errorCode;
+      // the returned data (only the first element of an array)
+      BACNET_APPLICATION_DATA_VALUE value;
+    } RPM_ENTRY_T;
+
     /**
      * Get our singleton instance, initializing it if neccessary.  All
      * requests to this class should be done through this instance
@@ -236,6 +255,53 @@ namespace upm {
                        uint8_t propPriority=BACNET_NO_PRIORITY,
                        int32_t arrayIndex=BACNET_ARRAY_ALL);
 
+    /**
+     * Perform one or more BACnet readPropertyMultiple transactions in
+     * order to read every property listed in a table.  The entries
+     * are packed into as few requests as will fit in the smaller of
+     * the target device's max APDU and our own.  When maxInfoFrames
+     * (see initMaster()) is greater than 1, up to that many requests
+     * are kept outstanding at once, so that several of them can be
+     * sent each time we hold the token.
+     *
+     * The results are stored back into the table supplied.  Entries
+     * that refer to the same object should be placed next to each
+     * other so that they can share a single object specifier in the
+     * request.  A property the device could not return does not cause
+     * this method to fail; instead that entry's valid field is set to
+     * false and its errorClass and errorCode fields are set to the
+     * error returned.  Only the first element of an array property is
+     * stored.
+     *
+     * @param targetDeviceInstanceID This is the Device Object
+     * Instance ID of the device to send the request to.  See
+     * readProperty().
+     * @param entries A pointer to the table of entries to read.  The
+     * objType, objInstance, objProperty and arrayIndex fields of each
+     * entry must be filled in.
+     * @param numEntries The number of entries in the table.
+     * @return true if an error occurred, false otherwise.
+     */
+    bool readPropertyMultiple(uint32_t targetDeviceInstanceID,
+                              RPM_ENTRY_T* entries, int numEntries);
+
+    /**
+     * Perform one or more BACnet readPropertyMultiple transactions on
+     * a table stored in a vector.  See the other form of
+     * readPropertyMultiple() for details.
+     *
+     * @param targetDeviceInstanceID This is the Device Object
+     * Instance ID of the device to send the request to.
+     * @param entries The table of entries to read.
+     * @return true if an error occurred, false otherwise.
+     */
+    bool readPropertyMultiple(uint32_t targetDeviceInstanceID,
+                              std::vector<RPM_ENTRY_T>& entries)
+    {
+      return readPropertyMultiple(targetDeviceInstanceID, entries.data(),
+                                  entries.size());
+    };
+
     /**
      * After a successful readProperty request, this method can be used
      * to return a BACNET_APPLICATION_DATA_VALUE structure containing
@@ -641,6 +707,13 @@ namespace upm {
                                        BACNET_ADDRESS* src,
                                        BACNET_CONFIRMED_SERVICE_ACK_DATA* service_data);
 
+    // our handler for dealing with return data from a
+    // ReadPropertyMultiple call
+    static void handlerReadPropertyMultipleAck(uint8_t* service_request,
+                                               uint16_t service_len,
+                                               BACNET_ADDRESS* src,
+                                               BACNET_CONFIRMED_SERVICE_ACK_DATA* service_data);
+
     // our handler for writeProp acks
     static void handlerWritePropertyAck(BACNET_ADDRESS* src,
                                         uint8_t invoke_id);
@@ -654,6 +727,25 @@ namespace upm {
     // responsible for dispatching a request to the BACnet network
     bool dispatchRequest();
 
+    // is invoke_id from src one of our outstanding transactions?
+    bool isPendingTransaction(BACNET_ADDRESS* src, uint8_t invoke_id);
+
+    // send as many readPropertyMultiple requests as we are allowed
+    // to have outstanding, and reap completed ones.  Returns true
+    // once every entry has been requested and answered, or an error
+    // has occurred.
+    bool serviceReadPropertyMultiple(unsigned max_apdu);
+
+    // encode and send a single readPropertyMultiple request starting
+    // at table entry first.  Returns the invoke ID used, or 0 if the
+    // request could not be sent yet.
+    uint8_t sendReadPropertyMultiple(unsigned max_apdu, int first,
+                                     int* count);
+
+    // decode a readPropertyMultiple ack into the table
+    void decodeReadPropertyMultipleAck(uint8_t* apdu, int apdu_len,
+                                       int first, int count);
+
   private:
     // prevent copying and assignment
     BACNETMSTP(BACNETMSTP const &) = delete;
@@ -714,6 +806,16 @@ namespace upm {
     // error detected flag
     bool m_errorDetected;
 
+    // outstanding readPropertyMultiple transactions, and the range
+    // of table entries each one is responsible for.
+    typedef struct {
+      uint8_t invokeID;
+      int first;
+      int count;
+    } RPM_PENDING_T;
+
+    std::vector<RPM_PENDING_T> m_rpmPending;
+
     // Commands - we create a struct to hold the arguments for each
     // command type we support.  Then, we create a command struct
     // which contains the command type and a union containing the
@@ -740,12 +842,21 @@ namespace upm {
       int32_t arrayIndex;
     } WRITE_PROPERTY_ARGS_T;
 
+    typedef struct {
+      uint32_t targetDeviceInstanceID;
+      RPM_ENTRY_T* entries;
+      int numEntries;
+      // index of the next entry that has not been requested yet
+      int nextEntry;
+    } READ_PROPERTY_MULTIPLE_ARGS_T;
+
     struct {
       BACCMD_TYPE_T cmd;
 
       union {
         READ_PROPERTY_ARGS_T readPropArgs;
         WRITE_PROPERTY_ARGS_T writePropArgs;
+        READ_PROPERTY_MULTIPLE_ARGS_T readPropMultipleArgs;
       };
     } m_command;
 
@@ -25,6 +25,7 @@
 #include <unistd.h>
 #include <assert.h>
 #include <errno.h>
+#include <string.h>
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -64,6 +65,11 @@ BACNETUTIL::BACNETUTIL(uint32_t targetDeviceObjectID) :
   // empty our binary info stores
   m_bvInfo.clear();
   m_biInfo.clear();
+
+  // no points yet, and assume ReadPropertyMultiple until we learn
+  // otherwise
+  clearPoints();
+  m_rpmSupported = true;
 }
 
 BACNETUTIL::~BACNETUTIL()
@@ -762,6 +768,268 @@ string BACNETUTIL::getBinaryValueText(uint32_t objInstance)
   return lookupBinaryValueText(objInstance, value);
 }
 
+// BACnet object identifier, used as a key for our points
+static uint32_t pointID(BACNET_OBJECT_TYPE objType, uint32_t objInstance)
+{
+  return ((uint32_t(objType) << BACNET_INSTANCE_BITS)
+          | (objInstance & BACNET_MAX_INSTANCE));
+}
+
+void BACNETUTIL::addPoint(BACNET_OBJECT_TYPE objType, uint32_t objInstance)
+{
+  if (objInstance >= BACNET_MAX_INSTANCE)
+    {
+      throw out_of_range(string(__FUNCTION__)
+                         + ": objInstance must be less than "
+                         + to_string(BACNET_MAX_INSTANCE));
+    }
+
+  uint32_t id = pointID(objType, objInstance);
+
+  for (size_t i=0; i<m_points.size(); i++)
+    if (m_points[i] == id)
+      return;
+
+  m_points.push_back(id);
+  m_pointTableDirty = true;
+}
+
+void BACNETUTIL::clearPoints()
+{
+  m_points.clear();
+  m_pointTable.clear();
+  m_pointIndex.clear();
+
+  m_pointTableDirty = false;
+  m_pointTableReliability = false;
+  m_pointsUpdated = false;
+}
+
+void BACNETUTIL::buildPointTable()
+{
+  m_pointTable.clear();
+  m_pointIndex.clear();
+
+  BACNETMSTP::RPM_ENTRY_T entry;
+  memset((void *)&entry, 0, sizeof(entry));
+  entry.arrayIndex = BACNET_ARRAY_ALL;
+
+  for (size_t i=0; i<m_points.size(); i++)
+    {
+      entry.objType =
+        static_cast<BACNET_OBJECT_TYPE>(m_points[i] >> BACNET_INSTANCE_BITS);
+      entry.objInstance = m_points[i] & BACNET_MAX_INSTANCE;
+
+      // keep the reliability and value of an object next to each
+      // other so they share an object specifier in the request
+      if (m_checkReliability)
+        {
+          entry.objProperty = PROP_RELIABILITY;
+          m_pointTable.push_back(entry);
+        }
+
+      entry.objProperty = PROP_PRESENT_VALUE;
+      m_pointIndex[m_points[i]] = m_pointTable.size();
+      m_pointTable.push_back(entry);
+    }
+
+  m_pointTableReliability = m_checkReliability;
+  m_pointTableDirty = false;
+  m_pointsUpdated = false;
+}
+
+void BACNETUTIL::updatePoints()
+{
+  if (m_pointTableDirty || m_pointTableReliability != m_checkReliability)
+    buildPointTable();
+
+  if (m_pointTable.empty())
+    return;
+
+  if (m_rpmSupported)
+    {
+      if (!m_instance->readPropertyMultiple(m_targetDeviceObjectID,
+                                            m_pointTable))
+        {
+          m_pointsUpdated = true;
+          return;
+        }
+
+      // Devices that do not implement ReadPropertyMultiple will
+      // reject it.  Anything else is a real error.
+      if (m_instance->getErrorType() != BACNETMSTP::BACERR_TYPE_REJECT ||
+          m_instance->getRejectReason() != REJECT_REASON_UNRECOGNIZED_SERVICE)
+        {
+          if (m_debugging)
+            cerr << __FUNCTION__ << ": " << getAllErrorString() << endl;
+
+          throw runtime_error(string(__FUNCTION__)
+                              + ": "
+                              + getAllErrorString());
+        }
+
+      if (m_debugging)
+        cerr << __FUNCTION__ << ": ReadPropertyMultiple not supported, "
+             << "falling back to ReadProperty" << endl;
+
+      m_rpmSupported = false;
+    }
+
+  // read them one at a time then
+  for (size_t i=0; i<m_pointTable.size(); i++)
+    {
+      BACNETMSTP::RPM_ENTRY_T& entry = m_pointTable[i];
+
+      if (m_instance->readProperty(m_targetDeviceObjectID, entry.objType,
+                                   entry.objInstance, entry.objProperty,
+                                   entry.arrayIndex))
+        {
+          // an error about the property itself is stored just as
+          // readPropertyMultiple() would do, anything else is fatal
+          if (m_instance->getErrorType() != BACNETMSTP::BACERR_TYPE_ERROR)
+            {
+              if (m_debugging)
+                cerr << __FUNCTION__ << ": " << getAllErrorString() << endl;
+
+              throw runtime_error(string(__FUNCTION__)
+                                  + ": "
+                                  + getAllErrorString());
+            }
+
+          entry.valid = false;
+          entry.errorClass = m_instance->getErrorClass();
+          entry.errorCode = m_instance->getErrorCode();
+        }
+      else
+        {
+          entry.valid = true;
+          entry.value = m_instance->getData();
+          entry.value.next = 0;
+        }
+    }
+
+  m_pointsUpdated = true;
+}
+
+const BACNET_APPLICATION_DATA_VALUE&
+BACNETUTIL::getPointValue(string func, BACNET_OBJECT_TYPE objType,
+                          uint32_t objInstance)
+{
+  if (!m_pointsUpdated)
+    {
+      throw runtime_error(func
+                          + ": updatePoints() must be called first");
+    }
+
+  pointIndexMap_t::iterator it =
+    m_pointIndex.find(pointID(objType, objInstance));
+
+  if (it == m_pointIndex.end())
+    {
+      throw out_of_range(func
+                         + ": point was not added with addPoint()");
+    }
+
+  // check reliability first, if it was read
+  if (m_pointTableReliability)
+    {
+      const BACNETMSTP::RPM_ENTRY_T& rel = m_pointTable[it->second - 1];
+
+      if (!rel.valid)
+        {
+          throw runtime_error(func + ": (reliability): "
+                              + bactext_error_class_name(rel.errorClass)
+                              + ": "
+                              + bactext_error_code_name(rel.errorCode));
+        }
+
+      if (rel.value.type.Enumerated != RELIABILITY_NO_FAULT_DETECTED)
+        {
+          if (m_debugging)
+            cerr << func << ": Reliability check failed" << endl;
+
+          throw runtime_error(func + ": Reliability check failed");
+        }
+    }
+
+  const BACNETMSTP::RPM_ENTRY_T& entry = m_pointTable[it->second];
+
+  if (!entry.valid)
+    {
+      throw runtime_error(func + ": (value): "
+                          + bactext_error_class_name(entry.errorClass)
+                          + ": "
+                          + bactext_error_code_name(entry.errorCode));
+    }
+
+  return entry.value;
+}
+
+float BACNETUTIL::getPointReal(BACNET_OBJECT_TYPE objType,
+                               uint32_t objInstance)
+{
+  const BACNET_APPLICATION_DATA_VALUE& value =
+    getPointValue(__FUNCTION__, objType, objInstance);
+
+  switch (value.tag)
+    {
+    case BACNET_APPLICATION_TAG_REAL:
+      return value.type.Real;
+    case BACNET_APPLICATION_TAG_BOOLEAN:
+      return (value.type.Boolean ? 1.0 : 0.0);
+    case BACNET_APPLICATION_TAG_UNSIGNED_INT:
+      return float(value.type.Unsigned_Int);
+    case BACNET_APPLICATION_TAG_SIGNED_INT:
+      return float(value.type.Signed_Int);
+    default:
+      throw invalid_argument(string(__FUNCTION__)
+                             + ": data type ("
+                             + to_string(int(value.tag))
+                             + ") is not convertible to Real");
+    }
+}
+
+bool BACNETUTIL::getPointBoolean(BACNET_OBJECT_TYPE objType,
+                                 uint32_t objInstance)
+{
+  const BACNET_APPLICATION_DATA_VALUE& value =
+    getPointValue(__FUNCTION__, objType, objInstance);
+
+  switch (value.tag)
+    {
+    case BACNET_APPLICATION_TAG_ENUMERATED:
+      // a BACNET_BINARY_PV
+      return (value.type.Enumerated == BINARY_INACTIVE) ? false : true;
+    case BACNET_APPLICATION_TAG_BOOLEAN:
+      return (value.type.Boolean) ? true : false;
+    default:
+      throw invalid_argument(string(__FUNCTION__)
+                             + ": data type ("
+                             + to_string(int(value.tag))
+                             + ") is not convertible to Bool");
+    }
+}
+
+unsigned int BACNETUTIL::getPointUnsignedInt(BACNET_OBJECT_TYPE objType,
+                                             uint32_t objInstance)
+{
+  const BACNET_APPLICATION_DATA_VALUE& value =
+    getPointValue(__FUNCTION__, objType, objInstance);
+
+  switch (value.tag)
+    {
+    case BACNET_APPLICATION_TAG_UNSIGNED_INT:
+      return value.type.Unsigned_Int;
+    case BACNET_APPLICATION_TAG_ENUMERATED:
+      return value.type.Enumerated;
+    default:
+      throw invalid_argument(string(__FUNCTION__)
+                             + ": data type ("
+                             + to_string(int(value.tag))
+                             + ") is not convertible to UnsignedInt");
+    }
+}
+
 BACNETMSTP::BACERR_TYPE_T BACNETUTIL::getErrorType()
 {
   return m_instance->getErrorType();
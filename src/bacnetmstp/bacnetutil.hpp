@@ -362,6 +362,76 @@ namespace upm {
       m_checkReliability = enable;
     };
 
+    /**
+     * Add an object to the list of points refreshed by
+     * updatePoints().  The Present_Value property of every point
+     * (and the Reliability property, if checkReliability() is
+     * enabled) is read in as few BACnet ReadPropertyMultiple requests
+     * as possible, rather than one ReadProperty request per
+     * property.  Adding a point that is already in the list has no
+     * effect.
+     *
+     * @param objType The BACnet object type of the point, like
+     * OBJECT_ANALOG_INPUT.
+     * @param objInstance The object instance of the point.
+     */
+    virtual void addPoint(BACNET_OBJECT_TYPE objType, uint32_t objInstance);
+
+    /**
+     * Remove all points added with addPoint().
+     */
+    virtual void clearPoints();
+
+    /**
+     * Read the Present_Value of every point added with addPoint() in
+     * a single pass, and store the results.  Devices that do not
+     * support ReadPropertyMultiple are detected, and will have their
+     * points read one at a time instead.  This method will throw if
+     * the transaction fails.  A point whose value the device could
+     * not return does not cause this method to throw, but the
+     * getPoint*() methods will throw when that point is queried.
+     */
+    virtual void updatePoints();
+
+    /**
+     * Return the Present_Value of a point as stored by the last call
+     * to updatePoints() as a floating point value.  This method will
+     * throw if the point has not been added, the device returned an
+     * error for it, its reliability check failed, or its value can
+     * not be converted.
+     *
+     * @param objType The BACnet object type of the point.
+     * @param objInstance The object instance of the point.
+     * @return The floating point value of the point.
+     */
+    virtual float getPointReal(BACNET_OBJECT_TYPE objType,
+                               uint32_t objInstance);
+
+    /**
+     * Return the Present_Value of a binary point as stored by the last
+     * call to updatePoints().  This method will throw under the same
+     * conditions as getPointReal().
+     *
+     * @param objType The BACnet object type of the point.
+     * @param objInstance The object instance of the point.
+     * @return The boolean value of the point.
+     */
+    virtual bool getPointBoolean(BACNET_OBJECT_TYPE objType,
+                                 uint32_t objInstance);
+
+    /**
+     * Return the Present_Value of a point as stored by the last call
+     * to updatePoints() as an unsigned integer.  This is the type
+     * used by Multi-State Value objects.  This method will throw
+     * under the same conditions as getPointReal().
+     *
+     * @param objType The BACnet object type of the point.
+     * @param objInstance The object instance of the point.
+     * @return The unsigned integer value of the point.
+     */
+    virtual unsigned int getPointUnsignedInt(BACNET_OBJECT_TYPE objType,
+                                             uint32_t objInstance);
+
     /**
      * Query the Device Object of the device and return it's
      * Description property.  This typically contains information like
@@ -504,6 +574,15 @@ namespace upm {
     // delete our stored info for a BI
     virtual void deleteBinaryInputInfo(uint32_t objInstance);
 
+    // (re)build the point table used by updatePoints()
+    virtual void buildPointTable();
+
+    // return the stored Present_Value of a point, throwing if it is
+    // not available
+    virtual const BACNET_APPLICATION_DATA_VALUE&
+      getPointValue(std::string func, BACNET_OBJECT_TYPE objType,
+                    uint32_t objInstance);
+
     // also enable mstp debugging in BACNETMSTP
     bool m_debugging;
 
@@ -554,6 +633,29 @@ namespace upm {
     typedef std::map<uint32_t, std::string> aiCacheMap_t;
     aiCacheMap_t m_aiUnitCache;
 
+    // the points to read in updatePoints(), as BACnet object
+    // identifiers, in the order they were added
+    std::vector<uint32_t> m_points;
+
+    // the table passed to readPropertyMultiple() for our points
+    std::vector<BACNETMSTP::RPM_ENTRY_T> m_pointTable;
+
+    // map of object identifier to the index of its Present_Value
+    // entry in m_pointTable.  If m_pointTableReliability is true,
+    // the Reliability entry immediately precedes it.
+    typedef std::map<uint32_t, int> pointIndexMap_t;
+    pointIndexMap_t m_pointIndex;
+
+    // does m_pointTable need to be rebuilt?
+    bool m_pointTableDirty;
+    // does m_pointTable contain Reliability entries?
+    bool m_pointTableReliability;
+    // has m_pointTable been read since it was built?
+    bool m_pointsUpdated;
+
+    // does the device support ReadPropertyMultiple?
+    bool m_rpmSupported;
+
   private:
   };
 }
@@ -25,6 +25,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 #include <mraa/i2c.h>
 #include <mraa/spi.h>
 #include <mraa/gpio.h>
@@ -33,58 +34,104 @@
 
 #include <upm_utilities.h>
 
-// we have to do it the old skool way.  Note, this also means that
-// only one instance of the bmi160 driver can be active at a time.
-static mraa_i2c_context i2cContext = NULL;
-static mraa_spi_context spiContext = NULL;
-/* this is used for chip-select when using SPI */
-static mraa_gpio_context gpioContext = NULL;
+// FIFO size in bytes
+#define BMI160_FIFO_SIZE 1024
+// room for the sensor time frame appended once the FIFO is drained
+#define BMI160_FIFO_TIME_FRAME_LEN 4
+// smallest regular frame: a header and one 6 byte sensor sample
+#define BMI160_FIFO_MAX_FRAMES (BMI160_FIFO_SIZE / 7)
+// the FIFO watermark register counts in units of 4 bytes
+#define BMI160_FIFO_WM_UNIT 4
+
+// sensor time runs at 25.6kHz (39.0625us per tick) and is 24 bits
+#define BMI160_SENSOR_TIME_HZ 25600
+#define BMI160_SENSOR_TIME_MASK 0xffffff
+
+// The Bosch driver code keeps its state in globals: the current
+// bmi160_t pointer, the BMM150 trim data and its manual/auto mode
+// flag.  Each of our contexts keeps its own copy of these, which is
+// swapped in for as long as the context is in use.  The lock is
+// recursive, since our public functions call each other.
+extern struct bmi160_t *p_bmi160;
+extern struct trim_data_t mag_trim;
+extern u8 V_bmm150_maual_auto_condition_u8;
+
+static pthread_once_t s_lockOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t s_lock;
+// the context currently using the Bosch code, and its nesting depth
+static bmi160_context s_current = NULL;
+static int s_depth = 0;
+
+static void bmi160_lock_init()
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&s_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+static void bmi160_acquire(const bmi160_context dev)
+{
+    pthread_once(&s_lockOnce, bmi160_lock_init);
+    pthread_mutex_lock(&s_lock);
+
+    if (s_depth++ == 0)
+    {
+        s_current = dev;
+        p_bmi160 = &dev->bmi160;
+        mag_trim = dev->magTrim;
+        V_bmm150_maual_auto_condition_u8 = dev->magManualAuto;
+    }
+}
 
-// whether we are doing I2C or SPI
-static bool isSPI = false;
+static void bmi160_release(const bmi160_context dev)
+{
+    if (--s_depth == 0)
+    {
+        dev->magTrim = mag_trim;
+        dev->magManualAuto = V_bmm150_maual_auto_condition_u8;
+        s_current = NULL;
+    }
 
-// Our bmi160 info structure
-struct bmi160_t s_bmi160;
+    pthread_mutex_unlock(&s_lock);
+}
 
 // For SPI, these are our CS on/off functions, if needed
-static void bmi160_cs_on()
+static void bmi160_cs_on(const bmi160_context dev)
 {
-    if (gpioContext)
-        mraa_gpio_write(gpioContext, 0);
+    if (dev->gpioCS)
+        mraa_gpio_write(dev->gpioCS, 0);
 }
 
-static void bmi160_cs_off()
+static void bmi160_cs_off(const bmi160_context dev)
 {
-    if (gpioContext)
-        mraa_gpio_write(gpioContext, 1);
+    if (dev->gpioCS)
+        mraa_gpio_write(dev->gpioCS, 1);
 }
 
-// i2c bus read and write functions for use with the bmi driver code
-s8 bmi160_bus_read(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
+// low level bus reads and writes on a specific device
+static s8 bmi160_dev_read(const bmi160_context dev, u8 reg_addr,
+                          u8 *reg_data, u8 cnt)
 {
-    if (isSPI)
+    if (dev->isSPI)
     {
-        if (!spiContext)
-        {
-            printf("%s: spiContext is NULL.\n", __FUNCTION__);
-            return 1;
-        }
-
         reg_addr |= 0x80; // needed for read
 
         uint8_t sbuf[cnt + 1];
         memset((char *)sbuf, 0, cnt + 1);
         sbuf[0] = reg_addr;
 
-        bmi160_cs_on();
+        bmi160_cs_on(dev);
 
-        if (mraa_spi_transfer_buf(spiContext, sbuf, sbuf, cnt + 1))
+        if (mraa_spi_transfer_buf(dev->spi, sbuf, sbuf, cnt + 1))
         {
-            bmi160_cs_off();
+            bmi160_cs_off(dev);
             printf("%s: mraa_spi_transfer_buf() failed.\n", __FUNCTION__);
             return 1;
         }
-        bmi160_cs_off();
+        bmi160_cs_off(dev);
 
       // now copy it into user buffer
         int i;
@@ -96,13 +143,7 @@ s8 bmi160_bus_read(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
 
     // doing I2C
 
-    if (!i2cContext)
-    {
-        printf("%s: i2cContext is NULL.\n", __FUNCTION__);
-        return 1;
-    }
-
-    if (mraa_i2c_read_bytes_data(i2cContext, reg_addr, reg_data, cnt) < 0)
+    if (mraa_i2c_read_bytes_data(dev->i2c, reg_addr, reg_data, cnt) < 0)
     {
         printf("%s: mraa_i2c_read_bytes() failed.\n", __FUNCTION__);
         return 1;
@@ -111,16 +152,11 @@ s8 bmi160_bus_read(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
     return 0;
 }
 
-s8 bmi160_bus_write(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
+static s8 bmi160_dev_write(const bmi160_context dev, u8 reg_addr,
+                           u8 *reg_data, u8 cnt)
 {
-    if (isSPI)
+    if (dev->isSPI)
     {
-        if (!spiContext)
-        {
-            printf("%s: spiContext is NULL.\n", __FUNCTION__);
-            return 1;
-        }
-
         reg_addr &= 0x7f; // mask off 0x80 for writing
 
         uint8_t sbuf[cnt + 1];
@@ -132,26 +168,20 @@ s8 bmi160_bus_write(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
         for (i=0; i<cnt; i++)
             sbuf[i + 1] = reg_data[i];
 
-        bmi160_cs_on();
+        bmi160_cs_on(dev);
 
-        if (mraa_spi_transfer_buf(spiContext, sbuf, sbuf, cnt + 1))
+        if (mraa_spi_transfer_buf(dev->spi, sbuf, sbuf, cnt + 1))
         {
-            bmi160_cs_off();
+            bmi160_cs_off(dev);
             printf("%s: mraa_spi_transfer_buf() failed.\n", __FUNCTION__);
             return 1;
         }
-        bmi160_cs_off();
+        bmi160_cs_off(dev);
 
         return 0;
     }
 
     // I2C...
-    if (!i2cContext)
-    {
-        printf("%s: i2cContext is NULL.\n", __FUNCTION__);
-        return 1;
-    }
-
     uint8_t buffer[cnt + 1];
 
     buffer[0] = reg_addr;
@@ -159,7 +189,7 @@ s8 bmi160_bus_write(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
     for (i=0; i<cnt; i++)
         buffer[i+1] = reg_data[i];
 
-    mraa_result_t rv = mraa_i2c_write(i2cContext, buffer, cnt+1);
+    mraa_result_t rv = mraa_i2c_write(dev->i2c, buffer, cnt+1);
 
     if (rv != MRAA_SUCCESS)
     {
@@ -170,6 +200,101 @@ s8 bmi160_bus_write(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
     return 0;
 }
 
+// i2c bus read and write functions for use with the bmi driver code.
+// These operate on the context currently in use.
+s8 bmi160_bus_read(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
+{
+    if (!s_current)
+    {
+        printf("%s: no device in use.\n", __FUNCTION__);
+        return 1;
+    }
+
+    return bmi160_dev_read(s_current, reg_addr, reg_data, cnt);
+}
+
+s8 bmi160_bus_write(u8 dev_addr, u8 reg_addr, u8 *reg_data, u8 cnt)
+{
+    if (!s_current)
+    {
+        printf("%s: no device in use.\n", __FUNCTION__);
+        return 1;
+    }
+
+    return bmi160_dev_write(s_current, reg_addr, reg_data, cnt);
+}
+
+// burst reads (used for the FIFO data register) can exceed the 255
+// bytes of a regular bus read, so they go through the FIFO buffer.
+static s8 bmi160_bus_burst_read(u8 dev_addr, u8 reg_addr, u8 *reg_data,
+                                u32 cnt)
+{
+    bmi160_context dev = s_current;
+
+    if (!dev || !dev->fifoBuffer
+        || cnt > BMI160_FIFO_SIZE + BMI160_FIFO_TIME_FRAME_LEN)
+    {
+        printf("%s: no device in use, or burst too large.\n", __FUNCTION__);
+        return 1;
+    }
+
+    if (dev->isSPI)
+    {
+        u8 *sbuf = dev->fifoBuffer;
+
+        memset((char *)sbuf, 0, cnt + 1);
+        sbuf[0] = reg_addr | 0x80;
+
+        bmi160_cs_on(dev);
+
+        if (mraa_spi_transfer_buf(dev->spi, sbuf, sbuf, cnt + 1))
+        {
+            bmi160_cs_off(dev);
+            printf("%s: mraa_spi_transfer_buf() failed.\n", __FUNCTION__);
+            return 1;
+        }
+        bmi160_cs_off(dev);
+
+        if (reg_data != sbuf + 1)
+            memmove(reg_data, sbuf + 1, cnt);
+
+        return 0;
+    }
+
+    if (mraa_i2c_read_bytes_data(dev->i2c, reg_addr, reg_data, cnt)
+        != (int)cnt)
+    {
+        printf("%s: mraa_i2c_read_bytes_data() failed.\n", __FUNCTION__);
+        return 1;
+    }
+
+    return 0;
+}
+
+s8 bmi160_read_regs(const bmi160_context dev, u8 reg_addr, u8 *reg_data,
+                    u8 cnt)
+{
+    assert(dev != NULL);
+
+    bmi160_acquire(dev);
+    s8 rv = bmi160_dev_read(dev, reg_addr, reg_data, cnt);
+    bmi160_release(dev);
+
+    return rv;
+}
+
+s8 bmi160_write_regs(const bmi160_context dev, u8 reg_addr, u8 *reg_data,
+                     u8 cnt)
+{
+    assert(dev != NULL);
+
+    bmi160_acquire(dev);
+    s8 rv = bmi160_dev_write(dev, reg_addr, reg_data, cnt);
+    bmi160_release(dev);
+
+    return rv;
+}
+
 // delay for some milliseconds
 void bmi160_delay_ms(u32 msek)
 {
@@ -201,16 +326,16 @@ bmi160_context bmi160_init(unsigned int bus, int address, int cs_pin,
     if (address > 0)
     {
         // we are doing I2C
-        isSPI = false;
+        dev->isSPI = false;
 
-        if (!(i2cContext = mraa_i2c_init(bus)))
+        if (!(dev->i2c = mraa_i2c_init(bus)))
         {
             printf("%s: mraa_i2c_init() failed.\n", __FUNCTION__);
             bmi160_close(dev);
             return NULL;
         }
 
-        if (mraa_i2c_address(i2cContext, address) != MRAA_SUCCESS)
+        if (mraa_i2c_address(dev->i2c, address) != MRAA_SUCCESS)
         {
             printf("%s: mraa_i2c_address() failed.\n", __FUNCTION__);
             bmi160_close(dev);
@@ -220,9 +345,9 @@ bmi160_context bmi160_init(unsigned int bus, int address, int cs_pin,
     else
     {
         // we are doing SPI
-        isSPI = true;
+        dev->isSPI = true;
 
-        if (!(spiContext = mraa_spi_init(bus)))
+        if (!(dev->spi = mraa_spi_init(bus)))
         {
             printf("%s: mraa_spi_init() failed.\n", __FUNCTION__);
             bmi160_close(dev);
@@ -233,25 +358,25 @@ bmi160_context bmi160_init(unsigned int bus, int address, int cs_pin,
         // A hardware controlled pin should specify cs as -1.
         if (cs_pin >= 0)
         {
-            if (!(gpioContext = mraa_gpio_init(cs_pin)))
+            if (!(dev->gpioCS = mraa_gpio_init(cs_pin)))
             {
                 printf("%s: mraa_gpio_init() failed.\n", __FUNCTION__);
                 bmi160_close(dev);
                 return NULL;
             }
 
-            mraa_gpio_dir(gpioContext, MRAA_GPIO_OUT);
-            bmi160_cs_off();
+            mraa_gpio_dir(dev->gpioCS, MRAA_GPIO_OUT);
+            bmi160_cs_off(dev);
         }
 
-        if (mraa_spi_mode(spiContext, MRAA_SPI_MODE0))
+        if (mraa_spi_mode(dev->spi, MRAA_SPI_MODE0))
         {
             printf("%s: mraa_spi_mode() failed.\n", __FUNCTION__);
             bmi160_close(dev);
             return NULL;
         }
 
-        if (mraa_spi_frequency(spiContext, 5000000))
+        if (mraa_spi_frequency(dev->spi, 5000000))
         {
             printf("%s: mraa_spi_frequency() failed.\n", __FUNCTION__);
             bmi160_close(dev);
@@ -259,29 +384,46 @@ bmi160_context bmi160_init(unsigned int bus, int address, int cs_pin,
         }
     }
 
+    // FIFO burst buffer (with room for the SPI command byte), and the
+    // decoded frames
+    if (!(dev->fifoBuffer = (u8 *)malloc(BMI160_FIFO_SIZE
+                                         + BMI160_FIFO_TIME_FRAME_LEN + 1))
+        || !(dev->fifoFrames = (bmi160_frame_t *)
+             malloc(sizeof(bmi160_frame_t) * BMI160_FIFO_MAX_FRAMES)))
+    {
+        printf("%s: FIFO buffer allocation failed.\n", __FUNCTION__);
+        bmi160_close(dev);
+        return NULL;
+    }
+
     // init the driver interface functions
-    s_bmi160.bus_write = bmi160_bus_write;
-    s_bmi160.bus_read = bmi160_bus_read;
-    s_bmi160.delay_msec = bmi160_delay_ms;
-    if (isSPI)
-        s_bmi160.dev_addr = 0;
+    dev->bmi160.bus_write = bmi160_bus_write;
+    dev->bmi160.bus_read = bmi160_bus_read;
+    dev->bmi160.burst_read = bmi160_bus_burst_read;
+    dev->bmi160.delay_msec = bmi160_delay_ms;
+    if (dev->isSPI)
+        dev->bmi160.dev_addr = 0;
     else
-        s_bmi160.dev_addr = address & 0xff;
+        dev->bmi160.dev_addr = address & 0xff;
+
+    bmi160_acquire(dev);
 
     // Init our driver interface pointers
-    if (bmi160_init_bus(&s_bmi160))
+    if (bmi160_init_bus(&dev->bmi160))
     {
         printf("%s: bmi160_bus_init() failed.\n", __FUNCTION__);
+        bmi160_release(dev);
         bmi160_close(dev);
         return NULL;
     }
 
     // bmi160_init_bus will read the chip Id and deposit into our
     // interface struct.  So, check it out and make sure it's correct.
-    if (s_bmi160.chip_id != BMI160_CHIP_ID)
+    if (dev->bmi160.chip_id != BMI160_CHIP_ID)
     {
         printf("%s: Error: expected chip id %02x, but got %02x.\n",
-               __FUNCTION__, BMI160_CHIP_ID, s_bmi160.chip_id);
+               __FUNCTION__, BMI160_CHIP_ID, dev->bmi160.chip_id);
+        bmi160_release(dev);
         bmi160_close(dev);
         return NULL;
     }
@@ -327,6 +469,12 @@ bmi160_context bmi160_init(unsigned int bus, int address, int cs_pin,
     bmi160_set_accelerometer_scale(dev, BMI160_ACC_RANGE_2G);
     bmi160_set_gyroscope_scale(dev, BMI160_GYRO_RANGE_125);
 
+    bmi160_release(dev);
+
+    // both sensors run at 200Hz, so consecutive FIFO frames are this
+    // many sensor time ticks apart
+    dev->frameTicks = BMI160_SENSOR_TIME_HZ / 200;
+
     return dev;
 }
 
@@ -334,17 +482,20 @@ void bmi160_close(bmi160_context dev)
 {
     assert(dev != NULL);
 
-    if (i2cContext)
-        mraa_i2c_stop(i2cContext);
-    i2cContext = NULL;
+    bmi160_uninstall_isr(dev, BMI160_INTERRUPT_INT1);
+    bmi160_uninstall_isr(dev, BMI160_INTERRUPT_INT2);
+
+    if (dev->i2c)
+        mraa_i2c_stop(dev->i2c);
 
-    if (spiContext)
-        mraa_spi_stop(spiContext);
-    spiContext = NULL;
+    if (dev->spi)
+        mraa_spi_stop(dev->spi);
 
-    if (gpioContext)
-        mraa_gpio_close(gpioContext);
-    gpioContext = NULL;
+    if (dev->gpioCS)
+        mraa_gpio_close(dev->gpioCS);
+
+    free(dev->fifoBuffer);
+    free(dev->fifoFrames);
 
     free(dev);
 }
@@ -357,6 +508,8 @@ void bmi160_update(const bmi160_context dev)
     struct bmi160_accel_t accelxyz;
     struct bmi160_mag_xyz_s32_t magxyz;
 
+    bmi160_acquire(dev);
+
     // read gyro data
     bmi160_read_gyro_xyz(&gyroxyz);
 
@@ -372,6 +525,8 @@ void bmi160_update(const bmi160_context dev)
     bmi160_get_sensor_time(&v_sensor_time);
     dev->sensorTime = (unsigned int)v_sensor_time;
 
+    bmi160_release(dev);
+
     dev->accelX = (float)accelxyz.x;
     dev->accelY = (float)accelxyz.y;
     dev->accelZ = (float)accelxyz.z;
@@ -424,7 +579,9 @@ void bmi160_set_accelerometer_scale(const bmi160_context dev,
         break;
     }
 
+    bmi160_acquire(dev);
     bmi160_set_accel_range(v_range);
+    bmi160_release(dev);
 
     return;
 }
@@ -471,7 +628,9 @@ void bmi160_set_gyroscope_scale(const bmi160_context dev,
         break;
     }
 
+    bmi160_acquire(dev);
     bmi160_set_gyro_range(v_range);
+    bmi160_release(dev);
 
     return;
 }
@@ -554,6 +713,8 @@ void bmi160_enable_magnetometer(const bmi160_context dev, bool enable)
 {
     assert(dev != NULL);
 
+    bmi160_acquire(dev);
+
     // butchered from support example
     if (!enable)
     {
@@ -578,6 +739,8 @@ void bmi160_enable_magnetometer(const bmi160_context dev, bool enable)
 
         dev->magEnabled = true;
     }
+
+    bmi160_release(dev);
 }
 
 unsigned int bmi160_get_time(const bmi160_context dev)
@@ -586,3 +749,316 @@ unsigned int bmi160_get_time(const bmi160_context dev)
 
     return dev->sensorTime;
 }
+
+upm_result_t bmi160_fifo_enable(const bmi160_context dev, bool enable,
+                                unsigned int watermark,
+                                BMI160_INTERRUPT_PINS_T intr)
+{
+    assert(dev != NULL);
+
+    // the watermark is set in units of 4 bytes, and the largest frame
+    // (header, mag, gyro and accel) is 21 bytes
+    unsigned int frameLen = 1 + 6 + 6 + (dev->magEnabled ? 8 : 0);
+    unsigned int wm = (watermark * frameLen + BMI160_FIFO_WM_UNIT - 1)
+        / BMI160_FIFO_WM_UNIT;
+
+    if (wm > 0xff)
+    {
+        printf("%s: watermark too large.\n", __FUNCTION__);
+        return UPM_ERROR_OUT_OF_RANGE;
+    }
+
+    u8 channel = (intr == BMI160_INTERRUPT_INT1) ? BMI160_INTR1_MAP_FIFO_WM
+        : BMI160_INTR2_MAP_FIFO_WM;
+    s8 rv = 0;
+
+    bmi160_acquire(dev);
+
+    // disable the watermark interrupt first in any case
+    rv |= bmi160_set_intr_enable_1(BMI160_FIFO_WM_ENABLE, 0);
+    rv |= bmi160_set_intr_fifo_wm(channel, 0);
+
+    rv |= bmi160_set_fifo_header_enable(enable ? 1 : 0);
+    rv |= bmi160_set_fifo_accel_enable(enable ? 1 : 0);
+    rv |= bmi160_set_fifo_gyro_enable(enable ? 1 : 0);
+    rv |= bmi160_set_fifo_mag_enable((enable && dev->magEnabled) ? 1 : 0);
+    rv |= bmi160_set_fifo_time_enable(enable ? 1 : 0);
+
+    if (enable)
+    {
+        // flush the FIFO
+        rv |= bmi160_set_command_register(0xb0);
+        bmi160_delay_ms(BMI160_GEN_READ_WRITE_DELAY);
+
+        if (watermark)
+        {
+            rv |= bmi160_set_fifo_wm((u8)wm);
+
+            // active high, push-pull, edge triggered output
+            rv |= bmi160_set_intr_edge_ctrl(channel, 1);
+            rv |= bmi160_set_intr_level(channel, 1);
+            rv |= bmi160_set_intr_output_type(channel, 0);
+            rv |= bmi160_set_output_enable(channel, 1);
+
+            rv |= bmi160_set_intr_fifo_wm(channel, 1);
+            rv |= bmi160_set_intr_enable_1(BMI160_FIFO_WM_ENABLE, 1);
+        }
+    }
+
+    bmi160_release(dev);
+
+    if (rv)
+    {
+        printf("%s: FIFO configuration failed.\n", __FUNCTION__);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+
+    dev->fifoEnabled = enable;
+    dev->fifoFrameCount = 0;
+    dev->fifoDropped = 0;
+
+    return UPM_SUCCESS;
+}
+
+// FIFO frame headers (header mode)
+#define BMI160_FIFO_HEAD_REGULAR_MASK 0xe3
+#define BMI160_FIFO_HEAD_REGULAR 0x80
+#define BMI160_FIFO_HEAD_MAG 0x10
+#define BMI160_FIFO_HEAD_GYRO 0x08
+#define BMI160_FIFO_HEAD_ACCEL 0x04
+#define BMI160_FIFO_HEAD_SKIP 0x40
+#define BMI160_FIFO_HEAD_SENSOR_TIME 0x44
+#define BMI160_FIFO_HEAD_INPUT_CONFIG 0x48
+// returned when reading past the end of the FIFO
+#define BMI160_FIFO_HEAD_OVER_READ 0x80
+
+static s16 bmi160_fifo_s16(const u8 *buf)
+{
+    return (s16)(buf[0] | (buf[1] << 8));
+}
+
+int bmi160_fifo_update(const bmi160_context dev)
+{
+    assert(dev != NULL);
+
+    if (!dev->fifoEnabled)
+    {
+        printf("%s: FIFO not enabled.\n", __FUNCTION__);
+        return -1;
+    }
+
+    u8 *buf = dev->fifoBuffer + 1;
+    u32 len = 0;
+    s8 rv;
+
+    bmi160_acquire(dev);
+
+    rv = bmi160_fifo_length(&len);
+    if (!rv && len)
+    {
+        // read past the end, so the device appends the sensor time
+        len += BMI160_FIFO_TIME_FRAME_LEN;
+        if (len > BMI160_FIFO_SIZE + BMI160_FIFO_TIME_FRAME_LEN)
+            len = BMI160_FIFO_SIZE + BMI160_FIFO_TIME_FRAME_LEN;
+
+        rv = bmi160_fifo_data(buf, (u16)len);
+    }
+
+    bool haveTime = false;
+    unsigned int sensorTime = 0;
+    unsigned int count = 0;
+    u32 i = 0;
+
+    while (!rv && i < len)
+    {
+        u8 head = buf[i++];
+
+        if ((head & BMI160_FIFO_HEAD_REGULAR_MASK) == BMI160_FIFO_HEAD_REGULAR
+            && head != BMI160_FIFO_HEAD_OVER_READ)
+        {
+            u32 flen = ((head & BMI160_FIFO_HEAD_MAG) ? 8 : 0)
+                + ((head & BMI160_FIFO_HEAD_GYRO) ? 6 : 0)
+                + ((head & BMI160_FIFO_HEAD_ACCEL) ? 6 : 0);
+
+            // partial frame, or no room left: stop here
+            if (i + flen > len || count >= BMI160_FIFO_MAX_FRAMES)
+                break;
+
+            bmi160_frame_t *frame = &dev->fifoFrames[count++];
+            memset((void *)frame, 0, sizeof(bmi160_frame_t));
+
+            // data is ordered mag, gyro, accel
+            if (head & BMI160_FIFO_HEAD_MAG)
+            {
+                const u8 *m = &buf[i];
+                s16 x = (s16)(((s8)m[1] << 5) | (m[0] >> 3));
+                s16 y = (s16)(((s8)m[3] << 5) | (m[2] >> 3));
+                s16 z = (s16)(((s8)m[5] << 7) | (m[4] >> 1));
+                u16 r = (u16)((m[7] << 6) | (m[6] >> 2));
+
+                frame->magX = (float)bmi160_bmm150_mag_compensate_X(x, r);
+                frame->magY = (float)bmi160_bmm150_mag_compensate_Y(y, r);
+                frame->magZ = (float)bmi160_bmm150_mag_compensate_Z(z, r);
+                frame->sensors |= BMI160_FRAME_MAG;
+                i += 8;
+            }
+
+            if (head & BMI160_FIFO_HEAD_GYRO)
+            {
+                frame->gyroX = bmi160_fifo_s16(&buf[i]) / dev->gyroScale;
+                frame->gyroY = bmi160_fifo_s16(&buf[i + 2]) / dev->gyroScale;
+                frame->gyroZ = bmi160_fifo_s16(&buf[i + 4]) / dev->gyroScale;
+                frame->sensors |= BMI160_FRAME_GYRO;
+                i += 6;
+            }
+
+            if (head & BMI160_FIFO_HEAD_ACCEL)
+            {
+                frame->accelX = bmi160_fifo_s16(&buf[i]) / dev->accelScale;
+                frame->accelY = bmi160_fifo_s16(&buf[i + 2])
+                    / dev->accelScale;
+                frame->accelZ = bmi160_fifo_s16(&buf[i + 4])
+                    / dev->accelScale;
+                frame->sensors |= BMI160_FRAME_ACCEL;
+                i += 6;
+            }
+        }
+        else if (head == BMI160_FIFO_HEAD_SKIP)
+        {
+            if (i + 1 > len)
+                break;
+            dev->fifoDropped += buf[i++];
+        }
+        else if (head == BMI160_FIFO_HEAD_SENSOR_TIME)
+        {
+            if (i + 3 > len)
+                break;
+            sensorTime = buf[i] | (buf[i + 1] << 8) | (buf[i + 2] << 16);
+            haveTime = true;
+            i += 3;
+        }
+        else if (head == BMI160_FIFO_HEAD_INPUT_CONFIG)
+        {
+            i++;
+        }
+        else
+        {
+            // over-read or unknown, nothing more to parse
+            break;
+        }
+    }
+
+    if (!rv && !haveTime)
+    {
+        u32 v_sensor_time;
+        rv = bmi160_get_sensor_time(&v_sensor_time);
+        sensorTime = (unsigned int)v_sensor_time;
+    }
+
+    bmi160_release(dev);
+
+    if (rv)
+    {
+        printf("%s: FIFO read failed.\n", __FUNCTION__);
+        dev->fifoFrameCount = 0;
+        return -1;
+    }
+
+    // the sensor time belongs to the newest frame, step back from there
+    unsigned int j;
+    for (j=0; j<count; j++)
+        dev->fifoFrames[j].sensorTime =
+            (sensorTime - (count - 1 - j) * dev->frameTicks)
+            & BMI160_SENSOR_TIME_MASK;
+
+    dev->fifoFrameCount = count;
+
+    return (int)count;
+}
+
+const bmi160_frame_t *bmi160_fifo_get_frames(const bmi160_context dev,
+                                             unsigned int *count)
+{
+    assert(dev != NULL);
+
+    if (count)
+        *count = dev->fifoFrameCount;
+
+    return dev->fifoFrames;
+}
+
+unsigned int bmi160_fifo_get_dropped(const bmi160_context dev)
+{
+    assert(dev != NULL);
+
+    return dev->fifoDropped;
+}
+
+upm_result_t bmi160_install_isr(const bmi160_context dev,
+                                BMI160_INTERRUPT_PINS_T intr, int gpio,
+                                mraa_gpio_edge_t level,
+                                void (*isr)(void *), void *arg)
+{
+    assert(dev != NULL);
+
+    // delete any existing ISR and GPIO context for this interrupt
+    bmi160_uninstall_isr(dev, intr);
+
+    mraa_gpio_context gpio_isr = NULL;
+
+    // create gpio context
+    if (!(gpio_isr = mraa_gpio_init(gpio)))
+    {
+        printf("%s: mraa_gpio_init() failed.\n", __FUNCTION__);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+
+    mraa_gpio_dir(gpio_isr, MRAA_GPIO_IN);
+
+    if (mraa_gpio_isr(gpio_isr, level, isr, arg))
+    {
+        mraa_gpio_close(gpio_isr);
+        printf("%s: mraa_gpio_isr() failed.\n", __FUNCTION__);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+
+    switch (intr)
+    {
+    case BMI160_INTERRUPT_INT1:
+        dev->gpio1 = gpio_isr;
+        break;
+
+    case BMI160_INTERRUPT_INT2:
+        dev->gpio2 = gpio_isr;
+        break;
+    }
+
+    return UPM_SUCCESS;
+}
+
+void bmi160_uninstall_isr(const bmi160_context dev,
+                          BMI160_INTERRUPT_PINS_T intr)
+{
+    assert(dev != NULL);
+
+    switch (intr)
+    {
+    case BMI160_INTERRUPT_INT1:
+        if (dev->gpio1)
+        {
+            mraa_gpio_isr_exit(dev->gpio1);
+            mraa_gpio_close(dev->gpio1);
+            dev->gpio1 = NULL;
+        }
+        break;
+
+    case BMI160_INTERRUPT_INT2:
+        if (dev->gpio2)
+        {
+            mraa_gpio_isr_exit(dev->gpio2);
+            mraa_gpio_close(dev->gpio2);
+            dev->gpio2 = NULL;
+        }
+        break;
+    }
+}
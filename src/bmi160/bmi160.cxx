@@ -112,19 +112,69 @@ unsigned int BMI160::getSensorTime()
     return bmi160_get_time(m_bmi160);
 }
 
+void BMI160::enableFIFO(bool enable, unsigned int watermark,
+                        BMI160_INTERRUPT_PINS_T intr)
+{
+    if (bmi160_fifo_enable(m_bmi160, enable, watermark, intr))
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": bmi160_fifo_enable() failed");
+}
+
+int BMI160::fifoUpdate()
+{
+    int rv = bmi160_fifo_update(m_bmi160);
+
+    if (rv < 0)
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": bmi160_fifo_update() failed");
+
+    return rv;
+}
+
+bmi160_frame_t BMI160::getFIFOFrame(unsigned int index)
+{
+    unsigned int count = 0;
+    const bmi160_frame_t *frames = bmi160_fifo_get_frames(m_bmi160, &count);
+
+    if (index >= count)
+        throw std::out_of_range(string(__FUNCTION__)
+                                + ": index out of range");
+
+    return frames[index];
+}
+
+unsigned int BMI160::getFIFODropped()
+{
+    return bmi160_fifo_get_dropped(m_bmi160);
+}
+
+void BMI160::installISR(BMI160_INTERRUPT_PINS_T intr, int gpio,
+                        mraa::Edge level,
+                        void (*isr)(void *), void *arg)
+{
+    if (bmi160_install_isr(m_bmi160, intr, gpio,
+                           (mraa_gpio_edge_t)level, isr, arg))
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": bmi160_install_isr() failed");
+}
+
+void BMI160::uninstallISR(BMI160_INTERRUPT_PINS_T intr)
+{
+    bmi160_uninstall_isr(m_bmi160, intr);
+}
+
 string BMI160::busRead(int addr, int reg, int len)
 {
-    u8 dev_addr = (u8)(addr & 0xff);
     u8 reg_addr = (u8)(reg & 0xff);
     u8 cnt = (u8)(len & 0xff);
 
     u8 *data = new u8[cnt];
 
-    if (bmi160_bus_read(dev_addr, reg_addr, data, cnt))
+    if (bmi160_read_regs(m_bmi160, reg_addr, data, cnt))
     {
         delete [] data;
         throw std::runtime_error(string(__FUNCTION__)
-                                 + ": bmi160_bus_read() failed");
+                                 + ": bmi160_read_regs() failed");
     }
 
     string dataStr((char *)data, cnt);
@@ -135,10 +185,10 @@ string BMI160::busRead(int addr, int reg, int len)
 
 void BMI160::busWrite(int addr, int reg, string data)
 {
-    u8 dev_addr = (u8)(addr & 0xff);
     u8 reg_addr = (u8)(reg & 0xff);
 
-    if (bmi160_bus_write(dev_addr, reg_addr, (u8 *)data.data(), data.size()))
+    if (bmi160_write_regs(m_bmi160, reg_addr, (u8 *)data.data(),
+                          data.size()))
         throw std::runtime_error(string(__FUNCTION__)
-                                 + ": bmi160_bus_write() failed");
+                                 + ": bmi160_write_regs() failed");
 }
@@ -28,6 +28,10 @@
 #include <stdio.h>
 #include <upm.h>
 
+#include <mraa/i2c.h>
+#include <mraa/spi.h>
+#include <mraa/gpio.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -50,9 +54,16 @@ extern "C" {
    * https://github.com/BoschSensortec/BMI160_driver
    *
    * The Bosch driver code does not provide a mechanism for passing
-   * user data around (like the device context).  For this reason,
-   * only one instance of this driver can be used in a given process,
-   * due to the use of static data in the driver.
+   * user data around (like the device context), and keeps its device
+   * state in global data.  Each context carries its own copy of that
+   * state, which is swapped in while the context is in use.  Access
+   * to the Bosch code is serialized, so multiple devices can be used
+   * in one process, even from different threads.
+   *
+   * The device FIFO can be used in header mode to collect batches of
+   * accelerometer, gyroscope and magnetometer frames, each with its
+   * sensor time, instead of polling the data registers with
+   * bmi160_update().
    *
    * While not all of the functionality of this device is supported
    * initially, the inclusion of the Bosch driver in the source code
@@ -86,6 +97,35 @@ extern "C" {
         // is the magnetometer enabled?
         bool magEnabled;
 
+        // bus contexts
+        mraa_i2c_context i2c;
+        mraa_spi_context spi;
+        // CS pin, if we are using one
+        mraa_gpio_context gpioCS;
+        // whether we are doing I2C or SPI
+        bool isSPI;
+
+        // interrupt pins
+        mraa_gpio_context gpio1;
+        mraa_gpio_context gpio2;
+
+        // Bosch driver state for this device
+        struct bmi160_t bmi160;
+        struct trim_data_t magTrim;
+        u8 magManualAuto;
+
+        // FIFO state
+        bool fifoEnabled;
+        // buffer for FIFO bursts (leading SPI command byte included)
+        u8 *fifoBuffer;
+        // frames parsed from the last FIFO burst
+        bmi160_frame_t *fifoFrames;
+        unsigned int fifoFrameCount;
+        // frames the device reported as skipped due to FIFO overflow
+        unsigned int fifoDropped;
+        // sensor time ticks between two frames at the configured ODR
+        unsigned int frameTicks;
+
     } *bmi160_context;
 
     /**
@@ -197,10 +237,119 @@ extern "C" {
      */
     unsigned int bmi160_get_time(const bmi160_context dev);
 
+    /**
+     * Enable or disable the FIFO.  When enabled, the FIFO is set up in
+     * header mode, collecting accelerometer, gyroscope and (if
+     * enabled) magnetometer frames along with the sensor time, and is
+     * flushed.  If watermark is non-zero, the FIFO watermark
+     * interrupt is mapped to the given interrupt pin, configured as
+     * an active high, push-pull, edge output.  Use
+     * bmi160_install_isr() to be notified and call
+     * bmi160_fifo_update() from there.
+     *
+     * @param dev Device context.
+     * @param enable true to enable the FIFO, false to disable.
+     * @param watermark The number of full frames in the FIFO that
+     * trigger the watermark interrupt, 0 to leave it disabled.
+     * @param intr One of the BMI160_INTERRUPT_PINS_T values, the pin
+     * the watermark interrupt is mapped to.
+     * @return UPM result.
+     */
+    upm_result_t bmi160_fifo_enable(const bmi160_context dev, bool enable,
+                                    unsigned int watermark,
+                                    BMI160_INTERRUPT_PINS_T intr);
+
+    /**
+     * Read the whole FIFO in a single burst and parse it into frames.
+     * The frames remain available through bmi160_fifo_get_frames()
+     * until the next call.  The sensor time of each frame is derived
+     * from the sensor time frame the device appends when the FIFO is
+     * drained, stepping back one output data rate period per frame.
+     *
+     * @param dev Device context.
+     * @return The number of frames read, or -1 on error.
+     */
+    int bmi160_fifo_update(const bmi160_context dev);
+
+    /**
+     * Get the frames read by the last bmi160_fifo_update() call.
+     *
+     * @param dev Device context.
+     * @param count A pointer into which the number of frames will be
+     * returned.
+     * @return A pointer to the first frame, oldest first.
+     */
+    const bmi160_frame_t *bmi160_fifo_get_frames(const bmi160_context dev,
+                                                 unsigned int *count);
+
+    /**
+     * Get the number of frames the device dropped because the FIFO
+     * overflowed, since the FIFO was enabled.
+     *
+     * @param dev Device context.
+     * @return The number of dropped frames.
+     */
+    unsigned int bmi160_fifo_get_dropped(const bmi160_context dev);
+
+    /**
+     * install an interrupt handler.
+     *
+     * @param dev Device context.
+     * @param intr One of the BMI160_INTERRUPT_PINS_T values
+     * specifying which interrupt pin you are installing.
+     * @param gpio GPIO pin to use as interrupt pin
+     * @param level The interrupt trigger level (one of the
+     * mraa_gpio_edge_t values).  Make sure that you have configured
+     * the interrupt pin properly for whatever level you choose.
+     * @param isr The interrupt handler, accepting a void * argument
+     * @param arg The argument to pass to the interrupt handler
+     * @return UPM result.
+     */
+    upm_result_t bmi160_install_isr(const bmi160_context dev,
+                                    BMI160_INTERRUPT_PINS_T intr, int gpio,
+                                    mraa_gpio_edge_t level,
+                                    void (*isr)(void *), void *arg);
+
+    /**
+     * uninstall a previously installed interrupt handler
+     *
+     * @param dev Device context.
+     * @param intr One of the BMI160_INTERRUPT_PINS_T values
+     * specifying which interrupt pin you are removing.
+     */
+    void bmi160_uninstall_isr(const bmi160_context dev,
+                              BMI160_INTERRUPT_PINS_T intr);
+
+    /**
+     * Read registers from a device.  This is the context aware
+     * counterpart of bmi160_bus_read().
+     *
+     * @param dev Device context.
+     * @param reg_addr The register address to access.
+     * @param reg_data A pointer to a buffer in which data will be read into.
+     * @param cnt The number of bytes to read.
+     * @return A return of 0 indicates no errors, non-zero indicates an error.
+     */
+    s8 bmi160_read_regs(const bmi160_context dev, u8 reg_addr, u8 *reg_data,
+                        u8 cnt);
+
+    /**
+     * Write registers on a device.  This is the context aware
+     * counterpart of bmi160_bus_write().
+     *
+     * @param dev Device context.
+     * @param reg_addr The register address to access.
+     * @param reg_data A pointer to a buffer containing data to write.
+     * @param cnt The number of bytes to write.
+     * @return A return of 0 indicates no errors, non-zero indicates an error.
+     */
+    s8 bmi160_write_regs(const bmi160_context dev, u8 reg_addr, u8 *reg_data,
+                         u8 cnt);
+
     /**
      * Perform a bus read.  This function is bus agnostic, and is used
-     * by the bosch code to perform bus reads.  It is exposed here for
-     * those users wishing to perform their own low level accesses.
+     * by the bosch code to perform bus reads on the device currently
+     * in use.  Outside of the driver, prefer bmi160_read_regs().
      * This is a low level function, and should not be used unless you
      * know what you are doing.
      *
@@ -215,8 +364,8 @@ extern "C" {
 
     /**
      * Perform a bus write.  This function is bus agnostic, and is used
-     * by the bosch code to perform bus writes.  It is exposed here for
-     * those users wishing to perform their own low level accesses.
+     * by the bosch code to perform bus writes on the device currently
+     * in use.  Outside of the driver, prefer bmi160_write_regs().
      * This is a low level function, and should not be used unless you
      * know what you are doing.
      *
@@ -23,6 +23,7 @@
  */
 #pragma once
 #include <string>
+#include <mraa/gpio.hpp>
 #include "bmi160.h"
 
 #define BMI160_I2C_BUS 0
@@ -209,13 +210,80 @@ namespace upm {
          */
         unsigned int getSensorTime();
 
+        /**
+         * Enable or disable the FIFO in header mode.  If watermark is
+         * non-zero, the FIFO watermark interrupt is mapped to the
+         * given interrupt pin.  See bmi160_fifo_enable().
+         *
+         * @param enable true to enable the FIFO, false to disable.
+         * @param watermark The number of frames that trigger the
+         * watermark interrupt, 0 to leave it disabled.
+         * @param intr One of the BMI160_INTERRUPT_PINS_T values.
+         * @throws std::runtime_error on failure.
+         */
+        void enableFIFO(bool enable, unsigned int watermark=0,
+                        BMI160_INTERRUPT_PINS_T intr=BMI160_INTERRUPT_INT1);
+
+        /**
+         * Read and parse the contents of the FIFO in a single burst.
+         * The frames can then be retrieved with getFIFOFrame().
+         *
+         * @return The number of frames read.
+         * @throws std::runtime_error on failure.
+         */
+        int fifoUpdate();
+
+        /**
+         * Get a frame read by the last fifoUpdate() call, oldest
+         * first.
+         *
+         * @param index The index of the frame.
+         * @return The frame.
+         * @throws std::out_of_range if index is not a valid frame.
+         */
+        bmi160_frame_t getFIFOFrame(unsigned int index);
+
+        /**
+         * Get the number of frames dropped due to FIFO overflows
+         * since the FIFO was enabled.
+         *
+         * @return The number of dropped frames.
+         */
+        unsigned int getFIFODropped();
+
+        /**
+         * install an interrupt handler.
+         *
+         * @param intr One of the BMI160_INTERRUPT_PINS_T values
+         * specifying which interrupt pin you are installing.
+         * @param gpio GPIO pin to use as interrupt pin.
+         * @param level The interrupt trigger level (one of mraa::Edge
+         * values).  Make sure that you have configured the interrupt pin
+         * properly for whatever level you choose.
+         * @param isr The interrupt handler, accepting a void * argument.
+         * @param arg The argument to pass the the interrupt handler.
+         * @throws std::runtime_error on failure.
+         */
+        void installISR(BMI160_INTERRUPT_PINS_T intr, int gpio,
+                        mraa::Edge level,
+                        void (*isr)(void *), void *arg);
+
+        /**
+         * uninstall a previously installed interrupt handler
+         *
+         * @param intr One of the BMI160_INTERRUPT_PINS_T values
+         * specifying which interrupt pin you are removing.
+         */
+        void uninstallISR(BMI160_INTERRUPT_PINS_T intr);
+
     protected:
         bmi160_context m_bmi160;
 
         /**
          * Perform a bus read.  This function is bus agnostic, and is used
          * by the bosch code to perform bus reads.  It is exposed here for
-         * those users wishing to perform their own low level accesses.
+         * those users wishing to perform their own low level accesses
+         * on this device.
          * This is a low level function, and should not be used unless you
          * know what you are doing.
          *
@@ -230,7 +298,8 @@ namespace upm {
         /**
          * Perform a bus write.  This function is bus agnostic, and is used
          * by the bosch code to perform bus writes.  It is exposed here for
-         * those users wishing to perform their own low level accesses.
+         * those users wishing to perform their own low level accesses
+         * on this device.
          * This is a low level function, and should not be used unless you
          * know what you are doing.
          *
@@ -46,6 +46,42 @@ extern "C" {
         BMI160_GYRO_RANGE_2000
     } BMI160_GYRO_RANGE_T;
 
+    typedef enum {
+        BMI160_INTERRUPT_INT1                      = 0,
+        BMI160_INTERRUPT_INT2
+    } BMI160_INTERRUPT_PINS_T;
+
+    // bits of bmi160_frame_t.sensors, indicating which data a FIFO
+    // frame carries
+    typedef enum {
+        BMI160_FRAME_ACCEL                         = 0x01,
+        BMI160_FRAME_GYRO                          = 0x02,
+        BMI160_FRAME_MAG                           = 0x04
+    } BMI160_FRAME_SENSORS_T;
+
+    // one FIFO frame, scaled the same way as the values returned by
+    // bmi160_get_accelerometer() and friends.
+    typedef struct _bmi160_frame {
+        // BMI160_FRAME_SENSORS_T bits for the data present
+        unsigned int sensors;
+
+        // sensor time (24 bits, 39us units) at which the frame was
+        // sampled
+        unsigned int sensorTime;
+
+        float accelX;
+        float accelY;
+        float accelZ;
+
+        float gyroX;
+        float gyroY;
+        float gyroZ;
+
+        float magX;
+        float magY;
+        float magZ;
+    } bmi160_frame_t;
+
 #ifdef __cplusplus
 }
 #endif
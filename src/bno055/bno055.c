@@ -26,6 +26,8 @@
 
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <time.h>
 
 #include <upm_utilities.h>
 
@@ -50,79 +52,151 @@ static void _clear_data(const bno055_context dev)
     dev->grvX = dev->grvY = dev->grvZ = 0;
 }
 
-// load fusion data
-static upm_result_t _update_fusion_data(const bno055_context dev)
+// decode the sensor output block read by bno055_update().  buf
+// starts at BNO055_REG_ACC_DATA_X_LSB.
+static void _decode_data(const bno055_context dev, const uint8_t *buf)
 {
     assert(dev != NULL);
 
-    // bail (with success code) if we are in config mode, or aren't in
-    // a fusion mode...
-    if (dev->currentMode == BNO055_OPERATION_MODE_CONFIGMODE ||
-        dev->currentMode < BNO055_OPERATION_MODE_IMU)
-        return UPM_SUCCESS;
-
-    if (bno055_set_page(dev, 0, false))
-        return UPM_ERROR_OPERATION_FAILED;
-
-    // FIXME/MAYBE? - abort early if SYS calibration is == 0?
-
-    const int fusionBytes = 26;
-    uint8_t buf[fusionBytes];
+    // non-fusion data
+    dev->accX = INT16_TO_FLOAT(buf[0], buf[1]);
+    dev->accY = INT16_TO_FLOAT(buf[2], buf[3]);
+    dev->accZ = INT16_TO_FLOAT(buf[4], buf[5]);
 
-    if (bno055_read_regs(dev, BNO055_REG_EUL_HEADING_LSB, buf, fusionBytes))
-        return UPM_ERROR_OPERATION_FAILED;
+    dev->magX = INT16_TO_FLOAT(buf[6], buf[7]);
+    dev->magY = INT16_TO_FLOAT(buf[8], buf[9]);
+    dev->magZ = INT16_TO_FLOAT(buf[10], buf[11]);
 
-    dev->eulHeading = INT16_TO_FLOAT(buf[0], buf[1]);
-    dev->eulRoll    = INT16_TO_FLOAT(buf[2], buf[3]);
-    dev->eulPitch   = INT16_TO_FLOAT(buf[4], buf[5]);
+    dev->gyrX = INT16_TO_FLOAT(buf[12], buf[13]);
+    dev->gyrY = INT16_TO_FLOAT(buf[14], buf[15]);
+    dev->gyrZ = INT16_TO_FLOAT(buf[16], buf[17]);
 
-    dev->quaW       = INT16_TO_FLOAT(buf[6], buf[7]);
-    dev->quaX       = INT16_TO_FLOAT(buf[8], buf[9]);
-    dev->quaY       = INT16_TO_FLOAT(buf[10], buf[11]);
-    dev->quaZ       = INT16_TO_FLOAT(buf[12], buf[13]);
+    // fusion data is only valid in a fusion mode, leave it cleared
+    // otherwise.
+    // FIXME/MAYBE? - ignore if SYS calibration is == 0?
+    if (dev->currentMode >= BNO055_OPERATION_MODE_IMU)
+    {
+        dev->eulHeading = INT16_TO_FLOAT(buf[18], buf[19]);
+        dev->eulRoll    = INT16_TO_FLOAT(buf[20], buf[21]);
+        dev->eulPitch   = INT16_TO_FLOAT(buf[22], buf[23]);
+
+        dev->quaW       = INT16_TO_FLOAT(buf[24], buf[25]);
+        dev->quaX       = INT16_TO_FLOAT(buf[26], buf[27]);
+        dev->quaY       = INT16_TO_FLOAT(buf[28], buf[29]);
+        dev->quaZ       = INT16_TO_FLOAT(buf[30], buf[31]);
+
+        dev->liaX       = INT16_TO_FLOAT(buf[32], buf[33]);
+        dev->liaY       = INT16_TO_FLOAT(buf[34], buf[35]);
+        dev->liaZ       = INT16_TO_FLOAT(buf[36], buf[37]);
+
+        dev->grvX       = INT16_TO_FLOAT(buf[38], buf[39]);
+        dev->grvY       = INT16_TO_FLOAT(buf[40], buf[41]);
+        dev->grvZ       = INT16_TO_FLOAT(buf[42], buf[43]);
+    }
 
-    dev->liaX       = INT16_TO_FLOAT(buf[14], buf[15]);
-    dev->liaY       = INT16_TO_FLOAT(buf[16], buf[17]);
-    dev->liaZ       = INT16_TO_FLOAT(buf[18], buf[19]);
+    // temperature, always in Celsius
+    dev->temperature = (float)((int8_t)buf[44]);
+}
 
-    dev->grvX       = INT16_TO_FLOAT(buf[20], buf[21]);
-    dev->grvY       = INT16_TO_FLOAT(buf[22], buf[23]);
-    dev->grvZ       = INT16_TO_FLOAT(buf[24], buf[25]);
+// monotonic time in microseconds
+static uint64_t _now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
 
-    return UPM_SUCCESS;
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
 }
 
-// update non-fusion data
-static upm_result_t _update_non_fusion_data(const bno055_context dev)
+// streaming thread, one bno055_update() per period
+static void *_stream_thread(void *ctx)
 {
+    bno055_context dev = (bno055_context)ctx;
     assert(dev != NULL);
 
-    // bail (with success code) if we are in config mode...
-    if (dev->currentMode == BNO055_OPERATION_MODE_CONFIGMODE)
-        return UPM_SUCCESS;
-
-    if (bno055_set_page(dev, 0, false))
-        return UPM_ERROR_OPERATION_FAILED;
-
-    const int nonFusionBytes = 18;
-    uint8_t buf[nonFusionBytes];
-
-    if (bno055_read_regs(dev, BNO055_REG_ACC_DATA_X_LSB, buf, nonFusionBytes))
-        return UPM_ERROR_OPERATION_FAILED;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
 
-    dev->accX = INT16_TO_FLOAT(buf[0], buf[1]);
-    dev->accY = INT16_TO_FLOAT(buf[2], buf[3]);
-    dev->accZ = INT16_TO_FLOAT(buf[4], buf[5]);
-
-    dev->magX = INT16_TO_FLOAT(buf[6], buf[7]);
-    dev->magY = INT16_TO_FLOAT(buf[8], buf[9]);
-    dev->magZ = INT16_TO_FLOAT(buf[10], buf[11]);
-
-    dev->gyrX = INT16_TO_FLOAT(buf[12], buf[13]);
-    dev->gyrY = INT16_TO_FLOAT(buf[14], buf[15]);
-    dev->gyrZ = INT16_TO_FLOAT(buf[16], buf[17]);
+    while (__atomic_load_n(&dev->streaming, __ATOMIC_ACQUIRE))
+    {
+        next.tv_nsec += dev->stream_period_us * 1000;
+        while (next.tv_nsec >= 1000000000)
+        {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000;
+        }
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL)
+               == EINTR)
+            ;
+
+        if (!__atomic_load_n(&dev->streaming, __ATOMIC_ACQUIRE))
+            break;
+
+        BNO055_FRAME_T frame;
+        frame.timestamp = _now_us();
+
+        if (bno055_update(dev) == UPM_SUCCESS)
+        {
+            bno055_get_euler_angles(dev, &frame.heading, &frame.roll,
+                                    &frame.pitch);
+            bno055_get_quaternions(dev, &frame.quaW, &frame.quaX,
+                                   &frame.quaY, &frame.quaZ);
+            bno055_get_linear_acceleration(dev, &frame.liaX, &frame.liaY,
+                                           &frame.liaZ);
+            bno055_get_gravity_vectors(dev, &frame.grvX, &frame.grvY,
+                                       &frame.grvZ);
+            bno055_get_accelerometer(dev, &frame.accX, &frame.accY,
+                                     &frame.accZ);
+            bno055_get_magnetometer(dev, &frame.magX, &frame.magY,
+                                    &frame.magZ);
+            bno055_get_gyroscope(dev, &frame.gyrX, &frame.gyrY,
+                                 &frame.gyrZ);
+            frame.temperature = bno055_get_temperature(dev);
+
+            pthread_mutex_lock(&dev->stream_lock);
+
+            unsigned int idx = (dev->stream_head + dev->stream_count)
+                % dev->stream_ring_size;
+            dev->stream_ring[idx] = frame;
+
+            if (dev->stream_count < dev->stream_ring_size)
+                dev->stream_count++;
+            else
+            {
+                // full, drop the oldest
+                dev->stream_head = (dev->stream_head + 1)
+                    % dev->stream_ring_size;
+                dev->stream_overruns++;
+            }
+
+            pthread_cond_broadcast(&dev->stream_cond);
+            pthread_mutex_unlock(&dev->stream_lock);
+
+            if (dev->stream_func)
+                dev->stream_func(&frame, dev->stream_arg);
+        }
+
+        // If we have fallen a full period or more behind, skip ahead
+        // rather than issuing a burst of back to back reads.
+        uint64_t now = _now_us();
+        uint64_t deadline = ((uint64_t)next.tv_sec * 1000000)
+            + (next.tv_nsec / 1000);
+
+        if (now >= deadline + dev->stream_period_us)
+        {
+            uint64_t skipped = (now - deadline) / dev->stream_period_us;
+            deadline += skipped * dev->stream_period_us;
+
+            next.tv_sec = deadline / 1000000;
+            next.tv_nsec = (deadline % 1000000) * 1000;
+
+            pthread_mutex_lock(&dev->stream_lock);
+            dev->stream_missed += skipped;
+            pthread_mutex_unlock(&dev->stream_lock);
+        }
+    }
 
-    return UPM_SUCCESS;
+    return NULL;
 }
 
 // init
@@ -137,6 +211,16 @@ bno055_context bno055_init(int bus, uint8_t addr)
     // zero out context
     memset((void *)dev, 0, sizeof(struct _bno055_context));
 
+    pthread_mutex_init(&dev->stream_lock, NULL);
+
+    // stream_cond is used for timed waits, so base it on the
+    // monotonic clock
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&dev->stream_cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
     // make sure MRAA is initialized
     int mraa_rv;
     if ((mraa_rv = mraa_init()) != MRAA_SUCCESS)
@@ -231,11 +315,16 @@ void bno055_close(bno055_context dev)
 {
     assert(dev != NULL);
 
+    bno055_stream_stop(dev);
     bno055_uninstall_isr(dev);
 
     if (dev->i2c)
         mraa_i2c_stop(dev->i2c);
 
+    free(dev->stream_ring);
+    pthread_cond_destroy(&dev->stream_cond);
+    pthread_mutex_destroy(&dev->stream_lock);
+
     free(dev);
 }
 
@@ -243,21 +332,32 @@ upm_result_t bno055_update(const bno055_context dev)
 {
     assert(dev != NULL);
 
+    // page 0 is cached, so this only costs a transaction if the last
+    // access was to page 1
     if (bno055_set_page(dev, 0, false))
         return UPM_ERROR_OPERATION_FAILED;
 
-    // temperature first, always in Celsius
-    uint8_t tempreg = 0;
-    if (bno055_read_reg(dev, BNO055_REG_TEMPERATURE, &tempreg))
-        return UPM_ERROR_OPERATION_FAILED;
+    // in config mode, only the temperature is available
+    if (dev->currentMode == BNO055_OPERATION_MODE_CONFIGMODE)
+    {
+        uint8_t tempreg = 0;
+        if (bno055_read_reg(dev, BNO055_REG_TEMPERATURE, &tempreg))
+            return UPM_ERROR_OPERATION_FAILED;
 
-    dev->temperature = (float)((int8_t)tempreg);
+        dev->temperature = (float)((int8_t)tempreg);
 
-    if (_update_fusion_data(dev))
-        return UPM_ERROR_OPERATION_FAILED;
-    if (_update_non_fusion_data(dev))
+        return UPM_SUCCESS;
+    }
+
+    // The sensor, fusion and temperature registers are contiguous,
+    // so grab them all at once.
+    uint8_t buf[BNO055_SNAPSHOT_DATA_SIZE];
+    if (bno055_read_regs(dev, BNO055_REG_ACC_DATA_X_LSB, buf,
+                         BNO055_SNAPSHOT_DATA_SIZE))
         return UPM_ERROR_OPERATION_FAILED;
 
+    _decode_data(dev, buf);
+
     return UPM_SUCCESS;
 }
 
@@ -1055,3 +1155,159 @@ void bno055_uninstall_isr(const bno055_context dev)
         dev->gpio = NULL;
     }
 }
+
+upm_result_t bno055_stream_start(const bno055_context dev,
+                                 unsigned int rate_hz,
+                                 unsigned int ring_size,
+                                 BNO055_STREAM_FUNC_T func, void *arg)
+{
+    assert(dev != NULL);
+
+    bno055_stream_stop(dev);
+
+    if (!rate_hz)
+        rate_hz = BNO055_FUSION_RATE_HZ;
+
+    if (rate_hz > 1000)
+    {
+        printf("%s: rate_hz must be 1000 or less.\n", __FUNCTION__);
+        return UPM_ERROR_INVALID_PARAMETER;
+    }
+
+    if (!ring_size)
+        ring_size = BNO055_STREAM_RING_SIZE;
+
+    free(dev->stream_ring);
+    dev->stream_ring_size = 0;
+    if (!(dev->stream_ring = calloc(ring_size, sizeof(BNO055_FRAME_T))))
+    {
+        printf("%s: calloc() failed.\n", __FUNCTION__);
+        return UPM_ERROR_NO_RESOURCES;
+    }
+
+    dev->stream_ring_size = ring_size;
+    dev->stream_head = 0;
+    dev->stream_count = 0;
+    dev->stream_overruns = 0;
+    dev->stream_missed = 0;
+
+    dev->stream_period_us = 1000000 / rate_hz;
+    dev->stream_func = func;
+    dev->stream_arg = arg;
+
+    // we only read page 0 from here on, so make sure we are there
+    // before we begin
+    if (bno055_set_page(dev, 0, false))
+        return UPM_ERROR_OPERATION_FAILED;
+
+    __atomic_store_n(&dev->streaming, true, __ATOMIC_RELEASE);
+
+    if (pthread_create(&dev->stream_thread, NULL, _stream_thread,
+                       (void *)dev))
+    {
+        __atomic_store_n(&dev->streaming, false, __ATOMIC_RELEASE);
+        printf("%s: pthread_create() failed.\n", __FUNCTION__);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+
+    return UPM_SUCCESS;
+}
+
+void bno055_stream_stop(const bno055_context dev)
+{
+    assert(dev != NULL);
+
+    if (!__atomic_load_n(&dev->streaming, __ATOMIC_ACQUIRE))
+        return;
+
+    __atomic_store_n(&dev->streaming, false, __ATOMIC_RELEASE);
+    pthread_join(dev->stream_thread, NULL);
+
+    // wake up any waiting readers
+    pthread_mutex_lock(&dev->stream_lock);
+    pthread_cond_broadcast(&dev->stream_cond);
+    pthread_mutex_unlock(&dev->stream_lock);
+}
+
+upm_result_t bno055_stream_read(const bno055_context dev,
+                                BNO055_FRAME_T *frame, int timeout_ms)
+{
+    assert(dev != NULL);
+    assert(frame != NULL);
+
+    if (!dev->stream_ring)
+        return UPM_ERROR_NO_RESOURCES;
+
+    struct timespec deadline;
+    if (timeout_ms > 0)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&dev->stream_lock);
+
+    int rv = 0;
+    while (!dev->stream_count && timeout_ms != 0 && rv != ETIMEDOUT
+           && __atomic_load_n(&dev->streaming, __ATOMIC_ACQUIRE))
+    {
+        if (timeout_ms > 0)
+            rv = pthread_cond_timedwait(&dev->stream_cond, &dev->stream_lock,
+                                        &deadline);
+        else
+            pthread_cond_wait(&dev->stream_cond, &dev->stream_lock);
+    }
+
+    if (!dev->stream_count)
+    {
+        pthread_mutex_unlock(&dev->stream_lock);
+        return UPM_ERROR_TIMED_OUT;
+    }
+
+    *frame = dev->stream_ring[dev->stream_head];
+    dev->stream_head = (dev->stream_head + 1) % dev->stream_ring_size;
+    dev->stream_count--;
+
+    pthread_mutex_unlock(&dev->stream_lock);
+
+    return UPM_SUCCESS;
+}
+
+unsigned int bno055_stream_pending(const bno055_context dev)
+{
+    assert(dev != NULL);
+
+    pthread_mutex_lock(&dev->stream_lock);
+    unsigned int count = dev->stream_count;
+    pthread_mutex_unlock(&dev->stream_lock);
+
+    return count;
+}
+
+uint32_t bno055_stream_overruns(const bno055_context dev)
+{
+    assert(dev != NULL);
+
+    pthread_mutex_lock(&dev->stream_lock);
+    uint32_t overruns = dev->stream_overruns;
+    pthread_mutex_unlock(&dev->stream_lock);
+
+    return overruns;
+}
+
+uint32_t bno055_stream_missed(const bno055_context dev)
+{
+    assert(dev != NULL);
+
+    pthread_mutex_lock(&dev->stream_lock);
+    uint32_t missed = dev->stream_missed;
+    pthread_mutex_unlock(&dev->stream_lock);
+
+    return missed;
+}
@@ -59,6 +59,39 @@ void BNO055::update()
                                  + ": bno055_update() failed");
 }
 
+void BNO055::startStreaming(unsigned int rateHz, unsigned int ringSize,
+                            BNO055_STREAM_FUNC_T func, void *arg)
+{
+    if (bno055_stream_start(m_bno055, rateHz, ringSize, func, arg))
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": bno055_stream_start() failed");
+}
+
+void BNO055::stopStreaming()
+{
+    bno055_stream_stop(m_bno055);
+}
+
+bool BNO055::streamRead(BNO055_FRAME_T *frame, int timeoutMs)
+{
+    return (bno055_stream_read(m_bno055, frame, timeoutMs) == UPM_SUCCESS);
+}
+
+unsigned int BNO055::streamPending()
+{
+    return bno055_stream_pending(m_bno055);
+}
+
+uint32_t BNO055::getStreamOverruns()
+{
+    return bno055_stream_overruns(m_bno055);
+}
+
+uint32_t BNO055::getStreamMissed()
+{
+    return bno055_stream_missed(m_bno055);
+}
+
 uint8_t BNO055::readReg(uint8_t reg)
 {
     uint8_t rv = 0;
@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <pthread.h>
 #include <upm.h>
 
 #include <mraa/i2c.h>
@@ -39,6 +40,9 @@
 extern "C" {
 #endif
 
+// default number of samples held by the streaming ring
+#define BNO055_STREAM_RING_SIZE (64)
+
     /**
      * @file bno055.h
      * @library bno055
@@ -106,6 +110,26 @@ extern "C" {
         float grvX;
         float grvY;
         float grvZ;
+
+        // streaming mode
+        pthread_t stream_thread;
+        bool streaming;
+        unsigned int stream_period_us;
+        BNO055_STREAM_FUNC_T stream_func;
+        void *stream_arg;
+
+        // streaming ring, the oldest sample is overwritten when full
+        pthread_mutex_t stream_lock;
+        pthread_cond_t stream_cond;
+        BNO055_FRAME_T *stream_ring;
+        unsigned int stream_ring_size;
+        unsigned int stream_head;
+        unsigned int stream_count;
+
+        // samples overwritten before being read, and sample periods
+        // skipped because a read did not complete in time
+        uint32_t stream_overruns;
+        uint32_t stream_missed;
     } *bno055_context;
 
     /**
@@ -134,13 +158,96 @@ extern "C" {
     void bno055_close(bno055_context dev);
 
     /**
-     * Update the internal stored values from sensor data.
+     * Update the internal stored values from sensor data.  The
+     * sensor, fusion and temperature data are read in a single I2C
+     * transaction.
      *
      * @param dev The device context.
      * @return UPM result.
      */
     upm_result_t bno055_update(const bno055_context dev);
 
+    /**
+     * Start streaming mode.  A thread reads the complete sensor
+     * output block (see bno055_update()) once per period, paced on
+     * absolute deadlines so that the sample rate does not drift, and
+     * delivers each timestamped sample to an optional callback and to
+     * a ring from which it can be retrieved with bno055_stream_read().
+     *
+     * The BNO055 has no data ready interrupt, so the rate should
+     * normally match the fusion output rate (BNO055_FUSION_RATE_HZ).
+     * Several devices may stream on the same I2C bus, since each
+     * sample requires only a single 45 byte transaction.
+     *
+     * While streaming, no other functions that access the device
+     * should be called.  Stop streaming first.
+     *
+     * @param dev The device context.
+     * @param rate_hz The sample rate in Hz.  Pass 0 to use
+     * BNO055_FUSION_RATE_HZ.
+     * @param ring_size The number of samples the ring can hold.  Pass
+     * 0 to use BNO055_STREAM_RING_SIZE.
+     * @param func A function to call with each sample, or NULL.
+     * @param arg An argument to pass to func.
+     * @return UPM result.
+     */
+    upm_result_t bno055_stream_start(const bno055_context dev,
+                                     unsigned int rate_hz,
+                                     unsigned int ring_size,
+                                     BNO055_STREAM_FUNC_T func, void *arg);
+
+    /**
+     * Stop streaming mode.  Samples remaining in the ring can still
+     * be retrieved with bno055_stream_read().
+     *
+     * @param dev The device context.
+     */
+    void bno055_stream_stop(const bno055_context dev);
+
+    /**
+     * Retrieve the oldest sample from the streaming ring.
+     *
+     * @param dev The device context.
+     * @param frame A pointer to a BNO055_FRAME_T in which the sample
+     * will be stored.
+     * @param timeout_ms The maximum number of milliseconds to wait
+     * for a sample.  0 means don't wait, a negative value means wait
+     * forever (or until streaming is stopped).
+     * @return UPM_SUCCESS if a sample was returned,
+     * UPM_ERROR_TIMED_OUT if none was available, or
+     * UPM_ERROR_NO_RESOURCES if streaming was never started.
+     */
+    upm_result_t bno055_stream_read(const bno055_context dev,
+                                    BNO055_FRAME_T *frame, int timeout_ms);
+
+    /**
+     * Return the number of samples waiting in the streaming ring.
+     *
+     * @param dev The device context.
+     * @return The number of samples waiting.
+     */
+    unsigned int bno055_stream_pending(const bno055_context dev);
+
+    /**
+     * Return the number of samples that were overwritten in the
+     * streaming ring before they were read.  This is reset by
+     * bno055_stream_start().
+     *
+     * @param dev The device context.
+     * @return The number of samples lost.
+     */
+    uint32_t bno055_stream_overruns(const bno055_context dev);
+
+    /**
+     * Return the number of sample periods that were skipped because
+     * a read did not complete in time (for example due to a busy I2C
+     * bus).  This is reset by bno055_stream_start().
+     *
+     * @param dev The device context.
+     * @return The number of periods skipped.
+     */
+    uint32_t bno055_stream_missed(const bno055_context dev);
+
     /**
      * Return the chip ID.
      *
@@ -128,12 +128,75 @@ namespace upm {
         virtual ~BNO055();
 
         /**
-         * Update the internal stored values from sensor data.
+         * Update the internal stored values from sensor data.  The
+         * sensor, fusion and temperature data are read in a single
+         * I2C transaction.
          *
          * @throws std::runtime_error on failure.
          */
         void update();
 
+        /**
+         * Start streaming mode.  A thread reads the sensor data once
+         * per period on absolute deadlines, and delivers each
+         * timestamped sample to an optional callback and to a ring
+         * from which it can be retrieved with streamRead().  No other
+         * methods that access the device should be called while
+         * streaming.
+         *
+         * @param rateHz The sample rate in Hz.  The default is
+         * BNO055_FUSION_RATE_HZ.
+         * @param ringSize The number of samples the ring can hold.
+         * The default is BNO055_STREAM_RING_SIZE.
+         * @param func A function to call with each sample, or NULL.
+         * @param arg An argument to pass to func.
+         * @throws std::runtime_error on failure.
+         */
+        void startStreaming(unsigned int rateHz=BNO055_FUSION_RATE_HZ,
+                            unsigned int ringSize=BNO055_STREAM_RING_SIZE,
+                            BNO055_STREAM_FUNC_T func=NULL, void *arg=NULL);
+
+        /**
+         * Stop streaming mode.  Samples remaining in the ring can
+         * still be retrieved with streamRead().
+         */
+        void stopStreaming();
+
+        /**
+         * Retrieve the oldest sample from the streaming ring.
+         *
+         * @param frame A pointer to a BNO055_FRAME_T in which the
+         * sample will be stored.
+         * @param timeoutMs The maximum number of milliseconds to wait
+         * for a sample.  0 means don't wait, a negative value means
+         * wait forever (or until streaming is stopped).
+         * @return True if a sample was retrieved, false otherwise.
+         */
+        bool streamRead(BNO055_FRAME_T *frame, int timeoutMs);
+
+        /**
+         * Return the number of samples waiting in the streaming ring.
+         *
+         * @return The number of samples waiting.
+         */
+        unsigned int streamPending();
+
+        /**
+         * Return the number of samples that were overwritten in the
+         * streaming ring before they were read.
+         *
+         * @return The number of samples lost.
+         */
+        uint32_t getStreamOverruns();
+
+        /**
+         * Return the number of sample periods that were skipped
+         * because a read did not complete in time.
+         *
+         * @return The number of periods skipped.
+         */
+        uint32_t getStreamMissed();
+
         /**
          * Return the chip ID.
          *
@@ -32,6 +32,14 @@
 // number of bytes of stored calibration data
 #define BNO055_CALIBRATION_DATA_SIZE (22)
 
+// number of bytes in the sensor output block read by bno055_update(),
+// BNO055_REG_ACC_DATA_X_LSB (0x08) through BNO055_REG_TEMPERATURE
+// (0x34)
+#define BNO055_SNAPSHOT_DATA_SIZE (45)
+
+// The rate at which the fusion outputs are updated by the device
+#define BNO055_FUSION_RATE_HZ (100)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -820,6 +828,55 @@ extern "C" {
         BNO055_SLOPE_SAMPLES_64                 = 3
     } BNO055_SLOPE_SAMPLES_T;
 
+    /**
+     * A timestamped sample produced by the streaming mode.  All
+     * values are scaled to the units currently selected, as returned
+     * by the corresponding bno055_get_*() functions.  Fusion values
+     * are 0 when not in a fusion mode.
+     */
+    typedef struct {
+        // microseconds (CLOCK_MONOTONIC) at which the sample was read
+        uint64_t timestamp;
+
+        float heading;
+        float roll;
+        float pitch;
+
+        float quaW;
+        float quaX;
+        float quaY;
+        float quaZ;
+
+        float liaX;
+        float liaY;
+        float liaZ;
+
+        float grvX;
+        float grvY;
+        float grvZ;
+
+        float accX;
+        float accY;
+        float accZ;
+
+        float magX;
+        float magY;
+        float magZ;
+
+        float gyrX;
+        float gyrY;
+        float gyrZ;
+
+        float temperature;
+    } BNO055_FRAME_T;
+
+    /**
+     * Streaming mode callback, called from the streaming thread for
+     * every sample.
+     */
+    typedef void (*BNO055_STREAM_FUNC_T)(const BNO055_FRAME_T *frame,
+                                         void *arg);
+
 #ifdef __cplusplus
 }
 #endif
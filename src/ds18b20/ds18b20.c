@@ -36,7 +36,20 @@ struct _ds18b20_info_t {
 
 // internal utility function forward to read temperature from a single
 // device
-static float readSingleTemp(const ds18b20_context dev, unsigned int index);
+static bool readSingleTemp(const ds18b20_context dev, unsigned int index,
+                           float *temp);
+
+// conversion time in ms for each resolution
+static unsigned int convertTime(DS18B20_RESOLUTIONS_T res)
+{
+    switch (res)
+    {
+    case DS18B20_RESOLUTION_9BITS: return 94;
+    case DS18B20_RESOLUTION_10BITS: return 188;
+    case DS18B20_RESOLUTION_11BITS: return 375;
+    default: return 750;
+    }
+}
 
 ds18b20_context ds18b20_init(unsigned int uart)
 {
@@ -171,6 +184,12 @@ ds18b20_context ds18b20_init(unsigned int uart)
         mraa_uart_ow_reset(dev->ow);
     }
 
+    // find out whether any device is parasitically powered.  Those
+    // pull the bus low during the read time slot.
+    mraa_uart_ow_command(dev->ow, DS18B20_CMD_READ_POWER_SUPPLY, NULL);
+    dev->parasitic = !mraa_uart_ow_bit(dev->ow, 1);
+    mraa_uart_ow_reset(dev->ow);
+
     return dev;
 }
 
@@ -196,74 +215,142 @@ void ds18b20_update(const ds18b20_context dev, int index)
         return;
     }
 
-    // should we update all of them?
-    bool doAll = (index < 0) ? true : false;
+    // if we want to update all of them, we broadcast the convert
+    // command to all of them, then wait.  This will be faster,
+    // timey-wimey wise, then converting, sleeping, and reading each
+    // individual sensor.
+    if (index < 0)
+    {
+        if (ds18b20_start_conversion(dev) == UPM_SUCCESS)
+            ds18b20_collect(dev);
+        return;
+    }
+
+    mraa_uart_ow_command(dev->ow, DS18B20_CMD_CONVERT,
+                         dev->devices[index].id);
+
+    dev->converting = true;
+    dev->convertTime = convertTime(dev->devices[index].resolution);
+    upm_clock_init(&dev->convertClock);
+
+    // wait for conversion to finish
+    while (!ds18b20_conversion_done(dev))
+        upm_delay_ms(1);
 
-    if (doAll)
+    readSingleTemp(dev, index, &dev->devices[index].temperature);
+}
+
+upm_result_t ds18b20_start_conversion(const ds18b20_context dev)
+{
+    assert(dev != NULL);
+
+    // a NULL id issues a Skip ROM, addressing all devices at once
+    if (mraa_uart_ow_command(dev->ow, DS18B20_CMD_CONVERT, NULL)
+        != MRAA_SUCCESS)
+    {
+        printf("%s: mraa_uart_ow_command() failed\n", __FUNCTION__);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+
+    // the slowest device determines how long we may have to wait
+    dev->convertTime = 0;
+    for (unsigned int i=0; i<dev->numDevices; i++)
     {
-        // if we want to update all of them, we will first send the
-        // convert command to all of them, then wait.  This will be
-        // faster, timey-wimey wise, then converting, sleeping, and
-        // reading each individual sensor.
-        for (unsigned int i=0; i<dev->numDevices; i++)
-            mraa_uart_ow_command(dev->ow, DS18B20_CMD_CONVERT, dev->devices[i].id);
+        unsigned int t = convertTime(dev->devices[i].resolution);
+        if (t > dev->convertTime)
+            dev->convertTime = t;
     }
-    else
-        mraa_uart_ow_command(dev->ow, DS18B20_CMD_CONVERT, dev->devices[index].id);
 
-    // wait for conversion(s) to finish
-    upm_delay_ms(750); // 750ms max
+    dev->converting = true;
+    upm_clock_init(&dev->convertClock);
+
+    return UPM_SUCCESS;
+}
+
+bool ds18b20_conversion_done(const ds18b20_context dev)
+{
+    assert(dev != NULL);
+
+    if (!dev->converting)
+        return true;
+
+    // devices hold the bus low during a read time slot while
+    // converting, unless they are parasitically powered
+    if (upm_elapsed_ms(&dev->convertClock) >= dev->convertTime
+        || (!dev->parasitic && mraa_uart_ow_bit(dev->ow, 1)))
+        dev->converting = false;
 
-    if (doAll)
+    return !dev->converting;
+}
+
+upm_result_t ds18b20_collect(const ds18b20_context dev)
+{
+    assert(dev != NULL);
+
+    while (!ds18b20_conversion_done(dev))
+        upm_delay_ms(1);
+
+    upm_result_t rv = UPM_SUCCESS;
+
+    for (unsigned int i=0; i<dev->numDevices; i++)
     {
-        for (unsigned int i=0; i<dev->numDevices; i++)
-            dev->devices[i].temperature = readSingleTemp(dev, i);
+        if (!readSingleTemp(dev, i, &dev->devices[i].temperature))
+            rv = UPM_ERROR_OPERATION_FAILED;
     }
-    else
-        dev->devices[index].temperature = readSingleTemp(dev, index);
+
+    return rv;
 }
 
-// utility function to read temp data from a single sensor
-static float readSingleTemp(const ds18b20_context dev, unsigned int index)
+// utility function to read temp data from a single sensor.  If the
+// read fails, temp is left untouched and false is returned.
+static bool readSingleTemp(const ds18b20_context dev, unsigned int index,
+                           float *temp)
 {
     assert(dev != NULL);
 
     if (index >= dev->numDevices)
     {
         printf("%s: device index %d out of range\n", __FUNCTION__, index);
-        return 0.0;
+        return false;
     }
 
     static const int numScratch = 9;
     uint8_t scratch[numScratch];
+    uint8_t crc = 0;
+    int retries;
 
-    // read the 9-byte scratchpad
-    mraa_uart_ow_command(dev->ow, DS18B20_CMD_READ_SCRATCHPAD,
-                         dev->devices[index].id);
-    int i;
-    for (i=0; i<numScratch; i++)
-        scratch[i] = (uint8_t)mraa_uart_ow_read_byte(dev->ow);
-
-    // validate cksum -- if we get an error, we will warn and simply
-    // return the current (previously read) temperature
-    uint8_t crc = mraa_uart_ow_crc8(scratch, 8);
+    // read the 9-byte scratchpad, retrying on a bad cksum.  If we
+    // still get an error, we will warn and keep the current
+    // (previously read) temperature.
+    for (retries=0; retries<=DS18B20_SCRATCHPAD_RETRIES; retries++)
+    {
+        mraa_uart_ow_command(dev->ow, DS18B20_CMD_READ_SCRATCHPAD,
+                             dev->devices[index].id);
+        int i;
+        for (i=0; i<numScratch; i++)
+            scratch[i] = (uint8_t)mraa_uart_ow_read_byte(dev->ow);
+
+        crc = mraa_uart_ow_crc8(scratch, 8);
+        if (crc == scratch[8])
+            break;
+    }
 
     if (crc != scratch[8])
     {
         printf("%s: crc check failed for device %d.  Got %02x, expected %02x."
-               " Returning previously measured temperature\n",
+               " Keeping previously measured temperature\n",
                __FUNCTION__, index, scratch[8], crc);
-        return dev->devices[index].temperature;
+        return false;
     }
 
     // check the sign bit(s)
     bool negative = (scratch[1] & 0x80) ? true : false;
 
     // shift everything into position
-    int16_t temp = (scratch[1] << 8) | scratch[0];
+    int16_t t = (scratch[1] << 8) | scratch[0];
 
     // grab the fractional
-    uint8_t frac = temp & 0x0f;
+    uint8_t frac = t & 0x0f;
 
     // depending on the resolution, some frac bits should be ignored, so
     // we mask them off.  For 12bits, all bits are valid so we leve them
@@ -283,14 +370,15 @@ static float readSingleTemp(const ds18b20_context dev, unsigned int index)
     }
 
     // remove the fractional with extreme prejudice
-    temp >>= 4;
+    t >>= 4;
 
     // compensate for sign
     if (negative)
-        temp -= 65536; // 2^^16
+        t -= 65536; // 2^^16
 
     // convert
-    return ( (float)temp + ((float)frac * 0.0625) );
+    *temp = ( (float)t + ((float)frac * 0.0625) );
+    return true;
 }
 
 float ds18b20_get_temperature(const ds18b20_context dev, unsigned int index)
@@ -337,6 +425,9 @@ void ds18b20_set_resolution(const ds18b20_context dev, unsigned int index,
                          dev->devices[index].id);
     for (i=0; i<3; i++)
         mraa_uart_ow_write_byte(dev->ow, scratch[i+2]);
+
+    // keep track of it, for the conversion time
+    dev->devices[index].resolution = res;
 }
 
 void ds18b20_copy_scratchpad(const ds18b20_context dev, unsigned int index)
@@ -63,6 +63,23 @@ void DS18B20::update(int index)
     ds18b20_update(m_ds18b20, index);
 }
 
+void DS18B20::startConversion()
+{
+    if (ds18b20_start_conversion(m_ds18b20))
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": ds18b20_start_conversion() failed");
+}
+
+bool DS18B20::conversionDone()
+{
+    return ds18b20_conversion_done(m_ds18b20);
+}
+
+bool DS18B20::collect()
+{
+    return (ds18b20_collect(m_ds18b20) == UPM_SUCCESS);
+}
+
 float DS18B20::getTemperature(unsigned int index, bool fahrenheit)
 {
     if (index >= ds18b20_devices_found(m_ds18b20))
@@ -29,6 +29,7 @@
 
 #include <mraa/uart_ow.h>
 #include <upm.h>
+#include <upm_utilities.h>
 #include "ds18b20_defs.h"
 
 #ifdef __cplusplus
@@ -57,6 +58,16 @@ extern "C" {
 
         // list of allocated ds18b20_info_t instances
         ds18b20_info_t *devices;
+
+        // is any device parasitically powered?  If so, it cannot
+        // signal conversion completion on the bus.
+        bool parasitic;
+
+        // conversion in progress, when it was started and how long
+        // it may take (ms)
+        bool converting;
+        upm_clock_t convertClock;
+        unsigned int convertTime;
     } *ds18b20_context;
 
     /**
@@ -77,13 +88,53 @@ extern "C" {
 
     /**
      * Update our stored temperature for a device.  This method must
-     * be called prior to ds18b20_get_temperature().
+     * be called prior to ds18b20_get_temperature().  When updating
+     * all devices, this is ds18b20_start_conversion() followed by
+     * ds18b20_collect().
      *
      * @param index The device index to access (starts at 0).  Specify
      * -1 to query all detected devices.  Default: -1
      */
     void ds18b20_update(const ds18b20_context dev, int index);
 
+    /**
+     * Start a temperature conversion on all devices at once, using a
+     * single Skip ROM broadcast, and return immediately.  Use
+     * ds18b20_conversion_done() to check for completion and
+     * ds18b20_collect() to read the results.
+     *
+     * @param dev Device context.
+     * @return UPM result.
+     */
+    upm_result_t ds18b20_start_conversion(const ds18b20_context dev);
+
+    /**
+     * Check whether the conversion started by
+     * ds18b20_start_conversion() has finished.  Unless a device is
+     * parasitically powered, this issues a read time slot, which the
+     * devices hold low while converting.  Otherwise, the conversion
+     * time of the highest configured resolution is used.
+     *
+     * @param dev Device context.
+     * @return true if the conversion has finished, or none is in
+     * progress.
+     */
+    bool ds18b20_conversion_done(const ds18b20_context dev);
+
+    /**
+     * Wait for the current conversion to finish, if it hasn't
+     * already, and read the temperature of all devices.  Each
+     * scratchpad read is CRC checked, and retried up to
+     * DS18B20_SCRATCHPAD_RETRIES times.  A device that still fails
+     * keeps its previous temperature, and the remaining devices are
+     * read regardless.
+     *
+     * @param dev Device context.
+     * @return UPM result.  UPM_ERROR_OPERATION_FAILED if any device
+     * could not be read.
+     */
+    upm_result_t ds18b20_collect(const ds18b20_context dev);
+
     /**
      * Get the current temperature.  ds18b20_update() must have been
      * called prior to calling this method.
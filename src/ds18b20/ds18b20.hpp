@@ -147,6 +147,34 @@ namespace upm {
        */
       void update(int index=-1);
 
+      /**
+       * Start a temperature conversion on all devices at once and
+       * return immediately.  Use conversionDone() to check for
+       * completion and collect() to read the results.
+       *
+       * @throws std::runtime_error on failure.
+       */
+      void startConversion();
+
+      /**
+       * Check whether the conversion started by startConversion()
+       * has finished.
+       *
+       * @return true if the conversion has finished, or none is in
+       * progress.
+       */
+      bool conversionDone();
+
+      /**
+       * Wait for the current conversion to finish, if it hasn't
+       * already, and read the temperature of all devices.  Each
+       * scratchpad read is CRC checked and retried.  A device that
+       * still fails keeps its previous temperature.
+       *
+       * @return true if all devices were read successfully.
+       */
+      bool collect();
+
       /**
        * Get the current temperature.  update() must have been called
        * prior to calling this method.
@@ -58,6 +58,9 @@ extern "C" {
         DS18B20_RESOLUTION_12BITS                   = 3  // 750ms (tconv)
     } DS18B20_RESOLUTIONS_T;
 
+    // how often a scratchpad read with a bad CRC is retried
+#define DS18B20_SCRATCHPAD_RETRIES 3
+
 #ifdef __cplusplus
 }
 #endif
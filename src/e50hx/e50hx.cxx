@@ -34,6 +34,58 @@
 using namespace upm;
 using namespace std;
 
+// the Analog Input Objects read by update()
+static const E50HX::ANALOG_INPUTS_T analogInputs[] = {
+  E50HX::AI_Energy,
+  E50HX::AI_kW_Total,
+  E50HX::AI_kVAR_Total,
+  E50HX::AI_kVA_Total,
+  E50HX::AI_PF_Total,
+  E50HX::AI_Volts_LL_Avg,
+  E50HX::AI_Volts_LN_Avg,
+  E50HX::AI_Current_Avg,
+  E50HX::AI_kW_A,
+  E50HX::AI_kW_B,
+  E50HX::AI_kW_C,
+  E50HX::AI_PF_A,
+  E50HX::AI_PF_B,
+  E50HX::AI_PF_C,
+  E50HX::AI_Volts_AB,
+  E50HX::AI_Volts_BC,
+  E50HX::AI_Volts_AC,
+  E50HX::AI_Volts_AN,
+  E50HX::AI_Volts_BN,
+  E50HX::AI_Volts_CN,
+  E50HX::AI_Current_A,
+  E50HX::AI_Current_B,
+  E50HX::AI_Current_C,
+  E50HX::AI_Frequency,
+  E50HX::AI_kVAh,
+  E50HX::AI_kVARh,
+  E50HX::AI_kVA_A,
+  E50HX::AI_kVA_B,
+  E50HX::AI_kVA_C,
+  E50HX::AI_kVAR_A,
+  E50HX::AI_kVAR_B,
+  E50HX::AI_kVAR_C,
+  E50HX::AI_KW_Present_Demand,
+  E50HX::AI_KVAR_Present_Demand,
+  E50HX::AI_KWA_Present_Demand,
+  E50HX::AI_KW_Max_Demand,
+  E50HX::AI_KVAR_Max_Demand,
+  E50HX::AI_KVA_Max_Demand,
+  E50HX::AI_Pulse_Count_1,
+  E50HX::AI_Pulse_Count_2,
+  E50HX::AI_KWH_A,
+  E50HX::AI_KWH_B,
+  E50HX::AI_KWH_C,
+  E50HX::AI_Max_Power,
+  E50HX::AI_Energy_Resets,
+  E50HX::AI_Power_Up_Count,
+  E50HX::AI_Output_Config,
+  E50HX::AI_Alarm_Bitmap
+};
+
 
 E50HX::E50HX(uint32_t targetDeviceObjectID) :
   BACNETUTIL(targetDeviceObjectID)
@@ -42,6 +94,9 @@ E50HX::E50HX(uint32_t targetDeviceObjectID) :
 
   // we disable this by default for performance reasons
   checkReliability(false);
+
+  for (size_t i=0; i<sizeof(analogInputs) / sizeof(analogInputs[0]); i++)
+    addPoint(OBJECT_ANALOG_INPUT, analogInputs[i]);
 }
 
 E50HX::~E50HX()
@@ -53,6 +108,16 @@ uint16_t E50HX::getAlarmBits()
   return uint16_t(getAnalogInput(AI_Alarm_Bitmap));
 }
 
+void E50HX::update()
+{
+  updatePoints();
+}
+
+float E50HX::getValue(ANALOG_INPUTS_T ai)
+{
+  return getPointReal(OBJECT_ANALOG_INPUT, ai);
+}
+
 void E50HX::writeConfig(CFG_VALUES_T config)
 {
   setAnalogValue(AV_Config, float(config));
@@ -79,6 +79,9 @@ namespace upm {
    * must use a full Serial RS232->RS485 or USB-RS485 interface
    * connected via USB.
    *
+   * All of the Analog Input Objects can be refreshed at once with
+   * update(), and retrieved with getValue().
+   *
    * @snippet e50hx.cxx Interesting
    */
 
@@ -315,6 +318,28 @@ namespace upm {
      */
     uint16_t getAlarmBits();
 
+    /**
+     * Read all of the supported Analog Input Objects (the
+     * measurements) in a single pass, and store the results.  The
+     * values are packed into as few BACnet ReadPropertyMultiple
+     * requests as possible, which is much faster than querying each
+     * of them individually.  Use getValue() to retrieve them.  Any
+     * other points added with BACNETUTIL::addPoint() are refreshed in
+     * the same pass.  This method will throw on error.
+     */
+    void update();
+
+    /**
+     * Return the value of an Analog Input Object as stored by the
+     * last call to update().  This method will throw if the device
+     * could not return the value, for example if the object is not
+     * present on this variant (like AI_Pulse_Count_2 on the E50H2).
+     *
+     * @param ai One of the ANALOG_INPUTS_T values.
+     * @return The floating point value of the object.
+     */
+    float getValue(ANALOG_INPUTS_T ai);
+
   protected:
   private:
   };
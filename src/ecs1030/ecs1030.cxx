@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <string>
 #include <stdexcept>
+#include <string.h>
 
 #include "ecs1030.hpp"
 
@@ -39,35 +40,53 @@ ECS1030::ECS1030 (int pinNumber) {
                                   ": mraa_aio_init() failed");
     }
 
+    m_capture = aiocapture_init_aio(m_dataPinCtx);
+    if (m_capture == NULL) {
+      mraa_aio_close (m_dataPinCtx);
+      throw std::runtime_error(std::string(__FUNCTION__) +
+                               ": aiocapture_init_aio() failed");
+    }
+
+    memset(&m_timing, 0, sizeof(m_timing));
     m_calibration = 111.1;
+    m_lastSample = m_sample = 0;
+    m_lastFilter = m_filteredSample = 0.0;
 }
 
 ECS1030::~ECS1030 () {
     mraa_result_t error = MRAA_SUCCESS;
 
+    aiocapture_close (m_capture);
+
     error = mraa_aio_close (m_dataPinCtx);
     if (error != MRAA_SUCCESS) {
     }
 }
 
+void
+ECS1030::capture () {
+    if (aiocapture_capture (m_capture, SAMPLE_PERIOD_US, m_samples,
+                            NUMBER_OF_SAMPLES, &m_timing))
+        throw std::runtime_error(std::string(__FUNCTION__) +
+                                 ": Failed to do an aio read.");
+}
+
 double
 ECS1030::getCurrency_A () {
-    int     sensorValue  = 0;
-    float   volt         = 0;
-    float   rms          = 0;
+    AIOCAPTURE_STATS_T stats;
 
-    for (int i = 0; i < NUMBER_OF_SAMPLES; i++) {
-        sensorValue = mraa_aio_read (m_dataPinCtx);
-        if (sensorValue == -1) throw std::runtime_error(std::string(__FUNCTION__) +
-                                                        ": Failed to do an aio read.");
-        volt = (VOLT_M * sensorValue) - 2.5;
-        volt = volt * volt;
-        rms = rms + volt;
-        usleep (DELAY_MS);
-    }
+    capture ();
+    aiocapture_compute_stats (m_samples, NUMBER_OF_SAMPLES, &stats);
 
-    rms = rms / (float)NUMBER_OF_SAMPLES;
-    rms = sqrt(rms);
+    // volt = (m * sample) + b, so the mean of volt^2 follows from the
+    // mean and mean square of the raw samples:
+    // E[volt^2] = m^2 E[s^2] + 2mb E[s] + b^2
+    double m = (SUPPLYVOLTAGE / 1000.0) / (ADC_RESOLUTION - 1);
+    double b = -2.5;
+    double meanSq = (m * m * stats.mean_square) + (2.0 * m * b * stats.mean)
+        + (b * b);
+
+    double rms = (meanSq > 0.0) ? sqrt(meanSq) : 0.0;
     return rms / R_LOAD;
 }
 
@@ -75,11 +94,11 @@ double
 ECS1030::getCurrency_B () {
     double sumCurrency    = 0;
 
+    capture ();
+
     for (int i = 0; i < NUMBER_OF_SAMPLES; i++) {
         m_lastSample = m_sample;
-        m_sample = mraa_aio_read (m_dataPinCtx);
-        if (m_sample == -1) throw std::runtime_error(std::string(__FUNCTION__) +
-                                                     ": Failed to do an aio read.");
+        m_sample = m_samples[i];
         m_lastFilter = m_filteredSample;
         m_filteredSample = 0.996 * (m_lastFilter + m_sample - m_lastSample);
         sumCurrency += (m_filteredSample * m_filteredSample);
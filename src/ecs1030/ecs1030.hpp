@@ -28,12 +28,16 @@
 #include <mraa/aio.h>
 #include <mraa/gpio.h>
 
+#include <aiocapture.h>
+
 namespace upm {
 
 #define NUMBER_OF_SAMPLES  500
 #define ADC_RESOLUTION     1024
 #define SUPPLYVOLTAGE      5100
 #define CURRENT_RATIO      2000.0
+/* 500 samples at 200us span 100ms, a whole number of 50Hz and 60Hz cycles */
+#define SAMPLE_PERIOD_US   200
 
 #define HIGH               1
 #define LOW                0
@@ -110,6 +114,28 @@ class ECS1030 {
          */
         double getPower_B ();
 
+        /**
+         * Returns the sample rate achieved during the last measurement.
+         * The RMS calculations assume the samples are evenly spaced, so
+         * this should be close to 1000000 / SAMPLE_PERIOD_US.
+         *
+         * @return The sample rate in Hz
+         */
+        float getSampleRate() {
+            return m_timing.rate;
+        }
+
+        /**
+         * Returns the timing jitter of the samples taken during the last
+         * measurement.
+         *
+         * @return The standard deviation of the sample times, in
+         * microseconds
+         */
+        float getJitter() {
+            return m_timing.jitter;
+        }
+
         /**
          * Returns the name of the component
          */
@@ -119,11 +145,16 @@ class ECS1030 {
     private:
         std::string         m_name;
         mraa_aio_context    m_dataPinCtx;
+        aiocapture_context  m_capture;
+        AIOCAPTURE_TIMING_T m_timing;
+        uint16_t            m_samples[NUMBER_OF_SAMPLES];
 
         double              m_calibration;
         int                 m_lastSample;
         double              m_lastFilter;
         int                 m_sample;
         double              m_filteredSample;
+
+        void capture ();
 };
 }
@@ -25,6 +25,8 @@
 #include <iostream>
 #include <string>
 #include <stdexcept>
+#include <vector>
+#include <string.h>
 
 #include "emg.hpp"
 
@@ -39,27 +41,36 @@ EMG::EMG(int pin)
                                   ": mraa_aio_init() failed, invalid pin?");
       return;
     }
+
+    if ( !(m_capture = aiocapture_init_aio(m_aio)) )
+    {
+      mraa_aio_close(m_aio);
+      throw std::runtime_error(std::string(__FUNCTION__) +
+                               ": aiocapture_init_aio() failed");
+      return;
+    }
+
+    memset(&m_timing, 0, sizeof(m_timing));
 }
 
 EMG::~EMG()
 {
+  aiocapture_close(m_capture);
   mraa_aio_close(m_aio);
 }
 
 void EMG::calibrate()
 {
-	int val, sum = 0;
+	std::vector<uint16_t> samples(1100);
+	AIOCAPTURE_STATS_T stats;
+
+	if (aiocapture_capture(m_capture, 1000, samples.data(),
+			       samples.size(), &m_timing))
+		throw std::runtime_error(std::string(__FUNCTION__) +
+					 ": Failed to do an aio read.");
 
-	for (int i=0; i<1100; i++)
-	{
-		val = mraa_aio_read(m_aio);
-                if (val != -1) throw std::runtime_error(std::string(__FUNCTION__) +
-                                                        ": Failed to do an aio read.");
-		sum += val;
-		usleep(1000);
-	}
-	sum /= 1100;
-	cout << "Static analog data = " << sum << endl;
+	aiocapture_compute_stats(samples.data(), samples.size(), &stats);
+	cout << "Static analog data = " << (int)stats.mean << endl;
 }
 
 int EMG::value()
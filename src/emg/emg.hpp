@@ -26,6 +26,8 @@
 #include <string>
 #include <mraa/aio.h>
 
+#include <aiocapture.h>
+
 namespace upm {
   /**
    * @brief EMG Muscle Signal Reader
@@ -64,7 +66,8 @@ namespace upm {
     ~EMG();
 
     /**
-     * Calibrates the Grove EMG reader
+     * Calibrates the Grove EMG reader.  This averages 1100 samples
+     * taken 1ms apart by a capture thread.
      */
     void calibrate();
 
@@ -75,8 +78,32 @@ namespace upm {
      */
     int value();
 
+    /**
+     * Returns the sample rate achieved during the last calibration
+     *
+     * @return The sample rate in Hz
+     */
+    float getSampleRate()
+    {
+      return m_timing.rate;
+    }
+
+    /**
+     * Returns the timing jitter of the samples taken during the last
+     * calibration
+     *
+     * @return The standard deviation of the sample times, in
+     * microseconds
+     */
+    float getJitter()
+    {
+      return m_timing.jitter;
+    }
+
   private:
     mraa_aio_context m_aio;
+    aiocapture_context m_capture;
+    AIOCAPTURE_TIMING_T m_timing;
   };
 }
 
@@ -57,7 +57,7 @@ static float regs2float(uint16_t h, uint16_t l)
 
 H803X::H803X(std::string device, int address, int baud, int bits, char parity,
                int stopBits) :
-  m_mbContext(0)
+  m_bus(0), m_pollID(-1), m_pollInterval(0)
 {
   // check some of the parameters
   if (!(bits == 7 || bits == 8))
@@ -78,51 +78,36 @@ H803X::H803X(std::string device, int address, int baud, int bits, char parity,
                               + ": stopBits must be 1 or 2");
     }
 
-  // now, open/init the device and modbus context
-
-  if (!(m_mbContext = modbus_new_rtu(device.c_str(), baud, parity, bits,
-                                     stopBits)))
-    {
-      throw std::runtime_error(std::string(__FUNCTION__)
-                               + ": modbus_new_rtu() failed");
-    }
+  // addresses are only 8bits wide
+  m_slave = address & 0xff;
 
-  // set the slave address of the device we want to talk to
+  // now, get the bus for this port and attach to it
+  m_bus = ModbusBus::instance(device, baud, bits, parity, stopBits);
+  m_bus->attach(m_slave);
 
-  // addresses are only 8bits wide
-  address &= 0xff;
-  if (modbus_set_slave(m_mbContext, address))
+  // the bus attachment is ours until the constructor returns, so
+  // release it if anything after this point fails
+  try
     {
-      throw std::runtime_error(std::string(__FUNCTION__)
-                               + ": modbus_set_slave() failed");
-    }
+      // will set m_isH8036 appropriately
+      testH8036();
 
-  // set the serial mode
-  modbus_rtu_set_serial_mode(m_mbContext, MODBUS_RTU_RS232);
+      clearData();
 
-  // now connect..
-  if (modbus_connect(m_mbContext))
+      // turn off debugging
+      setDebug(false);
+    }
+  catch (...)
     {
-      throw std::runtime_error(std::string(__FUNCTION__)
-                               + ": modbus_connect() failed");
+      m_bus->detach(m_slave);
+      throw;
     }
-
-  // will set m_isH8036 appropriately
-  testH8036();
-
-  clearData();
-
-  // turn off debugging
-  setDebug(false);
 }
 
 H803X::~H803X()
 {
-  if (m_mbContext)
-    {
-      modbus_close(m_mbContext);
-      modbus_free(m_mbContext);
-    }
+  unschedule();
+  m_bus->detach(m_slave);
 }
 
 int H803X::readHoldingRegs(HOLDING_REGS_T reg, int len, uint16_t *buf)
@@ -135,7 +120,7 @@ int H803X::readHoldingRegs(HOLDING_REGS_T reg, int len, uint16_t *buf)
 
   while (retries >= 0)
     {
-      if ((rv = modbus_read_registers(m_mbContext, reg, len, buf)) < 0)
+      if ((rv = m_bus->readHoldingRegs(m_slave, reg, len, buf)) < 0)
         {
           if (errno == ETIMEDOUT)
             {
@@ -170,7 +155,7 @@ int H803X::readHoldingRegs(HOLDING_REGS_T reg, int len, uint16_t *buf)
 
 void H803X::writeHoldingReg(HOLDING_REGS_T reg, int value)
 {
-  if (modbus_write_register(m_mbContext, reg, value) != 1)
+  if (m_bus->writeHoldingReg(m_slave, reg, value) != 1)
     {
       throw std::runtime_error(std::string(__FUNCTION__)
                                + ": modbus_write_register() failed: "
@@ -195,6 +180,37 @@ void H803X::update()
                                + modbus_strerror(errno));
     }
 
+  decode(buf);
+}
+
+void H803X::schedule(int intervalMs)
+{
+  unschedule();
+
+  // the same registers update() reads
+  m_pollID = m_bus->addPoll(m_slave, ModbusBus::REGS_HOLDING,
+                            HOLDING_CONSUMPTION_KWH,
+                            (isH8036() ? 52 : 4), intervalMs,
+                            pollHandler, this);
+  m_pollInterval = intervalMs;
+}
+
+void H803X::unschedule()
+{
+  if (m_pollID >= 0)
+    {
+      m_bus->removePoll(m_pollID);
+      m_pollID = -1;
+    }
+}
+
+void H803X::pollHandler(const uint16_t *regs, int len, void *arg)
+{
+  ((H803X *)arg)->decode(regs);
+}
+
+void H803X::decode(const uint16_t *buf)
+{
   // And so it begins...
 
   // H8035 / H8036
@@ -243,7 +259,7 @@ string H803X::getSlaveID()
   uint8_t id[MODBUS_MAX_PDU_LENGTH];
   int rv;
 
-  if ((rv = modbus_report_slave_id(m_mbContext, MODBUS_MAX_PDU_LENGTH, id)) < 0)
+  if ((rv = m_bus->reportSlaveID(m_slave, MODBUS_MAX_PDU_LENGTH, id)) < 0)
     {
       throw std::runtime_error(std::string(__FUNCTION__)
                                + ": modbus_report_slave_id() failed: "
@@ -269,15 +285,34 @@ void H803X::setSlaveAddress(int addr)
   // addresses are only 8bits wide
   addr &= 0xff;
 
-  if (modbus_set_slave(m_mbContext, addr))
+  // move our attachment, and any scheduled poll, to the new address
+  bool scheduled = (m_pollID >= 0);
+  unschedule();
+
+  // keep the old attachment until the device answers at the new
+  // address, so a failure leaves us where we were
+  int oldSlave = m_slave;
+  m_bus->attach(addr);
+  m_slave = addr;
+
+  try
     {
-      throw std::runtime_error(std::string(__FUNCTION__)
-                               + ": modbus_set_slave() failed: "
-                               + modbus_strerror(errno));
+      // retest H8036
+      testH8036();
+    }
+  catch (...)
+    {
+      m_slave = oldSlave;
+      m_bus->detach(addr);
+      if (scheduled)
+        schedule(m_pollInterval);
+      throw;
     }
 
-  // retest H8036
-  testH8036();
+  m_bus->detach(oldSlave);
+
+  if (scheduled)
+    schedule(m_pollInterval);
 
   // clear out any previously stored data
   clearData();
@@ -287,10 +322,7 @@ void H803X::setDebug(bool enable)
 {
   m_debugging = enable;
 
-  if (enable)
-    modbus_set_debug(m_mbContext, 1);
-  else
-    modbus_set_debug(m_mbContext, 0);
+  m_bus->setDebug(enable);
 }
 
 void H803X::clearData()
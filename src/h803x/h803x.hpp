@@ -25,7 +25,7 @@
 
 #include <string>
 
-#include <modbus/modbus.h>
+#include "modbusbus.hpp"
 
 namespace upm {
 
@@ -70,6 +70,11 @@ namespace upm {
    * must use a full Serial RS232->RS485 or USB-RS485 interface
    * connected via USB.
    *
+   * Devices on the same serial port share a ModbusBus, so daisy-chained
+   * transducers (and other UPM MODBUS devices) can be used together.
+   * Instead of calling update(), schedule() lets ModbusBus::poll()
+   * refresh the values on its own timetable.
+   *
    * @snippet h803x.cxx Interesting
    */
 
@@ -153,6 +158,31 @@ namespace upm {
      */
     void update();
 
+    /**
+     * Have the shared bus refresh the values every intervalMs
+     * milliseconds, instead of calling update().  The values are
+     * refreshed from ModbusBus::poll(), which must be called
+     * regularly on the bus returned by getBus().
+     *
+     * @param intervalMs How often to read the device, in milliseconds
+     */
+    void schedule(int intervalMs);
+
+    /**
+     * Stop refreshing the values from the shared bus.
+     */
+    void unschedule();
+
+    /**
+     * Get the shared bus this device is attached to.
+     *
+     * @return The bus for the serial port of this device
+     */
+    ModbusBus *getBus()
+    {
+      return m_bus;
+    };
+
     /**
      * Return a string corresponding the the device's MODBUS slave ID.
      *
@@ -165,7 +195,8 @@ namespace upm {
      * multiple H803X devices on a single bus.  When this method is
      * called, the current stored data is cleared, and a new attempt
      * is made to determine whether the target device is an H8035 or
-     * H8036.
+     * H8036.  If that fails, the old address is kept and the error
+     * is rethrown.
      *
      * @param addr The new slave address to set
      */
@@ -474,7 +505,7 @@ namespace upm {
 
     /**
      * Enable or disable debugging output.  This primarily enables and
-     * disables libmodbus debugging output.
+     * disables libmodbus debugging output, for the whole bus.
      *
      * @param enable true to enable debugging, false otherwise
      */
@@ -499,8 +530,15 @@ namespace upm {
     // clear out all stored data
     void clearData();
     
-    // MODBUS context
-    modbus_t *m_mbContext;
+    // decode the registers starting at HOLDING_CONSUMPTION_KWH
+    void decode(const uint16_t *buf);
+    static void pollHandler(const uint16_t *regs, int len, void *arg);
+
+    // shared MODBUS bus, our slave address and scheduled poll
+    ModbusBus *m_bus;
+    int m_slave;
+    int m_pollID;
+    int m_pollInterval;
 
     // test to see if the connected device is an H8036, and set
     // m_isH8036 appropriately
@@ -8,7 +8,9 @@ JAVA_JNI_LOADLIBRARY(javaupm_h803x)
 
 /* BEGIN Common SWIG syntax ------------------------------------------------- */
 %{
+#include "modbusbus.hpp"
 #include "h803x.hpp"
 %}
+%include "modbusbus.hpp"
 %include "h803x.hpp"
 /* END Common SWIG syntax */
@@ -24,9 +24,21 @@
  * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
  * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+
 #include "upm_utilities.h"
 #include "hcsr04.h"
 
+// current CLOCK_MONOTONIC time in us
+static uint64_t hcsr04_now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 hcsr04_context hcsr04_init(int triggerPin, int echoPin) {
     // make sure MRAA is initialized
     int mraa_rv;
@@ -42,6 +54,8 @@ hcsr04_context hcsr04_init(int triggerPin, int echoPin) {
         return NULL;
     }
 
+    memset((void *)dev, 0, sizeof(struct _hcsr04_context));
+
     // initialize the GPIO pins
     dev->trigPin = mraa_gpio_init(triggerPin);
     if(!dev->trigPin) {
@@ -79,16 +93,40 @@ hcsr04_context hcsr04_init(int triggerPin, int echoPin) {
     // initialize the interrupt counter
     dev->interruptCounter = 0;
 
+    // the ISR signals completion, waits are timed against
+    // CLOCK_MONOTONIC
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&dev->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&dev->lock, NULL);
+
     return dev;
 }
 
 void hcsr04_close(hcsr04_context dev) {
+    if(dev->isrInstalled)
+        mraa_gpio_isr_exit(dev->echoPin);
+    pthread_cond_destroy(&dev->cond);
+    pthread_mutex_destroy(&dev->lock);
+
     mraa_gpio_close(dev->trigPin);
     mraa_gpio_close(dev->echoPin);
     free(dev);
 }
 
 double hcsr04_get_distance(hcsr04_context dev, HCSR04_U unit) {
+    double distance = 0;
+    upm_result_t rv = hcsr04_measure(dev, unit, &distance);
+
+    if(rv == UPM_SUCCESS)
+        return distance;
+    else if(rv != UPM_ERROR_NOT_SUPPORTED)
+        return 0;
+
+    // no interrupt on the echo pin, poll it instead
+
     // set value to start cycle right after trigger
     long cycleLength = 0, sampleTime = 0;
     struct timeval tv;
@@ -125,3 +163,268 @@ double hcsr04_get_distance(hcsr04_context dev, HCSR04_U unit) {
     else
         return ((dev->endTime - dev->startTime)/2)/74.1;
 }
+
+double hcsr04_echo_to_distance(uint32_t echoTime, HCSR04_U unit) {
+    if(unit == HCSR04_CM)
+        return (echoTime/2)/29.1;
+    else
+        return (echoTime/2)/74.1;
+}
+
+// timestamps both edges of the echo pulse
+static void hcsr04_echo_isr(void *arg) {
+    hcsr04_context dev = (hcsr04_context)arg;
+    uint64_t now = hcsr04_now_us();
+
+    pthread_mutex_lock(&dev->lock);
+    if(dev->echoState == 1) {
+        dev->riseTime = now;
+        dev->echoState = 2;
+    } else if(dev->echoState == 2) {
+        dev->fallTime = now;
+        dev->echoState = 3;
+        pthread_cond_broadcast(&dev->cond);
+    }
+    pthread_mutex_unlock(&dev->lock);
+}
+
+upm_result_t hcsr04_trigger(hcsr04_context dev) {
+    if(!dev->isrInstalled) {
+        if(dev->isrFailed)
+            return UPM_ERROR_NOT_SUPPORTED;
+
+        if(mraa_gpio_isr(dev->echoPin, MRAA_GPIO_EDGE_BOTH,
+                         hcsr04_echo_isr, dev) != MRAA_SUCCESS) {
+            printf("%s: mraa_gpio_isr() failed\n", __FUNCTION__);
+            dev->isrFailed = true;
+            return UPM_ERROR_NOT_SUPPORTED;
+        }
+        dev->isrInstalled = true;
+    }
+
+    pthread_mutex_lock(&dev->lock);
+    dev->echoState = 1;
+    dev->triggerTime = hcsr04_now_us();
+    pthread_mutex_unlock(&dev->lock);
+
+    if(mraa_gpio_write(dev->trigPin, 1) != MRAA_SUCCESS) {
+        pthread_mutex_lock(&dev->lock);
+        dev->echoState = 0;
+        pthread_mutex_unlock(&dev->lock);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+    upm_delay_us(10);
+    mraa_gpio_write(dev->trigPin, 0);
+
+    return UPM_SUCCESS;
+}
+
+upm_result_t hcsr04_wait(hcsr04_context dev, uint32_t *echoTime) {
+    upm_result_t rv = UPM_SUCCESS;
+
+    pthread_mutex_lock(&dev->lock);
+
+    if(dev->echoState == 0) {
+        pthread_mutex_unlock(&dev->lock);
+        return UPM_ERROR_NO_DATA;
+    }
+
+    uint64_t deadline = dev->triggerTime + HCSR04_ECHO_TIMEOUT * 1000;
+    struct timespec ts;
+    ts.tv_sec = deadline / 1000000;
+    ts.tv_nsec = (deadline % 1000000) * 1000;
+
+    while(dev->echoState != 3) {
+        if(pthread_cond_timedwait(&dev->cond, &dev->lock, &ts) == ETIMEDOUT) {
+            rv = UPM_ERROR_TIMED_OUT;
+            break;
+        }
+    }
+
+    if(rv == UPM_SUCCESS && echoTime)
+        *echoTime = (uint32_t)(dev->fallTime - dev->riseTime);
+
+    dev->echoState = 0;
+    pthread_mutex_unlock(&dev->lock);
+
+    return rv;
+}
+
+upm_result_t hcsr04_measure(hcsr04_context dev, HCSR04_U unit,
+                            double *distance) {
+    uint32_t echoTime;
+    upm_result_t rv;
+
+    if((rv = hcsr04_trigger(dev)) != UPM_SUCCESS)
+        return rv;
+
+    if((rv = hcsr04_wait(dev, &echoTime)) != UPM_SUCCESS)
+        return rv;
+
+    if(distance)
+        *distance = hcsr04_echo_to_distance(echoTime, unit);
+
+    return UPM_SUCCESS;
+}
+
+static void *hcsr04_scheduler_thread(void *arg) {
+    hcsr04_scheduler_context sched = (hcsr04_scheduler_context)arg;
+
+    while(sched->running) {
+        unsigned int g, i;
+        for(g = 0; g < sched->numGroups && sched->running; g++) {
+            uint64_t start = hcsr04_now_us();
+            bool fired = false;
+
+            // fire the whole group at once...
+            for(i = 0; i < sched->numDevs; i++) {
+                if(sched->groups[i] == g
+                   && hcsr04_trigger(sched->devs[i]) == UPM_SUCCESS)
+                    fired = true;
+            }
+
+            if(fired) {
+                // ...then collect the echoes
+                hcsr04_reading_t results[sched->numDevs];
+                for(i = 0; i < sched->numDevs; i++) {
+                    if(sched->groups[i] != g)
+                        continue;
+
+                    uint32_t echoTime = 0;
+                    if(hcsr04_wait(sched->devs[i], &echoTime) != UPM_SUCCESS)
+                        echoTime = 0;
+                    results[i].echoTime = echoTime;
+                    results[i].timestamp = hcsr04_now_us();
+                }
+
+                // publish: readers retry while the sequence is odd or
+                // has changed under them
+                unsigned int seq = sched->seq;
+                __atomic_store_n(&sched->seq, seq + 1, __ATOMIC_RELAXED);
+                __atomic_thread_fence(__ATOMIC_RELEASE);
+                for(i = 0; i < sched->numDevs; i++) {
+                    if(sched->groups[i] == g)
+                        sched->readings[i] = results[i];
+                }
+                __atomic_store_n(&sched->seq, seq + 2, __ATOMIC_RELEASE);
+            }
+
+            // let the echoes die down before the next group fires.
+            // This also paces the loop when nothing could be fired.
+            uint64_t elapsed = hcsr04_now_us() - start;
+            if(elapsed < HCSR04_CYCLE_TIME * 1000)
+                upm_delay_us(HCSR04_CYCLE_TIME * 1000 - elapsed);
+        }
+    }
+
+    return NULL;
+}
+
+// the group of a device as passed to hcsr04_scheduler_init()
+static unsigned int hcsr04_group_of(const unsigned int *groups,
+                                    unsigned int index) {
+    return groups ? groups[index] : index;
+}
+
+hcsr04_scheduler_context hcsr04_scheduler_init(hcsr04_context *devs,
+                                               unsigned int numDevs,
+                                               const unsigned int *groups) {
+    if(!devs || !numDevs)
+        return NULL;
+
+    hcsr04_scheduler_context sched =
+        (hcsr04_scheduler_context) malloc(sizeof(struct _hcsr04_scheduler_context));
+
+    if(!sched)
+        return NULL;
+
+    memset((void *)sched, 0, sizeof(struct _hcsr04_scheduler_context));
+
+    sched->devs = (hcsr04_context *) malloc(sizeof(hcsr04_context) * numDevs);
+    sched->groups = (unsigned int *) malloc(sizeof(unsigned int) * numDevs);
+    sched->readings = (hcsr04_reading_t *) calloc(numDevs, sizeof(hcsr04_reading_t));
+
+    if(!sched->devs || !sched->groups || !sched->readings) {
+        printf("%s: allocation failed\n", __FUNCTION__);
+        hcsr04_scheduler_close(sched);
+        return NULL;
+    }
+
+    // renumber the groups 0..numGroups-1 in order, so that group
+    // numbers without members are not scheduled: each distinct group
+    // number bumps the number of every larger one
+    unsigned int i, j, k;
+    for(i = 0; i < numDevs; i++) {
+        sched->devs[i] = devs[i];
+        sched->groups[i] = 0;
+    }
+
+    for(j = 0; j < numDevs; j++) {
+        unsigned int group = hcsr04_group_of(groups, j);
+
+        for(k = 0; k < j; k++) {
+            if(hcsr04_group_of(groups, k) == group)
+                break;
+        }
+        if(k < j)
+            continue;
+
+        sched->numGroups++;
+        for(i = 0; i < numDevs; i++) {
+            if(hcsr04_group_of(groups, i) > group)
+                sched->groups[i]++;
+        }
+    }
+    sched->numDevs = numDevs;
+
+    sched->running = true;
+    if(pthread_create(&sched->thread, NULL, hcsr04_scheduler_thread, sched)) {
+        printf("%s: pthread_create() failed\n", __FUNCTION__);
+        sched->running = false;
+        hcsr04_scheduler_close(sched);
+        return NULL;
+    }
+
+    return sched;
+}
+
+void hcsr04_scheduler_close(hcsr04_scheduler_context sched) {
+    if(sched->running) {
+        sched->running = false;
+        pthread_join(sched->thread, NULL);
+    }
+
+    free(sched->devs);
+    free(sched->groups);
+    free(sched->readings);
+    free(sched);
+}
+
+upm_result_t hcsr04_scheduler_get_reading(hcsr04_scheduler_context sched,
+                                          unsigned int index,
+                                          hcsr04_reading_t *reading) {
+    if(index >= sched->numDevs)
+        return UPM_ERROR_OUT_OF_RANGE;
+
+    unsigned int seq1, seq2;
+    do {
+        seq1 = __atomic_load_n(&sched->seq, __ATOMIC_ACQUIRE);
+        *reading = sched->readings[index];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq2 = __atomic_load_n(&sched->seq, __ATOMIC_RELAXED);
+    } while((seq1 & 1) || seq1 != seq2);
+
+    return UPM_SUCCESS;
+}
+
+void hcsr04_scheduler_get_readings(hcsr04_scheduler_context sched,
+                                   hcsr04_reading_t *readings) {
+    unsigned int seq1, seq2;
+    do {
+        seq1 = __atomic_load_n(&sched->seq, __ATOMIC_ACQUIRE);
+        memcpy(readings, sched->readings,
+               sizeof(hcsr04_reading_t) * sched->numDevs);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq2 = __atomic_load_n(&sched->seq, __ATOMIC_RELAXED);
+    } while((seq1 & 1) || seq1 != seq2);
+}
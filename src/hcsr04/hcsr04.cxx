@@ -49,3 +49,60 @@ HCSR04::getDistance(HCSR04_U unit)
 {
     return hcsr04_get_distance(m_hcsr04, unit);
 }
+
+double
+HCSR04::measure(HCSR04_U unit)
+{
+    double distance;
+
+    if(hcsr04_measure(m_hcsr04, unit, &distance) != UPM_SUCCESS)
+        throw std::runtime_error(std::string(__FUNCTION__) +
+                                ": hcsr04_measure failed");
+    return distance;
+}
+
+HCSR04Scheduler::HCSR04Scheduler (std::vector<HCSR04 *> sensors,
+                                  std::vector<unsigned int> groups)
+{
+    if(!groups.empty() && groups.size() != sensors.size())
+        throw std::invalid_argument(std::string(__FUNCTION__) +
+                                    ": one group per sensor required");
+
+    std::vector<hcsr04_context> devs;
+    for(size_t i = 0; i < sensors.size(); i++)
+        devs.push_back(sensors[i]->m_hcsr04);
+
+    m_sched = hcsr04_scheduler_init(devs.data(), devs.size(),
+                                    groups.empty() ? NULL : groups.data());
+    if(!m_sched)
+        throw std::runtime_error(std::string(__FUNCTION__) +
+                                ": hcsr04_scheduler_init failed");
+}
+
+HCSR04Scheduler::~HCSR04Scheduler ()
+{
+    hcsr04_scheduler_close(m_sched);
+}
+
+hcsr04_reading_t
+HCSR04Scheduler::getReading(unsigned int index)
+{
+    hcsr04_reading_t reading;
+
+    if(hcsr04_scheduler_get_reading(m_sched, index, &reading) != UPM_SUCCESS)
+        throw std::out_of_range(std::string(__FUNCTION__) +
+                                ": index out of range");
+    return reading;
+}
+
+double
+HCSR04Scheduler::getDistance(unsigned int index, HCSR04_U unit)
+{
+    return hcsr04_echo_to_distance(getReading(index).echoTime, unit);
+}
+
+uint64_t
+HCSR04Scheduler::getTimestamp(unsigned int index)
+{
+    return getReading(index).timestamp;
+}
@@ -28,9 +28,13 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <mraa/gpio.h>
 #include <sys/time.h>
 
+#include "upm.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -47,14 +51,64 @@ typedef enum {
  * @include hcsr04.c
  */
 
+// The datasheet suggests measurement cycles of at least 60 ms.  An
+// echo is given up on after HCSR04_ECHO_TIMEOUT ms.
+#define HCSR04_CYCLE_TIME 60
+#define HCSR04_ECHO_TIMEOUT 70
+
 typedef struct _hcsr04_context {
     mraa_gpio_context        trigPin;
     mraa_gpio_context        echoPin;
     int                      interruptCounter;
     long                     startTime;
     long                     endTime;
+
+    // interrupt driven measurement.  The echo edges are timestamped
+    // (CLOCK_MONOTONIC, in us) by the ISR, which then signals the
+    // waiting thread.  If the ISR cannot be installed, it is not
+    // tried again.
+    bool                     isrInstalled;
+    bool                     isrFailed;
+    pthread_mutex_t          lock;
+    pthread_cond_t           cond;
+    // 0 idle, 1 triggered, 2 echo started, 3 echo complete
+    int                      echoState;
+    uint64_t                 triggerTime;
+    uint64_t                 riseTime;
+    uint64_t                 fallTime;
 } *hcsr04_context;
 
+/**
+ * A measurement published by the scheduler
+ */
+typedef struct _hcsr04_reading {
+    // echo pulse length in us, 0 if there was no echo
+    uint32_t                 echoTime;
+    // time the echo ended (CLOCK_MONOTONIC, in us)
+    uint64_t                 timestamp;
+} hcsr04_reading_t;
+
+/**
+ * Scheduler context.  The scheduler thread fires its sensors one
+ * group at a time, and publishes the results in a snapshot that can
+ * be read without blocking the scheduler.
+ */
+typedef struct _hcsr04_scheduler_context {
+    hcsr04_context          *devs;
+    unsigned int             numDevs;
+    // group of each device, and the number of groups
+    unsigned int            *groups;
+    unsigned int             numGroups;
+
+    pthread_t                thread;
+    volatile bool            running;
+
+    // latest readings, guarded by a sequence counter: odd while the
+    // scheduler is updating them
+    hcsr04_reading_t        *readings;
+    unsigned int             seq;
+} *hcsr04_scheduler_context;
+
 /**
  * HCSR04 Initialization function
  *
@@ -72,13 +126,105 @@ hcsr04_context hcsr04_init(int triggerPin, int echoPin);
 void hcsr04_close(hcsr04_context dev);
 
 /**
- * Function to get the distance from the HCSR04 sensor
+ * Function to get the distance from the HCSR04 sensor.  The
+ * interrupt driven path (hcsr04_measure()) is used, unless an
+ * interrupt can not be installed on the echo pin.
  *
  * @param unit cm/inches
  * @return distance in specified unit
  */
 double hcsr04_get_distance(hcsr04_context dev, HCSR04_U unit);
 
+/**
+ * Trigger a measurement and return immediately.  The echo is timed by
+ * an interrupt handler on the echo pin; use hcsr04_wait() to collect
+ * the result.
+ *
+ * @param dev hcsr04_context pointer
+ * @return UPM result
+ */
+upm_result_t hcsr04_trigger(hcsr04_context dev);
+
+/**
+ * Wait for the measurement started by hcsr04_trigger() to complete.
+ * The calling thread sleeps until the echo ends, or
+ * HCSR04_ECHO_TIMEOUT ms after the trigger.
+ *
+ * @param dev hcsr04_context pointer
+ * @param echoTime pointer to hold the echo pulse length in us
+ * @return UPM result, UPM_ERROR_TIMED_OUT if no echo completed
+ */
+upm_result_t hcsr04_wait(hcsr04_context dev, uint32_t *echoTime);
+
+/**
+ * Perform an interrupt driven measurement: hcsr04_trigger() followed
+ * by hcsr04_wait().
+ *
+ * @param dev hcsr04_context pointer
+ * @param unit cm/inches
+ * @param distance pointer to hold the distance in the specified unit
+ * @return UPM result
+ */
+upm_result_t hcsr04_measure(hcsr04_context dev, HCSR04_U unit,
+                            double *distance);
+
+/**
+ * Convert an echo pulse length to a distance
+ *
+ * @param echoTime echo pulse length in us
+ * @param unit cm/inches
+ * @return distance in specified unit
+ */
+double hcsr04_echo_to_distance(uint32_t echoTime, HCSR04_U unit);
+
+/**
+ * Create a scheduler for several sensors and start it.  Sensors in
+ * the same group are fired together, so they should not be able to
+ * hear each other.  The groups are fired in turn, one measurement
+ * cycle apart.
+ *
+ * @param devs array of sensor contexts, which remain owned by the
+ * caller and must not be used otherwise while the scheduler runs
+ * @param numDevs number of sensors
+ * @param groups group number of each sensor, or NULL to fire the
+ * sensors one at a time (round robin)
+ * @return scheduler context, or NULL on error
+ */
+hcsr04_scheduler_context hcsr04_scheduler_init(hcsr04_context *devs,
+                                               unsigned int numDevs,
+                                               const unsigned int *groups);
+
+/**
+ * Stop the scheduler and free it.  The sensor contexts are not
+ * closed.
+ *
+ * @param sched scheduler context
+ */
+void hcsr04_scheduler_close(hcsr04_scheduler_context sched);
+
+/**
+ * Get the latest reading of a sensor from the scheduler snapshot.
+ * This never blocks the scheduler thread.
+ *
+ * @param sched scheduler context
+ * @param index index of the sensor, as passed to
+ * hcsr04_scheduler_init()
+ * @param reading pointer to hold the reading
+ * @return UPM result
+ */
+upm_result_t hcsr04_scheduler_get_reading(hcsr04_scheduler_context sched,
+                                          unsigned int index,
+                                          hcsr04_reading_t *reading);
+
+/**
+ * Get a consistent copy of the latest readings of all sensors
+ *
+ * @param sched scheduler context
+ * @param readings array of at least numDevs readings
+ */
+void hcsr04_scheduler_get_readings(hcsr04_scheduler_context sched,
+                                   hcsr04_reading_t *readings);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
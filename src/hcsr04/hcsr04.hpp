@@ -24,6 +24,7 @@
  */
 #pragma once
 
+#include <vector>
 #include "hcsr04.h"
 
 namespace upm {
@@ -70,9 +71,71 @@ class HCSR04 {
          */
         double getDistance (HCSR04_U unit);
 
+        /**
+         * Measures the distance with the echo timed by an interrupt
+         * handler, sleeping while waiting for the echo
+         *
+         * @param unit Selects units for measurement
+         * @return The distance
+         * @throws std::runtime_error if no echo was received
+         */
+        double measure (HCSR04_U unit);
+
     private:
+        friend class HCSR04Scheduler;
         hcsr04_context m_hcsr04;
         HCSR04(const HCSR04& src) { /* do not create copied constructor */ }
         HCSR04& operator=(const HCSR04&) {return *this;}
     };
+
+/**
+ * @brief Scheduler for several HC-SR04 sensors
+ *
+ * A background thread fires the sensors one group at a time, one
+ * measurement cycle apart, and publishes the latest distances.
+ * Sensors in the same group are fired together, so they should not
+ * be able to hear each other.  Reading the distances never blocks
+ * the scheduler.
+ */
+class HCSR04Scheduler {
+    public:
+        /**
+         * Starts a scheduler
+         *
+         * @param sensors The sensors to fire.  They must outlive the
+         * scheduler, and must not be used otherwise while it runs.
+         * @param groups The group of each sensor.  If empty, the
+         * sensors are fired one at a time.
+         */
+        HCSR04Scheduler (std::vector<HCSR04 *> sensors,
+                         std::vector<unsigned int> groups =
+                         std::vector<unsigned int>());
+        /**
+         * HCSR04Scheduler object destructor, stops the scheduler
+         */
+        ~HCSR04Scheduler ();
+
+        /**
+         * Gets the latest distance measured by a sensor
+         *
+         * @param index Index of the sensor
+         * @param unit Selects units for measurement
+         * @return The distance, 0 if there was no echo
+         */
+        double getDistance (unsigned int index, HCSR04_U unit);
+
+        /**
+         * Gets the time of the latest measurement of a sensor
+         *
+         * @param index Index of the sensor
+         * @return The time the echo ended (CLOCK_MONOTONIC, in us)
+         */
+        uint64_t getTimestamp (unsigned int index);
+
+    private:
+        hcsr04_scheduler_context m_sched;
+        hcsr04_reading_t getReading (unsigned int index);
+        HCSR04Scheduler(const HCSR04Scheduler& src) { /* do not create copied constructor */ }
+        HCSR04Scheduler& operator=(const HCSR04Scheduler&) {return *this;}
+    };
 }
@@ -46,7 +46,7 @@ static float c2f(float c)
 
 HWXPXX::HWXPXX(std::string device, int address, int baud, int bits, char parity,
                int stopBits) :
-  m_mbContext(0)
+  m_bus(0), m_pollID(-1), m_pollInterval(0)
 {
   // check some of the parameters
   if (!(bits == 7 || bits == 8))
@@ -71,67 +71,52 @@ HWXPXX::HWXPXX(std::string device, int address, int baud, int bits, char parity,
   m_humidity = 0.0;
   m_slider = 0;
 
-  // now, open/init the device and modbus context
-
-  if (!(m_mbContext = modbus_new_rtu(device.c_str(), baud, parity, bits,
-                                     stopBits)))
-    {
-      throw std::runtime_error(std::string(__FUNCTION__) +
-                               ": modbus_new_rtu() failed");
-    }
+  // addresses are only 8bits wide
+  m_slave = address & 0xff;
 
-  // set the slave address of the device we want to talk to
+  // now, get the bus for this port and attach to it
+  m_bus = ModbusBus::instance(device, baud, bits, parity, stopBits);
+  m_bus->attach(m_slave);
 
-  // addresses are only 8bits wide
-  address &= 0xff;
-  if (modbus_set_slave(m_mbContext, address))
+  // the bus attachment is ours until the constructor returns, so
+  // release it if anything after this point fails
+  try
     {
-      throw std::runtime_error(std::string(__FUNCTION__) +
-                               ": modbus_set_slave() failed");
+      // read the 2 coils to determine temperature scale and current status
+      // of (optional) override switch
+      uint8_t coils[2];
+      readCoils(COIL_TEMP_SCALE, 2, coils);
+
+      // temp scale
+      if (coils[0])
+        m_isCelsius = false;
+      else
+        m_isCelsius = true;
+
+      // current override switch status
+      m_override = ((coils[1]) ? true : false);
+
+      // turn off debugging
+      setDebug(false);
     }
-
-  // set the serial mode
-  modbus_rtu_set_serial_mode(m_mbContext, MODBUS_RTU_RS232);
-
-  // now connect..
-  if (modbus_connect(m_mbContext))
+  catch (...)
     {
-      throw std::runtime_error(std::string(__FUNCTION__) +
-                               ": modbus_connect() failed");
+      m_bus->detach(m_slave);
+      throw;
     }
-
-  // read the 2 coils to determine temperature scale and current status
-  // of (optional) override switch
-  uint8_t coils[2];
-  readCoils(COIL_TEMP_SCALE, 2, coils);
-
-  // temp scale
-  if (coils[0])
-    m_isCelsius = false;
-  else
-    m_isCelsius = true;
-
-  // current override switch status
-  m_override = ((coils[1]) ? true : false);
-
-  // turn off debugging
-  setDebug(false);
 }
 
 HWXPXX::~HWXPXX()
 {
-  if (m_mbContext)
-    {
-      modbus_close(m_mbContext);
-      modbus_free(m_mbContext);
-    }
+  unschedule();
+  m_bus->detach(m_slave);
 }
 
 int HWXPXX::readInputRegs(INPUT_REGS_T reg, int len, uint16_t *buf)
 {
   int rv;
 
-  if ((rv = modbus_read_input_registers(m_mbContext, reg, len, buf)) < 0)
+  if ((rv = m_bus->readInputRegs(m_slave, reg, len, buf)) < 0)
     {
       throw std::runtime_error(std::string(__FUNCTION__) +
                                ": modbus_read_input_registers() failed");
@@ -157,7 +142,7 @@ int HWXPXX::readHoldingRegs(HOLDING_REGS_T reg, int len, uint16_t *buf)
 {
   int rv;
 
-  if ((rv = modbus_read_registers(m_mbContext, reg, len, buf)) < 0)
+  if ((rv = m_bus->readHoldingRegs(m_slave, reg, len, buf)) < 0)
     {
       throw std::runtime_error(std::string(__FUNCTION__) +
                                ": modbus_read_registers() failed");
@@ -181,7 +166,7 @@ uint16_t HWXPXX::readHoldingReg(HOLDING_REGS_T reg)
 
 void HWXPXX::writeHoldingReg(HOLDING_REGS_T reg, int value)
 {
-  if (modbus_write_register(m_mbContext, reg, value) != 1)
+  if (m_bus->writeHoldingReg(m_slave, reg, value) != 1)
     {
       throw std::runtime_error(std::string(__FUNCTION__) +
                                ": modbus_write_register() failed");
@@ -192,7 +177,7 @@ int HWXPXX::readCoils(COIL_REGS_T reg, int numBits, uint8_t *buf)
 {
   int rv;
 
-  if ((rv = modbus_read_bits(m_mbContext, reg, numBits, buf)) < 0)
+  if ((rv = m_bus->readCoils(m_slave, reg, numBits, buf)) < 0)
     {
       throw std::runtime_error(std::string(__FUNCTION__) +
                                ": modbus_read_bits() failed");
@@ -216,9 +201,7 @@ bool HWXPXX::readCoil(COIL_REGS_T reg)
 
 void HWXPXX::writeCoil(COIL_REGS_T reg, bool val)
 {
-  int value = (val) ? TRUE : FALSE;
-
-  if (modbus_write_bit(m_mbContext, reg, value) != 1)
+  if (m_bus->writeCoil(m_slave, reg, val) != 1)
     {
       throw std::runtime_error(std::string(__FUNCTION__) +
                                ": modbus_write_bit() failed");
@@ -237,6 +220,38 @@ void HWXPXX::update()
                                ": readInputRegs() failed to read 3 registers");
     }
 
+  decode(data);
+
+  // optional override switch status
+  m_override = readCoil(COIL_OVERRIDE);
+}
+
+void HWXPXX::schedule(int intervalMs)
+{
+  unschedule();
+
+  // the same 3 input registers update() reads
+  m_pollID = m_bus->addPoll(m_slave, ModbusBus::REGS_INPUT, INPUT_HUMIDITY,
+                            3, intervalMs, pollHandler, this);
+  m_pollInterval = intervalMs;
+}
+
+void HWXPXX::unschedule()
+{
+  if (m_pollID >= 0)
+    {
+      m_bus->removePoll(m_pollID);
+      m_pollID = -1;
+    }
+}
+
+void HWXPXX::pollHandler(const uint16_t *regs, int len, void *arg)
+{
+  ((HWXPXX *)arg)->decode(regs);
+}
+
+void HWXPXX::decode(const uint16_t *data)
+{
   // humidity
   m_humidity = float((int16_t)data[0]) / 10.0;
 
@@ -250,9 +265,6 @@ void HWXPXX::update()
 
   // optional slider level
   m_slider = int(data[2]);
-
-  // optional override switch status
-  m_override = readCoil(COIL_OVERRIDE);
 }
 
 float HWXPXX::getTemperature(bool fahrenheit)
@@ -331,7 +343,7 @@ string HWXPXX::getSlaveID()
   uint8_t id[MODBUS_MAX_PDU_LENGTH];
   int rv;
 
-  if ((rv = modbus_report_slave_id(m_mbContext, MODBUS_MAX_PDU_LENGTH, id)) < 0)
+  if ((rv = m_bus->reportSlaveID(m_slave, MODBUS_MAX_PDU_LENGTH, id)) < 0)
     {
       throw std::runtime_error(std::string(__FUNCTION__) +
                                ": modbus_report_slave_id() failed");
@@ -355,25 +367,42 @@ void HWXPXX::setSlaveAddress(int addr)
   // addresses are only 8bits wide
   addr &= 0xff;
 
-  if (modbus_set_slave(m_mbContext, addr))
+  // move our attachment, and any scheduled poll, to the new address
+  bool scheduled = (m_pollID >= 0);
+  unschedule();
+
+  // keep the old attachment until the device answers at the new
+  // address, so a failure leaves us where we were
+  int oldSlave = m_slave;
+  m_bus->attach(addr);
+  m_slave = addr;
+
+  try
     {
-      throw std::runtime_error(std::string(__FUNCTION__) +
-                               ": modbus_set_slave() failed");
+      // now re-read and set m_isCelsius properly
+      if (readCoil(COIL_TEMP_SCALE))
+        m_isCelsius = false;
+      else
+        m_isCelsius = true;
+    }
+  catch (...)
+    {
+      m_slave = oldSlave;
+      m_bus->detach(addr);
+      if (scheduled)
+        schedule(m_pollInterval);
+      throw;
     }
 
-  // now re-read and set m_isCelsius properly
-  if (readCoil(COIL_TEMP_SCALE))
-    m_isCelsius = false;
-  else
-    m_isCelsius = true;
+  m_bus->detach(oldSlave);
+
+  if (scheduled)
+    schedule(m_pollInterval);
 }
 
 void HWXPXX::setDebug(bool enable)
 {
   m_debugging = enable;
 
-  if (enable)
-    modbus_set_debug(m_mbContext, 1);
-  else
-    modbus_set_debug(m_mbContext, 0);
+  m_bus->setDebug(enable);
 }
@@ -25,7 +25,7 @@
 
 #include <string>
 
-#include <modbus/modbus.h>
+#include "modbusbus.hpp"
 
 namespace upm {
 
@@ -61,6 +61,12 @@ namespace upm {
    * the built in MCU TTL UART pins for accessing this device -- you
    * must use a full serial RS232->RS485 interface connected via USB.
    *
+   * Devices on the same serial port share a ModbusBus, so several
+   * HWXPXXs (and other UPM MODBUS devices) can be used on one line.
+   * Instead of calling update(), schedule() lets ModbusBus::poll()
+   * refresh the humidity, temperature and slider values on its own
+   * timetable.  The override switch status is only read by update().
+   *
    * @snippet hwxpxx.cxx Interesting
    */
 
@@ -117,6 +123,32 @@ namespace upm {
      */
     void update();
 
+    /**
+     * Have the shared bus refresh the humidity, temperature and
+     * slider values every intervalMs milliseconds, instead of calling
+     * update().  The values are refreshed from ModbusBus::poll(),
+     * which must be called regularly on the bus returned by getBus().
+     * The override switch status is only refreshed by update().
+     *
+     * @param intervalMs How often to read the sensor, in milliseconds
+     */
+    void schedule(int intervalMs);
+
+    /**
+     * Stop refreshing the values from the shared bus.
+     */
+    void unschedule();
+
+    /**
+     * Get the shared bus this device is attached to.
+     *
+     * @return The bus for the serial port of this device
+     */
+    ModbusBus *getBus()
+    {
+      return m_bus;
+    };
+
     /**
      * Get the current temperature.  update() must have been called
      * prior to calling this method.  If this option was not
@@ -158,6 +190,10 @@ namespace upm {
      * to programatically set this value to true - that can only be
      * done by physically pressing the override switch.
      *
+     * The override switch is a coil, which schedule() does not poll,
+     * so this value is only refreshed by update(), even while the
+     * other values are being refreshed from the shared bus.
+     *
      * @return The last overide switch status reading
      */
     bool getOverrideSwitchStatus();
@@ -236,7 +272,10 @@ namespace upm {
      * Set a new MODBUS slave address.  This is useful if you have
      * multiple HWXPXX devices on a single bus.  When this method is
      * called, the current temperature scale is re-read so that
-     * further update() calls can work correctly.
+     * further update() calls can work correctly.  A scheduled poll
+     * moves to the new address.  If the device does not answer at
+     * the new address, the old address is kept and the error is
+     * rethrown.
      *
      * @param addr The new slave address to set
      */
@@ -244,7 +283,7 @@ namespace upm {
 
     /**
      * Enable or disable debugging output.  This primarily enables and
-     * disables libmodbus debugging output.
+     * disables libmodbus debugging output, for the whole bus.
      *
      * @param enable true to enable debugging, false otherwise
      */
@@ -265,8 +304,15 @@ namespace upm {
     uint16_t readHoldingReg(HOLDING_REGS_T reg);
     void writeHoldingReg(HOLDING_REGS_T reg, int value);
 
-    // MODBUS context
-    modbus_t *m_mbContext;
+    // decode the 3 input registers starting at INPUT_HUMIDITY
+    void decode(const uint16_t *data);
+    static void pollHandler(const uint16_t *regs, int len, void *arg);
+
+    // shared MODBUS bus, our slave address and scheduled poll
+    ModbusBus *m_bus;
+    int m_slave;
+    int m_pollID;
+    int m_pollInterval;
 
     // is the device reporting in C or F?
     bool m_isCelsius;
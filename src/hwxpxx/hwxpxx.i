@@ -8,7 +8,9 @@ JAVA_JNI_LOADLIBRARY(javaupm_hwxpxx)
 
 /* BEGIN Common SWIG syntax ------------------------------------------------- */
 %{
+#include "modbusbus.hpp"
 #include "hwxpxx.hpp"
 %}
+%include "modbusbus.hpp"
 %include "hwxpxx.hpp"
 /* END Common SWIG syntax */
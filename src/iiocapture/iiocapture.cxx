@@ -0,0 +1,521 @@
+/*
+ * Author: agent <agent@local>
+ * Copyright (c) 2026 agent.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "iiocapture.hpp"
+
+#define IIO_SYSFS_PATH "/sys/bus/iio/devices/iio:device"
+#define IIO_DEV_PATH "/dev/iio:device"
+#define IIO_TIMESTAMP_CHANNEL "in_timestamp"
+
+using namespace upm;
+using namespace std;
+
+static bool
+readString(const string& path, char* buf, int len)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    ssize_t rv = read(fd, buf, len - 1);
+    close(fd);
+
+    if (rv <= 0)
+        return false;
+
+    buf[rv] = 0;
+    return true;
+}
+
+bool
+IIOCapture::channelOrder(const CHANNEL_T& a, const CHANNEL_T& b)
+{
+    return a.index < b.index;
+}
+
+IIOCapture::IIOCapture(int device)
+{
+    m_device = device;
+    m_sysfsPath = IIO_SYSFS_PATH + to_string(device) + "/";
+    m_fd = -1;
+    m_enabled = false;
+    m_scanSize = 0;
+    m_timestampChan = -1;
+    m_ringSize = 0;
+    m_ringHead = 0;
+    m_ringCount = 0;
+    m_handler = NULL;
+    m_handlerArg = NULL;
+    m_threadRunning = false;
+
+    if ((m_epollFd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        throw std::runtime_error(string(__FUNCTION__) +
+                                 ": epoll_create1() failed: " +
+                                 string(strerror(errno)));
+        return;
+    }
+
+    if ((m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+        close(m_epollFd);
+        throw std::runtime_error(string(__FUNCTION__) +
+                                 ": eventfd() failed: " +
+                                 string(strerror(errno)));
+        return;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = m_eventFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_eventFd, &ev);
+}
+
+IIOCapture::~IIOCapture()
+{
+    if (m_enabled)
+        disableBuffer();
+
+    if (m_fd >= 0)
+        close(m_fd);
+
+    close(m_eventFd);
+    close(m_epollFd);
+
+    for (map<string, int>::iterator it = m_attrFds.begin();
+         it != m_attrFds.end(); ++it)
+        close(it->second);
+}
+
+bool
+IIOCapture::writeAttribute(const string& name, const string& value)
+{
+    string path = m_sysfsPath + name;
+    int fd = open(path.c_str(), O_WRONLY);
+    if (fd < 0)
+        return false;
+
+    ssize_t rv = write(fd, value.c_str(), value.size());
+    close(fd);
+
+    return rv == (ssize_t) value.size();
+}
+
+bool
+IIOCapture::readAttribute(const string& name, int* value)
+{
+    char buf[32];
+    int fd;
+
+    map<string, int>::iterator it = m_attrFds.find(name);
+    if (it == m_attrFds.end()) {
+        string path = m_sysfsPath + name;
+        if ((fd = open(path.c_str(), O_RDONLY | O_CLOEXEC)) < 0)
+            return false;
+        m_attrFds[name] = fd;
+    } else {
+        fd = it->second;
+    }
+
+    // sysfs regenerates the value on every read from offset 0
+    ssize_t rv = pread(fd, buf, sizeof(buf) - 1, 0);
+    if (rv <= 0)
+        return false;
+    buf[rv] = 0;
+
+    return sscanf(buf, "%d", value) == 1;
+}
+
+bool
+IIOCapture::setTrigger(const string& trigger)
+{
+    return writeAttribute("trigger/current_trigger", trigger);
+}
+
+bool
+IIOCapture::hasChannel(const string& name)
+{
+    string path = m_sysfsPath + "scan_elements/" + name + "_en";
+    return access(path.c_str(), F_OK) == 0;
+}
+
+bool
+IIOCapture::enableChannel(const string& name, bool enable)
+{
+    return writeAttribute("scan_elements/" + name + "_en", enable ? "1" : "0");
+}
+
+int
+IIOCapture::getChannelIndex(const string& name)
+{
+    for (size_t i = 0; i < m_plan.size(); i++)
+        if (m_plan[i].name == name)
+            return i;
+
+    return -1;
+}
+
+bool
+IIOCapture::updateChannels()
+{
+    string scanPath = m_sysfsPath + "scan_elements/";
+    char buf[64];
+    DIR* dir;
+    struct dirent* ent;
+
+    // the kernel doesn't allow changes while the buffer is enabled,
+    // and the capture thread may be using the plan
+    if (m_enabled)
+        return false;
+
+    // timestamp every scan if the device can
+    if (hasChannel(IIO_TIMESTAMP_CHANNEL))
+        enableChannel(IIO_TIMESTAMP_CHANNEL);
+
+    m_plan.clear();
+    m_scanSize = 0;
+    m_timestampChan = -1;
+
+    if (!(dir = opendir(scanPath.c_str())))
+        return false;
+
+    while ((ent = readdir(dir)) != NULL) {
+        string file = ent->d_name;
+        if (file.size() <= 3 || file.compare(file.size() - 3, 3, "_en"))
+            continue;
+
+        if (!readString(scanPath + file, buf, sizeof(buf)) || atoi(buf) != 1)
+            continue;
+
+        CHANNEL_T chan;
+        chan.name = file.substr(0, file.size() - 3);
+
+        // an enabled element we can't decode would throw off the
+        // offsets of all the others, so give up
+        if (!readString(scanPath + chan.name + "_index", buf, sizeof(buf))) {
+            closedir(dir);
+            return false;
+        }
+        chan.index = atoi(buf);
+
+        // le:s12/16>>4, or le:s16/16X3>>0 for repeated elements
+        char endian, sign;
+        unsigned int bits, storage, shift, repeat = 1;
+        if (!readString(scanPath + chan.name + "_type", buf, sizeof(buf))) {
+            closedir(dir);
+            return false;
+        }
+        if (sscanf(buf, "%ce:%c%u/%uX%u>>%u", &endian, &sign, &bits, &storage,
+                   &repeat, &shift) != 6) {
+            repeat = 1;
+            if (sscanf(buf, "%ce:%c%u/%u>>%u", &endian, &sign, &bits, &storage,
+                       &shift) != 5) {
+                cerr << __FUNCTION__ << ": can't parse type of " << chan.name
+                     << ": " << buf << endl;
+                closedir(dir);
+                return false;
+            }
+        }
+
+        if ((storage != 8 && storage != 16 && storage != 32 && storage != 64) ||
+            bits == 0 || bits > storage || shift >= storage || repeat == 0) {
+            cerr << __FUNCTION__ << ": unsupported type for " << chan.name
+                 << ": " << buf << endl;
+            closedir(dir);
+            return false;
+        }
+
+        chan.bytes = storage / 8;
+        chan.length = chan.bytes * repeat;
+        chan.shift = shift;
+        chan.signShift = 64 - bits;
+        chan.mask = (bits == 64) ? ~0ULL : ((1ULL << bits) - 1);
+        chan.bigEndian = (endian == 'b');
+        chan.isSigned = (sign == 's');
+        chan.offset = 0;
+
+        m_plan.push_back(chan);
+    }
+    closedir(dir);
+
+    if (m_plan.empty())
+        return false;
+
+    // lay out the scan the way the kernel does: in scan index order,
+    // each element aligned to its own size, and the whole scan
+    // aligned to the largest element
+    sort(m_plan.begin(), m_plan.end(), channelOrder);
+
+    int bytes = 0;
+    int largest = 0;
+    for (size_t i = 0; i < m_plan.size(); i++) {
+        int length = m_plan[i].length;
+        if (bytes % length)
+            bytes += length - (bytes % length);
+        m_plan[i].offset = bytes;
+        bytes += length;
+        largest = max(largest, length);
+
+        if (m_plan[i].name == IIO_TIMESTAMP_CHANNEL)
+            m_timestampChan = i;
+    }
+    if (bytes % largest)
+        bytes += largest - (bytes % largest);
+
+    m_scanSize = bytes;
+    return true;
+}
+
+bool
+IIOCapture::enableBuffer(int length, int watermark)
+{
+    if (m_enabled)
+        disableBuffer();
+
+    if (length < 1)
+        length = 1;
+
+    if (!m_scanSize && !updateChannels()) {
+        cerr << __FUNCTION__ << ": can't read the enabled scan elements" << endl;
+        return false;
+    }
+
+    if (m_fd < 0) {
+        string path = IIO_DEV_PATH + to_string(m_device);
+        if ((m_fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC)) < 0) {
+            throw std::runtime_error(string(__FUNCTION__) + ": open(" + path +
+                                     ") failed: " + string(strerror(errno)));
+            return false;
+        }
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = m_fd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_fd, &ev);
+    }
+
+    m_ringSize = length;
+    m_ring.resize(m_ringSize * m_scanSize);
+    m_ringHead = 0;
+    m_ringCount = 0;
+
+    writeAttribute("buffer/length", to_string(length));
+    // not all kernels have this
+    writeAttribute("buffer/watermark", to_string(min(max(watermark, 1), length)));
+    // enable must be last step, else will have error in writing above config
+    if (!writeAttribute("buffer/enable", "1"))
+        return false;
+
+    m_enabled = true;
+
+    if (m_handler)
+        startThread();
+
+    return true;
+}
+
+bool
+IIOCapture::disableBuffer()
+{
+    stopThread();
+
+    m_enabled = false;
+    m_ringHead = 0;
+    m_ringCount = 0;
+
+    return writeAttribute("buffer/enable", "0");
+}
+
+void
+IIOCapture::installHandler(IIO_HANDLER_T handler, void* arg)
+{
+    stopThread();
+
+    m_handler = handler;
+    m_handlerArg = arg;
+
+    if (m_enabled && m_handler)
+        startThread();
+}
+
+int
+IIOCapture::fillRing()
+{
+    int total = 0;
+
+    while (m_ringCount < m_ringSize) {
+        // read into the free space up to the end of the ring, then
+        // go around again for the part at the start
+        int tail = m_ringHead + m_ringCount;
+        if (tail >= m_ringSize)
+            tail -= m_ringSize;
+        int space = min(m_ringSize - m_ringCount, m_ringSize - tail);
+
+        ssize_t rv = read(m_fd, &m_ring[tail * m_scanSize], space * m_scanSize);
+        if (rv < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                break;
+            return -1;
+        }
+
+        // the kernel only returns whole scans
+        int scans = rv / m_scanSize;
+        m_ringCount += scans;
+        total += scans;
+
+        if (scans < space)
+            break;
+    }
+
+    return total;
+}
+
+int
+IIOCapture::waitScans(int timeoutMs)
+{
+    if (m_threadRunning) {
+        throw std::runtime_error(string(__FUNCTION__) +
+                                 ": not available while a handler is installed");
+        return 0;
+    }
+
+    if (!m_enabled)
+        return 0;
+
+    if (!m_ringCount) {
+        struct epoll_event ev;
+        int rv = epoll_wait(m_epollFd, &ev, 1, timeoutMs);
+        if (rv < 0 && errno != EINTR) {
+            throw std::runtime_error(string(__FUNCTION__) +
+                                     ": epoll_wait() failed: " +
+                                     string(strerror(errno)));
+            return 0;
+        }
+        if (rv <= 0)
+            return 0;
+    }
+
+    if (fillRing() < 0) {
+        throw std::runtime_error(string(__FUNCTION__) + ": read() failed: " +
+                                 string(strerror(errno)));
+        return 0;
+    }
+
+    return m_ringCount;
+}
+
+void
+IIOCapture::consumeScans(int count)
+{
+    if (count > m_ringCount)
+        count = m_ringCount;
+
+    m_ringHead += count;
+    if (m_ringHead >= m_ringSize)
+        m_ringHead -= m_ringSize;
+    m_ringCount -= count;
+}
+
+void
+IIOCapture::startThread()
+{
+    if (m_threadRunning)
+        return;
+
+    if (pthread_create(&m_thread, NULL, captureThread, this)) {
+        throw std::runtime_error(string(__FUNCTION__) +
+                                 ": pthread_create() failed");
+        return;
+    }
+
+    m_threadRunning = true;
+}
+
+void
+IIOCapture::stopThread()
+{
+    if (!m_threadRunning)
+        return;
+
+    uint64_t val = 1;
+    if (write(m_eventFd, &val, sizeof(val)) != sizeof(val))
+        cerr << __FUNCTION__ << ": eventfd write failed" << endl;
+
+    pthread_join(m_thread, NULL);
+    m_threadRunning = false;
+
+    // drain it for next time
+    if (read(m_eventFd, &val, sizeof(val)) != sizeof(val))
+        cerr << __FUNCTION__ << ": eventfd read failed" << endl;
+}
+
+void*
+IIOCapture::captureThread(void* ctx)
+{
+    IIOCapture* This = (IIOCapture*) ctx;
+    struct epoll_event events[2];
+
+    while (true) {
+        int rv = epoll_wait(This->m_epollFd, events, 2, -1);
+        if (rv < 0) {
+            if (errno == EINTR)
+                continue;
+            cerr << __FUNCTION__ << ": epoll_wait() failed: "
+                 << strerror(errno) << endl;
+            break;
+        }
+
+        bool stop = false;
+        for (int i = 0; i < rv; i++)
+            if (events[i].data.fd == This->m_eventFd)
+                stop = true;
+        if (stop)
+            break;
+
+        if (This->fillRing() < 0) {
+            cerr << __FUNCTION__ << ": read() failed: " << strerror(errno)
+                 << endl;
+            break;
+        }
+
+        for (int i = 0; i < This->m_ringCount; i++)
+            This->m_handler(This->getScan(i), This->m_handlerArg);
+        This->consumeScans(This->m_ringCount);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,350 @@
+/*
+ * Author: agent <agent@local>
+ * Copyright (c) 2026 agent.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+#include <pthread.h>
+
+namespace upm
+{
+/**
+ * @brief IIO Triggered Buffer Capture
+ * @defgroup iiocapture libupm-iiocapture
+ * @ingroup iio
+ */
+
+/**
+ * @library iiocapture
+ * @comname IIO triggered buffer capture engine
+ * @con iio
+ *
+ * @brief API for capturing from an IIO device's triggered buffer
+ *
+ * This module reads scans from the /dev/iio:deviceX character device
+ * of an IIO driver.  Once the scan elements are enabled, they are
+ * read from sysfs once, and a decode plan (offset,
+ * storage size, endianness, shift, and sign of each channel) is
+ * built from them, so decoding a channel from a scan needs no
+ * lookups.
+ *
+ * Scans are read into a ring, as many as are available per read()
+ * call.  The character device is watched with epoll, and the epoll
+ * descriptor returned by getFd() can be added to an application's
+ * own poll loop.  Alternatively, a handler can be installed that is
+ * called for each scan from a capture thread.
+ *
+ * If the device has a timestamp scan element, it is enabled along
+ * with the others, and is available through getTimestamp().
+ *
+ * This module also provides reads of sysfs attributes through
+ * descriptors that are kept open, for devices that are polled
+ * rather than buffered.
+ */
+
+class IIOCapture
+{
+  public:
+    /**
+     * Handler called from the capture thread for each scan.  The
+     * data remains valid only until the handler returns.
+     */
+    typedef void (*IIO_HANDLER_T)(char* data, void* arg);
+
+    /**
+     * IIOCapture constructor
+     * @param device iio device number
+     */
+    IIOCapture(int device);
+
+    /**
+     * IIOCapture destructor.  This disables the buffer if it was
+     * enabled.
+     */
+    ~IIOCapture();
+
+    /**
+     * Set the trigger for the buffer
+     * @param trigger trigger name
+     * @return true if successful
+     */
+    bool setTrigger(const std::string& trigger);
+
+    /**
+     * Returns whether the device has a scan element
+     * @param name scan element name, such as "in_accel_x"
+     * @return true if the scan element exists
+     */
+    bool hasChannel(const std::string& name);
+
+    /**
+     * Enable or disable a scan element.  Call updateChannels() once
+     * done enabling scan elements.
+     * @param name scan element name, such as "in_accel_x"
+     * @param enable true to enable the scan element
+     * @return true if successful
+     */
+    bool enableChannel(const std::string& name, bool enable = true);
+
+    /**
+     * Read the enabled scan elements and build the decode plan.  The
+     * timestamp scan element is enabled first if the device has one.
+     * This must be called after changing the enabled scan elements,
+     * and before looking up channels with getChannelIndex().  This
+     * fails while the buffer is enabled.
+     * @return true if successful
+     */
+    bool updateChannels();
+
+    /**
+     * Enable the buffer.  If updateChannels() has not been called,
+     * it is called first.  If a handler is installed, the capture
+     * thread is started.
+     * @param length buffer length in scans
+     * @param watermark number of scans the kernel buffers before
+     * waking us up, 1 wakes up for every scan.  This is ignored by
+     * kernels without buffer watermark support.
+     * @return true if successful
+     */
+    bool enableBuffer(int length, int watermark = 1);
+
+    /**
+     * Disable the buffer, stopping the capture thread if running.
+     * Scans remaining in the ring are discarded.
+     * @return true if successful
+     */
+    bool disableBuffer();
+
+    /**
+     * Returns whether the buffer is enabled
+     * @return true if the buffer is enabled
+     */
+    bool isEnabled()
+    {
+        return m_enabled;
+    };
+
+    /**
+     * Install a handler to be called for each scan from a capture
+     * thread, replacing any previous handler.  The thread runs while
+     * the buffer is enabled.  Pass NULL to remove the handler.  While
+     * a handler is installed, waitScans() cannot be used.
+     * @param handler handler function
+     * @param arg argument passed to the handler
+     */
+    void installHandler(IIO_HANDLER_T handler, void* arg);
+
+    /**
+     * Returns an epoll descriptor that becomes readable when scans
+     * are available from the device, to be used with poll(),
+     * select() or epoll when waitScans() should not block.
+     * @return epoll file descriptor
+     */
+    int getFd()
+    {
+        return m_epollFd;
+    };
+
+    /**
+     * Wait until scans are available and read as many as possible
+     * into the ring.  If scans are already in the ring, this does not
+     * wait.
+     * @param timeoutMs time to wait in milliseconds, 0 to not wait,
+     * -1 to wait forever
+     * @return number of scans in the ring, 0 on timeout
+     */
+    int waitScans(int timeoutMs = -1);
+
+    /**
+     * Returns a scan from the ring
+     * @param idx index of the scan, 0 being the oldest, and less than
+     * the count returned by waitScans()
+     * @return scan data
+     */
+    char* getScan(int idx)
+    {
+        int slot = m_ringHead + idx;
+        if (slot >= m_ringSize)
+            slot -= m_ringSize;
+        return &m_ring[slot * m_scanSize];
+    };
+
+    /**
+     * Remove the oldest scans from the ring
+     * @param count number of scans
+     */
+    void consumeScans(int count);
+
+    /**
+     * Returns the size of a scan with the scan elements enabled at
+     * the last updateChannels()
+     * @return scan size in bytes
+     */
+    int getScanSize()
+    {
+        return m_scanSize;
+    };
+
+    /**
+     * Returns the position of a scan element in the decode plan, for
+     * use with getChannelValue()
+     * @param name scan element name, such as "in_accel_x"
+     * @return position, or -1 if the scan element is not enabled
+     */
+    int getChannelIndex(const std::string& name);
+
+    /**
+     * Extract a channel value from a scan using the decode plan
+     * @param data scan data
+     * @param chan position of the channel, see getChannelIndex()
+     * @return channel value, with shift and sign applied
+     */
+    int64_t getChannelValue(const char* data, int chan) const
+    {
+        const CHANNEL_T& c = m_plan[chan];
+        const char* p = data + c.offset;
+        uint64_t u64;
+
+        switch (c.bytes) {
+            case 1:
+                u64 = *(const uint8_t*) p;
+                break;
+
+            case 2:
+            {
+                uint16_t u16;
+                memcpy(&u16, p, sizeof(u16));
+                u64 = c.bigEndian ? be16toh(u16) : le16toh(u16);
+                break;
+            }
+
+            case 4:
+            {
+                uint32_t u32;
+                memcpy(&u32, p, sizeof(u32));
+                u64 = c.bigEndian ? be32toh(u32) : le32toh(u32);
+                break;
+            }
+
+            default:
+                memcpy(&u64, p, sizeof(u64));
+                u64 = c.bigEndian ? be64toh(u64) : le64toh(u64);
+                break;
+        }
+
+        u64 = (u64 >> c.shift) & c.mask;
+
+        if (c.isSigned)
+            return (int64_t)(u64 << c.signShift) >> c.signShift;
+
+        return (int64_t) u64;
+    };
+
+    /**
+     * Returns whether scans have a timestamp
+     * @return true if the timestamp scan element is enabled
+     */
+    bool hasTimestamp()
+    {
+        return m_timestampChan >= 0;
+    };
+
+    /**
+     * Returns the timestamp of a scan, taken by the kernel when the
+     * trigger fired
+     * @param data scan data
+     * @return timestamp in nanoseconds, or 0 if scans have no
+     * timestamp
+     */
+    int64_t getTimestamp(const char* data) const
+    {
+        if (m_timestampChan < 0)
+            return 0;
+        return getChannelValue(data, m_timestampChan);
+    };
+
+    /**
+     * Read an integer sysfs attribute of the device.  The attribute
+     * is kept open, so repeated reads cost a single pread().
+     * @param name attribute name, such as "in_proximity_raw"
+     * @param value pointer to store the value
+     * @return true if successful
+     */
+    bool readAttribute(const std::string& name, int* value);
+
+  private:
+    // decode plan entry for an enabled scan element
+    typedef struct {
+        std::string name;
+        int index;      // scan index
+        int offset;     // byte offset in a scan
+        int bytes;      // storage size
+        int length;     // bytes * repeat
+        int shift;
+        int signShift;  // 64 - bits
+        uint64_t mask;
+        bool bigEndian;
+        bool isSigned;
+    } CHANNEL_T;
+
+    int m_device;
+    std::string m_sysfsPath;
+    int m_fd;           // character device
+    int m_epollFd;
+    int m_eventFd;      // wakes the capture thread to exit
+    bool m_enabled;
+
+    std::vector<CHANNEL_T> m_plan;
+    int m_scanSize;
+    int m_timestampChan;
+
+    // ring of scans
+    std::vector<char> m_ring;
+    int m_ringSize;
+    int m_ringHead;
+    int m_ringCount;
+
+    IIO_HANDLER_T m_handler;
+    void* m_handlerArg;
+    bool m_threadRunning;
+    pthread_t m_thread;
+
+    std::map<std::string, int> m_attrFds;
+
+    bool writeAttribute(const std::string& name, const std::string& value);
+    static bool channelOrder(const CHANNEL_T& a, const CHANNEL_T& b);
+    int fillRing();
+    void startThread();
+    void stopThread();
+    static void* captureThread(void* ctx);
+
+    // disable copying, the object owns descriptors and a thread
+    IIOCapture(const IIOCapture&) = delete;
+    IIOCapture& operator=(const IIOCapture&) = delete;
+};
+}
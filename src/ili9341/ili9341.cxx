@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 
 #include "ili9341.hpp"
 
@@ -102,6 +103,13 @@ void ILI9341::setRotation(uint8_t r) {
         _height = ILI9341_TFTWIDTH;
         break;
     }
+
+    // The framebuffer is laid out in screen coordinates, so after a
+    // rotation its contents map to different panel pixels
+    if (!m_fb.empty()) {
+        m_dirty.clear();
+        markDirty(0, 0, _width - 1, _height - 1);
+    }
 }
 
 void ILI9341::configModule() {
@@ -248,6 +256,12 @@ void ILI9341::drawPixel(int16_t x, int16_t y, uint16_t color) {
     if((x < 0) ||(x >= _width) || (y < 0) || (y >= _height)) {
         return;
     }
+
+    if (!m_fb.empty()) {
+        m_fb[y * _width + x] = color;
+        markDirty(x, y, x, y);
+        return;
+    }
     
     setAddrWindow(x, y, x + 1, y + 1);
     
@@ -257,6 +271,11 @@ void ILI9341::drawPixel(int16_t x, int16_t y, uint16_t color) {
 
 void ILI9341::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
 
+    if (!m_fb.empty()) {
+        fbFillRect(x, y, 1, h, color);
+        return;
+    }
+
     // Rudimentary clipping
     if((x >= _width) || (y >= _height)) {
         return;
@@ -284,6 +303,11 @@ void ILI9341::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
 
 void ILI9341::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
 
+    if (!m_fb.empty()) {
+        fbFillRect(x, y, w, 1, color);
+        return;
+    }
+
     // Rudimentary clipping
     if((x >= _width) || (y >= _height)) {
         return;
@@ -314,6 +338,11 @@ void ILI9341::fillRect(int16_t x,
                        int16_t w, 
                        int16_t h,
                        uint16_t color) {
+
+    if (!m_fb.empty()) {
+        fbFillRect(x, y, w, h, color);
+        return;
+    }
                        
     // rudimentary clipping (drawChar w/big text requires this)
     if((x >= _width) || (y >= _height)) return;
@@ -342,6 +371,141 @@ void ILI9341::fillScreen(uint16_t color) {
     fillRect(0, 0,  _width, _height, color);
 }
 
+void ILI9341::enableFramebuffer(bool enable) {
+    m_dirty.clear();
+
+    if (!enable) {
+        std::vector<uint16_t>().swap(m_fb);
+        return;
+    }
+
+    // The panel contents are unknown, so the first flush sends everything
+    m_fb.assign(ILI9341_TFTWIDTH * ILI9341_TFTHEIGHT, ILI9341_BLACK);
+    markDirty(0, 0, _width - 1, _height - 1);
+}
+
+void ILI9341::flush() {
+    uint8_t buf[ILI9341_FLUSH_CHUNK];
+    mraa::Result error = mraa::SUCCESS;
+
+    if (m_fb.empty()) {
+        return;
+    }
+
+    for (size_t i = 0; i < m_dirty.size(); i++) {
+        const DirtyRect &r = m_dirty[i];
+        int len = 0;
+
+        setAddrWindow(r.x0, r.y0, r.x1, r.y1);
+
+        lcdCSOn();
+        dcHigh();
+
+        for (int y = r.y0; y <= r.y1; y++) {
+            const uint16_t *row = &m_fb[y * _width];
+
+            for (int x = r.x0; x <= r.x1; x++) {
+                buf[len++] = row[x] >> 8;
+                buf[len++] = row[x];
+
+                if (len == ILI9341_FLUSH_CHUNK) {
+                    error = m_spi.transfer(buf, NULL, len);
+                    if (error != mraa::SUCCESS) {
+                        mraa::printError(error);
+                    }
+                    len = 0;
+                }
+            }
+        }
+
+        if (len) {
+            error = m_spi.transfer(buf, NULL, len);
+            if (error != mraa::SUCCESS) {
+                mraa::printError(error);
+            }
+        }
+
+        lcdCSOff();
+    }
+
+    m_dirty.clear();
+}
+
+void ILI9341::fbFillRect(int16_t x,
+                         int16_t y,
+                         int16_t w,
+                         int16_t h,
+                         uint16_t color) {
+
+    // full clipping, the framebuffer must never be written out of bounds
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + w - 1;
+    int y1 = y + h - 1;
+
+    if (x1 >= _width) x1 = _width - 1;
+    if (y1 >= _height) y1 = _height - 1;
+    if (w <= 0 || h <= 0 || x0 > x1 || y0 > y1) return;
+
+    for (int row = y0; row <= y1; row++) {
+        std::fill(m_fb.begin() + row * _width + x0,
+                  m_fb.begin() + row * _width + x1 + 1, color);
+    }
+
+    markDirty(x0, y0, x1, y1);
+}
+
+void ILI9341::markDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    DirtyRect r = { x0, y0, x1, y1 };
+
+    // Absorb every tracked rectangle that overlaps or touches the new
+    // one. Once the list is full, merge with whichever rectangle grows
+    // the least instead, trading a few redundant pixels for fewer
+    // address window setups.
+    for (;;) {
+        size_t best = m_dirty.size();
+        long bestGrowth = 0;
+
+        for (size_t i = 0; i < m_dirty.size(); i++) {
+            const DirtyRect &d = m_dirty[i];
+
+            if (d.x0 <= r.x1 + 1 && r.x0 <= d.x1 + 1 &&
+                d.y0 <= r.y1 + 1 && r.y0 <= d.y1 + 1) {
+                best = i;
+                break;
+            }
+        }
+
+        if (best == m_dirty.size() && m_dirty.size() >= ILI9341_MAX_DIRTY) {
+            for (size_t i = 0; i < m_dirty.size(); i++) {
+                const DirtyRect &d = m_dirty[i];
+                long uw = std::max(d.x1, r.x1) - std::min(d.x0, r.x0) + 1;
+                long uh = std::max(d.y1, r.y1) - std::min(d.y0, r.y0) + 1;
+                long growth = uw * uh
+                    - (long)(d.x1 - d.x0 + 1) * (d.y1 - d.y0 + 1);
+
+                if (best == m_dirty.size() || growth < bestGrowth) {
+                    best = i;
+                    bestGrowth = growth;
+                }
+            }
+        }
+
+        if (best == m_dirty.size()) {
+            break;
+        }
+
+        const DirtyRect &d = m_dirty[best];
+        r.x0 = std::min(r.x0, d.x0);
+        r.y0 = std::min(r.y0, d.y0);
+        r.x1 = std::max(r.x1, d.x1);
+        r.y1 = std::max(r.y1, d.y1);
+        m_dirty.erase(m_dirty.begin() + best);
+    }
+
+    m_dirty.push_back(r);
+}
+
 void ILI9341::invertDisplay(bool i) {
     writecommand(i ? ILI9341_INVON : ILI9341_INVOFF);
 }
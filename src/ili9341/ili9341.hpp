@@ -29,6 +29,7 @@
 
 // Includes
 #include <string>
+#include <vector>
 #include <mraa/common.hpp>
 #include <mraa/gpio.hpp>
 #include <mraa/spi.hpp>
@@ -40,6 +41,11 @@
 
 #define SPI_FREQ            15000000
 
+// Framebuffer mode: maximum number of separate dirty rectangles tracked
+// before they are coalesced, and the SPI transfer size used by flush()
+#define ILI9341_MAX_DIRTY   8
+#define ILI9341_FLUSH_CHUNK 4096
+
 #define ILI9341_NOP         0x00
 #define ILI9341_SWRESET     0x01
 #define ILI9341_RDDID       0x04
@@ -289,6 +295,36 @@ namespace upm {
              */
             void writedata(uint8_t d);
 
+            /**
+             * Enables or disables the off-screen framebuffer. While
+             * enabled, all drawing goes to an RGB565 buffer in memory and
+             * nothing is sent to the display until flush() is called.
+             * Enabling the framebuffer clears it to black and marks the
+             * whole screen dirty. Disabling it discards any unflushed
+             * changes and frees the buffer.
+             *
+             * @param enable True to draw into memory, false to draw
+             * directly to the display
+             */
+            void enableFramebuffer(bool enable);
+
+            /**
+             * Returns whether the off-screen framebuffer is enabled.
+             *
+             * @return True if drawing goes to the framebuffer
+             */
+            bool framebufferEnabled() {
+                return !m_fb.empty();
+            }
+
+            /**
+             * Sends the regions of the framebuffer modified since the
+             * last flush to the display, one address window and one bulk
+             * SPI transfer per dirty rectangle. Does nothing if the
+             * framebuffer is not enabled.
+             */
+            void flush();
+
             /**
              * Set LCD chip select to LOW
              */
@@ -330,6 +366,14 @@ namespace upm {
             mraa::Result rstLow();
 
         private:
+            struct DirtyRect {
+                int16_t x0, y0, x1, y1;
+            };
+
+            void markDirty(int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+            void fbFillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                            uint16_t color);
+
             mraa::Gpio  m_csLCDPinCtx;
             mraa::Gpio  m_csSDPinCtx;
             mraa::Gpio  m_dcPinCtx;
@@ -338,6 +382,10 @@ namespace upm {
             mraa::Spi   m_spi;
 
             std::string m_name;
+
+            // framebuffer mode, indexed [y * _width + x]
+            std::vector<uint16_t>  m_fb;
+            std::vector<DirtyRect> m_dirty;
     };
 }
 
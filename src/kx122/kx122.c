@@ -22,6 +22,8 @@
 * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
+#include <string.h>
+
 #include "kx122.h"
 
 //Used to set the bit required for SPI reading
@@ -67,6 +69,25 @@
 #define MAX_BUFFER_SAMPLES_LOW_RES 681
 #define MAX_BUFFER_SAMPLES_HIGH_RES 340
 
+//Maximum amount of bytes in the buffer (BUF_STATUS is 11 bits wide)
+#define MAX_BUFFER_BYTES 2048
+
+//Amount of samples unpacked at a time when reading the buffer into float arrays
+#define UNPACK_CHUNK_SAMPLES 64
+
+//Byte offsets of the axis LSB and MSB within one high resolution buffer sample.
+//In FILO mode the sample bytes are read out in reverse order.
+static const uint8_t high_res_offsets[2][3][2] = {
+  {{0,1},{2,3},{4,5}},
+  {{5,4},{3,2},{1,0}}
+};
+
+//Byte offsets of the axes within one low resolution buffer sample
+static const uint8_t low_res_offsets[2][3] = {
+  {0,1,2},
+  {2,1,0}
+};
+
 //Earth gravity constant (m/s^2)
 #define GRAVITY 9.81f
 /**
@@ -161,6 +182,42 @@ Sets acceleration scale of sensor and the buffer.
 */
 static void kx122_map_grange(const kx122_context dev, KX122_RANGE_T grange);
 
+/**
+Gets the amount of bytes in the buffer, reading both status registers in one transaction.
+
+@param dev The device context.
+@param bytes Pointer to an uint variable to store the value.
+@return UPM result.
+*/
+static upm_result_t kx122_get_buffer_bytes(const kx122_context dev, uint *bytes);
+
+/**
+Reads bytes from the buffer in a single transaction into a preallocated transfer buffer.
+
+@param dev The device context.
+@param xfer Transfer buffer of MAX_BUFFER_BYTES + 1 bytes.
+@param len Amount of bytes to read.
+@return Pointer to the data, or NULL if an error occurs.
+*/
+static uint8_t *kx122_read_buffer_bytes(const kx122_context dev, uint8_t *xfer, uint len);
+
+/**
+Unpacks raw buffer bytes into samples, according to the buffer resolution and mode.
+
+@param dev The device context.
+@param data Pointer to the raw buffer bytes.
+@param len Amount of samples to unpack.
+@param samples Pointer to a kx122_sample array to store the samples.
+*/
+static void kx122_unpack_samples(const kx122_context dev, const uint8_t *data, uint len, kx122_sample *samples);
+
+/**
+Interrupt handler used for streaming, drains the buffer into the stream ring.
+
+@param arg The device context.
+*/
+static void kx122_stream_isr(void *arg);
+
 kx122_context kx122_init(int bus, int addr, int chip_select_pin)
 {
   kx122_context dev = (kx122_context)malloc(sizeof(struct _kx122_context));
@@ -178,6 +235,27 @@ kx122_context kx122_init(int bus, int addr, int chip_select_pin)
   dev->gpio1 = NULL;
   dev->gpio2 = NULL;
 
+  dev->stream_ring = NULL;
+  dev->stream_ring_len = 0;
+  dev->stream_head = 0;
+  dev->stream_tail = 0;
+  dev->stream_dropped = 0;
+  dev->stream_overruns = 0;
+  dev->stream_intp = INT1;
+  dev->stream_cb = NULL;
+  dev->stream_cb_arg = NULL;
+  dev->streaming = false;
+
+  dev->xfer_buffer = NULL;
+  dev->stream_xfer_buffer = NULL;
+
+  if (!(dev->xfer_buffer = (uint8_t *)malloc(MAX_BUFFER_BYTES + 1)) ||
+      !(dev->stream_xfer_buffer = (uint8_t *)malloc(MAX_BUFFER_BYTES + 1))){
+    printf("%s: malloc() failed.\n", __FUNCTION__);
+    kx122_close(dev);
+    return NULL;
+  }
+
   if(mraa_init() != MRAA_SUCCESS){
     printf("%s: mraa_init() failed.\n", __FUNCTION__);
     kx122_close(dev);
@@ -255,6 +333,8 @@ void kx122_close(kx122_context dev)
   if(dev->chip_select){
     mraa_gpio_close(dev->chip_select);
   }
+  free(dev->xfer_buffer);
+  free(dev->stream_xfer_buffer);
   free(dev);
 }
 
@@ -332,16 +412,10 @@ static upm_result_t kx122_read_registers(const kx122_context dev, uint8_t reg, u
     return UPM_SUCCESS;
   }
   else{
-      uint8_t data_buffer[len];
-      if(mraa_i2c_read_bytes_data(dev->i2c,reg,data_buffer,len) != (int)len){
+      if(mraa_i2c_read_bytes_data(dev->i2c,reg,buffer,len) != (int)len){
         return UPM_ERROR_OPERATION_FAILED;
       }
-      else{
-        for(size_t i = 0; i < len; i++){
-          buffer[i] = data_buffer[i];
-        }
-        return UPM_SUCCESS;
-      }
+      return UPM_SUCCESS;
   }
 }
 
@@ -962,101 +1036,129 @@ upm_result_t kx122_clear_buffer(const kx122_context dev)
   return kx122_write_register(dev,KX122_BUF_CLEAR,0xFF); //Writing anything to the register clears the buffer
 }
 
-upm_result_t kx122_get_buffer_status(const kx122_context dev, uint *samples)
+static upm_result_t kx122_get_buffer_bytes(const kx122_context dev, uint *bytes)
 {
-  uint8_t reg_val;
-  uint16_t temp; //Using only 10 bits
+  uint8_t status[2];
 
-  if(kx122_read_register(dev,KX122_BUF_STATUS_2,&reg_val) != UPM_SUCCESS){
+  if(kx122_read_registers(dev,KX122_BUF_STATUS_1,status,2) != UPM_SUCCESS){
     return UPM_ERROR_OPERATION_FAILED;
   }
 
-  temp = (reg_val & 0x0007) << 8; //Get 3 MSb from BUF_STATUS 2
+  //3 MSb from BUF_STATUS_2, rest of the bits from BUF_STATUS_1
+  *bytes = ((uint)(status[1] & 0x07) << 8) | status[0];
+  return UPM_SUCCESS;
+}
+
+upm_result_t kx122_get_buffer_status(const kx122_context dev, uint *samples)
+{
+  uint bytes;
 
-  if(kx122_read_register(dev,KX122_BUF_STATUS_1, &reg_val) != UPM_SUCCESS){
+  if(kx122_get_buffer_bytes(dev,&bytes) != UPM_SUCCESS){
     return UPM_ERROR_OPERATION_FAILED;
   }
 
-  temp = (temp + (reg_val & 0x00FF)); //Get rest of the bits from BUF_STATUS 1
-
   //Get the amount of samples
   if(dev->buffer_res == LOW_RES){
     //3 axis / sample
-    *samples = ((uint)(int16_t)temp) / 3;
+    *samples = bytes / LOW_RES_SAMPLE_MODIFIER;
   }
   else{
     //3 axis * MSB/LSB / sample
-    *samples = ((uint)(int16_t)temp) / 6;
+    *samples = bytes / HIGH_RES_SAMPLE_MODIFIER;
   }
 
   return UPM_SUCCESS;
 }
 
-upm_result_t kx122_read_buffer_samples_raw(const kx122_context dev, uint len, float *x_array, float *y_array, float *z_array)
+static uint8_t *kx122_read_buffer_bytes(const kx122_context dev, uint8_t *xfer, uint len)
 {
-  assert(dev != NULL);
-  if(dev->buffer_res == LOW_RES){
-    len *= LOW_RES_SAMPLE_MODIFIER; //3 axis / sample
-  }
-  else{
-    len *= HIGH_RES_SAMPLE_MODIFIER; //3 axis * 2 bytes / sample
+  //Data is placed after the SPI command byte in both modes
+  uint8_t *data = xfer + 1;
+
+  if(len > MAX_BUFFER_BYTES){
+    printf("%s: %u bytes requested, buffer holds at most %d.\n", __FUNCTION__, len, MAX_BUFFER_BYTES);
+    return NULL;
   }
 
-  uint8_t buffer[len];
+  if(dev->using_spi){
+    xfer[0] = KX122_BUF_READ | SPI_READ;
 
-  if(kx122_read_registers(dev,KX122_BUF_READ,buffer,len) != UPM_SUCCESS){
-    return UPM_ERROR_OPERATION_FAILED;
+    kx122_chip_select_on(dev);
+
+    if(mraa_spi_transfer_buf(dev->spi,xfer,xfer,len + 1) != MRAA_SUCCESS){
+      printf("%s: mraa_spi_transfer_buf() failed.\n", __FUNCTION__);
+
+      kx122_chip_select_off(dev);
+      return NULL;
+    }
+
+    kx122_chip_select_off(dev);
+  }
+  else if(mraa_i2c_read_bytes_data(dev->i2c,KX122_BUF_READ,data,len) != (int)len){
+    printf("%s: mraa_i2c_read_bytes_data() failed.\n", __FUNCTION__);
+    return NULL;
   }
 
+  return data;
+}
+
+static void kx122_unpack_samples(const kx122_context dev, const uint8_t *data, uint len, kx122_sample *samples)
+{
+  const int filo = (dev->buffer_mode == KX122_FILO_MODE) ? 1 : 0;
+
   if(dev->buffer_res == HIGH_RES){
-    for (size_t i = 0; i < len; i+= HIGH_RES_SAMPLE_MODIFIER) {
-      if(dev->buffer_mode != KX122_FILO_MODE){
-        if(x_array){
-          x_array[i / HIGH_RES_SAMPLE_MODIFIER] = (float)((int16_t) (buffer[i + 1] << 8) | buffer[i]);
-        }
-        if(y_array){
-          y_array[i / HIGH_RES_SAMPLE_MODIFIER] = (float)((int16_t) (buffer[i + 3] << 8) | buffer[i + 2]);
-        }
-        if(z_array){
-          z_array[i / HIGH_RES_SAMPLE_MODIFIER] = (float)((int16_t) (buffer[i + 5] << 8) | buffer[i + 4]);
-        }
-      }
-      else{
-        if(x_array){
-          x_array[i / HIGH_RES_SAMPLE_MODIFIER] = (float)((int16_t) (buffer[i + 4] << 8) | buffer[i + 5]);
-        }
-        if(y_array){
-          y_array[i / HIGH_RES_SAMPLE_MODIFIER] = (float)((int16_t) (buffer[i + 2] << 8) | buffer[i + 3]);
-        }
-        if(z_array){
-          z_array[i / HIGH_RES_SAMPLE_MODIFIER] = (float)((int16_t) (buffer[i] << 8) | buffer[i + 1]);
-        }
-      }
+    const uint8_t (*offs)[2] = high_res_offsets[filo];
+
+    for (uint i = 0; i < len; i++, data += HIGH_RES_SAMPLE_MODIFIER) {
+      samples[i].x = (int16_t)((data[offs[0][1]] << 8) | data[offs[0][0]]);
+      samples[i].y = (int16_t)((data[offs[1][1]] << 8) | data[offs[1][0]]);
+      samples[i].z = (int16_t)((data[offs[2][1]] << 8) | data[offs[2][0]]);
     }
   }
   else{ //Low resolution
-    for (size_t i = 0; i < len; i+= LOW_RES_SAMPLE_MODIFIER) {
-      if(dev->buffer_mode != KX122_FILO_MODE){
-        if(x_array){
-          x_array[i / LOW_RES_SAMPLE_MODIFIER] = (float)(int8_t)buffer[i];
-        }
-        if(y_array){
-          y_array[i / LOW_RES_SAMPLE_MODIFIER] = (float)(int8_t)buffer[i + 1];
-        }
-        if(z_array){
-          z_array[i / LOW_RES_SAMPLE_MODIFIER] = (float)(int8_t)buffer[i + 2];
-        }
+    const uint8_t *offs = low_res_offsets[filo];
+
+    for (uint i = 0; i < len; i++, data += LOW_RES_SAMPLE_MODIFIER) {
+      samples[i].x = (int8_t)data[offs[0]];
+      samples[i].y = (int8_t)data[offs[1]];
+      samples[i].z = (int8_t)data[offs[2]];
+    }
+  }
+}
+
+upm_result_t kx122_read_buffer_samples_raw(const kx122_context dev, uint len, float *x_array, float *y_array, float *z_array)
+{
+  assert(dev != NULL);
+  uint sample_size = (dev->buffer_res == LOW_RES) ? LOW_RES_SAMPLE_MODIFIER : HIGH_RES_SAMPLE_MODIFIER;
+
+  const uint8_t *data = kx122_read_buffer_bytes(dev,dev->xfer_buffer,len * sample_size);
+  if(!data){
+    return UPM_ERROR_OPERATION_FAILED;
+  }
+
+  kx122_sample chunk[UNPACK_CHUNK_SAMPLES];
+
+  for (uint done = 0; done < len; done += UNPACK_CHUNK_SAMPLES) {
+    uint count = len - done;
+    if(count > UNPACK_CHUNK_SAMPLES){
+      count = UNPACK_CHUNK_SAMPLES;
+    }
+
+    kx122_unpack_samples(dev,data + (done * sample_size),count,chunk);
+
+    if(x_array){
+      for (uint i = 0; i < count; i++) {
+        x_array[done + i] = chunk[i].x;
       }
-      else{
-        if(x_array){
-          x_array[i / LOW_RES_SAMPLE_MODIFIER] = (float)(int8_t)buffer[i + 2];
-        }
-        if(y_array){
-          y_array[i / LOW_RES_SAMPLE_MODIFIER] = (float)(int8_t)buffer[i + 1];
-        }
-        if(z_array){
-          z_array[i / LOW_RES_SAMPLE_MODIFIER] = (float)(int8_t)buffer[i];
-        }
+    }
+    if(y_array){
+      for (uint i = 0; i < count; i++) {
+        y_array[done + i] = chunk[i].y;
+      }
+    }
+    if(z_array){
+      for (uint i = 0; i < count; i++) {
+        z_array[done + i] = chunk[i].z;
       }
     }
   }
@@ -1071,17 +1173,275 @@ upm_result_t kx122_read_buffer_samples(const kx122_context dev, uint len, float
     return UPM_ERROR_OPERATION_FAILED;
   }
 
-  for (size_t i = 0; i < len; i++) {
-    if(x_array){
-      x_array[i] = (x_array[i] * dev->buffer_accel_scale) * GRAVITY;
+  const float scale = dev->buffer_accel_scale * GRAVITY;
+  float *arrays[3] = {x_array, y_array, z_array};
+
+  for (size_t axis = 0; axis < 3; axis++) {
+    float *array = arrays[axis];
+    if(!array){
+      continue;
     }
-    if(y_array){
-      y_array[i] = (y_array[i] * dev->buffer_accel_scale) * GRAVITY;
+    for (uint i = 0; i < len; i++) {
+      array[i] *= scale;
     }
-    if(z_array){
-      z_array[i] = (z_array[i] * dev->buffer_accel_scale) * GRAVITY;
+  }
+
+  return UPM_SUCCESS;
+}
+
+//The stream ring counters run modulo twice the ring length, so that a full
+//ring can be told apart from an empty one without wasting a slot.
+static uint kx122_stream_used(const kx122_context dev, uint head, uint tail)
+{
+  return (head + 2 * dev->stream_ring_len - tail) % (2 * dev->stream_ring_len);
+}
+
+upm_result_t kx122_stream_drain(const kx122_context dev, uint *samples)
+{
+  assert(dev != NULL);
+  if(samples){
+    *samples = 0;
+  }
+
+  if(!dev->stream_ring){
+    return UPM_ERROR_NO_RESOURCES;
+  }
+
+  uint sample_size, max_samples, bytes;
+
+  if(dev->buffer_res == LOW_RES){
+    sample_size = LOW_RES_SAMPLE_MODIFIER;
+    max_samples = MAX_BUFFER_SAMPLES_LOW_RES;
+  }
+  else{
+    sample_size = HIGH_RES_SAMPLE_MODIFIER;
+    max_samples = MAX_BUFFER_SAMPLES_HIGH_RES;
+  }
+
+  if(kx122_get_buffer_bytes(dev,&bytes) != UPM_SUCCESS){
+    return UPM_ERROR_OPERATION_FAILED;
+  }
+
+  uint count = bytes / sample_size;
+  if(count == 0){
+    return UPM_SUCCESS;
+  }
+  if(count >= max_samples){
+    __atomic_add_fetch(&dev->stream_overruns,1,__ATOMIC_RELAXED);
+  }
+
+  //Read everything, even if it does not fit in the ring, so the sensor buffer is emptied
+  const uint8_t *data = kx122_read_buffer_bytes(dev,dev->stream_xfer_buffer,count * sample_size);
+  if(!data){
+    return UPM_ERROR_OPERATION_FAILED;
+  }
+
+  uint ring_len = dev->stream_ring_len;
+  uint head = dev->stream_head;
+  uint tail = __atomic_load_n(&dev->stream_tail,__ATOMIC_ACQUIRE);
+  uint space = ring_len - kx122_stream_used(dev,head,tail);
+
+  if(count > space){
+    __atomic_add_fetch(&dev->stream_dropped,count - space,__ATOMIC_RELAXED);
+    count = space;
+  }
+
+  uint index = head % ring_len;
+  uint first = ring_len - index;
+  if(first > count){
+    first = count;
+  }
+
+  kx122_unpack_samples(dev,data,first,&dev->stream_ring[index]);
+  kx122_unpack_samples(dev,data + (first * sample_size),count - first,dev->stream_ring);
+
+  __atomic_store_n(&dev->stream_head,(head + count) % (2 * ring_len),__ATOMIC_RELEASE);
+
+  if(samples){
+    *samples = count;
+  }
+  return UPM_SUCCESS;
+}
+
+static void kx122_stream_isr(void *arg)
+{
+  kx122_context dev = (kx122_context)arg;
+
+  if(kx122_stream_drain(dev,NULL) != UPM_SUCCESS){
+    return;
+  }
+  if(dev->stream_cb){
+    dev->stream_cb(kx122_stream_available(dev),dev->stream_cb_arg);
+  }
+}
+
+upm_result_t kx122_stream_start(const kx122_context dev, kx122_sample *ring, uint ring_len, uint watermark,
+KX122_INTERRUPT_PIN_T intp, int pin, kx122_stream_callback cb, void *arg)
+{
+  assert(dev != NULL);
+  if(!ring || ring_len == 0){
+    return UPM_ERROR_INVALID_PARAMETER;
+  }
+
+  if(dev->streaming){
+    kx122_stream_stop(dev);
+  }
+
+  dev->stream_ring = ring;
+  dev->stream_ring_len = ring_len;
+  dev->stream_head = 0;
+  dev->stream_tail = 0;
+  dev->stream_dropped = 0;
+  dev->stream_overruns = 0;
+  dev->stream_intp = intp;
+  dev->stream_cb = cb;
+  dev->stream_cb_arg = arg;
+
+  kx122_set_sensor_standby(dev);
+
+  if(kx122_set_buffer_threshold(dev,watermark) != UPM_SUCCESS){
+    return UPM_ERROR_OPERATION_FAILED;
+  }
+
+  upm_result_t result;
+  if(intp == INT1){
+    result = kx122_route_interrupt1(dev,KX122_WATERMARK_INT);
+    if(result == UPM_SUCCESS){
+      result = kx122_enable_interrupt1(dev,ACTIVE_HIGH);
     }
   }
+  else{
+    result = kx122_route_interrupt2(dev,KX122_WATERMARK_INT);
+    if(result == UPM_SUCCESS){
+      result = kx122_enable_interrupt2(dev,ACTIVE_HIGH);
+    }
+  }
+  if(result != UPM_SUCCESS){
+    return UPM_ERROR_OPERATION_FAILED;
+  }
+
+  if(kx122_enable_buffer(dev) != UPM_SUCCESS || kx122_clear_buffer(dev) != UPM_SUCCESS){
+    return UPM_ERROR_OPERATION_FAILED;
+  }
+
+  kx122_uninstall_isr(dev,intp);
+  if(kx122_install_isr(dev,MRAA_GPIO_EDGE_RISING,intp,pin,kx122_stream_isr,dev) != UPM_SUCCESS){
+    return UPM_ERROR_OPERATION_FAILED;
+  }
+
+  dev->streaming = true;
+  kx122_set_sensor_active(dev);
 
   return UPM_SUCCESS;
 }
+
+void kx122_stream_stop(const kx122_context dev)
+{
+  assert(dev != NULL);
+  if(!dev->streaming){
+    return;
+  }
+
+  kx122_uninstall_isr(dev,dev->stream_intp);
+
+  kx122_set_sensor_standby(dev);
+  if(dev->stream_intp == INT1){
+    kx122_disable_interrupt1(dev);
+  }
+  else{
+    kx122_disable_interrupt2(dev);
+  }
+  kx122_set_sensor_active(dev);
+
+  dev->streaming = false;
+}
+
+uint kx122_stream_available(const kx122_context dev)
+{
+  assert(dev != NULL);
+  if(!dev->stream_ring){
+    return 0;
+  }
+
+  uint head = __atomic_load_n(&dev->stream_head,__ATOMIC_ACQUIRE);
+  return kx122_stream_used(dev,head,dev->stream_tail);
+}
+
+uint kx122_stream_peek(const kx122_context dev, const kx122_sample **samples)
+{
+  assert(dev != NULL);
+  uint available = kx122_stream_available(dev);
+  if(available == 0){
+    *samples = NULL;
+    return 0;
+  }
+
+  uint index = dev->stream_tail % dev->stream_ring_len;
+  uint contiguous = dev->stream_ring_len - index;
+
+  *samples = &dev->stream_ring[index];
+  return (available < contiguous) ? available : contiguous;
+}
+
+void kx122_stream_consume(const kx122_context dev, uint len)
+{
+  assert(dev != NULL);
+  uint available = kx122_stream_available(dev);
+  if(len > available){
+    len = available;
+  }
+  if(len == 0){
+    return;
+  }
+
+  __atomic_store_n(&dev->stream_tail,(dev->stream_tail + len) % (2 * dev->stream_ring_len),__ATOMIC_RELEASE);
+}
+
+uint kx122_stream_read(const kx122_context dev, kx122_sample *samples, uint len)
+{
+  assert(dev != NULL);
+  uint total = 0;
+
+  //At most two passes, one for each side of the ring wrap-around
+  for (int pass = 0; pass < 2 && total < len; pass++) {
+    const kx122_sample *src;
+    uint count = kx122_stream_peek(dev,&src);
+    if(count > len - total){
+      count = len - total;
+    }
+    if(count == 0){
+      break;
+    }
+
+    memcpy(&samples[total],src,count * sizeof(kx122_sample));
+    kx122_stream_consume(dev,count);
+    total += count;
+  }
+
+  return total;
+}
+
+void kx122_stream_get_stats(const kx122_context dev, uint *dropped, uint *overruns)
+{
+  assert(dev != NULL);
+  if(dropped){
+    *dropped = __atomic_load_n(&dev->stream_dropped,__ATOMIC_RELAXED);
+  }
+  if(overruns){
+    *overruns = __atomic_load_n(&dev->stream_overruns,__ATOMIC_RELAXED);
+  }
+}
+
+void kx122_convert_samples(const kx122_context dev, const kx122_sample *samples, uint len, float *xyz)
+{
+  assert(dev != NULL);
+  const float scale = dev->buffer_accel_scale * GRAVITY;
+
+  //Samples are packed int16 triplets, so the block is converted as one flat array
+  const int16_t *raw = (const int16_t *)samples;
+  const size_t count = (size_t)len * 3;
+
+  for (size_t i = 0; i < count; i++) {
+    xyz[i] = raw[i] * scale;
+  }
+}
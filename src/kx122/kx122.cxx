@@ -331,3 +331,55 @@ void KX122::clearBuffer()
     throw std::runtime_error(std::string(__FUNCTION__) + "kx122_clear_buffer failed");
   }
 }
+
+void KX122::streamStart(uint ringLen, uint watermark, KX122_INTERRUPT_PIN_T intp, int pin)
+{
+  kx122_stream_stop(m_kx122);
+  m_streamRing.resize(ringLen);
+
+  if(kx122_stream_start(m_kx122,m_streamRing.data(),ringLen,watermark,intp,pin,NULL,NULL)){
+    throw std::runtime_error(std::string(__FUNCTION__) + "kx122_stream_start failed");
+  }
+}
+
+void KX122::streamStop()
+{
+  kx122_stream_stop(m_kx122);
+}
+
+std::vector<float> KX122::getStreamSamples(uint maxSamples)
+{
+  std::vector<float> values;
+  uint available = kx122_stream_available(m_kx122);
+  if(available < maxSamples){
+    maxSamples = available;
+  }
+
+  values.resize(maxSamples * 3);
+
+  const kx122_sample *samples;
+  uint done = 0;
+  while(done < maxSamples){
+    uint count = kx122_stream_peek(m_kx122,&samples);
+    if(count == 0){
+      break;
+    }
+    if(count > maxSamples - done){
+      count = maxSamples - done;
+    }
+
+    kx122_convert_samples(m_kx122,samples,count,&values[done * 3]);
+    kx122_stream_consume(m_kx122,count);
+    done += count;
+  }
+
+  values.resize(done * 3);
+  return values;
+}
+
+uint KX122::getStreamDropped()
+{
+  uint dropped;
+  kx122_stream_get_stats(m_kx122,&dropped,NULL);
+  return dropped;
+}
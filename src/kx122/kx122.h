@@ -133,6 +133,16 @@ typedef enum{
   ACTIVE_HIGH
 } KX122_INTERRUPT_POLARITY_T;
 
+//Raw buffer sample, packed as stored in the stream ring
+typedef struct _kx122_sample {
+  int16_t x;
+  int16_t y;
+  int16_t z;
+} kx122_sample;
+
+//Called after each stream drain with the amount of samples waiting in the ring
+typedef void (*kx122_stream_callback)(uint available, void *arg);
+
 //Device context
 typedef struct _kx122_context {
   mraa_i2c_context i2c;
@@ -151,6 +161,20 @@ typedef struct _kx122_context {
 
   bool using_spi;
 
+  uint8_t *xfer_buffer; //Preallocated bulk transfer buffer (command byte + buffer contents)
+  uint8_t *stream_xfer_buffer; //Same, used only by the stream drain so it does not clobber user reads
+
+  kx122_sample *stream_ring; //Caller provided sample ring
+  uint stream_ring_len; //Size of the sample ring
+  uint stream_head; //Write counter, advanced by the drain
+  uint stream_tail; //Read counter, advanced by the consumer
+  uint stream_dropped; //Samples lost because the ring was full
+  uint stream_overruns; //Drains that found the sensor buffer full
+  KX122_INTERRUPT_PIN_T stream_intp; //Interrupt pin used for streaming
+  kx122_stream_callback stream_cb;
+  void *stream_cb_arg;
+  bool streaming;
+
 } *kx122_context;
 
 //Struct for ODR values and their decimal counterparts.
@@ -666,6 +690,109 @@ Clears the buffer, removing all existing samples from the buffer.
 */
 upm_result_t kx122_clear_buffer(const kx122_context dev);
 
+/**
+Starts streaming the sensor buffer into a caller provided ring of raw samples.
+
+The buffer watermark interrupt is routed to the given interrupt pin, and every
+interrupt drains the whole sensor buffer in a single bus transaction straight into
+the ring. No conversion is done while draining, use kx122_convert_samples() on the
+samples taken out of the ring.
+
+The buffer resolution and operating mode set with kx122_buffer_init() are kept.
+If the ring is full, new samples are dropped and counted (see kx122_stream_get_stats()).
+
+Sensor is automatically set into standby mode during the stream setup.
+Sensor is set to active mode after the setup.
+
+@param dev The device context.
+@param ring Pointer to a kx122_sample array used as the ring. Must stay valid until kx122_stream_stop().
+@param ring_len Amount of samples the ring can hold.
+@param watermark Amount of samples in the sensor buffer that triggers a drain.
+@param intp One of the KX122_INTERRUPT_PIN_T values. Sensor interrupt pin to use.
+@param pin The GPIO pin connected to the sensor interrupt pin.
+@param cb Function to be called after each drain. Can be set to NULL if not wanted.
+@param arg The argument to be passed to the callback function.
+@return UPM result.
+*/
+upm_result_t kx122_stream_start(const kx122_context dev, kx122_sample *ring, uint ring_len, uint watermark,
+KX122_INTERRUPT_PIN_T intp, int pin, kx122_stream_callback cb, void *arg);
+
+/**
+Stops streaming, uninstalls the interrupt handler and disables the watermark interrupt.
+Samples still in the ring can be read after stopping.
+
+@param dev The device context.
+*/
+void kx122_stream_stop(const kx122_context dev);
+
+/**
+Moves all samples currently in the sensor buffer to the stream ring.
+This is called from the interrupt handler, but can also be called directly
+to poll the sensor without an interrupt pin.
+
+@param dev The device context.
+@param samples Pointer to an uint variable to store the amount of samples drained. Can be set to NULL if not wanted.
+@return UPM result.
+*/
+upm_result_t kx122_stream_drain(const kx122_context dev, uint *samples);
+
+/**
+Gets the amount of samples waiting in the stream ring.
+
+@param dev The device context.
+@return Amount of samples in the ring.
+*/
+uint kx122_stream_available(const kx122_context dev);
+
+/**
+Gets a pointer to the oldest samples in the stream ring without copying them.
+The returned samples are contiguous; when the ring wraps around, call
+kx122_stream_consume() and peek again to get the rest.
+
+@param dev The device context.
+@param samples Pointer to store the address of the first sample.
+@return Amount of contiguous samples at the returned address.
+*/
+uint kx122_stream_peek(const kx122_context dev, const kx122_sample **samples);
+
+/**
+Releases samples previously returned by kx122_stream_peek() back to the ring.
+
+@param dev The device context.
+@param len Amount of samples to release.
+*/
+void kx122_stream_consume(const kx122_context dev, uint len);
+
+/**
+Copies up to len samples from the stream ring and removes them from the ring.
+
+@param dev The device context.
+@param samples Pointer to a kx122_sample array to store the samples.
+@param len Maximum amount of samples to read.
+@return Amount of samples read.
+*/
+uint kx122_stream_read(const kx122_context dev, kx122_sample *samples, uint len);
+
+/**
+Gets the stream loss counters.
+
+@param dev The device context.
+@param dropped Pointer to an uint variable to store the amount of samples dropped because the ring was full. Can be set to NULL if not wanted.
+@param overruns Pointer to an uint variable to store the amount of drains that found the sensor buffer full,
+meaning the sensor may have lost samples. Can be set to NULL if not wanted.
+*/
+void kx122_stream_get_stats(const kx122_context dev, uint *dropped, uint *overruns);
+
+/**
+Converts a block of raw buffer samples to m/s^2 using the current buffer scaling.
+
+@param dev The device context.
+@param samples Pointer to the raw samples.
+@param len Amount of samples to convert.
+@param xyz Pointer to a floating point array of at least 3 * len values. Values are stored interleaved as x, y, z.
+*/
+void kx122_convert_samples(const kx122_context dev, const kx122_sample *samples, uint len, float *xyz);
+
 #ifdef __cplusplus
 }
 #endif
@@ -507,10 +507,48 @@ namespace upm{
       @throws std::runtime_error on failure.
       */
       void clearBuffer();
+
+      /**
+      Starts streaming the buffer into an internal ring on the buffer watermark interrupt.
+      Each interrupt drains the whole buffer in a single bus transaction.
+
+      Sensor is automatically set into standby mode during the stream setup.
+      Sensor is set to active mode after the setup.
+
+      @param ringLen Amount of samples the internal ring can hold.
+      @param watermark Amount of samples in the buffer that triggers a drain.
+      @param intp One of the KX122_INTERRUPT_PIN_T values. Sensor interrupt pin to use.
+      @param pin The GPIO pin connected to the sensor interrupt pin.
+      @throws std::runtime_error on failure.
+      */
+      void streamStart(uint ringLen, uint watermark, KX122_INTERRUPT_PIN_T intp, int pin);
+
+      /**
+      Stops streaming. Samples still in the ring can be read after stopping.
+      */
+      void streamStop();
+
+      /**
+      Takes up to maxSamples converted (m/s^2) samples out of the stream ring.
+
+      @param maxSamples Maximum amount of samples to take.
+      @return Vector of interleaved x, y, z values.
+      */
+      std::vector<float> getStreamSamples(uint maxSamples);
+
+      /**
+      Gets the amount of samples dropped because the stream ring was full.
+
+      @return Amount of dropped samples.
+      */
+      uint getStreamDropped();
     private:
       //Device context
       kx122_context m_kx122;
 
+      //Ring used for streaming
+      std::vector<kx122_sample> m_streamRing;
+
       /* Disable implicit copy and assignment operators */
       KX122(const KX122&) = delete;
       KX122 &operator=(const KX122&) = delete;
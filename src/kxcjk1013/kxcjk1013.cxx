@@ -42,6 +42,8 @@ KXCJK1013::KXCJK1013(int device)
                                     ": mraa_iio_init() failed, invalid device?");
         return;
     }
+    m_capture = new IIOCapture(device);
+    m_chan[0] = m_chan[1] = m_chan[2] = -1;
     m_scale = 1;
     m_iio_device_num = device;
     sprintf(trigger, "hrtimer-kxcjk1013-hr-dev%d", device);
@@ -60,6 +62,7 @@ KXCJK1013::KXCJK1013(int device)
 
 KXCJK1013::~KXCJK1013()
 {
+    delete m_capture;
     if (m_iio)
         mraa_iio_close(m_iio);
 }
@@ -67,7 +70,7 @@ KXCJK1013::~KXCJK1013()
 void
 KXCJK1013::installISR(void (*isr)(char*, void*), void* arg)
 {
-    mraa_iio_trigger_buffer(m_iio, isr, arg);
+    m_capture->installHandler(isr, arg);
 }
 
 int64_t
@@ -124,21 +127,15 @@ KXCJK1013::getChannelValue(unsigned char* input, mraa_iio_channel* chan)
 }
 
 bool
-KXCJK1013::enableBuffer(int length)
+KXCJK1013::enableBuffer(int length, int watermark)
 {
-    mraa_iio_write_int(m_iio, "buffer/length", length);
-    // enable must be last step, else will have error in writing above config
-    mraa_iio_write_int(m_iio, "buffer/enable", 1);
-
-    return true;
+    return m_capture->enableBuffer(length, watermark);
 }
 
 bool
 KXCJK1013::disableBuffer()
 {
-    mraa_iio_write_int(m_iio, "buffer/enable", 0);
-
-    return true;
+    return m_capture->disableBuffer();
 }
 
 bool
@@ -164,26 +161,31 @@ KXCJK1013::enable3AxisChannel()
     char trigger[64];
     sprintf(trigger, "kxcjk1013-hr-dev%d", m_iio_device_num);
 
-    mraa_iio_write_string(m_iio, "trigger/current_trigger", trigger);
-    mraa_iio_write_int(m_iio, "scan_elements/in_accel_x_en", 1);
-    mraa_iio_write_int(m_iio, "scan_elements/in_accel_y_en", 1);
-    mraa_iio_write_int(m_iio, "scan_elements/in_accel_z_en", 1);
+    m_capture->setTrigger(trigger);
+    m_capture->enableChannel("in_accel_x");
+    m_capture->enableChannel("in_accel_y");
+    m_capture->enableChannel("in_accel_z");
 
     // need update channel data size after enable
-    mraa_iio_update_channels(m_iio);
-    return true;
+    if (!m_capture->updateChannels())
+        return false;
+
+    m_chan[0] = m_capture->getChannelIndex("in_accel_x");
+    m_chan[1] = m_capture->getChannelIndex("in_accel_y");
+    m_chan[2] = m_capture->getChannelIndex("in_accel_z");
+
+    return m_chan[0] >= 0 && m_chan[1] >= 0 && m_chan[2] >= 0;
 }
 
 void
 KXCJK1013::extract3Axis(char* data, float* x, float* y, float* z)
 {
-    mraa_iio_channel* channels = mraa_iio_get_channels(m_iio);
     float tmp[3];
     int iio_x, iio_y, iio_z;
 
-    iio_x = getChannelValue((unsigned char*) (data + channels[0].location), &channels[0]);
-    iio_y = getChannelValue((unsigned char*) (data + channels[1].location), &channels[1]);
-    iio_z = getChannelValue((unsigned char*) (data + channels[2].location), &channels[2]);
+    iio_x = m_capture->getChannelValue(data, m_chan[0]);
+    iio_y = m_capture->getChannelValue(data, m_chan[1]);
+    iio_z = m_capture->getChannelValue(data, m_chan[2]);
 
     // Raw data is acceleration in direction. Units after application of scale are m/s^2
     *x = (iio_x * m_scale);
@@ -200,3 +202,34 @@ KXCJK1013::extract3Axis(char* data, float* x, float* y, float* z)
         *z = tmp[2];
     }
 }
+
+int64_t
+KXCJK1013::getTimestamp(char* data)
+{
+    return m_capture->getTimestamp(data);
+}
+
+int
+KXCJK1013::readSamples(float* xyz, int64_t* timestamps, int count, int timeoutMs)
+{
+    int got = 0;
+    int avail = m_capture->waitScans(timeoutMs);
+
+    if (avail > 0) {
+        for (int i = 0; i < avail && got < count; i++, got++) {
+            char* data = m_capture->getScan(i);
+            extract3Axis(data, &xyz[got * 3], &xyz[got * 3 + 1], &xyz[got * 3 + 2]);
+            if (timestamps)
+                timestamps[got] = m_capture->getTimestamp(data);
+        }
+        m_capture->consumeScans(got);
+    }
+
+    return got;
+}
+
+int
+KXCJK1013::getFd()
+{
+    return m_capture->getFd();
+}
@@ -57,6 +57,8 @@ L3GD20::L3GD20(int device) :
                                     ": mraa_iio_init() failed, invalid device?");
         return;
     }
+    m_capture = new IIOCapture(device);
+    m_chan[0] = m_chan[1] = m_chan[2] = -1;
 
     m_scale = 1;
     m_iio_device_num = device;
@@ -101,6 +103,8 @@ L3GD20::L3GD20(int bus, int addr)
                                ": I2c.address() failed");
     }
 
+  m_iio = 0;
+  m_capture = 0;
   m_scale = 1.0;
   m_iio_device_num = 0;
 
@@ -165,6 +169,7 @@ L3GD20::~L3GD20()
         free(m_filter.buff);
         m_filter.buff = NULL;
     }
+    delete m_capture;
     if (m_iio)
         mraa_iio_close(m_iio);
 }
@@ -346,7 +351,8 @@ uint8_t L3GD20::getStatusBits()
 void
 L3GD20::installISR(void (*isr)(char*, void*), void* arg)
 {
-    mraa_iio_trigger_buffer(m_iio, isr, arg);
+    requireIIO(__FUNCTION__);
+    m_capture->installHandler(isr, arg);
 }
 
 int64_t
@@ -402,19 +408,17 @@ L3GD20::getChannelValue(unsigned char* input, mraa_iio_channel* chan)
 }
 
 bool
-L3GD20::enableBuffer(int length)
+L3GD20::enableBuffer(int length, int watermark)
 {
-    mraa_iio_write_int(m_iio, "buffer/length", length);
-    // enable must be last step, else will have error in writing above config
-    mraa_iio_write_int(m_iio, "buffer/enable", 1);
-    return true;
+    requireIIO(__FUNCTION__);
+    return m_capture->enableBuffer(length, watermark);
 }
 
 bool
 L3GD20::disableBuffer()
 {
-    mraa_iio_write_int(m_iio, "buffer/enable", 0);
-    return true;
+    requireIIO(__FUNCTION__);
+    return m_capture->disableBuffer();
 }
 
 bool
@@ -438,26 +442,35 @@ L3GD20::setSamplingFrequency(float sampling_frequency)
 bool
 L3GD20::enable3AxisChannel()
 {
+    requireIIO(__FUNCTION__);
+
     char trigger[64];
     sprintf(trigger, "l3gd20-hr-dev%d", m_iio_device_num);
 
-    mraa_iio_write_string(m_iio, "trigger/current_trigger", trigger);
-    mraa_iio_write_int(m_iio, "scan_elements/in_anglvel_x_en", 1);
-    mraa_iio_write_int(m_iio, "scan_elements/in_anglvel_y_en", 1);
-    mraa_iio_write_int(m_iio, "scan_elements/in_anglvel_z_en", 1);
+    m_capture->setTrigger(trigger);
+    m_capture->enableChannel("in_anglvel_x");
+    m_capture->enableChannel("in_anglvel_y");
+    m_capture->enableChannel("in_anglvel_z");
 
     // need update channel data size after enable
-    mraa_iio_update_channels(m_iio);
-    return true;
+    if (!m_capture->updateChannels())
+        return false;
+
+    m_chan[0] = m_capture->getChannelIndex("in_anglvel_x");
+    m_chan[1] = m_capture->getChannelIndex("in_anglvel_y");
+    m_chan[2] = m_capture->getChannelIndex("in_anglvel_z");
+
+    return m_chan[0] >= 0 && m_chan[1] >= 0 && m_chan[2] >= 0;
 }
 
 bool
 L3GD20::extract3Axis(char* data, float* x, float* y, float* z)
 {
-    mraa_iio_channel* channels = mraa_iio_get_channels(m_iio);
     float tmp[3];
     int iio_x, iio_y, iio_z;
 
+    requireIIO(__FUNCTION__);
+
     m_event_count++;
 
     if (m_event_count < GYRO_MIN_SAMPLES) {
@@ -465,9 +478,9 @@ L3GD20::extract3Axis(char* data, float* x, float* y, float* z)
         return false;
     }
 
-    iio_x = getChannelValue((unsigned char*) (data + channels[0].location), &channels[0]);
-    iio_y = getChannelValue((unsigned char*) (data + channels[1].location), &channels[1]);
-    iio_z = getChannelValue((unsigned char*) (data + channels[2].location), &channels[2]);
+    iio_x = m_capture->getChannelValue(data, m_chan[0]);
+    iio_y = m_capture->getChannelValue(data, m_chan[1]);
+    iio_z = m_capture->getChannelValue(data, m_chan[2]);
 
     // Raw data is x, y, z axis angular velocity. Units after application of scale are radians per
     // second
@@ -500,6 +513,57 @@ L3GD20::extract3Axis(char* data, float* x, float* y, float* z)
     return true;
 }
 
+int64_t
+L3GD20::getTimestamp(char* data)
+{
+    requireIIO(__FUNCTION__);
+    return m_capture->getTimestamp(data);
+}
+
+int
+L3GD20::readSamples(float* xyz, int64_t* timestamps, int count, int timeoutMs)
+{
+    requireIIO(__FUNCTION__);
+
+    int got = 0;
+    int avail = m_capture->waitScans(timeoutMs);
+
+    // extract3Axis() drops samples while the gyroscope settles, so
+    // we may return fewer samples than we consume
+    if (avail > 0) {
+        if (avail > count)
+            avail = count;
+        for (int i = 0; i < avail; i++) {
+            char* data = m_capture->getScan(i);
+            if (!extract3Axis(data, &xyz[got * 3], &xyz[got * 3 + 1], &xyz[got * 3 + 2]))
+                continue;
+            if (timestamps)
+                timestamps[got] = m_capture->getTimestamp(data);
+            got++;
+        }
+        m_capture->consumeScans(avail);
+    }
+
+    return got;
+}
+
+int
+L3GD20::getFd()
+{
+    requireIIO(__FUNCTION__);
+
+    return m_capture->getFd();
+}
+
+void
+L3GD20::requireIIO(const char* func)
+{
+    if (!m_capture) {
+        throw std::runtime_error(std::string(func) +
+                                 ": only available in IIO mode");
+    }
+}
+
 void
 L3GD20::initCalibrate()
 {
@@ -29,6 +29,8 @@
 
 #include <string>
 #include <mraa/iio.h>
+
+#include "iiocapture.hpp"
 #include <mraa/i2c.hpp>
 
 #define L3GD20_DEFAULT_I2C_BUS                      0
@@ -561,8 +563,10 @@ class L3GD20
      * Enable trigger buffer.  IIO only.
      *
      * @param length buffer length in integer
+     * @param watermark number of samples the kernel buffers before
+     * delivering them, 1 delivers every sample as it arrives
      */
-    bool enableBuffer(int length);
+    bool enableBuffer(int length, int watermark = 1);
 
     /**
      * Disable trigger buffer.   IIO only.
@@ -603,6 +607,37 @@ class L3GD20
      */
     bool extract3Axis(char* data, float* x, float* y, float* z);
 
+    /**
+     * Returns the timestamp of a sample taken by the kernel, when the
+     * device has a timestamp scan element.  IIO only.
+     * @param data Enabled channel data
+     * @return Timestamp in nanoseconds, or 0 if not available
+     */
+    int64_t getTimestamp(char* data);
+
+    /**
+     * Read buffered samples, as an alternative to installISR().
+     * This waits for samples, then returns as many as are available,
+     * up to count, processed as with extract3Axis().  IIO only.  Samples dropped while the
+     * gyroscope settles are not returned.
+     * @param xyz Array of 3 * count floats to store the x, y, and z
+     * axis of each sample
+     * @param timestamps Array of count timestamps in nanoseconds, or
+     * NULL if not needed
+     * @param count Maximum number of samples
+     * @param timeoutMs Time to wait in milliseconds, -1 to wait forever
+     * @return Number of samples read, 0 on timeout
+     */
+    int readSamples(float* xyz, int64_t* timestamps, int count, int timeoutMs = -1);
+
+    /**
+     * Returns a file descriptor that becomes readable when buffered
+     * samples are available, for use with poll(), select() or epoll
+     * along with readSamples().  IIO only.
+     * @return File descriptor
+     */
+    int getFd();
+
     /**
      * Reset calibration data and start collect calibration data again
      */
@@ -699,6 +734,8 @@ class L3GD20
 
   private:
     mraa_iio_context m_iio;
+    IIOCapture* m_capture;
+    int m_chan[3];             // x, y, z positions in a scan
 
     int m_iio_device_num;
     bool m_mount_matrix_exist; // is mount matrix exist
@@ -708,5 +745,8 @@ class L3GD20
     bool m_calibrated;         // calibrate state
     gyro_cal_t m_cal_data;     // calibrate data
     filter_median_t m_filter;  // filter data
+
+    // throws if the device was opened over I2C rather than IIO
+    void requireIIO(const char* func);
 };
 }
@@ -25,14 +25,17 @@
  * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 #include <unistd.h>
+#include <string.h>
 #include <iostream>
+#include <stdexcept>
 
 #include "eboled.hpp"
 
 using namespace upm;
 using namespace std;
 
-static uint16_t screenBuffer[BUFFER_SIZE];
+// this display has a horizontal offset of 32 columns
+#define EBOLED_COLUMN_OFFSET 0x20
 
 EBOLED::EBOLED(int spi, int CD, int reset) :
   m_spi(spi), m_gpioCD(CD), m_gpioRST(reset)
@@ -44,6 +47,22 @@ EBOLED::EBOLED(int spi, int CD, int reset) :
   m_cursorX = 0;
   m_cursorY = 0;
 
+  // we don't know what is on the display yet, so the first refresh
+  // sends everything
+  memset(m_screenBuffer, 0, sizeof(m_screenBuffer));
+  markAllDirty(m_dirtyStart, m_dirtyEnd);
+
+  m_doubleBuffer = false;
+  m_refreshExit = false;
+  m_refreshPending = false;
+  m_refreshResult = mraa::SUCCESS;
+  memset(m_frontBuffer, 0, sizeof(m_frontBuffer));
+  memset(m_frontDirtyStart, OLED_WIDTH, sizeof(m_frontDirtyStart));
+  memset(m_frontDirtyEnd, 0, sizeof(m_frontDirtyEnd));
+
+  pthread_mutex_init(&m_refreshLock, NULL);
+  pthread_cond_init(&m_refreshCond, NULL);
+
   m_gpioCD.dir(mraa::DIR_OUT);
   m_gpioRST.dir(mraa::DIR_OUT);
 
@@ -110,22 +129,207 @@ EBOLED::EBOLED(int spi, int CD, int reset) :
 
 EBOLED::~EBOLED()
 {
+  setDoubleBuffer(false);
   clear();
+
+  pthread_cond_destroy(&m_refreshCond);
+  pthread_mutex_destroy(&m_refreshLock);
 }
 
-mraa::Result EBOLED::refresh()
+mraa::Result EBOLED::refresh(bool force)
 {
-  mraa::Result error = mraa::SUCCESS;;
+  if (force)
+    markAllDirty(m_dirtyStart, m_dirtyEnd);
 
-  m_gpioCD.write(1);            // data mode
-  for(int i=0; i<BUFFER_SIZE; i++)
+  if (!m_doubleBuffer)
+    return writeDirty(m_screenBuffer, m_dirtyStart, m_dirtyEnd);
+
+  pthread_mutex_lock(&m_refreshLock);
+
+  // wait for the previous frame to go out
+  while (m_refreshPending)
+    pthread_cond_wait(&m_refreshCond, &m_refreshLock);
+
+  // anything the thread failed to send is still marked dirty in the
+  // front buffer, so merge rather than replace
+  memcpy(m_frontBuffer, m_screenBuffer, sizeof(m_frontBuffer));
+  for (int page = 0; page < OLED_PAGES; page++)
+  {
+    if (m_dirtyStart[page] < m_frontDirtyStart[page])
+      m_frontDirtyStart[page] = m_dirtyStart[page];
+    if (m_dirtyEnd[page] > m_frontDirtyEnd[page])
+      m_frontDirtyEnd[page] = m_dirtyEnd[page];
+  }
+  memset(m_dirtyStart, OLED_WIDTH, sizeof(m_dirtyStart));
+  memset(m_dirtyEnd, 0, sizeof(m_dirtyEnd));
+
+  mraa::Result rv = m_refreshResult;
+  m_refreshPending = true;
+  pthread_cond_broadcast(&m_refreshCond);
+
+  pthread_mutex_unlock(&m_refreshLock);
+
+  return rv;
+}
+
+void EBOLED::setDoubleBuffer(bool enable)
+{
+  if (enable == m_doubleBuffer)
+    return;
+
+  if (enable)
+  {
+    m_refreshExit = false;
+    m_refreshPending = false;
+    m_refreshResult = mraa::SUCCESS;
+
+    if (pthread_create(&m_refreshThread, NULL, refreshThread, this))
+      throw std::runtime_error(std::string(__FUNCTION__) +
+                               ": pthread_create() failed");
+
+    m_doubleBuffer = true;
+    return;
+  }
+
+  // the thread sends any pending frame before exiting
+  pthread_mutex_lock(&m_refreshLock);
+  m_refreshExit = true;
+  pthread_cond_broadcast(&m_refreshCond);
+  pthread_mutex_unlock(&m_refreshLock);
+
+  pthread_join(m_refreshThread, NULL);
+  m_doubleBuffer = false;
+
+  // whatever the thread could not send is still owed to the display
+  for (int page = 0; page < OLED_PAGES; page++)
+  {
+    if (m_frontDirtyStart[page] < m_dirtyStart[page])
+      m_dirtyStart[page] = m_frontDirtyStart[page];
+    if (m_frontDirtyEnd[page] > m_dirtyEnd[page])
+      m_dirtyEnd[page] = m_frontDirtyEnd[page];
+  }
+  memset(m_frontDirtyStart, OLED_WIDTH, sizeof(m_frontDirtyStart));
+  memset(m_frontDirtyEnd, 0, sizeof(m_frontDirtyEnd));
+}
+
+mraa::Result EBOLED::waitRefresh()
+{
+  if (!m_doubleBuffer)
+    return mraa::SUCCESS;
+
+  pthread_mutex_lock(&m_refreshLock);
+  while (m_refreshPending)
+    pthread_cond_wait(&m_refreshCond, &m_refreshLock);
+  mraa::Result rv = m_refreshResult;
+  pthread_mutex_unlock(&m_refreshLock);
+
+  return rv;
+}
+
+void *EBOLED::refreshThread(void *ctx)
+{
+  EBOLED *This = (EBOLED *)ctx;
+
+  pthread_mutex_lock(&This->m_refreshLock);
+  while (true)
   {
-    error = data(screenBuffer[i]);
-    if(error != mraa::SUCCESS)
-      return error;
+    while (!This->m_refreshPending && !This->m_refreshExit)
+      pthread_cond_wait(&This->m_refreshCond, &This->m_refreshLock);
+
+    if (!This->m_refreshPending)
+      break;
+
+    // the front buffer is ours until m_refreshPending is cleared, so
+    // the lock isn't needed while we send it
+    pthread_mutex_unlock(&This->m_refreshLock);
+    mraa::Result rv = This->writeDirty(This->m_frontBuffer,
+                                       This->m_frontDirtyStart,
+                                       This->m_frontDirtyEnd);
+    pthread_mutex_lock(&This->m_refreshLock);
+
+    This->m_refreshResult = rv;
+    This->m_refreshPending = false;
+    pthread_cond_broadcast(&This->m_refreshCond);
   }
+  pthread_mutex_unlock(&This->m_refreshLock);
 
-  return error;
+  return NULL;
+}
+
+void EBOLED::markAllDirty(uint8_t *start, uint8_t *end)
+{
+  memset(start, 0, OLED_PAGES);
+  memset(end, OLED_WIDTH - 1, OLED_PAGES);
+}
+
+mraa::Result EBOLED::setWindow(uint8_t firstPage, uint8_t lastPage,
+                               uint8_t firstCol, uint8_t lastCol)
+{
+  uint8_t cmds[6] = {
+    CMD_SETPAGEADDRESS, firstPage, lastPage,
+    CMD_SETCOLUMNADDRESS, (uint8_t)(EBOLED_COLUMN_OFFSET + firstCol),
+    (uint8_t)(EBOLED_COLUMN_OFFSET + lastCol)
+  };
+
+  m_gpioCD.write(0);            // command mode
+  return m_spi.transfer(cmds, NULL, sizeof(cmds));
+}
+
+mraa::Result EBOLED::writeDirty(const uint16_t *buffer, uint8_t *start,
+                                uint8_t *end)
+{
+  uint8_t buf[BUFFER_SIZE * 2];
+  int page = 0;
+
+  while (page < OLED_PAGES)
+  {
+    if (start[page] > end[page])
+    {
+      page++;
+      continue;
+    }
+
+    // gather a run of dirty pages, sent as one window covering the
+    // union of their dirty columns
+    int firstPage = page;
+    uint8_t firstCol = start[page];
+    uint8_t lastCol = end[page];
+    while (page < OLED_PAGES && start[page] <= end[page])
+    {
+      if (start[page] < firstCol)
+        firstCol = start[page];
+      if (end[page] > lastCol)
+        lastCol = end[page];
+      page++;
+    }
+    int lastPage = page - 1;
+
+    // each buffer word holds two columns, low byte first
+    int len = 0;
+    for (int p = firstPage; p <= lastPage; p++)
+      for (int col = firstCol; col <= lastCol; col++)
+      {
+        uint16_t word = buffer[(col / 2) + (p * VERT_COLUMNS)];
+        buf[len++] = (col & 1) ? (word >> 8) : (word & 0xff);
+      }
+
+    mraa::Result rv = setWindow(firstPage, lastPage, firstCol, lastCol);
+    if (rv != mraa::SUCCESS)
+      return rv;
+
+    m_gpioCD.write(1);          // data mode
+    rv = m_spi.transfer(buf, NULL, len);
+    if (rv != mraa::SUCCESS)
+      return rv;
+
+    for (int p = firstPage; p <= lastPage; p++)
+    {
+      start[p] = OLED_WIDTH;
+      end[p] = 0;
+    }
+  }
+
+  return mraa::SUCCESS;
 }
 
 mraa::Result EBOLED::write (std::string msg)
@@ -213,17 +417,21 @@ void EBOLED::drawChar (uint8_t x, uint8_t y, uint8_t data, uint8_t color, uint8_
 
 mraa::Result EBOLED::clear()
 {
-  mraa::Result error = mraa::SUCCESS;;
+  uint8_t buf[BUFFER_SIZE * 2];
 
-  m_gpioCD.write(1);            // data mode
-  for(int i=0; i<BUFFER_SIZE; i++)
-  {
-    error = data(0x0000);
-    if(error != mraa::SUCCESS)
-      return error;
-  }
+  // don't step on a frame being sent
+  waitRefresh();
 
-  return mraa::SUCCESS;;
+  // the display no longer shows the screen buffer
+  markAllDirty(m_dirtyStart, m_dirtyEnd);
+
+  mraa::Result error = setWindow(0, OLED_PAGES - 1, 0, OLED_WIDTH - 1);
+  if (error != mraa::SUCCESS)
+    return error;
+
+  memset(buf, 0, sizeof(buf));
+  m_gpioCD.write(1);            // data mode
+  return m_spi.transfer(buf, NULL, sizeof(buf));
 }
 
 mraa::Result EBOLED::home()
@@ -248,15 +456,19 @@ void EBOLED::drawPixel(int8_t x, int8_t y, uint8_t color)
   switch(color)
   {
     case COLOR_XOR:
-      screenBuffer[(x/2) + ((y/8) * VERT_COLUMNS)] ^= (1<<(y%8+(x%2 * 8)));
-      return;
+      m_screenBuffer[(x/2) + ((y/8) * VERT_COLUMNS)] ^= (1<<(y%8+(x%2 * 8)));
+      break;
     case COLOR_WHITE:
-      screenBuffer[(x/2) + ((y/8) * VERT_COLUMNS)] |= (1<<(y%8+(x%2 * 8)));
-      return;
+      m_screenBuffer[(x/2) + ((y/8) * VERT_COLUMNS)] |= (1<<(y%8+(x%2 * 8)));
+      break;
     case COLOR_BLACK:
-      screenBuffer[(x/2) + ((y/8) * VERT_COLUMNS)] &= ~(1<<(y%8+(x%2 * 8)));
+      m_screenBuffer[(x/2) + ((y/8) * VERT_COLUMNS)] &= ~(1<<(y%8+(x%2 * 8)));
+      break;
+    default:
       return;
   }
+
+  markDirty(x, y/8);
 }
 
 void EBOLED::drawLine(int8_t x0, int8_t y0, int8_t x1, int8_t y1, uint8_t color)
@@ -562,6 +774,6 @@ mraa::Result EBOLED::data(uint16_t data)
 
 void EBOLED::clearScreenBuffer()
 {
-  for(int i=0; i<BUFFER_SIZE;i++)
-    screenBuffer[i] = 0x0000;
+  memset(m_screenBuffer, 0, sizeof(m_screenBuffer));
+  markAllDirty(m_dirtyStart, m_dirtyEnd);
 }
@@ -30,6 +30,7 @@
 #pragma once
 
 #include <string>
+#include <pthread.h>
 #include <mraa/spi.hpp>
 
 #include <mraa/gpio.hpp>
@@ -51,6 +52,7 @@ namespace upm
   const uint8_t OLED_WIDTH      = 0x40; // 64 pixels
   const uint8_t VERT_COLUMNS    = 0x20; // half width for hi/lo 16bit writes.
   const uint8_t OLED_HEIGHT     = 0x30; // 48 pixels
+  const uint8_t OLED_PAGES      = 0x06; // 8 pixel high pages
   const int     BUFFER_SIZE     = 192;
 
   /**
@@ -74,6 +76,13 @@ namespace upm
    * standard GPIO -- this driver only concerns itself with the
    * display.
    *
+   * Drawing happens in a local screen buffer.  The driver keeps
+   * track of which columns of each page were drawn to, and refresh()
+   * only sends those to the display, using one SPI transfer per run
+   * of changed pages.  With setDoubleBuffer() enabled, refresh()
+   * hands the frame to a background thread and returns, so the next
+   * frame can be drawn while the previous one is being sent.
+   *
    * @image html eboled.jpg
    * <br><em>OLED Sensor image provided by SparkFun* under
    * <a href=https://creativecommons.org/licenses/by-nc-sa/3.0/>
@@ -131,11 +140,36 @@ namespace upm
     ~EBOLED();
 
     /**
-     * Draw the buffer to screen.
+     * Draw the buffer to screen.  Only the parts of the buffer that
+     * have been drawn to since the last refresh are sent, unless
+     * force is true.  In double buffer mode, this queues the frame
+     * for the background thread, waiting for the previous frame to
+     * be sent first if needed, and returns the result of the
+     * previous frame.
      *
+     * @param force true to send the whole buffer
      * @return result of operation
      */
-    mraa::Result refresh();
+    mraa::Result refresh(bool force=false);
+
+    /**
+     * Enable or disable double buffer mode.  When enabled, a
+     * background thread sends frames to the display, and refresh()
+     * returns as soon as the screen buffer has been copied.
+     * Disabling it waits for any pending frame to be sent.
+     *
+     * @param enable true to enable double buffer mode
+     */
+    void setDoubleBuffer(bool enable);
+
+    /**
+     * In double buffer mode, wait until the background thread has
+     * finished sending the last frame queued by refresh().
+     * Otherwise, this returns immediately.
+     *
+     * @return result of the last frame sent
+     */
+    mraa::Result waitRefresh();
 
     /**
      * Write a string to LCD
@@ -189,12 +223,16 @@ namespace upm
     void drawChar (uint8_t x, uint8_t y, uint8_t data, uint8_t color, uint8_t size);
 
     /**
-     * Clear display
+     * Clear display.  The screen buffer is left untouched, and will
+     * be sent in full by the next refresh().
      *
      * @return result of operation
      */
     mraa::Result clear();
 
+    /**
+     * Clear the screen buffer.
+     */
     void clearScreenBuffer();
 
     /**
@@ -371,5 +409,42 @@ namespace upm
     uint8_t m_textSize;
     uint8_t m_textColor;
     uint8_t m_textWrap;
+
+    // the buffer we draw into, and the columns of each page changed
+    // since the last refresh.  A page is clean when start > end.
+    uint16_t m_screenBuffer[BUFFER_SIZE];
+    uint8_t m_dirtyStart[OLED_PAGES];
+    uint8_t m_dirtyEnd[OLED_PAGES];
+
+    // double buffer mode.  The front buffer and its dirty spans
+    // belong to the refresh thread while m_refreshPending is set.
+    bool m_doubleBuffer;
+    bool m_refreshExit;
+    bool m_refreshPending;
+    mraa::Result m_refreshResult;
+    uint16_t m_frontBuffer[BUFFER_SIZE];
+    uint8_t m_frontDirtyStart[OLED_PAGES];
+    uint8_t m_frontDirtyEnd[OLED_PAGES];
+    pthread_t m_refreshThread;
+    pthread_mutex_t m_refreshLock;
+    pthread_cond_t m_refreshCond;
+
+    void markDirty(uint8_t x, uint8_t page)
+    {
+      if (x < m_dirtyStart[page])
+        m_dirtyStart[page] = x;
+      if (x > m_dirtyEnd[page])
+        m_dirtyEnd[page] = x;
+    }
+    void markAllDirty(uint8_t *start, uint8_t *end);
+    mraa::Result setWindow(uint8_t firstPage, uint8_t lastPage,
+                           uint8_t firstCol, uint8_t lastCol);
+    mraa::Result writeDirty(const uint16_t *buffer, uint8_t *start,
+                            uint8_t *end);
+    static void *refreshThread(void *ctx);
+
+    // disable copying, the object owns a thread
+    EBOLED(const EBOLED&) = delete;
+    EBOLED &operator=(const EBOLED&) = delete;
   };
 }
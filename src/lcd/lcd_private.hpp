@@ -32,3 +32,99 @@
     if ((ret) != mraa::SUCCESS) {           \
         goto target;                       \
     }
+
+#include <string.h>
+#include <mraa/i2c.hpp>
+
+namespace upm
+{
+// SSD13xx I2C control byte announcing that every following byte in
+// the transfer is a command.  LCD_DATA (0x40) does the same for
+// display data.
+const uint8_t SSD_CMD_STREAM = 0x00;
+
+// Largest block of bytes sent in one I2C transfer.  A full SSD1327
+// frame (96x96 at 4bpp) fits, and it is well below the 8K per message
+// limit of the Linux i2c-dev interface.
+const int SSD_MAX_TRANSFER = 4608;
+
+// Send a block of commands or display data to an SSD13xx controller,
+// with the control byte prefixed once per transfer instead of once
+// per byte.
+inline mraa::Result
+ssdWriteBulk(mraa::I2c& i2c, uint8_t control, const uint8_t* data, int len)
+{
+    uint8_t buf[SSD_MAX_TRANSFER + 1];
+    mraa::Result rv = mraa::SUCCESS;
+
+    while (len > 0) {
+        int chunk = (len > SSD_MAX_TRANSFER) ? SSD_MAX_TRANSFER : len;
+
+        buf[0] = control;
+        memcpy(&buf[1], data, chunk);
+
+        rv = i2c.write(buf, chunk + 1);
+        if (rv != mraa::SUCCESS) {
+            return rv;
+        }
+
+        data += chunk;
+        len -= chunk;
+    }
+
+    return rv;
+}
+
+// Send the pages of a framebuffer that differ from shadow, the copy of
+// what is on the display, calling (lcd->*writeRun)(first, last) once
+// for each run of consecutive changed pages.  If shadowValid is false
+// (e.g. after a text write), or force is set, every page is sent.  On
+// success the shadow is updated; on failure it is marked invalid, as
+// the display no longer matches either buffer.  partial is set if only
+// some pages were sent, in which case the caller should reset its
+// address window to cover the whole display.
+template <typename T>
+inline mraa::Result
+ssdRefreshPages(T* lcd, mraa::Result (T::*writeRun)(int, int),
+                const uint8_t* frame, uint8_t* shadow, bool& shadowValid,
+                int pages, int pageSize, bool force, bool& partial)
+{
+    mraa::Result rv;
+
+    partial = false;
+    if (!shadowValid) {
+        force = true;
+    }
+
+    int page = 0;
+    while (page < pages) {
+        if (!force && !memcmp(&frame[page * pageSize],
+                              &shadow[page * pageSize], pageSize)) {
+            page++;
+            continue;
+        }
+
+        int first = page;
+        while (page < pages &&
+               (force || memcmp(&frame[page * pageSize],
+                                &shadow[page * pageSize], pageSize))) {
+            page++;
+        }
+
+        rv = (lcd->*writeRun)(first, page - 1);
+        if (rv != mraa::SUCCESS) {
+            shadowValid = false;
+            return rv;
+        }
+
+        if (first != 0 || page != pages) {
+            partial = true;
+        }
+    }
+
+    memcpy(shadow, frame, pages * pageSize);
+    shadowValid = true;
+
+    return mraa::SUCCESS;
+}
+}
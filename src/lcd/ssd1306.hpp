@@ -83,6 +83,7 @@ const uint8_t  SSD1306_BLACK = 0;
 const uint8_t  SSD1306_WHITE = 1;
 const uint8_t  SSD1306_LCDWIDTH = 128;
 const uint8_t  SSD1306_LCDHEIGHT = 64;
+const int      SSD1306_FRAMEBUFFER_SIZE = SSD1306_LCDWIDTH * SSD1306_LCDHEIGHT / 8;
 
 /**
  * @library lcd
@@ -121,13 +122,33 @@ class SSD1306 : public LCD
     ~SSD1306();
     /**
      * Draws an image; see examples/python/make_oled_pic.py for an
-     * explanation of how pixels are mapped to bytes
+     * explanation of how pixels are mapped to bytes.  The image is
+     * copied into the framebuffer starting at the top left corner,
+     * and the display is then updated with refresh().
      *
      * @param data Buffer to read
      * @param bytes Number of bytes to read from the pointer
      * @return Result of the operation
      */
     mraa::Result draw(uint8_t* data, int bytes);
+    /**
+     * Returns a pointer to the framebuffer.  It holds
+     * SSD1306_FRAMEBUFFER_SIZE bytes, in the same format used by
+     * draw().  Render into it, then call refresh() to show it.
+     *
+     * @return Pointer to the framebuffer
+     */
+    uint8_t* getFramebuffer();
+    /**
+     * Sends the framebuffer to the display.  Only the pages that
+     * have changed since the last refresh are sent, and each run of
+     * consecutive changed pages goes out as a single I2C transfer.
+     *
+     * @param force true to send the whole framebuffer even if it has
+     * not changed
+     * @return Result of the operation
+     */
+    mraa::Result refresh(bool force = false);
     /**
      * Writes a string to the LCD
      *
@@ -221,6 +242,12 @@ class SSD1306 : public LCD
     mraa::Result writeChar(uint8_t value);
     mraa::Result setNormalDisplay();
     mraa::Result setAddressingMode(displayAddressingMode mode);
+    mraa::Result writePages(int first, int last);
+
+    // what we want on the display, and what is on it now
+    uint8_t m_framebuffer[SSD1306_FRAMEBUFFER_SIZE];
+    uint8_t m_shadow[SSD1306_FRAMEBUFFER_SIZE];
+    bool m_shadowValid;
 
     int m_lcd_control_address;
     mraa::I2c m_i2c_lcd_control;
@@ -27,6 +27,7 @@
 #include <unistd.h>
 
 #include "hd44780_bits.hpp"
+#include "lcd_private.hpp"
 #include "ssd1308.hpp"
 
 using namespace upm;
@@ -36,6 +37,9 @@ SSD1308::SSD1308(int bus_in, int addr_in) : m_i2c_lcd_control(bus_in)
     m_lcd_control_address = addr_in;
     m_name = "SSD1308";
 
+    memset(m_framebuffer, 0, SSD1308_FRAMEBUFFER_SIZE);
+    m_shadowValid = false;
+
     mraa::Result error = m_i2c_lcd_control.address(m_lcd_control_address);
     if (error != mraa::SUCCESS) {
         throw std::invalid_argument(std::string(__FUNCTION__) +
@@ -60,14 +64,39 @@ SSD1308::~SSD1308()
 mraa::Result
 SSD1308::draw(uint8_t* data, int bytes)
 {
-    mraa::Result error = mraa::SUCCESS;
+    if (bytes > SSD1308_FRAMEBUFFER_SIZE) {
+        bytes = SSD1308_FRAMEBUFFER_SIZE;
+    }
+    if (bytes > 0) {
+        memcpy(m_framebuffer, data, bytes);
+    }
+
+    return refresh();
+}
+
+uint8_t*
+SSD1308::getFramebuffer()
+{
+    return m_framebuffer;
+}
 
-    setAddressingMode(HORIZONTAL);
-    for (int idx = 0; idx < bytes; idx++) {
-        m_i2c_lcd_control.writeReg(LCD_DATA, data[idx]);
+mraa::Result
+SSD1308::refresh(bool force)
+{
+    const int pages = SSD1308_LCDHEIGHT / 8;
+    bool partial;
+
+    mraa::Result rv = ssdRefreshPages(this, &SSD1308::writePages, m_framebuffer,
+                                      m_shadow, m_shadowValid, pages,
+                                      SSD1308_LCDWIDTH, force, partial);
+
+    // leave the whole display addressable again
+    if (rv == mraa::SUCCESS && partial) {
+        const uint8_t cmds[] = { SSD1308_PAGEADDR, 0, pages - 1 };
+        rv = ssdWriteBulk(m_i2c_lcd_control, SSD_CMD_STREAM, cmds, sizeof(cmds));
     }
 
-    return error;
+    return rv;
 }
 
 /*
@@ -105,21 +134,15 @@ SSD1308::setCursor(int row, int column)
 mraa::Result
 SSD1308::clear()
 {
-    uint8_t columnIdx, rowIdx;
+    mraa::Result error;
 
-    m_i2c_lcd_control.writeReg(LCD_CMD, DISPLAY_CMD_OFF); // display off
-    for (rowIdx = 0; rowIdx < 8; rowIdx++) {
-        setCursor(rowIdx, 0);
+    memset(m_framebuffer, 0, SSD1308_FRAMEBUFFER_SIZE);
+    error = refresh(true);
 
-        // clear all columns
-        for (columnIdx = 0; columnIdx < 16; columnIdx++) {
-            writeChar(' ');
-        }
-    }
-    m_i2c_lcd_control.writeReg(LCD_CMD, DISPLAY_CMD_ON); // display on
+    setAddressingMode(PAGE);
     home();
 
-    return mraa::SUCCESS;
+    return error;
 }
 
 mraa::Result
@@ -136,16 +159,33 @@ SSD1308::home()
 mraa::Result
 SSD1308::writeChar(uint8_t value)
 {
-    mraa::Result rv;
     if (value < 0x20 || value > 0x7F) {
         value = 0x20; // space
     }
 
-    for (uint8_t idx = 0; idx < 8; idx++) {
-        rv = m_i2c_lcd_control.writeReg(LCD_DATA, BasicFont[value - 32][idx]);
+    // the display no longer matches the framebuffer
+    m_shadowValid = false;
+
+    return ssdWriteBulk(m_i2c_lcd_control, LCD_DATA, BasicFont[value - 32], 8);
+}
+
+mraa::Result
+SSD1308::writePages(int first, int last)
+{
+    const uint8_t cmds[] = {
+        DISPLAY_CMD_MEM_ADDR_MODE, HORIZONTAL,
+        SSD1308_COLUMNADDR, 0, SSD1308_LCDWIDTH - 1,
+        SSD1308_PAGEADDR, (uint8_t) first, (uint8_t) last
+    };
+
+    mraa::Result rv = ssdWriteBulk(m_i2c_lcd_control, SSD_CMD_STREAM, cmds, sizeof(cmds));
+    if (rv != mraa::SUCCESS) {
+        return rv;
     }
 
-    return rv;
+    return ssdWriteBulk(m_i2c_lcd_control, LCD_DATA,
+                        &m_framebuffer[first * SSD1308_LCDWIDTH],
+                        (last - first + 1) * SSD1308_LCDWIDTH);
 }
 
 mraa::Result
@@ -27,6 +27,7 @@
 #include <unistd.h>
 
 #include "hd44780_bits.hpp"
+#include "lcd_private.hpp"
 #include "ssd1327.hpp"
 
 using namespace upm;
@@ -41,6 +42,10 @@ SSD1327::SSD1327(int bus_in, int addr_in) : m_i2c_lcd_control(bus_in)
     m_lcd_control_address = addr_in;
     m_name = "SSD1327";
 
+    setGrayLevel(0x0F);
+    memset(m_framebuffer, 0, SSD1327_FRAMEBUFFER_SIZE);
+    m_shadowValid = false;
+
     error = m_i2c_lcd_control.address(m_lcd_control_address);
     if (error != mraa::SUCCESS) {
         throw std::invalid_argument(std::string(__FUNCTION__) +
@@ -149,25 +154,46 @@ SSD1327::~SSD1327()
 mraa::Result
 SSD1327::draw(uint8_t* data, int bytes)
 {
-    mraa::Result error = mraa::SUCCESS;
+    if (bytes > SSD1327_FRAMEBUFFER_SIZE) {
+        bytes = SSD1327_FRAMEBUFFER_SIZE;
+    }
+    if (bytes > 0) {
+        memcpy(m_framebuffer, data, bytes);
+    }
+
+    return refresh();
+}
+
+uint8_t*
+SSD1327::getFramebuffer()
+{
+    return m_framebuffer;
+}
 
-    setHorizontalMode();
-    for (int row = 0; row < bytes; row++) {
-        for (uint8_t col = 0; col < 8; col += 2) {
-            uint8_t value = 0x0;
+mraa::Result
+SSD1327::refresh(bool force)
+{
+    const int bands = SSD1327_LCDHEIGHT / 8;
+    bool partial;
 
-            uint8_t bitOne = (data[row] << col) & 0x80;
-            uint8_t bitTwo = (data[row] << (col + 1)) & 0x80;
+    // expand each pixel to a nibble of the current gray level
+    for (int idx = 0; idx < SSD1327_FRAMEBUFFER_SIZE; idx++) {
+        memcpy(&m_gray[idx * 4], m_grayLUT[m_framebuffer[idx]], 4);
+    }
 
-            value |= (bitOne) ? grayHigh : 0x00;
-            value |= (bitTwo) ? grayLow : 0x00;
+    // each band of 8 rows is one "page" of the gray buffer
+    mraa::Result rv = ssdRefreshPages(this, &SSD1327::writeBands, m_gray,
+                                      m_shadow, m_shadowValid, bands,
+                                      SSD1327_GRAYBUFFER_SIZE / bands, force,
+                                      partial);
 
-            m_i2c_lcd_control.writeReg(LCD_DATA, value);
-            usleep(CMD_SLEEP - 2000);
-        }
+    // leave the whole display addressable again
+    if (rv == mraa::SUCCESS && partial) {
+        const uint8_t cmds[] = { 0x75, 0x00, SSD1327_LCDHEIGHT - 1 };
+        rv = ssdWriteBulk(m_i2c_lcd_control, SSD_CMD_STREAM, cmds, sizeof(cmds));
     }
 
-    return error;
+    return rv;
 }
 
 /*
@@ -215,16 +241,9 @@ SSD1327::setCursor(int row, int column)
 mraa::Result
 SSD1327::clear()
 {
-    uint8_t columnIdx, rowIdx;
-
-    for (rowIdx = 0; rowIdx < 12; rowIdx++) {
-        // clear all columns
-        for (columnIdx = 0; columnIdx < 12; columnIdx++) {
-            writeChar(' ');
-        }
-    }
+    memset(m_framebuffer, 0, SSD1327_FRAMEBUFFER_SIZE);
 
-    return mraa::SUCCESS;
+    return refresh(true);
 }
 
 mraa::Result
@@ -238,6 +257,19 @@ SSD1327::setGrayLevel(uint8_t level)
 {
     grayHigh = (level << 4) & 0xF0;
     grayLow = level & 0x0F;
+
+    // Each framebuffer byte holds 8 pixels, MSB first, which become
+    // 4 bytes of 2 pixels each on the display.
+    for (int value = 0; value < 256; value++) {
+        for (int idx = 0; idx < 4; idx++) {
+            uint8_t data = 0x0;
+
+            data |= (value & (0x80 >> (idx * 2))) ? grayHigh : 0x00;
+            data |= (value & (0x40 >> (idx * 2))) ? grayLow : 0x00;
+
+            m_grayLUT[value][idx] = data;
+        }
+    }
 }
 
 /*
@@ -248,7 +280,9 @@ SSD1327::setGrayLevel(uint8_t level)
 mraa::Result
 SSD1327::writeChar(uint8_t value)
 {
-    mraa::Result rv = mraa::SUCCESS;
+    uint8_t buf[32];
+    int len = 0;
+
     if (value < 0x20 || value > 0x7F) {
         value = 0x20; // space
     }
@@ -263,47 +297,41 @@ SSD1327::writeChar(uint8_t value)
             data |= (bitOne) ? grayHigh : 0x00;
             data |= (bitTwo) ? grayLow : 0x00;
 
-            rv = m_i2c_lcd_control.writeReg(LCD_DATA, data);
-            usleep(CMD_SLEEP - 2000);
+            buf[len++] = data;
         }
     }
-    return rv;
+
+    // the display no longer matches the framebuffer
+    m_shadowValid = false;
+
+    return ssdWriteBulk(m_i2c_lcd_control, LCD_DATA, buf, len);
 }
 
 mraa::Result
-SSD1327::setNormalDisplay()
+SSD1327::writeBands(int first, int last)
 {
-    return m_i2c_lcd_control.writeReg(LCD_CMD,
-                                      DISPLAY_CMD_SET_NORMAL); // set to normal display '1' is ON
+    const uint8_t cmds[] = {
+        0xA0, 0x42,                                            // remap to horizontal mode
+        0x75, (uint8_t) (first * 8), (uint8_t) (last * 8 + 7), // Set Row Address
+        0x15, 0x08, 0x37                                       // Set Column Address
+    };
+
+    mraa::Result rv = ssdWriteBulk(m_i2c_lcd_control, SSD_CMD_STREAM, cmds, sizeof(cmds));
+    if (rv != mraa::SUCCESS) {
+        return rv;
+    }
+
+    const int bandSize = SSD1327_GRAYBUFFER_SIZE / (SSD1327_LCDHEIGHT / 8);
+
+    return ssdWriteBulk(m_i2c_lcd_control, LCD_DATA, &m_gray[first * bandSize],
+                        (last - first + 1) * bandSize);
 }
 
 mraa::Result
-SSD1327::setHorizontalMode()
+SSD1327::setNormalDisplay()
 {
-    mraa::Result rv = mraa::SUCCESS;
-    rv = m_i2c_lcd_control.writeReg(LCD_CMD, 0xA0); // remap to
-    usleep(CMD_SLEEP);
-    rv = m_i2c_lcd_control.writeReg(LCD_CMD, 0x42); // horizontal mode
-    usleep(CMD_SLEEP);
-
-    // Row Address
-    rv = m_i2c_lcd_control.writeReg(LCD_CMD, 0x75); // Set Row Address
-    usleep(CMD_SLEEP);
-    rv = m_i2c_lcd_control.writeReg(LCD_CMD, 0x00); // Start 0
-    usleep(CMD_SLEEP);
-    rv = m_i2c_lcd_control.writeReg(LCD_CMD, 0x5f); // End 95
-    usleep(CMD_SLEEP);
-
-    // Column Address
-    rv = m_i2c_lcd_control.writeReg(LCD_CMD, 0x15); // Set Column Address
-    usleep(CMD_SLEEP);
-    rv = m_i2c_lcd_control.writeReg(LCD_CMD, 0x08); // Start from 8th Column of driver
-                                               // IC. This is 0th Column for OLED
-    usleep(CMD_SLEEP);
-    rv = m_i2c_lcd_control.writeReg(LCD_CMD, 0x37); // End at  (8 + 47)th column. Each
-                                               // Column has 2 pixels(or segments)
-    usleep(CMD_SLEEP);
-    return rv;
+    return m_i2c_lcd_control.writeReg(LCD_CMD,
+                                      DISPLAY_CMD_SET_NORMAL); // set to normal display '1' is ON
 }
 
 mraa::Result
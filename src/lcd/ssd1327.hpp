@@ -32,6 +32,11 @@
 namespace upm
 {
 const uint8_t DISPLAY_CMD_SET_NORMAL = 0xA4;
+const uint8_t SSD1327_LCDWIDTH = 96;
+const uint8_t SSD1327_LCDHEIGHT = 96;
+// the framebuffer is 1bpp, as used by draw().  The display itself is 4bpp.
+const int     SSD1327_FRAMEBUFFER_SIZE = SSD1327_LCDWIDTH * SSD1327_LCDHEIGHT / 8;
+const int     SSD1327_GRAYBUFFER_SIZE = SSD1327_LCDWIDTH * SSD1327_LCDHEIGHT / 2;
 
 /**
  * @library lcd
@@ -68,7 +73,9 @@ class SSD1327 : public LCD
     ~SSD1327();
     /**
      * Draws an image; see examples/python/make_oled_pic.py for an
-     * explanation of how pixels are mapped to bytes
+     * explanation of how pixels are mapped to bytes.  The image is
+     * copied into the framebuffer starting at the top left corner,
+     * and the display is then updated with refresh().
      *
      * @param data Buffer to read
      * @param bytes Number of bytes to read from the pointer
@@ -76,7 +83,29 @@ class SSD1327 : public LCD
      */
     mraa::Result draw(uint8_t* data, int bytes);
     /**
-     * Sets the gray level for the LCD panel
+     * Returns a pointer to the framebuffer.  It holds
+     * SSD1327_FRAMEBUFFER_SIZE bytes of 1 bit per pixel data, in the
+     * same format used by draw().  Render into it, then call
+     * refresh() to show it.
+     *
+     * @return Pointer to the framebuffer
+     */
+    uint8_t* getFramebuffer();
+    /**
+     * Sends the framebuffer to the display, using the current gray
+     * level for lit pixels.  Only the bands of 8 rows that have
+     * changed since the last refresh are sent, and each run of
+     * consecutive changed bands goes out as a single I2C transfer.
+     *
+     * @param force true to send the whole framebuffer even if it has
+     * not changed
+     * @return Result of the operation
+     */
+    mraa::Result refresh(bool force = false);
+    /**
+     * Sets the gray level for the LCD panel.  This applies to text
+     * written afterwards, and to the framebuffer from the next
+     * refresh().
      *
      * @param level level from 0 to 255
      * @return Result of the operation
@@ -114,12 +143,22 @@ class SSD1327 : public LCD
   private:
     mraa::Result writeChar(uint8_t value);
     mraa::Result setNormalDisplay();
-    mraa::Result setHorizontalMode();
     mraa::Result setVerticalMode();
+    mraa::Result writeBands(int first, int last);
 
     uint8_t grayHigh;
     uint8_t grayLow;
 
+    // expansion of each framebuffer byte into 4 bytes of display data
+    uint8_t m_grayLUT[256][4];
+
+    // what we want on the display, its expansion to 4bpp, and what
+    // is on the display now
+    uint8_t m_framebuffer[SSD1327_FRAMEBUFFER_SIZE];
+    uint8_t m_gray[SSD1327_GRAYBUFFER_SIZE];
+    uint8_t m_shadow[SSD1327_GRAYBUFFER_SIZE];
+    bool m_shadowValid;
+
     int m_lcd_control_address;
     mraa::I2c m_i2c_lcd_control;
 };
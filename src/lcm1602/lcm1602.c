@@ -40,11 +40,41 @@
 #include "lcm1602.h"
 #include "hd44780_bits.h"
 
+// The largest single I2C write we will build when batching.  Each
+// byte sent to the controller costs 4 expander bytes, plus one more
+// whenever RS changes.
+#define LCM1602_BATCH_MAX 256
+
+// The longest run of characters written after a single set address
+// command, so that a run always fits in a batch.
+#define LCM1602_MAX_RUN ((LCM1602_BATCH_MAX - 6) / 4)
+
+// When flushing, unchanged cells between two changed ones are
+// rewritten rather than starting a new run, if there are no more
+// than this many.  An unchanged cell costs 4 expander bytes, a new
+// set address command at least as much.
+#define LCM1602_RUN_GAP 1
+
+// A batch of expander writes, sent in one I2C transaction
+typedef struct {
+    uint8_t buf[LCM1602_BATCH_MAX];
+    int len;
+    // RS of the last nibble added, or -1 if none yet
+    int mode;
+} lcm1602_batch_t;
+
 // forward declarations
 static upm_result_t send(const lcm1602_context dev, uint8_t value, int mode);
 static upm_result_t write4bits(const lcm1602_context dev, uint8_t value);
 static upm_result_t expandWrite(const lcm1602_context dev, uint8_t value);
 static upm_result_t pulseEnable(const lcm1602_context dev, uint8_t value);
+static uint8_t ddram_address(const lcm1602_context dev, unsigned int row,
+                             unsigned int column);
+static void batch_init(lcm1602_batch_t *batch);
+static void batch_add(const lcm1602_context dev, lcm1602_batch_t *batch,
+                      uint8_t value, int mode);
+static upm_result_t batch_send(const lcm1602_context dev,
+                               lcm1602_batch_t *batch);
 
 lcm1602_context lcm1602_i2c_init(int bus, int address, bool is_expander,
                                  uint8_t num_columns, uint8_t num_rows)
@@ -279,6 +309,9 @@ void lcm1602_close(lcm1602_context dev)
     if (dev->gpioD3)
         mraa_gpio_close(dev->gpioD3);
 
+    free(dev->shadow);
+    free(dev->glass);
+
     free(dev);
 }
 
@@ -289,9 +322,33 @@ upm_result_t lcm1602_write(const lcm1602_context dev, char *buffer,
 
     upm_result_t error = UPM_SUCCESS;
 
+    // we no longer know what is on the display
+    dev->glassValid = false;
+
+    if (dev->isI2C)
+    {
+        // send as many characters as fit in each I2C write
+        lcm1602_batch_t batch;
+        int i = 0;
+
+        while (i < len)
+        {
+            batch_init(&batch);
+
+            int j;
+            for (j = 0; j < LCM1602_MAX_RUN && i < len; j++, i++)
+                batch_add(dev, &batch, buffer[i], HD44780_RS);
+
+            if (batch_send(dev, &batch))
+                error = UPM_ERROR_OPERATION_FAILED;
+        }
+
+        return error;
+    }
+
     int i;
     for (i=0; i<len; ++i)
-        error = lcm1602_data(dev, buffer[i]);
+        error = send(dev, buffer[i], HD44780_RS);
 
     return error;
 }
@@ -301,58 +358,8 @@ upm_result_t lcm1602_set_cursor(const lcm1602_context dev, unsigned int row,
 {
     assert(dev != NULL);
 
-    column = column % dev->columns;
-    uint8_t offset = column;
-
-    switch (dev->rows)
-    {
-    case 1:
-        // Single row displays with more than 8 columns usually have their
-        // DDRAM split in two halves. The first half starts at address 00.
-        // The second half starts at address 40. E.g. 16x2 DDRAM mapping:
-        // 00 01 02 03 04 05 06 07 40 41 42 43 44 45 46 47
-        if (dev->columns > 8)
-        {
-            offset = (column % (dev->columns / 2)) +
-                (column / (dev->columns / 2)) * 0x40;
-        }
-        break;
-
-    case 2:
-        // this should work for any display with two rows
-        // DDRAM mapping:
-        // 00 .. 27
-        // 40 .. 67
-        offset += row * 0x40;
-        break;
-
-    case 4:
-        if (dev->columns == 16)
-        {
-            // 16x4 display
-            // DDRAM mapping:
-            // 00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F
-            // 40 41 42 43 43 45 46 47 48 49 4A 4B 4C 4D 4E 4F
-            // 10 11 12 13 14 15 16 17 18 19 1A 1B 1C 1D 1E 1F
-            // 50 51 52 53 54 55 56 57 58 59 5A 5B 5C 5D 5E 5F
-            int row_addr[] = { 0x00, 0x40, 0x10, 0x50 };
-            offset += row_addr[row];
-        }
-        else
-        {
-            // 20x4 display
-            // DDRAM mapping:
-            // 00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F 10 11 12 13
-            // 40 41 42 43 43 45 46 47 48 49 4A 4B 4C 4D 4E 4F 50 51 52 53
-            // 14 15 16 17 18 19 1A 1B 1C 1D 1E 1F 20 21 22 23 24 25 26 27
-            // 54 55 56 57 58 59 5A 5B 5C 5D 5E 5F 60 61 62 63 64 65 66 67
-            int row_addr[] = { 0x00, 0x40, 0x14, 0x54 };
-            offset += row_addr[row];
-        }
-        break;
-    }
-
-    return lcm1602_command(dev, HD44780_CMD | offset);
+    return lcm1602_command(dev, HD44780_CMD | ddram_address(dev, row,
+                                                             column));
 }
 
 upm_result_t lcm1602_clear(const lcm1602_context dev)
@@ -362,6 +369,14 @@ upm_result_t lcm1602_clear(const lcm1602_context dev)
     upm_result_t ret;
     ret = lcm1602_command(dev, HD44780_CLEARDISPLAY);
     upm_delay_us(2000); // this command takes awhile
+
+    // the display is now all spaces
+    if (dev->glass)
+    {
+        memset(dev->glass, ' ', dev->rows * dev->columns);
+        dev->glassValid = (ret == UPM_SUCCESS);
+    }
+
     return ret;
 }
 
@@ -385,19 +400,116 @@ upm_result_t lcm1602_create_char(const lcm1602_context dev,
 
     slot &= 0x07; // only have 8 positions we can set
 
-    error = lcm1602_command(dev, HD44780_SETCGRAMADDR | (slot << 3));
+    dev->cgramLastUse[slot] = ++dev->cgramClock;
 
-    if (error == UPM_SUCCESS)
+    // nothing to do if the slot already holds this glyph
+    if ((dev->cgramValid & (1 << slot))
+        && !memcmp(dev->cgram[slot], data, 8))
+        return UPM_SUCCESS;
+
+    if (dev->isI2C)
     {
+        // the command and all 8 rows in a single I2C write
+        lcm1602_batch_t batch;
+        batch_init(&batch);
+
+        batch_add(dev, &batch, HD44780_SETCGRAMADDR | (slot << 3), 0);
+
         int i;
-        for (i = 0; i < 8; i++) {
-            error = lcm1602_data(dev, data[i]);
+        for (i = 0; i < 8; i++)
+            batch_add(dev, &batch, data[i], HD44780_RS);
+
+        error = batch_send(dev, &batch);
+    }
+    else
+    {
+        error = lcm1602_command(dev, HD44780_SETCGRAMADDR | (slot << 3));
+
+        if (error == UPM_SUCCESS)
+        {
+            int i;
+            for (i = 0; i < 8; i++) {
+                error = send(dev, data[i], HD44780_RS);
+            }
         }
     }
 
+    if (error == UPM_SUCCESS)
+    {
+        memcpy(dev->cgram[slot], data, 8);
+        dev->cgramValid |= (1 << slot);
+    }
+    else
+        dev->cgramValid &= ~(1 << slot);
+
     return error;
 }
 
+upm_result_t lcm1602_get_char_slot(const lcm1602_context dev,
+                                   char *data, unsigned int *slot)
+{
+    assert(dev != NULL);
+    assert(slot != NULL);
+
+    int i;
+
+    // already loaded?
+    for (i = 0; i < 8; i++)
+    {
+        if ((dev->cgramValid & (1 << i)) && !memcmp(dev->cgram[i], data, 8))
+        {
+            dev->cgramLastUse[i] = ++dev->cgramClock;
+            *slot = i;
+            return UPM_SUCCESS;
+        }
+    }
+
+    // Pick a slot to replace.  Unused slots are best, then slots
+    // whose character codes (0-7, or their aliases 8-15) do not
+    // appear in the shadow buffer, oldest first.
+    int best = -1;
+    int bestScore = 0;
+    uint32_t bestUse = 0;
+
+    for (i = 0; i < 8; i++)
+    {
+        int score;
+
+        if (!(dev->cgramValid & (1 << i)))
+            score = 2;
+        else
+        {
+            score = 1;
+
+            if (dev->shadow)
+            {
+                unsigned int j;
+                for (j = 0; j < dev->rows * dev->columns; j++)
+                {
+                    uint8_t c = (uint8_t)dev->shadow[j];
+                    if (c < 16 && (c & 0x07) == i)
+                    {
+                        score = 0;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (best < 0 || score > bestScore
+            || (score == bestScore && dev->cgramLastUse[i] < bestUse))
+        {
+            best = i;
+            bestScore = score;
+            bestUse = dev->cgramLastUse[i];
+        }
+    }
+
+    *slot = best;
+
+    return lcm1602_create_char(dev, best, data);
+}
+
 upm_result_t lcm1602_display_on(const lcm1602_context dev, bool on)
 {
     assert(dev != NULL);
@@ -496,9 +608,215 @@ upm_result_t lcm1602_command(const lcm1602_context dev, uint8_t cmd)
 upm_result_t lcm1602_data(const lcm1602_context dev, uint8_t cmd)
 {
     assert(dev != NULL);
+
+    // we no longer know what is on the display
+    dev->glassValid = false;
+
     return send(dev, cmd, HD44780_RS); // 1
 }
 
+upm_result_t lcm1602_shadow_enable(const lcm1602_context dev, bool enable)
+{
+    assert(dev != NULL);
+
+    free(dev->shadow);
+    free(dev->glass);
+    dev->shadow = NULL;
+    dev->glass = NULL;
+    dev->glassValid = false;
+
+    if (!enable)
+        return UPM_SUCCESS;
+
+    unsigned int size = dev->rows * dev->columns;
+
+    if (!size)
+    {
+        printf("%s: display has no rows or columns\n", __FUNCTION__);
+        return UPM_ERROR_INVALID_SIZE;
+    }
+
+    if (!(dev->shadow = (char *)malloc(size))
+        || !(dev->glass = (char *)malloc(size)))
+    {
+        printf("%s: malloc() failed\n", __FUNCTION__);
+        free(dev->shadow);
+        dev->shadow = NULL;
+        return UPM_ERROR_NO_RESOURCES;
+    }
+
+    memset(dev->shadow, ' ', size);
+    memset(dev->glass, ' ', size);
+
+    return UPM_SUCCESS;
+}
+
+upm_result_t lcm1602_shadow_write(const lcm1602_context dev,
+                                  unsigned int row, unsigned int column,
+                                  const char *buffer, int len)
+{
+    assert(dev != NULL);
+
+    if (!dev->shadow)
+    {
+        printf("%s: shadow buffer mode is not enabled\n", __FUNCTION__);
+        return UPM_ERROR_NO_RESOURCES;
+    }
+
+    if (row >= dev->rows || column >= dev->columns)
+        return UPM_ERROR_OUT_OF_RANGE;
+
+    if (len < 0)
+        return UPM_ERROR_INVALID_PARAMETER;
+
+    if ((unsigned int)len > dev->columns - column)
+        len = dev->columns - column;
+
+    memcpy(dev->shadow + (row * dev->columns) + column, buffer, len);
+
+    return UPM_SUCCESS;
+}
+
+upm_result_t lcm1602_shadow_clear(const lcm1602_context dev)
+{
+    assert(dev != NULL);
+
+    if (!dev->shadow)
+    {
+        printf("%s: shadow buffer mode is not enabled\n", __FUNCTION__);
+        return UPM_ERROR_NO_RESOURCES;
+    }
+
+    memset(dev->shadow, ' ', dev->rows * dev->columns);
+
+    return UPM_SUCCESS;
+}
+
+void lcm1602_shadow_invalidate(const lcm1602_context dev)
+{
+    assert(dev != NULL);
+
+    dev->glassValid = false;
+}
+
+upm_result_t lcm1602_flush(const lcm1602_context dev)
+{
+    assert(dev != NULL);
+
+    if (!dev->shadow)
+    {
+        printf("%s: shadow buffer mode is not enabled\n", __FUNCTION__);
+        return UPM_ERROR_NO_RESOURCES;
+    }
+
+    upm_result_t rv = UPM_SUCCESS;
+    lcm1602_batch_t batch;
+    batch_init(&batch);
+
+    // runs are written left to right, without shifting the display
+    uint8_t entryMode = HD44780_ENTRYLEFT | HD44780_ENTRYSHIFTDECREMENT;
+    bool restoreEntry = (dev->entryDisplayMode != entryMode);
+
+    if (restoreEntry)
+    {
+        if (dev->isI2C)
+            batch_add(dev, &batch, HD44780_ENTRYMODESET | entryMode, 0);
+        else if (send(dev, HD44780_ENTRYMODESET | entryMode, 0))
+            rv = UPM_ERROR_OPERATION_FAILED;
+    }
+
+    unsigned int row;
+    for (row = 0; row < dev->rows; row++)
+    {
+        char *shadow = dev->shadow + (row * dev->columns);
+        char *glass = dev->glass + (row * dev->columns);
+        unsigned int col = 0;
+
+        while (col < dev->columns)
+        {
+            if (dev->glassValid && shadow[col] == glass[col])
+            {
+                col++;
+                continue;
+            }
+
+            // Extend the run over further changed cells, and over
+            // short gaps of unchanged ones, as long as the DDRAM
+            // addresses stay contiguous.
+            unsigned int start = col;
+            unsigned int end = col;
+            uint8_t addr = ddram_address(dev, row, start);
+            unsigned int next;
+
+            for (next = start + 1; next < dev->columns
+                     && (next - start) < LCM1602_MAX_RUN; next++)
+            {
+                if (ddram_address(dev, row, next) != addr + (next - start))
+                    break;
+
+                if (!dev->glassValid || shadow[next] != glass[next])
+                    end = next;
+                else if (next - end > LCM1602_RUN_GAP)
+                    break;
+            }
+
+            unsigned int i;
+            if (dev->isI2C)
+            {
+                // start a new transaction if this run won't fit
+                if (batch.len + 6 + ((end - start + 1) * 4)
+                    > LCM1602_BATCH_MAX)
+                {
+                    if (batch_send(dev, &batch))
+                        rv = UPM_ERROR_OPERATION_FAILED;
+                    batch_init(&batch);
+                }
+
+                batch_add(dev, &batch, HD44780_CMD | addr, 0);
+                for (i = start; i <= end; i++)
+                    batch_add(dev, &batch, shadow[i], HD44780_RS);
+            }
+            else
+            {
+                if (send(dev, HD44780_CMD | addr, 0))
+                    rv = UPM_ERROR_OPERATION_FAILED;
+                for (i = start; i <= end; i++)
+                    if (send(dev, shadow[i], HD44780_RS))
+                        rv = UPM_ERROR_OPERATION_FAILED;
+            }
+
+            memcpy(glass + start, shadow + start, end - start + 1);
+            col = end + 1;
+        }
+    }
+
+    if (restoreEntry)
+    {
+        uint8_t cmd = HD44780_ENTRYMODESET | dev->entryDisplayMode;
+
+        if (dev->isI2C)
+        {
+            if (batch.len + 6 > LCM1602_BATCH_MAX)
+            {
+                if (batch_send(dev, &batch))
+                    rv = UPM_ERROR_OPERATION_FAILED;
+                batch_init(&batch);
+            }
+            batch_add(dev, &batch, cmd, 0);
+        }
+        else if (send(dev, cmd, 0))
+            rv = UPM_ERROR_OPERATION_FAILED;
+    }
+
+    if (dev->isI2C && batch_send(dev, &batch))
+        rv = UPM_ERROR_OPERATION_FAILED;
+
+    // if anything failed, we can't trust what we think is displayed
+    dev->glassValid = (rv == UPM_SUCCESS);
+
+    return rv;
+}
+
 
 // static declarations
 static upm_result_t send(const lcm1602_context dev, uint8_t value,
@@ -638,3 +956,116 @@ static upm_result_t pulseEnable(const lcm1602_context dev,
 
     return rv;
 }
+
+static uint8_t ddram_address(const lcm1602_context dev, unsigned int row,
+                             unsigned int column)
+{
+    assert(dev != NULL);
+
+    column = column % dev->columns;
+    uint8_t offset = column;
+
+    switch (dev->rows)
+    {
+    case 1:
+        // Single row displays with more than 8 columns usually have their
+        // DDRAM split in two halves. The first half starts at address 00.
+        // The second half starts at address 40. E.g. 16x2 DDRAM mapping:
+        // 00 01 02 03 04 05 06 07 40 41 42 43 44 45 46 47
+        if (dev->columns > 8)
+        {
+            offset = (column % (dev->columns / 2)) +
+                (column / (dev->columns / 2)) * 0x40;
+        }
+        break;
+
+    case 2:
+        // this should work for any display with two rows
+        // DDRAM mapping:
+        // 00 .. 27
+        // 40 .. 67
+        offset += row * 0x40;
+        break;
+
+    case 4:
+        if (dev->columns == 16)
+        {
+            // 16x4 display
+            // DDRAM mapping:
+            // 00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F
+            // 40 41 42 43 43 45 46 47 48 49 4A 4B 4C 4D 4E 4F
+            // 10 11 12 13 14 15 16 17 18 19 1A 1B 1C 1D 1E 1F
+            // 50 51 52 53 54 55 56 57 58 59 5A 5B 5C 5D 5E 5F
+            int row_addr[] = { 0x00, 0x40, 0x10, 0x50 };
+            offset += row_addr[row];
+        }
+        else
+        {
+            // 20x4 display
+            // DDRAM mapping:
+            // 00 01 02 03 04 05 06 07 08 09 0A 0B 0C 0D 0E 0F 10 11 12 13
+            // 40 41 42 43 43 45 46 47 48 49 4A 4B 4C 4D 4E 4F 50 51 52 53
+            // 14 15 16 17 18 19 1A 1B 1C 1D 1E 1F 20 21 22 23 24 25 26 27
+            // 54 55 56 57 58 59 5A 5B 5C 5D 5E 5F 60 61 62 63 64 65 66 67
+            int row_addr[] = { 0x00, 0x40, 0x14, 0x54 };
+            offset += row_addr[row];
+        }
+        break;
+    }
+
+    return offset;
+}
+
+static void batch_init(lcm1602_batch_t *batch)
+{
+    batch->len = 0;
+    batch->mode = -1;
+}
+
+// Add the expander writes that clock one byte into the controller.
+// Each nibble is latched by raising and lowering EN.  RS and the data
+// lines only need to be set up ahead of EN when RS changes, after
+// that the data can change along with the rising edge, since it is
+// latched on the falling edge.
+//
+// No delays are needed between nibbles: at 400kHz each expander byte
+// takes over 20us on the bus, so consecutive bytes are latched well
+// over the 37us the controller needs to execute each one.  The slow
+// clear and home commands are never batched.
+static void batch_add(const lcm1602_context dev, lcm1602_batch_t *batch,
+                      uint8_t value, int mode)
+{
+    uint8_t nibbles[2] = { value & 0xf0, (value << 4) & 0xf0 };
+    int i;
+
+    assert(batch->len + 5 <= LCM1602_BATCH_MAX);
+
+    for (i = 0; i < 2; i++)
+    {
+        uint8_t out = nibbles[i] | mode | dev->backlight;
+
+        if (batch->mode != mode)
+        {
+            batch->buf[batch->len++] = out;
+            batch->mode = mode;
+        }
+
+        batch->buf[batch->len++] = out | HD44780_EN;
+        batch->buf[batch->len++] = out;
+    }
+}
+
+static upm_result_t batch_send(const lcm1602_context dev,
+                               lcm1602_batch_t *batch)
+{
+    if (!batch->len)
+        return UPM_SUCCESS;
+
+    if (mraa_i2c_write(dev->i2c, batch->buf, batch->len))
+    {
+        printf("%s: mraa_i2c_write() failed\n", __FUNCTION__);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+
+    return UPM_SUCCESS;
+}
@@ -161,6 +161,46 @@ upm_result_t Lcm1602::autoscrollOff()
     return lcm1602_autoscroll_on(m_lcm1602, false);
 }
 
+unsigned int Lcm1602::getCharSlot(std::vector<uint8_t> charData)
+{
+    if (charData.size() != 8)
+        throw std::invalid_argument(std::string(__FUNCTION__) +
+                                    ": charData must contain 8 bytes");
+
+    unsigned int slot;
+    if (lcm1602_get_char_slot(m_lcm1602, (char *)charData.data(), &slot))
+        throw std::runtime_error(std::string(__FUNCTION__) +
+                                 ": lcm1602_get_char_slot() failed");
+
+    return slot;
+}
+
+upm_result_t Lcm1602::shadowEnable(bool enable)
+{
+    return lcm1602_shadow_enable(m_lcm1602, enable);
+}
+
+upm_result_t Lcm1602::shadowWrite(int row, int column, std::string msg)
+{
+    return lcm1602_shadow_write(m_lcm1602, row, column, msg.data(),
+                                msg.size());
+}
+
+upm_result_t Lcm1602::shadowClear()
+{
+    return lcm1602_shadow_clear(m_lcm1602);
+}
+
+void Lcm1602::shadowInvalidate()
+{
+    lcm1602_shadow_invalidate(m_lcm1602);
+}
+
+upm_result_t Lcm1602::flush()
+{
+    return lcm1602_flush(m_lcm1602);
+}
+
 upm_result_t Lcm1602::command(uint8_t cmd)
 {
     return lcm1602_command(m_lcm1602, cmd);
@@ -79,6 +79,20 @@ extern "C" {
         uint8_t                  displayControl;
         uint8_t                  entryDisplayMode;
         uint8_t                  backlight;
+
+        // shadow buffer mode.  shadow holds the contents we want on
+        // the display, glass what we last wrote to it.  If glassValid
+        // is false, we don't know what is on the display.
+        char                     *shadow;
+        char                     *glass;
+        bool                     glassValid;
+
+        // CGRAM cache.  cgramValid is a bitmask of the slots whose
+        // contents we know, cgramLastUse an LRU stamp for each slot.
+        uint8_t                  cgram[8][8];
+        uint8_t                  cgramValid;
+        uint32_t                 cgramLastUse[8];
+        uint32_t                 cgramClock;
     } *lcm1602_context;
 
     /**
@@ -167,7 +181,9 @@ extern "C" {
     upm_result_t lcm1602_home(const lcm1602_context dev);
 
     /**
-     * Create a custom character.
+     * Create a custom character.  The contents of each slot are
+     * cached, so rewriting a slot with the data it already holds
+     * does not touch the display.
      *
      * @param dev The device context.
      * @param slot The character slot to write, only 8 are available.
@@ -178,6 +194,23 @@ extern "C" {
                                      unsigned int slot,
                                      char *data);
 
+    /**
+     * Find or allocate a custom character slot holding a glyph.  If a
+     * slot already holds the glyph, it is returned without touching
+     * the display.  Otherwise the least recently used slot is loaded
+     * with it, preferring slots that are not in use in the shadow
+     * buffer.  Note that reloading a slot changes every character on
+     * the display using that slot.
+     *
+     * @param dev The device context.
+     * @param data The character data (8 bytes) making up the character.
+     * @param slot A pointer in which the slot (0-7) is returned.  Write
+     * this value as a character to display the glyph.
+     * @return UPM result.
+     */
+    upm_result_t lcm1602_get_char_slot(const lcm1602_context dev,
+                                       char *data, unsigned int *slot);
+
     /**
      * Turn the display on.
      *
@@ -272,6 +305,68 @@ extern "C" {
      */
     upm_result_t lcm1602_data(const lcm1602_context dev, uint8_t data);
 
+    /**
+     * Enable or disable shadow buffer mode.  In this mode the
+     * lcm1602_shadow_*() functions draw into a buffer in memory, and
+     * lcm1602_flush() then updates only the characters that differ
+     * from what is on the display.  When using an I2C expander, all of
+     * the updates are sent in as few I2C transactions as possible.
+     *
+     * The shadow buffer is initially filled with spaces, and the
+     * display contents are considered unknown, so the first flush
+     * writes every character.
+     *
+     * @param dev The device context.
+     * @param enable true to enable shadow buffer mode, false to
+     * disable it and free the buffers.
+     * @return UPM result.
+     */
+    upm_result_t lcm1602_shadow_enable(const lcm1602_context dev,
+                                       bool enable);
+
+    /**
+     * Write characters into the shadow buffer.  Characters past the
+     * end of the row are discarded.
+     *
+     * @param dev The device context.
+     * @param row The row to write to.
+     * @param column The column to start writing at.
+     * @param buffer The characters to write.
+     * @param len The number of characters to write.
+     * @return UPM result.
+     */
+    upm_result_t lcm1602_shadow_write(const lcm1602_context dev,
+                                      unsigned int row, unsigned int column,
+                                      const char *buffer, int len);
+
+    /**
+     * Fill the shadow buffer with spaces.
+     *
+     * @param dev The device context.
+     * @return UPM result.
+     */
+    upm_result_t lcm1602_shadow_clear(const lcm1602_context dev);
+
+    /**
+     * Mark the display contents as unknown, so that the next flush
+     * writes every character.  This is done automatically by
+     * functions that write to the display directly, such as
+     * lcm1602_write().
+     *
+     * @param dev The device context.
+     */
+    void lcm1602_shadow_invalidate(const lcm1602_context dev);
+
+    /**
+     * Update the display from the shadow buffer, writing only the
+     * characters that changed.  This leaves the cursor position
+     * undefined.
+     *
+     * @param dev The device context.
+     * @return UPM result.
+     */
+    upm_result_t lcm1602_flush(const lcm1602_context dev);
+
 
 #ifdef __cplusplus
 }
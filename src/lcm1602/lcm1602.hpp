@@ -249,6 +249,64 @@ namespace upm
          */
         upm_result_t autoscrollOff();
 
+        /**
+         * Find or allocate a custom character slot holding a glyph.
+         * If no slot holds it yet, the least recently used slot is
+         * loaded with it, preferring slots not in use in the shadow
+         * buffer.  Reloading a slot changes every character on the
+         * display using it.
+         *
+         * @param charData A vector containing 8 bytes making up the
+         * character
+         * @return The slot (0-7) holding the glyph
+         */
+        unsigned int getCharSlot(std::vector<uint8_t> charData);
+
+        /**
+         * Enable or disable shadow buffer mode.  In this mode,
+         * shadowWrite() draws into a buffer in memory, and flush()
+         * updates only the characters on the display that changed,
+         * batching the I2C expander writes into as few transactions
+         * as possible.
+         *
+         * @param enable true to enable shadow buffer mode, false to
+         * disable it
+         * @return Result of operation
+         */
+        upm_result_t shadowEnable(bool enable=true);
+
+        /**
+         * Write a string into the shadow buffer.  Characters past the
+         * end of the row are discarded.
+         *
+         * @param row The row to write to
+         * @param column The column to start writing at
+         * @param msg The string to write
+         * @return Result of operation
+         */
+        upm_result_t shadowWrite(int row, int column, std::string msg);
+
+        /**
+         * Fill the shadow buffer with spaces
+         *
+         * @return Result of operation
+         */
+        upm_result_t shadowClear();
+
+        /**
+         * Mark the display contents as unknown, so that the next
+         * flush() rewrites every character
+         */
+        void shadowInvalidate();
+
+        /**
+         * Update the display from the shadow buffer, writing only the
+         * characters that changed
+         *
+         * @return Result of operation
+         */
+        upm_result_t flush();
+
 
     protected:
         lcm1602_context m_lcm1602;
@@ -28,6 +28,8 @@
 #include <stdexcept>
 #include <unistd.h>
 #include <stdlib.h>
+#include <time.h>
+#include <errno.h>
 
 #include "lidarlitev3.hpp"
 
@@ -39,6 +41,26 @@ LIDARLITEV3::LIDARLITEV3 (int bus, int devAddr) : m_i2ControlCtx(bus) {
     m_controlAddr = devAddr;
     m_bus = bus;
 
+    m_gpioBusy = NULL;
+    m_sampling = false;
+    m_sampleMode = SAMPLE_TRIGGERED;
+    m_sampleCount = 0;
+    m_shotsTaken = 0;
+    m_refInterval = 1;
+    m_shotsSinceRef = 0;
+    m_savedAcqConfig = 0;
+    m_ringHead = 0;
+    m_ringCount = 0;
+    m_overwritten = 0;
+    m_errors = 0;
+
+    pthread_condattr_t condAttr;
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&m_ringLock, NULL);
+    pthread_cond_init(&m_ringCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+
     mraa::Result ret = m_i2ControlCtx.address(m_controlAddr);
     if (ret != mraa::SUCCESS) {
         throw std::invalid_argument(std::string(__FUNCTION__) +
@@ -46,6 +68,13 @@ LIDARLITEV3::LIDARLITEV3 (int bus, int devAddr) : m_i2ControlCtx(bus) {
     }
 }
 
+LIDARLITEV3::~LIDARLITEV3 () {
+    stopSampling();
+
+    pthread_cond_destroy(&m_ringCond);
+    pthread_mutex_destroy(&m_ringLock);
+}
+
 int
 LIDARLITEV3::getDistance () {
 
@@ -132,3 +161,245 @@ LIDARLITEV3::i2cWriteReg (uint8_t reg, uint8_t value) {
 
     return error;
 }
+
+void
+LIDARLITEV3::setReferenceInterval (int shots) {
+    pthread_mutex_lock(&m_ringLock);
+    m_refInterval = (shots < 1) ? 1 : shots;
+    m_shotsSinceRef = 0;
+    pthread_mutex_unlock(&m_ringLock);
+}
+
+void
+LIDARLITEV3::busyISR (void *ctx) {
+    LIDARLITEV3 *This = (LIDARLITEV3 *)ctx;
+    uint8_t buf[2];
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    // FULL_DELAY_HIGH with the auto-increment bit, both bytes in one
+    // transfer.  No throwing helpers in here.
+    bool ok = (This->m_i2ControlCtx.writeByte(0x80 | FULL_DELAY_HIGH)
+               == mraa::SUCCESS &&
+               This->m_i2ControlCtx.read(buf, 2) == 2);
+
+    pthread_mutex_lock(&This->m_ringLock);
+
+    if (!This->m_sampling) {
+        pthread_mutex_unlock(&This->m_ringLock);
+        return;
+    }
+
+    if (ok) {
+        int size = This->m_ring.size();
+        int idx = (This->m_ringHead + This->m_ringCount) % size;
+
+        This->m_ring[idx].distance = (buf[0] << 8) | buf[1];
+        This->m_ring[idx].timestamp =
+            (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+        if (This->m_ringCount < size) {
+            This->m_ringCount++;
+        } else {
+            // full, drop the oldest
+            This->m_ringHead = (This->m_ringHead + 1) % size;
+            This->m_overwritten++;
+        }
+
+        pthread_cond_signal(&This->m_ringCond);
+    } else {
+        This->m_errors++;
+    }
+
+    This->m_shotsTaken++;
+
+    bool more = (This->m_sampleCount == 0 ||
+                 This->m_shotsTaken < This->m_sampleCount);
+    uint8_t cmd = ACQ_MEASURE_NO_BIAS;
+
+    if (!more) {
+        This->m_sampling = false;
+    } else if (This->m_sampleMode == SAMPLE_TRIGGERED &&
+               ++This->m_shotsSinceRef >= This->m_refInterval) {
+        cmd = ACQ_MEASURE_BIAS;
+        This->m_shotsSinceRef = 0;
+    }
+
+    bool retrigger = more && This->m_sampleMode == SAMPLE_TRIGGERED;
+
+    pthread_mutex_unlock(&This->m_ringLock);
+
+    if (retrigger) {
+        uint8_t data[2] = { ACQ_COMMAND, cmd };
+        if (This->m_i2ControlCtx.write(data, 2) != mraa::SUCCESS) {
+            pthread_mutex_lock(&This->m_ringLock);
+            This->m_errors++;
+            pthread_mutex_unlock(&This->m_ringLock);
+        }
+    }
+}
+
+void
+LIDARLITEV3::startSampling (int busyPin, SAMPLE_MODE_T mode, int count,
+                            uint8_t measureDelay, int ringSize) {
+    if (ringSize < 1)
+        throw std::out_of_range(std::string(__FUNCTION__) +
+                                ": ringSize must be at least 1");
+
+    if (count < 0 || (mode == SAMPLE_BURST && (count == 1 || count > 254)))
+        throw std::out_of_range(std::string(__FUNCTION__) +
+                                ": invalid count");
+
+    stopSampling();
+
+    m_savedAcqConfig = i2cReadReg_8(ACQ_CONFIG_REG);
+
+    uint8_t config = m_savedAcqConfig &
+        ~(ACQ_CONFIG_MODE_MASK | ACQ_CONFIG_MEASURE_DELAY);
+    config |= ACQ_CONFIG_MODE_STATUS;
+
+    if (mode == SAMPLE_BURST) {
+        i2cWriteReg(OUTER_LOOP_COUNT, (count) ? count : OUTER_LOOP_FOREVER);
+
+        if (measureDelay) {
+            i2cWriteReg(MEASURE_DELAY, measureDelay);
+            config |= ACQ_CONFIG_MEASURE_DELAY;
+        }
+    } else {
+        i2cWriteReg(OUTER_LOOP_COUNT, 0x01);
+    }
+
+    i2cWriteReg(ACQ_CONFIG_REG, config);
+
+    pthread_mutex_lock(&m_ringLock);
+    m_ring.resize(ringSize);
+    m_ringHead = 0;
+    m_ringCount = 0;
+    m_overwritten = 0;
+    m_errors = 0;
+    m_sampleMode = mode;
+    m_sampleCount = count;
+    m_shotsTaken = 0;
+    m_shotsSinceRef = 0;
+    m_sampling = true;
+    pthread_mutex_unlock(&m_ringLock);
+
+    m_gpioBusy = new mraa::Gpio(busyPin);
+    m_gpioBusy->dir(mraa::DIR_IN);
+
+    // the busy output drops when a measurement completes
+    if (m_gpioBusy->isr(mraa::EDGE_FALLING, busyISR, this) != mraa::SUCCESS) {
+        stopSampling();
+        throw std::runtime_error(std::string(__FUNCTION__) +
+                                 ": Gpio.isr() failed");
+    }
+
+    // the first shot always does a full acquisition
+    i2cWriteReg(ACQ_COMMAND, ACQ_MEASURE_BIAS);
+}
+
+void
+LIDARLITEV3::stopSampling () {
+    pthread_mutex_lock(&m_ringLock);
+    bool wasRunning = (m_gpioBusy != NULL);
+    m_sampling = false;
+    pthread_mutex_unlock(&m_ringLock);
+
+    if (!wasRunning)
+        return;
+
+    m_gpioBusy->isrExit();
+    delete m_gpioBusy;
+    m_gpioBusy = NULL;
+
+    // end any free running burst and give the mode pin back
+    uint8_t loop[2] = { OUTER_LOOP_COUNT, 0x01 };
+    uint8_t config[2] = { ACQ_CONFIG_REG, m_savedAcqConfig };
+    m_i2ControlCtx.write(loop, 2);
+    m_i2ControlCtx.write(config, 2);
+}
+
+bool
+LIDARLITEV3::getSample (SAMPLE_T *sample, int timeoutMs) {
+    if (!sample)
+        throw std::invalid_argument(std::string(__FUNCTION__) +
+                                    ": sample must not be NULL");
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    if (timeoutMs > 0) {
+        deadline.tv_sec += timeoutMs / 1000;
+        deadline.tv_nsec += (timeoutMs % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&m_ringLock);
+
+    while (m_ringCount == 0) {
+        if (timeoutMs == 0) {
+            pthread_mutex_unlock(&m_ringLock);
+            return false;
+        }
+
+        if (timeoutMs < 0) {
+            pthread_cond_wait(&m_ringCond, &m_ringLock);
+        } else if (pthread_cond_timedwait(&m_ringCond, &m_ringLock, &deadline)
+                   == ETIMEDOUT && m_ringCount == 0) {
+            pthread_mutex_unlock(&m_ringLock);
+            return false;
+        }
+    }
+
+    *sample = m_ring[m_ringHead];
+    m_ringHead = (m_ringHead + 1) % m_ring.size();
+    m_ringCount--;
+
+    pthread_mutex_unlock(&m_ringLock);
+
+    return true;
+}
+
+bool
+LIDARLITEV3::getLatestSample (SAMPLE_T *sample) {
+    if (!sample)
+        throw std::invalid_argument(std::string(__FUNCTION__) +
+                                    ": sample must not be NULL");
+
+    pthread_mutex_lock(&m_ringLock);
+
+    if (m_ringCount == 0) {
+        pthread_mutex_unlock(&m_ringLock);
+        return false;
+    }
+
+    *sample = m_ring[(m_ringHead + m_ringCount - 1) % m_ring.size()];
+    m_ringHead = 0;
+    m_ringCount = 0;
+
+    pthread_mutex_unlock(&m_ringLock);
+
+    return true;
+}
+
+int
+LIDARLITEV3::samplesAvailable () {
+    pthread_mutex_lock(&m_ringLock);
+    int count = m_ringCount;
+    pthread_mutex_unlock(&m_ringLock);
+
+    return count;
+}
+
+void
+LIDARLITEV3::getSampleStats (uint32_t *overwritten, uint32_t *errors) {
+    pthread_mutex_lock(&m_ringLock);
+    if (overwritten)
+        *overwritten = m_overwritten;
+    if (errors)
+        *errors = m_errors;
+    pthread_mutex_unlock(&m_ringLock);
+}
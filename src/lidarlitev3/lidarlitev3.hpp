@@ -25,7 +25,10 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <pthread.h>
 #include <mraa/i2c.hpp>
+#include <mraa/gpio.hpp>
 
 #define ADDR                  0x62 // device address
 
@@ -62,6 +65,21 @@
 #define HIGH               1
 #define LOW                0
 
+// ACQ_COMMAND values
+#define ACQ_MEASURE_NO_BIAS   0x03 // Measure without receiver bias correction
+#define ACQ_MEASURE_BIAS      0x04 // Measure with receiver bias correction
+
+// ACQ_CONFIG_REG bits
+#define ACQ_CONFIG_MODE_MASK      0x03 // Mode pin function
+#define ACQ_CONFIG_MODE_STATUS    0x01 // Mode pin is the busy output
+#define ACQ_CONFIG_MEASURE_DELAY  0x20 // Use MEASURE_DELAY for bursts
+
+// OUTER_LOOP_COUNT value for free running measurements
+#define OUTER_LOOP_FOREVER    0xFF
+
+// default sample ring size
+#define LIDARLITEV3_RING_SIZE 256
+
 namespace upm {
 
 /**
@@ -89,6 +107,26 @@ namespace upm {
  */
 class LIDARLITEV3 {
     public:
+        /**
+         * How measurements are paced while sampling
+         */
+        typedef enum {
+            // each completion immediately triggers the next shot
+            SAMPLE_TRIGGERED = 0,
+            // the device repeats on its own using OUTER_LOOP_COUNT
+            // and MEASURE_DELAY
+            SAMPLE_BURST
+        } SAMPLE_MODE_T;
+
+        /**
+         * A distance sample with the CLOCK_MONOTONIC time, in
+         * microseconds, at which its busy interrupt was seen
+         */
+        typedef struct {
+            uint16_t distance;
+            uint64_t timestamp;
+        } SAMPLE_T;
+
         /**
          * Instantiates an LIDARLITEV3 object
          *
@@ -98,12 +136,11 @@ class LIDARLITEV3 {
         LIDARLITEV3 (int bus, int devAddr=ADDR);
 
         /**
-         * LIDARLITEV3 object destructor; basically, it closes the I2C connection.
-         *
-         *~LIDARLITEV3 ();
-         * no need for the destructor - the I2c connection will be closed when
-         * m_i2ControlCtx variable will be out of context
-         **/
+         * LIDARLITEV3 object destructor.  Stops background sampling.
+         * The I2c connection is closed when m_i2ControlCtx goes out of
+         * scope.
+         */
+        ~LIDARLITEV3 ();
 
         /**
          * Returns distance measurement on success
@@ -151,12 +188,110 @@ class LIDARLITEV3 {
          */
         mraa::Result i2cWriteReg (uint8_t reg, uint8_t value);
 
+        /**
+         * Set how often a triggered shot performs a full acquisition
+         * with receiver bias correction.  The shots in between skip
+         * the reference acquisition, which makes them considerably
+         * faster.  The manual suggests a full acquisition every 100
+         * measurements.  This only applies to SAMPLE_TRIGGERED.
+         *
+         * @param shots Perform a full acquisition every shots
+         * measurements.  0 or 1 performs one every shot.
+         */
+        void setReferenceInterval(int shots);
+
+        /**
+         * Start sampling in the background.  The mode pin is switched
+         * to its busy output function, and its falling edge (end of
+         * measurement) is handled on a GPIO interrupt: the distance
+         * is read in one burst and added, timestamped, to a ring.
+         * When the ring is full, the oldest sample is overwritten.
+         * Do not call getDistance() or read() while sampling.
+         *
+         * @param busyPin GPIO connected to the device's mode pin
+         * @param mode One of the SAMPLE_MODE_T values
+         * @param count The number of measurements to take, or 0 to
+         * keep measuring until stopSampling() is called.  In
+         * SAMPLE_BURST mode, this must be 0 or between 2 and 254.
+         * @param measureDelay For SAMPLE_BURST, the MEASURE_DELAY
+         * value between measurements, or 0 to use the device default
+         * (about 10Hz).  Smaller values are faster.
+         * @param ringSize The number of samples kept
+         * @throws std::out_of_range on bad parameters
+         * @throws std::runtime_error on GPIO or I2C errors
+         */
+        void startSampling(int busyPin, SAMPLE_MODE_T mode = SAMPLE_TRIGGERED,
+                           int count = 0, uint8_t measureDelay = 0,
+                           int ringSize = LIDARLITEV3_RING_SIZE);
+
+        /**
+         * Stop background sampling.  Samples still in the ring can
+         * be retrieved.
+         */
+        void stopSampling();
+
+        /**
+         * Retrieve the oldest sample in the ring.
+         *
+         * @param sample Pointer to a SAMPLE_T to fill in
+         * @param timeoutMs Milliseconds to wait for a sample.  0
+         * returns immediately, a negative value waits forever.
+         * @return true if a sample was returned, false on timeout
+         */
+        bool getSample(SAMPLE_T *sample, int timeoutMs = 0);
+
+        /**
+         * Retrieve the newest sample and empty the ring.
+         *
+         * @param sample Pointer to a SAMPLE_T to fill in
+         * @return true if a sample was returned, false if the ring
+         * was empty
+         */
+        bool getLatestSample(SAMPLE_T *sample);
+
+        /**
+         * Return the number of samples waiting in the ring
+         *
+         * @return the number of samples
+         */
+        int samplesAvailable();
+
+        /**
+         * Return the number of samples overwritten before they were
+         * retrieved, and the number of interrupts whose distance
+         * couldn't be read.
+         *
+         * @param overwritten Samples lost to a full ring
+         * @param errors Failed reads or re-triggers
+         */
+        void getSampleStats(uint32_t *overwritten, uint32_t *errors);
+
     private:
         std::string m_name;
 
         int m_controlAddr;
         int m_bus;
         mraa::I2c m_i2ControlCtx;
+
+        // background sampling
+        static void busyISR(void *ctx);
+
+        mraa::Gpio *m_gpioBusy;
+        bool m_sampling;
+        SAMPLE_MODE_T m_sampleMode;
+        int m_sampleCount;
+        int m_shotsTaken;
+        int m_refInterval;
+        int m_shotsSinceRef;
+        uint8_t m_savedAcqConfig;
+
+        std::vector<SAMPLE_T> m_ring;
+        int m_ringHead;
+        int m_ringCount;
+        uint32_t m_overwritten;
+        uint32_t m_errors;
+        pthread_mutex_t m_ringLock;
+        pthread_cond_t m_ringCond;
 };
 
 }
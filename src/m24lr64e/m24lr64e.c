@@ -32,6 +32,9 @@
  * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "m24lr64e.h"
 #include "upm_utilities.h"
 
@@ -47,6 +50,10 @@ upm_result_t m24lr64e_eeprom_write_byte(m24lr64e_context dev,
 upm_result_t m24lr64e_eeprom_write_bytes(m24lr64e_context dev,
                                          uint32_t address,
                                          uint8_t* data, int len);
+upm_result_t m24lr64e_eeprom_write_pages(m24lr64e_context dev,
+                                         uint32_t address,
+                                         const uint8_t* data, int len,
+                                         bool skip_unchanged);
 
 m24lr64e_context m24lr64e_init(int bus, m24lr64e_access_mode mode){
     // make sure MRAA is initialized
@@ -233,12 +240,50 @@ upm_result_t m24lr64e_get_memory_size(m24lr64e_context dev,
 }
 
 upm_result_t m24lr64e_clear_memory(m24lr64e_context dev){
-    int i=0;
-    for(i = 0; i < M24LR64E_EEPROM_I2C_LENGTH; i++){
-        // call to write byte function
-        m24lr64e_write_byte(dev, i, 0x0);
+    return m24lr64e_fill(dev, 0, 0x0, M24LR64E_EEPROM_I2C_LENGTH);
+}
+
+upm_result_t m24lr64e_write_block(m24lr64e_context dev, uint32_t address,
+                                  const uint8_t* buffer, int len){
+    return m24lr64e_eeprom_write_pages(dev, address, buffer, len, true);
+}
+
+upm_result_t m24lr64e_fill(m24lr64e_context dev, uint32_t address,
+                           uint8_t value, int len){
+    if (len <= 0)
+        return UPM_SUCCESS;
+
+    uint8_t *buf = (uint8_t *)malloc(len);
+    if (!buf){
+        printf("%s: malloc() failed.\n", __FUNCTION__);
+        return UPM_ERROR_NO_RESOURCES;
     }
-    return UPM_SUCCESS;
+
+    memset(buf, value, len);
+    upm_result_t rv = m24lr64e_eeprom_write_pages(dev, address, buf, len,
+                                                  true);
+    free(buf);
+    return rv;
+}
+
+upm_result_t m24lr64e_copy(m24lr64e_context dev, uint32_t dst, uint32_t src,
+                           int len){
+    if (len <= 0 || dst == src)
+        return UPM_SUCCESS;
+
+    // read the whole source first, so overlapping regions work
+    uint8_t *buf = (uint8_t *)malloc(len);
+    if (!buf){
+        printf("%s: malloc() failed.\n", __FUNCTION__);
+        return UPM_ERROR_NO_RESOURCES;
+    }
+
+    upm_result_t rv = m24lr64e_eeprom_read_bytes(dev, src, buf, len);
+    if (rv == UPM_SUCCESS)
+        rv = m24lr64e_eeprom_write_pages(dev, dst, buf, len, true);
+
+    free(buf);
+    return rv;
 }
 
 upm_result_t m24lr64e_write_byte(m24lr64e_context dev, uint32_t address,
@@ -249,8 +294,8 @@ upm_result_t m24lr64e_write_byte(m24lr64e_context dev, uint32_t address,
 
 upm_result_t m24lr64e_write_bytes(m24lr64e_context dev,
                                   uint32_t address, uint8_t* buffer, int len){
-    // call to EEPROM write bytes
-    return m24lr64e_eeprom_write_bytes(dev, address, buffer, len);
+    // call to EEPROM write pages
+    return m24lr64e_eeprom_write_pages(dev, address, buffer, len, false);
 }
 
 upm_result_t m24lr64e_read_byte(m24lr64e_context dev, uint32_t address,
@@ -262,7 +307,24 @@ upm_result_t m24lr64e_read_byte(m24lr64e_context dev, uint32_t address,
 upm_result_t m24lr64e_read_bytes(m24lr64e_context dev, uint32_t address,
                                  uint8_t* buffer, int len){
     // call to EEPROM read bytes
-    return m24lr64e_eeprom_write_bytes(dev, address, buffer, len);
+    return m24lr64e_eeprom_read_bytes(dev, address, buffer, len);
+}
+
+// The device does not acknowledge its address while an internal write
+// cycle is in progress, so poll it with a 1 byte read until it does.
+static upm_result_t m24lr64e_wait_write(m24lr64e_context dev){
+    upm_clock_t clock;
+    upm_clock_init(&clock);
+
+    uint8_t byte;
+    while (mraa_i2c_read(dev->i2c, &byte, 1) != 1){
+        if (upm_elapsed_ms(&clock) > M24LR64E_WRITE_TIMEOUT){
+            printf("%s: timed out waiting for write cycle.\n", __FUNCTION__);
+            return UPM_ERROR_TIMED_OUT;
+        }
+        upm_delay_us(100);
+    }
+    return UPM_SUCCESS;
 }
 
 upm_result_t m24lr64e_eeprom_write_byte(m24lr64e_context dev, uint32_t address,
@@ -277,8 +339,7 @@ upm_result_t m24lr64e_eeprom_write_byte(m24lr64e_context dev, uint32_t address,
         return UPM_ERROR_OPERATION_FAILED;
     }
 
-    upm_delay_us(M24LR64E_I2C_WRITE_TIME*1000);
-    return UPM_SUCCESS;
+    return m24lr64e_wait_write(dev);
 }
 
 upm_result_t m24lr64e_eeprom_write_bytes(m24lr64e_context dev,
@@ -297,7 +358,57 @@ upm_result_t m24lr64e_eeprom_write_bytes(m24lr64e_context dev,
     if (mraa_i2c_write(dev->i2c, buf, pkt_len) != MRAA_SUCCESS){
         return UPM_ERROR_OPERATION_FAILED;
     }
-    upm_delay_us(M24LR64E_I2C_WRITE_TIME*1000);
+    return m24lr64e_wait_write(dev);
+}
+
+upm_result_t m24lr64e_eeprom_write_pages(m24lr64e_context dev,
+                                         uint32_t address,
+                                         const uint8_t* data, int len,
+                                         bool skip_unchanged){
+    if (len <= 0)
+        return UPM_SUCCESS;
+
+    uint8_t *current = NULL;
+    upm_result_t rv;
+
+    // read the current contents in one go, to find the pages that
+    // need no writing
+    if (skip_unchanged){
+        if (!(current = (uint8_t *)malloc(len))){
+            printf("%s: malloc() failed.\n", __FUNCTION__);
+            return UPM_ERROR_NO_RESOURCES;
+        }
+
+        if ((rv = m24lr64e_eeprom_read_bytes(dev, address, current, len))
+            != UPM_SUCCESS){
+            free(current);
+            return rv;
+        }
+    }
+
+    int offset = 0;
+    while (offset < len){
+        // don't cross a page boundary, the device would wrap around
+        // within the page
+        uint32_t addr = address + offset;
+        int chunk = M24LR64E_PAGE_SIZE - (addr % M24LR64E_PAGE_SIZE);
+        if (chunk > len - offset)
+            chunk = len - offset;
+
+        if (!current || memcmp(current + offset, data + offset, chunk)){
+            rv = m24lr64e_eeprom_write_bytes(dev, addr,
+                                             (uint8_t *)data + offset,
+                                             chunk);
+            if (rv != UPM_SUCCESS){
+                free(current);
+                return rv;
+            }
+        }
+
+        offset += chunk;
+    }
+
+    free(current);
     return UPM_SUCCESS;
 }
 
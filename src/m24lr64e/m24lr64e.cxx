@@ -26,6 +26,11 @@
 #include <math.h>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+
+#include "upm_utilities.h"
 
 #include "m24lr64e.hpp"
 
@@ -184,9 +189,33 @@ uint32_t M24LR64E::getMemorySize()
 
 void M24LR64E::clearMemory()
 {
-  for(int i = 0; i < EEPROM_I2C_LENGTH; i++){
-    writeByte(i,0x0);
-  }
+  fill(0, 0x0, EEPROM_I2C_LENGTH);
+}
+
+void M24LR64E::writeBlock(unsigned int address, const uint8_t* buffer,
+                          int len)
+{
+  EEPROM_Write_Pages(address, buffer, len, true);
+}
+
+void M24LR64E::fill(unsigned int address, uint8_t value, int len)
+{
+  if (len <= 0)
+    return;
+
+  std::vector<uint8_t> buf(len, value);
+  EEPROM_Write_Pages(address, buf.data(), len, true);
+}
+
+void M24LR64E::copy(unsigned int dst, unsigned int src, int len)
+{
+  if (len <= 0 || dst == src)
+    return;
+
+  // read the whole source first, so overlapping regions work
+  std::vector<uint8_t> buf(len);
+  EEPROM_Read_Bytes(src, buf.data(), len);
+  EEPROM_Write_Pages(dst, buf.data(), len, true);
 }
 
 mraa::Result M24LR64E::writeByte(unsigned int address, uint8_t data)
@@ -196,7 +225,7 @@ mraa::Result M24LR64E::writeByte(unsigned int address, uint8_t data)
 
 mraa::Result M24LR64E::writeBytes(unsigned int address, uint8_t* buffer, int len)
 {
-  return EEPROM_Write_Bytes(address, buffer, len);
+  return EEPROM_Write_Pages(address, buffer, len, false);
 }
 
 uint8_t M24LR64E::readByte(unsigned int address)
@@ -223,7 +252,7 @@ mraa::Result M24LR64E::EEPROM_Write_Byte(unsigned int address, uint8_t data)
     throw std::runtime_error(std::string(__FUNCTION__) +
                              ": I2c.write() failed");
 
-  usleep(I2C_WRITE_TIME * 1000);
+  EEPROM_Wait_Write();
   return rv;
 }
 
@@ -244,11 +273,65 @@ mraa::Result M24LR64E::EEPROM_Write_Bytes(unsigned int address, uint8_t* data,
     throw std::runtime_error(std::string(__FUNCTION__) +
                              ": I2c.write() failed");
 
-  usleep(I2C_WRITE_TIME * 1000);
+  EEPROM_Wait_Write();
 
   return rv;
 }
 
+mraa::Result M24LR64E::EEPROM_Write_Pages(unsigned int address,
+                                          const uint8_t* data, int len,
+                                          bool skipUnchanged)
+{
+  if (len <= 0)
+    return mraa::SUCCESS;
+
+  // read the current contents in one go, to find the pages that need
+  // no writing
+  std::vector<uint8_t> current;
+  if (skipUnchanged)
+    {
+      current.resize(len);
+      EEPROM_Read_Bytes(address, current.data(), len);
+    }
+
+  int offset = 0;
+  while (offset < len)
+    {
+      // don't cross a page boundary, the device would wrap around
+      // within the page
+      unsigned int addr = address + offset;
+      int chunk = PAGE_SIZE - (addr % PAGE_SIZE);
+      if (chunk > len - offset)
+        chunk = len - offset;
+
+      if (!skipUnchanged
+          || memcmp(current.data() + offset, data + offset, chunk))
+        EEPROM_Write_Bytes(addr, (uint8_t *)data + offset, chunk);
+
+      offset += chunk;
+    }
+
+  return mraa::SUCCESS;
+}
+
+void M24LR64E::EEPROM_Wait_Write()
+{
+  // The device does not acknowledge its address while an internal
+  // write cycle is in progress, so poll it with a 1 byte read until
+  // it does.
+  upm_clock_t clock;
+  upm_clock_init(&clock);
+
+  uint8_t byte;
+  while (m_i2c.read(&byte, 1) != 1)
+    {
+      if (upm_elapsed_ms(&clock) > WRITE_TIMEOUT)
+        throw std::runtime_error(std::string(__FUNCTION__) +
+                                 ": timed out waiting for write cycle");
+      upm_delay_us(100);
+    }
+}
+
 uint8_t M24LR64E::EEPROM_Read_Byte(unsigned int address)
 {
   const int apktLen = 2;
@@ -52,6 +52,11 @@
 #define M24LR64E_UID_LENGTH 8
 #define M24LR64E_I2C_WRITE_TIME 5
 
+// the device programs at most this many bytes per write cycle
+#define M24LR64E_PAGE_SIZE 4
+// give up ACK polling after this many ms
+#define M24LR64E_WRITE_TIMEOUT (M24LR64E_I2C_WRITE_TIME * 4)
+
 /**
  * @file m24lr64e.h
  * @library m24lr64e
@@ -221,12 +226,50 @@ upm_result_t m24lr64e_get_uid(m24lr64e_context dev, uint8_t* uid);
 upm_result_t m24lr64e_get_memory_size(m24lr64e_context dev, uint32_t* memory_size);
 
 /**
- * Sets all memory to 0, if permissions allow
+ * Sets all memory to 0, if permissions allow.  Pages that are
+ * already 0 are not rewritten.
  *
  * @param dev void pointer to sensor struct
  */
 upm_result_t m24lr64e_clear_memory(m24lr64e_context dev);
 
+/**
+ * Writes a block of data to the EEPROM.  The write is split on page
+ * boundaries, and pages that already hold the requested data are
+ * skipped.  The end of each write cycle is detected by ACK polling.
+ *
+ * @param dev void pointer to sensor struct
+ * @param address Address to write to
+ * @param buffer Data to write
+ * @param len Length of the data buffer
+ */
+upm_result_t m24lr64e_write_block(m24lr64e_context dev, uint32_t address,
+                                  const uint8_t* buffer, int len);
+
+/**
+ * Fills a region of the EEPROM with a value.  Pages that already
+ * hold the value are skipped.
+ *
+ * @param dev void pointer to sensor struct
+ * @param address Address to start at
+ * @param value Value to write
+ * @param len Number of bytes to fill
+ */
+upm_result_t m24lr64e_fill(m24lr64e_context dev, uint32_t address,
+                           uint8_t value, int len);
+
+/**
+ * Copies a region of the EEPROM to another address.  The regions
+ * may overlap.  Pages that already hold the data are skipped.
+ *
+ * @param dev void pointer to sensor struct
+ * @param dst Address to copy to
+ * @param src Address to copy from
+ * @param len Number of bytes to copy
+ */
+upm_result_t m24lr64e_copy(m24lr64e_context dev, uint32_t dst, uint32_t src,
+                           int len);
+
 /**
  * Writes a byte to the EEPROM
  *
@@ -238,7 +281,8 @@ upm_result_t m24lr64e_write_byte(m24lr64e_context dev, uint32_t address,
                                  uint8_t data);
 
 /**
- * Writes bytes to the EEPROM
+ * Writes bytes to the EEPROM.  The write is split on page
+ * boundaries.
  *
  * @param dev void pointer to sensor struct
  * @param address Address to write to
@@ -93,6 +93,10 @@ namespace upm {
     static const int UID_LENGTH                 = 8; // bytes
 
     static const unsigned int I2C_WRITE_TIME    = 5; // 5ms
+    // bytes programmed per write cycle
+    static const int PAGE_SIZE                  = 4;
+    // give up ACK polling after this many ms
+    static const unsigned int WRITE_TIMEOUT     = I2C_WRITE_TIME * 4;
 
     /**
      * M24LR64E addresses, accessible only in the root mode
@@ -232,10 +236,43 @@ namespace upm {
     uint32_t getMemorySize();
 
     /**
-     * Sets all memory to 0, if permissions allow
+     * Sets all memory to 0, if permissions allow.  Pages that are
+     * already 0 are not rewritten.
      */
     void clearMemory();
 
+    /**
+     * Writes a block of data to the EEPROM.  The write is split on
+     * page boundaries, and pages that already hold the requested
+     * data are skipped.  The end of each write cycle is detected by
+     * ACK polling.
+     *
+     * @param address Address to write to
+     * @param buffer Data to write
+     * @param len Length of the data buffer
+     */
+    void writeBlock(unsigned int address, const uint8_t* buffer, int len);
+
+    /**
+     * Fills a region of the EEPROM with a value.  Pages that already
+     * hold the value are skipped.
+     *
+     * @param address Address to start at
+     * @param value Value to write
+     * @param len Number of bytes to fill
+     */
+    void fill(unsigned int address, uint8_t value, int len);
+
+    /**
+     * Copies a region of the EEPROM to another address.  The regions
+     * may overlap.  Pages that already hold the data are skipped.
+     *
+     * @param dst Address to copy to
+     * @param src Address to copy from
+     * @param len Number of bytes to copy
+     */
+    void copy(unsigned int dst, unsigned int src, int len);
+
     /**
      * Writes a byte to the EEPROM
      *
@@ -245,7 +282,8 @@ namespace upm {
     mraa::Result writeByte(unsigned int address, uint8_t data);
 
     /**
-     * Writes bytes to the EEPROM
+     * Writes bytes to the EEPROM.  The write is split on page
+     * boundaries.
      *
      * @param address Address to write to
      * @param buffer Data to write
@@ -275,6 +313,9 @@ namespace upm {
     mraa::Result EEPROM_Write_Byte(unsigned int address, uint8_t data);
     mraa::Result EEPROM_Write_Bytes(unsigned int address, uint8_t* data,
                             int len);
+    mraa::Result EEPROM_Write_Pages(unsigned int address, const uint8_t* data,
+                                    int len, bool skipUnchanged);
+    void EEPROM_Wait_Write();
     uint8_t EEPROM_Read_Byte(unsigned int address);
     int EEPROM_Read_Bytes(unsigned int address, 
                                    uint8_t* buffer, int len);
@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <syslog.h>
 #include <math.h>
+#include <string.h>
 
 #include "max30100.h"
 #include "upm_utilities.h"
@@ -70,6 +71,14 @@ max30100_context* max30100_init(int16_t i2c_bus)
     /* Start without GPIO */
     dev->_gpio_context = NULL;
 
+    /* Start idle, with no handlers */
+    dev->sample_state = MAX30100_SAMPLE_STATE_IDLE;
+    dev->func_sample_ready = NULL;
+    dev->func_samples_ready = NULL;
+    dev->arg = NULL;
+    dev->func_vitals_ready = NULL;
+    dev->vitals_arg = NULL;
+
     return dev;
 
     /* Handle all failing cases here */
@@ -367,30 +376,87 @@ static upm_result_t _read_single_sample(const max30100_context* dev, max30100_va
     return UPM_SUCCESS;
 }
 
+/* Drain the FIFO with a single burst read.  The number of unread
+ * samples comes from the WR/RD pointers, or is a full FIFO if the
+ * overflow counter shows samples were lost.  Equal pointers mean
+ * either an empty or a full FIFO, a_full tells them apart. */
+static upm_result_t _read_fifo(const max30100_context* dev, max30100_value *samps,
+        int *count, bool a_full)
+{
+    uint8_t wr_ptr, rd_ptr, ovf;
+    uint8_t data[MAX30100_FIFO_DEPTH * 4];
+
+    *count = 0;
+
+    if (max30100_read(dev, MAX30100_REG_FIFO_WR_PTR, &wr_ptr) != UPM_SUCCESS ||
+        max30100_read(dev, MAX30100_REG_FIFO_OVF_COUNTER, &ovf) != UPM_SUCCESS ||
+        max30100_read(dev, MAX30100_REG_FIFO_RD_PTR, &rd_ptr) != UPM_SUCCESS)
+        return UPM_ERROR_OPERATION_FAILED;
+
+    int n = ovf ? MAX30100_FIFO_DEPTH : ((wr_ptr - rd_ptr) & (MAX30100_FIFO_DEPTH - 1));
+    if (n == 0 && a_full) n = MAX30100_FIFO_DEPTH;
+    if (n == 0) return UPM_SUCCESS;
+
+    /* The FIFO data register does not auto-increment, a burst read
+     * pops consecutive samples */
+    if (mraa_i2c_read_bytes_data(dev->_i2c_context, MAX30100_REG_FIFO_DATA,
+                data, n * 4) != n * 4)
+        return UPM_ERROR_OPERATION_FAILED;
+
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        samps[i].IR = ((uint16_t)data[i * 4] << 8) | data[i * 4 + 1];
+        samps[i].R = ((uint16_t)data[i * 4 + 2] << 8) | data[i * 4 + 3];
+    }
+
+    *count = n;
+
+    return UPM_SUCCESS;
+}
+
 static void _internal_sample_rdy(void *arg)
 {
     max30100_context* dev = arg;
+    uint8_t tmp;
 
     if (dev->sample_state == MAX30100_SAMPLE_STATE_IDLE) return;
 
-    int i = 15;
-    max30100_value samp = {0, 0};
-    /* If state is BUFFERED, read 16 samples, else read 1 sample */
-    do
+    if (dev->sample_state == MAX30100_SAMPLE_STATE_CONTINUOUS_BUFFERED)
     {
+        max30100_value samps[MAX30100_FIFO_DEPTH];
+        int count, i;
+
+        /* A FIFO full interrupt generated this, clear it by reading sts
+         * before draining, so a new one is not lost */
+        if(max30100_read(dev, MAX30100_REG_INTERRUPT_STATUS, &tmp) != UPM_SUCCESS)
+            goto max30100_sample_rdy_fail;
+
+        /* Read every sample in the FIFO in one burst */
+        if (_read_fifo(dev, samps, &count, tmp & MAX30100_A_FULL) != UPM_SUCCESS)
+            goto max30100_sample_rdy_fail;
+
+        // Call handler
+        if (dev->func_samples_ready != NULL)
+        {
+            if (count > 0)
+                dev->func_samples_ready(samps, count, dev->arg);
+        }
+        else
+        {
+            for (i = 0; i < count; i++)
+                dev->func_sample_ready(samps[i], dev->arg);
+        }
+    }
+    else
+    {
+        max30100_value samp = {0, 0};
         if (_read_single_sample(dev, &samp) != UPM_SUCCESS)
             goto max30100_sample_rdy_fail;
 
         // Call handler
         dev->func_sample_ready(samp, dev->arg);
-
-    } while ((i-- > 0) && (dev->sample_state == MAX30100_SAMPLE_STATE_CONTINUOUS_BUFFERED));
-
-    /* If a FIFO full interrupt generated this, clear it by reading sts */
-    uint8_t tmp;
-    if (dev->sample_state == MAX30100_SAMPLE_STATE_CONTINUOUS_BUFFERED)
-        if(max30100_read(dev, MAX30100_REG_INTERRUPT_STATUS, &tmp) != UPM_SUCCESS)
-            goto max30100_sample_rdy_fail;
+    }
 
     return;
 
@@ -410,6 +476,173 @@ static void _internal_sample_rdy(void *arg)
         return;
 }
 
+/* Heart-rate/SpO2 signal chain tuning */
+#define DSP_DC_CUTOFF_HZ    0.1f
+#define DSP_BAND_LOW_HZ     0.5f
+#define DSP_BAND_HIGH_HZ    4.0f
+#define DSP_MIN_BPM         30.0f
+#define DSP_MAX_BPM         240.0f
+#define DSP_BEAT_TIMEOUT_S  3.0f
+#define DSP_ENV_DECAY_S     2.0f
+#define DSP_PEAK_THRESHOLD  0.5f
+#define DSP_RATIO_SMOOTHING 0.25f
+
+static const float _sample_rate_hz[] = {50, 100, 167, 200, 400, 600, 900, 1000};
+
+static void _dsp_reset_channel(max30100_dsp_channel *ch)
+{
+    ch->x1 = ch->x2 = ch->y1 = ch->y2 = 0;
+    ch->ac_max = -HUGE_VALF;
+    ch->ac_min = HUGE_VALF;
+}
+
+static void _dsp_init(max30100_dsp_state *dsp, float fs, float report_hz)
+{
+    memset(dsp, 0, sizeof(*dsp));
+    dsp->fs = fs;
+
+    /* Single pole tracker for the DC level, well below the pulse band */
+    dsp->k_dc = 1.0f - expf(-2.0f * (float)M_PI * DSP_DC_CUTOFF_HZ / fs);
+
+    /* RBJ constant 0 dB peak gain band-pass centered in the pulse band */
+    float f0 = sqrtf(DSP_BAND_LOW_HZ * DSP_BAND_HIGH_HZ);
+    float q = f0 / (DSP_BAND_HIGH_HZ - DSP_BAND_LOW_HZ);
+    float w0 = 2.0f * (float)M_PI * f0 / fs;
+    float alpha = sinf(w0) / (2.0f * q);
+    float a0 = 1.0f + alpha;
+
+    dsp->b0 = alpha / a0;
+    dsp->b2 = -alpha / a0;
+    dsp->a1 = -2.0f * cosf(w0) / a0;
+    dsp->a2 = (1.0f - alpha) / a0;
+
+    dsp->env_decay = expf(-1.0f / (DSP_ENV_DECAY_S * fs));
+
+    _dsp_reset_channel(&dsp->ir);
+    _dsp_reset_channel(&dsp->r);
+
+    dsp->report_period = (uint32_t)(fs / report_hz + 0.5f);
+    if (dsp->report_period == 0) dsp->report_period = 1;
+}
+
+/* DC removal followed by the band-pass, returns the band-passed value */
+static float _dsp_filter(max30100_dsp_state *dsp, max30100_dsp_channel *ch,
+        float x, bool first)
+{
+    if (first) ch->dc = x;
+    ch->dc += (x - ch->dc) * dsp->k_dc;
+
+    float ac = x - ch->dc;
+    float y = dsp->b0 * ac + dsp->b2 * ch->x2 - dsp->a1 * ch->y1 - dsp->a2 * ch->y2;
+
+    ch->x2 = ch->x1;
+    ch->x1 = ac;
+    ch->y2 = ch->y1;
+    ch->y1 = y;
+
+    if (y > ch->ac_max) ch->ac_max = y;
+    if (y < ch->ac_min) ch->ac_min = y;
+
+    return y;
+}
+
+static void _dsp_beat(max30100_dsp_state *dsp, uint32_t beat)
+{
+    if (dsp->have_beat)
+    {
+        uint32_t interval = beat - dsp->last_beat;
+
+        /* Ignore intervals outside the plausible heart-rate range */
+        if (interval >= (uint32_t)(dsp->fs * 60.0f / DSP_MAX_BPM) &&
+            interval <= (uint32_t)(dsp->fs * 60.0f / DSP_MIN_BPM))
+        {
+            dsp->intervals[dsp->interval_idx] = interval;
+            dsp->interval_idx = (dsp->interval_idx + 1) % MAX30100_DSP_INTERVALS;
+            if (dsp->n_intervals < MAX30100_DSP_INTERVALS) dsp->n_intervals++;
+
+            uint32_t sum = 0;
+            int i;
+            for (i = 0; i < dsp->n_intervals; i++)
+                sum += dsp->intervals[i];
+            dsp->vitals.bpm = 60.0f * dsp->fs * dsp->n_intervals / sum;
+
+            /* R = (AC_red / DC_red) / (AC_ir / DC_ir) over this beat */
+            float ac_ir = dsp->ir.ac_max - dsp->ir.ac_min;
+            float ac_r = dsp->r.ac_max - dsp->r.ac_min;
+            if (ac_ir > 0 && dsp->ir.dc > 0 && dsp->r.dc > 0)
+            {
+                float ratio = (ac_r / dsp->r.dc) / (ac_ir / dsp->ir.dc);
+
+                if (dsp->ratio == 0)
+                    dsp->ratio = ratio;
+                else
+                    dsp->ratio += (ratio - dsp->ratio) * DSP_RATIO_SMOOTHING;
+
+                /* Common empirical linear calibration */
+                float spo2 = 110.0f - 25.0f * dsp->ratio;
+                dsp->vitals.spo2 = spo2 < 0 ? 0 : (spo2 > 100 ? 100 : spo2);
+            }
+        }
+    }
+
+    dsp->last_beat = beat;
+    dsp->have_beat = true;
+    dsp->ir.ac_max = dsp->r.ac_max = -HUGE_VALF;
+    dsp->ir.ac_min = dsp->r.ac_min = HUGE_VALF;
+}
+
+static void _dsp_process(max30100_context* dev, max30100_value samp)
+{
+    max30100_dsp_state *dsp = &dev->dsp;
+    bool first = dsp->n == 0;
+
+    _dsp_filter(dsp, &dsp->r, samp.R, first);
+
+    /* Blood volume increases absorption, invert so beats are peaks */
+    float sig = -_dsp_filter(dsp, &dsp->ir, samp.IR, first);
+
+    dsp->env *= dsp->env_decay;
+    if (fabsf(sig) > dsp->env) dsp->env = fabsf(sig);
+
+    /* The previous sample is a beat if it is a local maximum above the
+     * threshold and the refractory period has passed */
+    if (dsp->n >= 2 && dsp->prev1 > dsp->prev2 && dsp->prev1 >= sig &&
+        dsp->prev1 > dsp->env * DSP_PEAK_THRESHOLD &&
+        (!dsp->have_beat ||
+         dsp->n - 1 - dsp->last_beat >= (uint32_t)(dsp->fs * 60.0f / DSP_MAX_BPM)))
+        _dsp_beat(dsp, dsp->n - 1);
+
+    /* Drop the estimates once the pulse is lost */
+    if (dsp->have_beat && dsp->n - dsp->last_beat > (uint32_t)(dsp->fs * DSP_BEAT_TIMEOUT_S))
+    {
+        dsp->have_beat = false;
+        dsp->n_intervals = 0;
+        dsp->interval_idx = 0;
+        dsp->ratio = 0;
+        dsp->vitals.bpm = 0;
+        dsp->vitals.spo2 = 0;
+    }
+
+    dsp->prev2 = dsp->prev1;
+    dsp->prev1 = sig;
+    dsp->n++;
+
+    if (++dsp->report_count >= dsp->report_period)
+    {
+        dsp->report_count = 0;
+        dev->func_vitals_ready(dsp->vitals, dev->vitals_arg);
+    }
+}
+
+static void _internal_vitals_rdy(const max30100_value* samples, int count, void* arg)
+{
+    max30100_context* dev = arg;
+    int i;
+
+    for (i = 0; i < count; i++)
+        _dsp_process(dev, samples[i]);
+}
+
 upm_result_t max30100_sample(max30100_context* dev, max30100_value *samp)
 {
     assert(dev != NULL && "max30100_sample: Context cannot be NULL");
@@ -452,24 +685,13 @@ upm_result_t max30100_sample(max30100_context* dev, max30100_value *samp)
     return UPM_SUCCESS;
 }
 
-upm_result_t max30100_sample_continuous(max30100_context* dev, int gpio_pin,
-        bool buffered, func_sample_ready_handler isr, void* arg)
+static upm_result_t _sample_continuous_start(max30100_context* dev, int gpio_pin,
+        bool buffered)
 {
-    assert(dev != NULL && "max30100_sample_continuous: Context cannot be NULL");
     uint8_t tmp;
 
     upm_result_t result = UPM_SUCCESS;
 
-    // Set state to IDLE
-    dev->sample_state = MAX30100_SAMPLE_STATE_IDLE;
-
-    // Disable interrupts
-    result = max30100_write(dev, MAX30100_REG_INTERRUPT_ENABLE, 0x00);
-    if (result != UPM_SUCCESS) return result;
-
-    /* Setup the external callback info */
-    dev->func_sample_ready = isr;
-    dev->arg = arg;
     // Register internal callback handler
     result = _internal_install_isr(dev, gpio_pin, _internal_sample_rdy, dev);
     if (result != UPM_SUCCESS) return result;
@@ -497,9 +719,11 @@ upm_result_t max30100_sample_continuous(max30100_context* dev, int gpio_pin,
             (mode == MAX30100_MODE_SPO2_EN ? MAX30100_EN_SPO2_RDY : 0x00);
     }
 
-    /* Clear wr/rd pointers */
+    /* Clear wr/rd pointers and the overflow counter */
     result = max30100_write(dev, MAX30100_REG_FIFO_WR_PTR, 0x00);
     if (result != UPM_SUCCESS) return result;
+    result = max30100_write(dev, MAX30100_REG_FIFO_OVF_COUNTER, 0x00);
+    if (result != UPM_SUCCESS) return result;
     result = max30100_write(dev, MAX30100_REG_FIFO_RD_PTR, 0x00);
     if (result != UPM_SUCCESS) return result;
 
@@ -514,6 +738,75 @@ upm_result_t max30100_sample_continuous(max30100_context* dev, int gpio_pin,
     return UPM_SUCCESS;
 }
 
+/* Stop any running acquisition before the handlers are swapped */
+static upm_result_t _sample_continuous_idle(max30100_context* dev)
+{
+    // Set state to IDLE
+    dev->sample_state = MAX30100_SAMPLE_STATE_IDLE;
+
+    // Disable interrupts
+    return max30100_write(dev, MAX30100_REG_INTERRUPT_ENABLE, 0x00);
+}
+
+upm_result_t max30100_sample_continuous(max30100_context* dev, int gpio_pin,
+        bool buffered, func_sample_ready_handler isr, void* arg)
+{
+    assert(dev != NULL && "max30100_sample_continuous: Context cannot be NULL");
+
+    upm_result_t result = _sample_continuous_idle(dev);
+    if (result != UPM_SUCCESS) return result;
+
+    /* Setup the external callback info */
+    dev->func_sample_ready = isr;
+    dev->func_samples_ready = NULL;
+    dev->arg = arg;
+
+    return _sample_continuous_start(dev, gpio_pin, buffered);
+}
+
+upm_result_t max30100_sample_continuous_block(max30100_context* dev,
+        int gpio_pin, func_samples_ready_handler isr, void* arg)
+{
+    assert(dev != NULL && "max30100_sample_continuous_block: Context cannot be NULL");
+
+    upm_result_t result = _sample_continuous_idle(dev);
+    if (result != UPM_SUCCESS) return result;
+
+    /* Setup the external callback info */
+    dev->func_sample_ready = NULL;
+    dev->func_samples_ready = isr;
+    dev->arg = arg;
+
+    return _sample_continuous_start(dev, gpio_pin, true);
+}
+
+upm_result_t max30100_sample_vitals(max30100_context* dev, int gpio_pin,
+        float report_hz, func_vitals_ready_handler isr, void* arg)
+{
+    assert(dev != NULL && "max30100_sample_vitals: Context cannot be NULL");
+
+    if (report_hz <= 0) return UPM_ERROR_INVALID_PARAMETER;
+
+    upm_result_t result = _sample_continuous_idle(dev);
+    if (result != UPM_SUCCESS) return result;
+
+    /* The signal chain is tuned for the configured sample rate */
+    MAX30100_SR sample_rate;
+    result = max30100_get_sample_rate(dev, &sample_rate);
+    if (result != UPM_SUCCESS) return result;
+
+    _dsp_init(&dev->dsp, _sample_rate_hz[sample_rate], report_hz);
+
+    /* Setup the external callback info, samples go to the signal chain */
+    dev->func_vitals_ready = isr;
+    dev->vitals_arg = arg;
+    dev->func_sample_ready = NULL;
+    dev->func_samples_ready = _internal_vitals_rdy;
+    dev->arg = dev;
+
+    return _sample_continuous_start(dev, gpio_pin, true);
+}
+
 upm_result_t max30100_sample_stop(max30100_context* dev)
 {
     assert(dev != NULL && "max30100_sample_stop: Context cannot be NULL");
@@ -35,7 +35,8 @@ void max30100_throw(std::string func, std::string cmd, upm_result_t result)
             "upm_result_t: " + std::to_string(result));
 }
 
-MAX30100::MAX30100(int16_t i2c_bus) : _dev(max30100_init(i2c_bus))
+MAX30100::MAX30100(int16_t i2c_bus) : _callback(NULL), _vitals_callback(NULL),
+    _dev(max30100_init(i2c_bus))
 {
     if (_dev == NULL)
         throw std::runtime_error(std::string(__FUNCTION__) +
@@ -48,6 +49,12 @@ void _read_sample_proxy(max30100_value sample, void* _max30100)
         ((MAX30100*)_max30100)->_callback->run(sample);
 }
 
+void _read_vitals_proxy(max30100_vitals vitals, void* _max30100)
+{
+    if ((_max30100 != NULL) && ((MAX30100*)_max30100)->_vitals_callback != NULL)
+        ((MAX30100*)_max30100)->_vitals_callback->run(vitals);
+}
+
 max30100_value MAX30100::sample()
 {
     max30100_value retval;
@@ -68,6 +75,19 @@ void MAX30100::sample_continuous(int gpio_pin, bool buffered, Callback *cb)
     max30100_sample_continuous(_dev, gpio_pin, buffered, &_read_sample_proxy, this);
 }
 
+void MAX30100::sample_vitals(int gpio_pin, float report_hz, VitalsCallback *cb)
+{
+    // Use a default callback if one is NOT provided
+    if (cb == NULL)
+        _vitals_callback = &_default_vitals_callback;
+    else
+        _vitals_callback = cb;
+    upm_result_t result = max30100_sample_vitals(_dev, gpio_pin, report_hz,
+            &_read_vitals_proxy, this);
+    if (result != UPM_SUCCESS)
+        max30100_throw(__FUNCTION__, "max30100_sample_vitals", result);
+}
+
 void MAX30100::sample_stop()
 {
     upm_result_t result = max30100_sample_stop(_dev);
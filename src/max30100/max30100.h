@@ -29,6 +29,9 @@
 
 #include "max30100_regs.h"
 
+/* Number of beat-to-beat intervals averaged into the heart rate */
+#define MAX30100_DSP_INTERVALS 4
+
 #include "mraa/gpio.h"
 #include "mraa/i2c.h"
 #include "upm.h"
@@ -45,6 +48,50 @@ extern "C" {
  * @include max30100.c
  */
 
+/**
+ * Per-channel (IR or R) state of the heart-rate/SpO2 signal chain
+ */
+typedef struct {
+    /* Slowly tracking DC level of the raw signal */
+    float dc;
+    /* Band-pass filter delay line */
+    float x1, x2, y1, y2;
+    /* Band-passed signal extremes since the last detected beat */
+    float ac_max, ac_min;
+} max30100_dsp_channel;
+
+/**
+ * Heart-rate/SpO2 signal chain state
+ */
+typedef struct {
+    /* Sample rate in Hz */
+    float fs;
+    /* DC tracker coefficient */
+    float k_dc;
+    /* Normalized band-pass biquad coefficients (b1 is always 0) */
+    float b0, b2, a1, a2;
+    /* Per-beat pulse envelope decay */
+    float env_decay;
+    max30100_dsp_channel ir;
+    max30100_dsp_channel r;
+    /* Pulse envelope and the previous two pulse signal values */
+    float env, prev1, prev2;
+    /* Samples processed, index of the last detected beat */
+    uint32_t n;
+    uint32_t last_beat;
+    bool have_beat;
+    /* Recent beat-to-beat intervals in samples */
+    uint32_t intervals[MAX30100_DSP_INTERVALS];
+    int n_intervals;
+    int interval_idx;
+    /* Averaged R ratio, 0 until the first valid beat */
+    float ratio;
+    max30100_vitals vitals;
+    /* Samples between reports and samples since the last report */
+    uint32_t report_period;
+    uint32_t report_count;
+} max30100_dsp_state;
+
 /**
  * device context
  */
@@ -61,8 +108,16 @@ typedef struct {
     /* Continuous sampling function ptr */
     func_sample_ready_handler func_sample_ready;
 
+    /* Optional block handler, replaces func_sample_ready when set */
+    func_samples_ready_handler func_samples_ready;
+
     /* Optional void ptr arg returned from callback */
     void* arg;
+
+    /* Heart-rate/SpO2 handler, its arg, and the signal chain state */
+    func_vitals_ready_handler func_vitals_ready;
+    void* vitals_arg;
+    max30100_dsp_state dsp;
 } max30100_context;
 
 /**
@@ -109,7 +164,7 @@ upm_result_t max30100_sample(max30100_context* dev, max30100_value *samp);
  * @param dev Sensor context pointer
  * @param gpio_pin GPIO pin used for interrupt (input from sensor INT pin)
  * @param buffered Enable buffered sampling.  In buffered sampling mode, the
- * device reads 16 samples at a time.  This can help with I2C read timing.
+ * device drains the FIFO with one I2C burst read per interrupt.
  *      buffered == true, enable buffered sampling
  *      buffered == false, single-sample mode
  * @param isr Function pointer which handles 1 IR/R sample and a void ptr arg
@@ -122,6 +177,54 @@ upm_result_t max30100_sample_continuous(max30100_context* dev,
                                         func_sample_ready_handler isr,
                                         void* arg);
 
+/**
+ * Continuously sample Infrared/Red values, a FIFO at a time.
+ *
+ * Same as max30100_sample_continuous() in buffered mode, except that
+ * each FIFO almost full interrupt drains every sample the FIFO holds
+ * with a single I2C burst read and hands the whole block to the
+ * handler in one call.
+ *
+ * @param dev Sensor context pointer
+ * @param gpio_pin GPIO pin used for interrupt (input from sensor INT pin)
+ * @param isr Function pointer which handles a block of IR/R samples and
+ * a void ptr arg
+ * @param arg Void * passed back with ISR call
+ * @return Function result code
+ */
+upm_result_t max30100_sample_continuous_block(max30100_context* dev,
+                                              int gpio_pin,
+                                              func_samples_ready_handler isr,
+                                              void* arg);
+
+/**
+ * Continuously estimate heart rate and SpO2.
+ *
+ * Samples are read a FIFO at a time (see
+ * max30100_sample_continuous_block()) and run through a signal chain:
+ * DC removal, a 0.5-4 Hz band-pass, peak detection on the IR pulse for
+ * the heart rate, and the red/IR ratio of AC/DC ratios for SpO2.  The
+ * current estimate is handed to the handler report_hz times per second.
+ * Estimates read 0 until enough beats have been seen, or when no pulse
+ * has been detected for 3 seconds.
+ *
+ * The sample rate is read from the device, so all setup must be done
+ * prior to calling this method.  The device should be in SpO2 mode for
+ * the SpO2 estimate to be meaningful.
+ *
+ * @param dev Sensor context pointer
+ * @param gpio_pin GPIO pin used for interrupt (input from sensor INT pin)
+ * @param report_hz Number of estimates reported per second
+ * @param isr Function pointer which handles an estimate and a void ptr arg
+ * @param arg Void * passed back with ISR call
+ * @return Function result code
+ */
+upm_result_t max30100_sample_vitals(max30100_context* dev,
+                                    int gpio_pin,
+                                    float report_hz,
+                                    func_vitals_ready_handler isr,
+                                    void* arg);
+
 /**
  * Stop continuous sampling.  Disable interrupts.
  *
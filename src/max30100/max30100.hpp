@@ -42,6 +42,17 @@ class Callback {
         { std::cout << "Base sample IR: " << samp.IR << " R: " << samp.R << std::endl; }
 };
 
+/* Callback class for continuously reading heart-rate/SpO2 estimates */
+class VitalsCallback {
+    public:
+        virtual ~VitalsCallback() { }
+        /* Default run method, called for each new estimate in vitals
+         * sampling mode.
+         * Override this method */
+        virtual void run(max30100_vitals vitals)
+        { std::cout << "Base vitals BPM: " << vitals.bpm << " SpO2: " << vitals.spo2 << std::endl; }
+};
+
 /**
  * @brief MAX30100 Pulse Oximeter and Heart Rate Sensor
  * @defgroup max30100 libupm-max30100
@@ -117,8 +128,7 @@ class MAX30100 {
          *
          * @param gpio_pin GPIO pin for interrupt (input from sensor INT pin)
          * @param buffered Enable buffered sampling.  In buffered sampling mode,
-         * the device reads 16 samples at a time.  This can help with I2C read
-         * timing.
+         * the FIFO is drained with one I2C burst read per interrupt.
          *      buffered == true, enable buffered sampling
          *      buffered == false, single-sample mode
          * @param cb Pointer to instance of Callback class.  If parameter is left
@@ -128,6 +138,27 @@ class MAX30100 {
          */
         void sample_continuous(int gpio_pin, bool buffered, Callback *cb = NULL);
 
+        /**
+         * Continuously estimate heart rate and SpO2.
+         *
+         * Samples are read a FIFO at a time and run through DC removal,
+         * a 0.5-4 Hz band-pass, peak detection and the red/IR ratio of
+         * AC/DC ratios.  Estimates read 0 until enough beats have been
+         * seen, or when no pulse has been detected for 3 seconds.
+         *
+         * Note, all setup (sample rate, mode, LED current, and pulse width
+         * must be done prior to calling this sample method.
+         *
+         * @param gpio_pin GPIO pin for interrupt (input from sensor INT pin)
+         * @param report_hz Number of estimates reported per second
+         * @param cb Pointer to instance of VitalsCallback class.  If
+         * parameter is left NULL, a default instance of the VitalsCallback
+         * class will be used which prints out the estimates.
+         * @throws std::runtime_error on I2C command failure
+         */
+        void sample_vitals(int gpio_pin, float report_hz = 1.0,
+                           VitalsCallback *cb = NULL);
+
         /**
          * Stop continuous sampling.  Disable interrupts.
          */
@@ -285,10 +316,16 @@ class MAX30100 {
 
         /* Callback pointer available for a user-specified callback */
         Callback *_callback;
+
+        /* Callback pointer available for a user-specified vitals callback */
+        VitalsCallback *_vitals_callback;
     private:
         /* base Callback instance to use if none provided */
         Callback _default_callback;
 
+        /* base VitalsCallback instance to use if none provided */
+        VitalsCallback _default_vitals_callback;
+
         /* device context struct */
         max30100_context* _dev;
 };
@@ -5,6 +5,7 @@
 #ifndef ANDROID
 %module(directors="1", threads="1") javaupm_max30100
 %feature("director") upm::Callback;
+%feature("director") upm::VitalsCallback;
 #endif
 JAVA_JNI_LOADLIBRARY(javaupm_max30100)
 #endif
@@ -15,6 +16,7 @@ JAVA_JNI_LOADLIBRARY(javaupm_max30100)
 %module(directors="1", threads="1") pyupm_max30100
 
 %feature("director") upm::Callback;
+%feature("director") upm::VitalsCallback;
 #endif
 /* END Python syntax */
 
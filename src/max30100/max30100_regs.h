@@ -32,6 +32,9 @@ extern "C" {
 
 #define MAX30100_I2C_ADDRESS 0x57
 
+/* Number of IR/R samples held in the FIFO */
+#define MAX30100_FIFO_DEPTH 16
+
 /* Single IR/R sample */
 typedef struct {
     /* Raw IR (pulse) read value */
@@ -43,6 +46,21 @@ typedef struct {
 /* Function pointer for returning 1 IR/R sample */
 typedef void (*func_sample_ready_handler)(max30100_value sample, void* arg);
 
+/* Function pointer for returning a block of IR/R samples read in one burst */
+typedef void (*func_samples_ready_handler)(const max30100_value* samples,
+                                           int count, void* arg);
+
+/* Heart-rate and SpO2 estimate */
+typedef struct {
+    /* Heart rate in beats per minute, 0 if no pulse is detected */
+    float bpm;
+    /* Oxygen saturation in percent, 0 if no estimate is available */
+    float spo2;
+} max30100_vitals;
+
+/* Function pointer for returning a heart-rate/SpO2 estimate */
+typedef void (*func_vitals_ready_handler)(max30100_vitals vitals, void* arg);
+
 /* Sample state */
 typedef enum {
     /* NOT sampling */
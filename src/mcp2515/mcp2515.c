@@ -25,6 +25,8 @@
 #include <unistd.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <time.h>
 
 #include "mcp2515.h"
 
@@ -151,6 +153,39 @@ static int mcp2515_id_to_int(const mcp2515_context dev, bool *ext,
     return id;
 }
 
+// monotonic time in microseconds, used to timestamp received frames
+static uint64_t mcp2515_now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+// decode the id, ext, len and (extended) rtr fields from the raw
+// packet of a received message.  The standard frame rtr and filter
+// number live elsewhere, and are filled in by the caller.
+static void mcp2515_decode_rx_pkt(const mcp2515_context dev,
+                                  MCP2515_MSG_T *msg)
+{
+    assert(dev != NULL);
+    assert(msg != NULL);
+
+    MCP2515_ID_T did;
+    did.SIDH = msg->pkt.SIDH;
+    did.SIDL = msg->pkt.SIDL;
+    did.EID8 = msg->pkt.EID8;
+    did.EID0 = msg->pkt.EID0;
+
+    msg->id = mcp2515_id_to_int(dev, &(msg->ext), &did);
+
+    // ext message stores rtr in the DLC
+    msg->rtr = (msg->ext && (msg->pkt.DLC & MCP2515_RXBDLC_RTR));
+
+    msg->len = ((msg->pkt.DLC & (_MCP2515_RXBDLC_MASK << _MCP2515_RXBDLC_SHIFT))
+                >> _MCP2515_RXBDLC_SHIFT);
+}
+
 // init...
 mcp2515_context mcp2515_init(int bus, int cs_pin)
 {
@@ -163,6 +198,16 @@ mcp2515_context mcp2515_init(int bus, int cs_pin)
     // zero out context
     memset((void *)dev, 0, sizeof(struct _mcp2515_context));
 
+    pthread_mutex_init(&dev->bus_lock, NULL);
+    pthread_mutex_init(&dev->rx_lock, NULL);
+
+    // rx_cond is used for timed waits, so base it on the monotonic clock
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    pthread_cond_init(&dev->rx_cond, &cattr);
+    pthread_condattr_destroy(&cattr);
+
     // make sure MRAA is initialized
     int mraa_rv;
     if ((mraa_rv = mraa_init()) != MRAA_SUCCESS)
@@ -289,6 +334,7 @@ void mcp2515_close(mcp2515_context dev)
 {
     assert(dev != NULL);
 
+    mcp2515_rx_stop(dev);
     mcp2515_uninstall_isr(dev);
 
     if (dev->spi)
@@ -297,6 +343,12 @@ void mcp2515_close(mcp2515_context dev)
     if (dev->gpio)
         mraa_gpio_close(dev->gpio);
 
+    free(dev->rx_ring);
+
+    pthread_cond_destroy(&dev->rx_cond);
+    pthread_mutex_destroy(&dev->rx_lock);
+    pthread_mutex_destroy(&dev->bus_lock);
+
     free(dev);
 }
 
@@ -319,15 +371,18 @@ upm_result_t mcp2515_bus_read(const mcp2515_context dev, uint8_t cmd,
             sbuf[index++] = args[i];
     }
 
+    pthread_mutex_lock(&dev->bus_lock);
     mcp2515_cs_on(dev);
 
     if (mraa_spi_transfer_buf(dev->spi, sbuf, sbuf, buflen))
     {
         mcp2515_cs_off(dev);
+        pthread_mutex_unlock(&dev->bus_lock);
         printf("%s: mraa_spi_transfer_buf() failed.\n", __FUNCTION__);
         return UPM_ERROR_OPERATION_FAILED;
     }
     mcp2515_cs_off(dev);
+    pthread_mutex_unlock(&dev->bus_lock);
 
     // now copy it into user buffer
     for (int i=0; i<len; i++)
@@ -352,15 +407,18 @@ upm_result_t mcp2515_bus_write(const mcp2515_context dev, uint8_t cmd,
             sbuf[i + 1] = data[i];
     }
 
+    pthread_mutex_lock(&dev->bus_lock);
     mcp2515_cs_on(dev);
 
     if (mraa_spi_transfer_buf(dev->spi, sbuf, sbuf, len + 1))
     {
         mcp2515_cs_off(dev);
+        pthread_mutex_unlock(&dev->bus_lock);
         printf("%s: mraa_spi_transfer_buf() failed.\n", __FUNCTION__);
         return UPM_ERROR_OPERATION_FAILED;
     }
     mcp2515_cs_off(dev);
+    pthread_mutex_unlock(&dev->bus_lock);
 
     return UPM_SUCCESS;
 }
@@ -937,14 +995,8 @@ upm_result_t mcp2515_get_rx_msg(const mcp2515_context dev,
     // if we are here, we got the packet, so decode and determine some
     // things.
 
-    // id & ext
-    MCP2515_ID_T did;
-    did.SIDH = msg->pkt.SIDH;
-    did.SIDL = msg->pkt.SIDL;
-    did.EID8 = msg->pkt.EID8;
-    did.EID0 = msg->pkt.EID0;
-
-    msg->id = mcp2515_id_to_int(dev, &(msg->ext), &did);
+    // id, ext, len, and rtr for extended messages
+    mcp2515_decode_rx_pkt(dev, msg);
 
     // rtr
     if (!msg->ext)
@@ -955,12 +1007,6 @@ upm_result_t mcp2515_get_rx_msg(const mcp2515_context dev,
         if (rxbctrl & MCP2515_RXB0CTRL_RXRTR)
             msg->rtr = true;
     }
-    else
-    {
-        // ext message stores rtr separately
-        if (msg->pkt.DLC & MCP2515_RXBDLC_RTR)
-            msg->rtr = true;
-    }
 
     // filter num
     if (bufnum == MCP2515_RX_BUFFER0)
@@ -980,11 +1026,6 @@ upm_result_t mcp2515_get_rx_msg(const mcp2515_context dev,
                   >> _MCP2515_RXB1CTRL_FILHIT_SHIFT);
     }
 
-    // now the payload length
-    msg->len = ((msg->pkt.DLC & (_MCP2515_RXBDLC_MASK << _MCP2515_RXBDLC_SHIFT))
-                >> _MCP2515_RXBDLC_SHIFT);
-
-
     return UPM_SUCCESS;
 }
 
@@ -1107,3 +1148,505 @@ upm_result_t mcp2515_clear_error_flags(const mcp2515_context dev,
 
     return mcp2515_bit_modify(dev, MCP2515_REG_EFLG, flags, 0);
 }
+
+// The receive ISR.  This is also called directly from
+// mcp2515_rx_start() to release an already asserted INT line.
+static void mcp2515_rx_isr(void *ctx)
+{
+    mcp2515_context dev = (mcp2515_context)ctx;
+    assert(dev != NULL);
+
+    // mraa_gpio_isr_exit() may cancel this thread, so make sure that
+    // can't happen while we are holding locks.
+    int cancel_state;
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &cancel_state);
+
+    pthread_mutex_lock(&dev->rx_lock);
+
+    const uint8_t rxmsgs = (MCP2515_RXSTATUS_RXMSG0
+                            | MCP2515_RXSTATUS_RXMSG1);
+    const uint8_t ovr = (MCP2515_EFLG_RX0OVR | MCP2515_EFLG_RX1OVR);
+    const unsigned int ring_mask = dev->rx_ring_size - 1;
+    bool queued = false;
+
+    // Keep going until both buffers are empty.  INT stays asserted as
+    // long as either RXnIF is set, and we will not see another
+    // falling edge until it has been released.
+    while (__atomic_load_n(&dev->rx_running, __ATOMIC_ACQUIRE))
+    {
+        uint8_t status;
+        if (mcp2515_bus_read(dev, MCP2515_CMD_RX_STATUS, NULL, 0,
+                             &status, 1))
+            break;
+
+        if (!(status & rxmsgs))
+            break;
+
+        uint64_t now = mcp2515_now_us();
+
+        // With rollover enabled, the device can only lose a frame
+        // when RXB1 is full, so that is the only time we need to go
+        // and look.
+        if (status & MCP2515_RXSTATUS_RXMSG1)
+        {
+            uint8_t eflg;
+            if (!mcp2515_read_reg(dev, MCP2515_REG_EFLG, &eflg)
+                && (eflg & ovr))
+            {
+                __atomic_add_fetch(&dev->rx_device_overflows, 1,
+                                   __ATOMIC_RELAXED);
+                mcp2515_bit_modify(dev, MCP2515_REG_EFLG, ovr, 0);
+            }
+        }
+
+        uint8_t cmd;
+        int filter_num;
+        if ((status & rxmsgs) == rxmsgs)
+        {
+            // Both buffers are full.  We read RXB0 first, but the RX
+            // STATUS filter match can't be relied upon to describe
+            // it, so get it from RXB0CTRL instead.  RXB1 will be
+            // described properly on the next pass.
+            uint8_t rxbctrl;
+            if (mcp2515_read_reg(dev, MCP2515_REG_RXB0CTRL, &rxbctrl))
+                break;
+
+            cmd = MCP2515_CMD_READ_RXBUF_RXB0SIDH;
+            filter_num = (rxbctrl & MCP2515_RXB0CTRL_FILHIT) ? 1 : 0;
+        }
+        else
+        {
+            cmd = ((status & MCP2515_RXSTATUS_RXMSG0)
+                   ? MCP2515_CMD_READ_RXBUF_RXB0SIDH
+                   : MCP2515_CMD_READ_RXBUF_RXB1SIDH);
+
+            MCP2515_FILTERMATCH_T fm =
+                (status &
+                 (_MCP2515_RXSTATUS_FILTERMATCH_MASK
+                  << _MCP2515_RXSTATUS_FILTERMATCH_SHIFT))
+                >> _MCP2515_RXSTATUS_FILTERMATCH_SHIFT;
+
+            if (fm == MCP2515_FILTERMATCH_RXF0_ROLLOVER)
+                filter_num = 0;
+            else if (fm == MCP2515_FILTERMATCH_RXF1_ROLLOVER)
+                filter_num = 1;
+            else
+                filter_num = (int)fm;
+        }
+
+        // If the ring is full, we still have to read the buffer to
+        // release it, we just throw the frame away.
+        unsigned int head = dev->rx_head;
+        unsigned int tail = __atomic_load_n(&dev->rx_tail, __ATOMIC_ACQUIRE);
+        bool full = ((head - tail) >= dev->rx_ring_size);
+
+        MCP2515_FRAME_T discard;
+        MCP2515_FRAME_T *frame = (full) ? &discard
+            : &dev->rx_ring[head & ring_mask];
+
+        // READ RX BUFFER clears the matching RXnIF when CS is raised
+        if (mcp2515_bus_read(dev, cmd, NULL, 0, frame->msg.pkt.data,
+                             MCP2515_MAX_PKT_DATA))
+            break;
+
+        mcp2515_decode_rx_pkt(dev, &frame->msg);
+        if (!frame->msg.ext && (frame->msg.pkt.SIDL & MCP2515_SIDL_SRR))
+            frame->msg.rtr = true;
+        frame->msg.filter_num = filter_num;
+        frame->timestamp = now;
+
+        if (full)
+        {
+            __atomic_add_fetch(&dev->rx_ring_overflows, 1, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            __atomic_store_n(&dev->rx_head, head + 1, __ATOMIC_RELEASE);
+            queued = true;
+        }
+    }
+
+    if (queued)
+        pthread_cond_broadcast(&dev->rx_cond);
+
+    pthread_mutex_unlock(&dev->rx_lock);
+
+    pthread_setcancelstate(cancel_state, NULL);
+}
+
+upm_result_t mcp2515_rx_start(const mcp2515_context dev, int pin,
+                              unsigned int ring_size)
+{
+    assert(dev != NULL);
+
+    mcp2515_rx_stop(dev);
+
+    if (!ring_size)
+        ring_size = MCP2515_RX_RING_SIZE;
+
+    // the ring is indexed by masking, so it must be a power of 2
+    unsigned int size = 2;
+    while (size < ring_size)
+        size <<= 1;
+
+    free(dev->rx_ring);
+    dev->rx_ring_size = 0;
+    if (!(dev->rx_ring = calloc(size, sizeof(MCP2515_FRAME_T))))
+    {
+        printf("%s: calloc() failed.\n", __FUNCTION__);
+        return UPM_ERROR_NO_RESOURCES;
+    }
+
+    dev->rx_ring_size = size;
+    dev->rx_head = 0;
+    dev->rx_tail = 0;
+    dev->rx_ring_overflows = 0;
+    dev->rx_device_overflows = 0;
+
+    // enable rollover so that RXB1 can absorb a frame while RXB0 is
+    // waiting to be read
+    upm_result_t rv;
+    if ((rv = mcp2515_bit_modify(dev, MCP2515_REG_RXB0CTRL,
+                                 MCP2515_RXB0CTRL_BUKT,
+                                 MCP2515_RXB0CTRL_BUKT)))
+    {
+        printf("%s: mcp2515_bit_modify(RXB0CTRL) failed.\n", __FUNCTION__);
+        return rv;
+    }
+
+    __atomic_store_n(&dev->rx_running, true, __ATOMIC_RELEASE);
+
+    if ((rv = mcp2515_install_isr(dev, pin, mcp2515_rx_isr, (void *)dev)))
+    {
+        __atomic_store_n(&dev->rx_running, false, __ATOMIC_RELEASE);
+        return rv;
+    }
+
+    if ((rv = mcp2515_bit_modify(dev, MCP2515_REG_CANINTE,
+                                 (MCP2515_CANINT_RX0I | MCP2515_CANINT_RX1I),
+                                 (MCP2515_CANINT_RX0I | MCP2515_CANINT_RX1I))))
+    {
+        printf("%s: mcp2515_bit_modify(CANINTE) failed.\n", __FUNCTION__);
+        mcp2515_rx_stop(dev);
+        return rv;
+    }
+
+    // If frames arrived before the ISR was installed, INT is already
+    // low and no falling edge will come, so drain once by hand.
+    mcp2515_rx_isr((void *)dev);
+
+    return UPM_SUCCESS;
+}
+
+void mcp2515_rx_stop(const mcp2515_context dev)
+{
+    assert(dev != NULL);
+
+    if (!__atomic_load_n(&dev->rx_running, __ATOMIC_ACQUIRE))
+        return;
+
+    __atomic_store_n(&dev->rx_running, false, __ATOMIC_RELEASE);
+
+    mcp2515_uninstall_isr(dev);
+    mcp2515_bit_modify(dev, MCP2515_REG_CANINTE,
+                       (MCP2515_CANINT_RX0I | MCP2515_CANINT_RX1I), 0);
+
+    // wake up any waiting readers
+    pthread_mutex_lock(&dev->rx_lock);
+    pthread_cond_broadcast(&dev->rx_cond);
+    pthread_mutex_unlock(&dev->rx_lock);
+}
+
+upm_result_t mcp2515_rx_dequeue(const mcp2515_context dev,
+                                MCP2515_FRAME_T *frame, int timeout_ms)
+{
+    assert(dev != NULL);
+    assert(frame != NULL);
+
+    if (!dev->rx_ring)
+        return UPM_ERROR_NO_RESOURCES;
+
+    unsigned int tail = dev->rx_tail;
+
+    if (__atomic_load_n(&dev->rx_head, __ATOMIC_ACQUIRE) == tail)
+    {
+        if (timeout_ms == 0)
+            return UPM_ERROR_TIMED_OUT;
+
+        struct timespec deadline;
+        if (timeout_ms > 0)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += timeout_ms / 1000;
+            deadline.tv_nsec += (timeout_ms % 1000) * 1000000;
+            if (deadline.tv_nsec >= 1000000000)
+            {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000;
+            }
+        }
+
+        pthread_mutex_lock(&dev->rx_lock);
+
+        int rv = 0;
+        while (__atomic_load_n(&dev->rx_head, __ATOMIC_ACQUIRE) == tail
+               && __atomic_load_n(&dev->rx_running, __ATOMIC_ACQUIRE)
+               && rv != ETIMEDOUT)
+        {
+            if (timeout_ms > 0)
+                rv = pthread_cond_timedwait(&dev->rx_cond, &dev->rx_lock,
+                                            &deadline);
+            else
+                pthread_cond_wait(&dev->rx_cond, &dev->rx_lock);
+        }
+
+        pthread_mutex_unlock(&dev->rx_lock);
+
+        if (__atomic_load_n(&dev->rx_head, __ATOMIC_ACQUIRE) == tail)
+            return UPM_ERROR_TIMED_OUT;
+    }
+
+    *frame = dev->rx_ring[tail & (dev->rx_ring_size - 1)];
+    __atomic_store_n(&dev->rx_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return UPM_SUCCESS;
+}
+
+unsigned int mcp2515_rx_pending(const mcp2515_context dev)
+{
+    assert(dev != NULL);
+
+    return (__atomic_load_n(&dev->rx_head, __ATOMIC_ACQUIRE)
+            - __atomic_load_n(&dev->rx_tail, __ATOMIC_ACQUIRE));
+}
+
+uint32_t mcp2515_rx_ring_overflows(const mcp2515_context dev)
+{
+    assert(dev != NULL);
+
+    return __atomic_load_n(&dev->rx_ring_overflows, __ATOMIC_RELAXED);
+}
+
+uint32_t mcp2515_rx_device_overflows(const mcp2515_context dev)
+{
+    assert(dev != NULL);
+
+    return __atomic_load_n(&dev->rx_device_overflows, __ATOMIC_RELAXED);
+}
+
+static int mcp2515_cmp_int(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Store the distinct values of (id & mask) in classes (sorted), and
+// return how many there are.  classes must have room for count
+// entries, and may be the same array as ids.
+static unsigned int mcp2515_plan_classes(const int *ids, unsigned int count,
+                                         int mask, int *classes)
+{
+    for (unsigned int i=0; i<count; i++)
+        classes[i] = ids[i] & mask;
+
+    qsort(classes, count, sizeof(int), mcp2515_cmp_int);
+
+    unsigned int n = 0;
+    for (unsigned int i=0; i<count; i++)
+        if (!n || classes[i] != classes[n - 1])
+            classes[n++] = classes[i];
+
+    return n;
+}
+
+// Compute a mask and filters for one RX buffer so that all of ids
+// are accepted using no more than slots filters.  Starting with every
+// bit significant, we repeatedly drop the mask bit that merges the
+// most ids into the same filter until they fit.  Unused filters
+// duplicate the first one.  Returns the number of ids that will be
+// accepted.
+static uint64_t mcp2515_plan_buffer(const int *ids, unsigned int count,
+                                    unsigned int slots, int width,
+                                    int *scratch, int *mask, int *filters)
+{
+    int m = (1 << width) - 1;
+    unsigned int n = mcp2515_plan_classes(ids, count, m, scratch);
+
+    while (n > slots)
+    {
+        int best_bit = -1;
+        unsigned int best_n = n;
+
+        for (int b=0; b<width; b++)
+        {
+            if (!(m & (1 << b)))
+                continue;
+
+            unsigned int c = mcp2515_plan_classes(ids, count, m & ~(1 << b),
+                                                  scratch);
+            if (best_bit < 0 || c < best_n)
+            {
+                best_bit = b;
+                best_n = c;
+            }
+        }
+
+        m &= ~(1 << best_bit);
+        n = best_n;
+    }
+
+    n = mcp2515_plan_classes(ids, count, m, scratch);
+    for (unsigned int i=0; i<slots; i++)
+        filters[i] = scratch[(i < n) ? i : 0];
+
+    *mask = m;
+
+    return (uint64_t)n << (width - __builtin_popcount(m));
+}
+
+upm_result_t mcp2515_plan_filters(const int *ids, unsigned int count,
+                                  bool ext, MCP2515_FILTER_PLAN_T *plan)
+{
+    assert(plan != NULL);
+
+    if (!ids || !count)
+        return UPM_ERROR_INVALID_PARAMETER;
+
+    const int width = (ext) ? 29 : 11;
+    const int full = (1 << width) - 1;
+
+    for (unsigned int i=0; i<count; i++)
+    {
+        if (ids[i] < 0 || ids[i] > full)
+        {
+            printf("%s: id 0x%x is out of range.\n", __FUNCTION__, ids[i]);
+            return UPM_ERROR_INVALID_PARAMETER;
+        }
+    }
+
+    // sorted, de-duplicated ids followed by scratch space
+    int *sorted = malloc(sizeof(int) * count * 2);
+    if (!sorted)
+    {
+        printf("%s: malloc() failed.\n", __FUNCTION__);
+        return UPM_ERROR_NO_RESOURCES;
+    }
+    int *scratch = sorted + count;
+
+    unsigned int n = mcp2515_plan_classes(ids, count, full, sorted);
+
+    memset((void *)plan, 0, sizeof(MCP2515_FILTER_PLAN_T));
+    plan->ext = ext;
+    plan->accepted = UINT64_MAX;
+
+    // Try every split of the sorted ids into a low and high group,
+    // with each group on either RXB0 (2 filters) or RXB1 (4 filters),
+    // and keep the one that accepts the fewest ids.  Up to 6 ids are
+    // always matched exactly.
+    for (unsigned int split=0; split<=n; split++)
+    {
+        for (int swap=0; swap<2; swap++)
+        {
+            const int *group[2] = { sorted, sorted + split };
+            unsigned int gcount[2] = { split, n - split };
+            if (swap)
+            {
+                group[0] = sorted + split;
+                group[1] = sorted;
+                gcount[0] = n - split;
+                gcount[1] = split;
+            }
+
+            int masks[2];
+            int filters[6];
+            uint64_t accepted = 0;
+
+            for (int buf=0; buf<2; buf++)
+            {
+                unsigned int slots = (buf) ? 4 : 2;
+                int *bfilters = (buf) ? &filters[2] : &filters[0];
+
+                if (gcount[buf])
+                {
+                    accepted += mcp2515_plan_buffer(group[buf], gcount[buf],
+                                                    slots, width, scratch,
+                                                    &masks[buf], bfilters);
+                }
+                else
+                {
+                    // nothing for this buffer, so match an id that
+                    // the other buffer accepts anyway
+                    masks[buf] = full;
+                    for (unsigned int i=0; i<slots; i++)
+                        bfilters[i] = sorted[0];
+                }
+            }
+
+            if (accepted < plan->accepted)
+            {
+                plan->accepted = accepted;
+                memcpy(plan->masks, masks, sizeof(masks));
+                memcpy(plan->filters, filters, sizeof(filters));
+            }
+        }
+    }
+
+    free(sorted);
+
+    return UPM_SUCCESS;
+}
+
+upm_result_t mcp2515_apply_filter_plan(const mcp2515_context dev,
+                                       const MCP2515_FILTER_PLAN_T *plan)
+{
+    assert(dev != NULL);
+    assert(plan != NULL);
+
+    // save the current mode so we can return to it
+    upm_result_t rv;
+    uint8_t canstat;
+    if ((rv = mcp2515_read_reg(dev, MCP2515_REG_CANSTAT, &canstat)))
+    {
+        printf("%s: mcp2515_read_reg() failed.\n", __FUNCTION__);
+        return rv;
+    }
+
+    MCP2515_OPMODE_T opmode =
+        (canstat & (_MCP2515_CANSTAT_OPMODE_MASK
+                    << _MCP2515_CANSTAT_OPMODE_SHIFT))
+        >> _MCP2515_CANSTAT_OPMODE_SHIFT;
+
+    // masks and filters can only be changed in CONFIG mode
+    if ((rv = mcp2515_set_opmode(dev, MCP2515_OPMODE_CONFIG)))
+    {
+        printf("%s: mcp2515_set_opmode(config) failed.\n", __FUNCTION__);
+        return rv;
+    }
+
+    for (int i=0; !rv && i<2; i++)
+        rv = mcp2515_set_mask(dev, (MCP2515_RX_MASK_T)i, plan->ext,
+                              plan->masks[i]);
+
+    for (int i=0; !rv && i<6; i++)
+        rv = mcp2515_set_filter(dev, (MCP2515_RX_FILTER_T)i, plan->ext,
+                                plan->filters[i]);
+
+    if (!rv)
+        rv = mcp2515_set_rx_buffer_mode(dev, MCP2515_RX_BUFFER0,
+                                        MCP2515_RXMODE_ANY_FILTER);
+    if (!rv)
+        rv = mcp2515_set_rx_buffer_mode(dev, MCP2515_RX_BUFFER1,
+                                        MCP2515_RXMODE_ANY_FILTER);
+
+    if (rv)
+        printf("%s: failed to program masks and filters.\n", __FUNCTION__);
+
+    // return to the original mode regardless
+    upm_result_t mrv = mcp2515_set_opmode(dev, opmode);
+    if (mrv)
+        printf("%s: mcp2515_set_opmode() failed.\n", __FUNCTION__);
+
+    return (rv) ? rv : mrv;
+}
@@ -33,7 +33,7 @@ using namespace upm;
 using namespace std;
 
 MCP2515::MCP2515(int bus, int csPin) :
-    m_mcp2515(mcp2515_init(bus, csPin))
+    m_mcp2515(mcp2515_init(bus, csPin)), m_timestamp(0)
 {
     if (!m_mcp2515)
         throw std::runtime_error(string(__FUNCTION__)
@@ -152,6 +152,64 @@ void MCP2515::uninstallISR()
     mcp2515_uninstall_isr(m_mcp2515);
 }
 
+void MCP2515::startRX(int pin, unsigned int ringSize)
+{
+    if (mcp2515_rx_start(m_mcp2515, pin, ringSize))
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": mcp2515_rx_start() failed");
+}
+
+void MCP2515::stopRX()
+{
+    mcp2515_rx_stop(m_mcp2515);
+}
+
+bool MCP2515::rxDequeue(int timeoutMs)
+{
+    MCP2515_FRAME_T frame;
+
+    if (mcp2515_rx_dequeue(m_mcp2515, &frame, timeoutMs))
+        return false;
+
+    m_message = frame.msg;
+    m_timestamp = frame.timestamp;
+
+    return true;
+}
+
+unsigned int MCP2515::rxPending()
+{
+    return mcp2515_rx_pending(m_mcp2515);
+}
+
+uint32_t MCP2515::getRXRingOverflows()
+{
+    return mcp2515_rx_ring_overflows(m_mcp2515);
+}
+
+uint32_t MCP2515::getRXDeviceOverflows()
+{
+    return mcp2515_rx_device_overflows(m_mcp2515);
+}
+
+MCP2515_FILTER_PLAN_T MCP2515::planFilters(std::vector<int> ids, bool ext)
+{
+    MCP2515_FILTER_PLAN_T plan;
+
+    if (mcp2515_plan_filters(ids.data(), ids.size(), ext, &plan))
+        throw std::invalid_argument(string(__FUNCTION__)
+                                    + ": mcp2515_plan_filters() failed");
+
+    return plan;
+}
+
+void MCP2515::applyFilterPlan(const MCP2515_FILTER_PLAN_T &plan)
+{
+    if (mcp2515_apply_filter_plan(m_mcp2515, &plan))
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": mcp2515_apply_filter_plan() failed");
+}
+
 void MCP2515::setIntrEnables(uint8_t enables)
 {
     if (mcp2515_set_intr_enables(m_mcp2515, enables))
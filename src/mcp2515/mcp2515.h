@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <pthread.h>
 #include <upm.h>
 
 #include <mraa/i2c.h>
@@ -38,6 +39,9 @@
 extern "C" {
 #endif
 
+// default number of frames held by the interrupt driven receive ring
+#define MCP2515_RX_RING_SIZE (256)
+
     /**
      * @file mcp2515
      * @library mcp2515
@@ -58,6 +62,27 @@ extern "C" {
 
         // interrupt, if enabled
         mraa_gpio_context       intr;
+
+        // serializes SPI transactions between the caller and the
+        // receive ISR
+        pthread_mutex_t         bus_lock;
+
+        // interrupt driven receive ring.  rx_head is only written by
+        // the ISR, rx_tail only by the reader.
+        MCP2515_FRAME_T         *rx_ring;
+        unsigned int            rx_ring_size;
+        unsigned int            rx_head;
+        unsigned int            rx_tail;
+        bool                    rx_running;
+
+        // frames dropped because the ring was full, and frames lost
+        // by the device itself (RXnOVR)
+        uint32_t                rx_ring_overflows;
+        uint32_t                rx_device_overflows;
+
+        // held by the ISR while draining, and used to wake readers
+        pthread_mutex_t         rx_lock;
+        pthread_cond_t          rx_cond;
     } *mcp2515_context;
 
     /**
@@ -317,6 +342,116 @@ extern "C" {
      */
     void mcp2515_uninstall_isr(const mcp2515_context dev);
 
+    /**
+     * Start interrupt driven reception.  An ISR is installed on the
+     * given pin which, on every interrupt, drains RXB0 and RXB1 using
+     * the READ RX BUFFER instruction and places the decoded,
+     * timestamped frames into a lock-free ring.  Rollover from RXB0
+     * to RXB1 is enabled, as are the RX0 and RX1 interrupts.  Frames
+     * are retrieved with mcp2515_rx_dequeue().
+     *
+     * This replaces any ISR previously installed with
+     * mcp2515_install_isr().  While running, you should not call
+     * mcp2515_get_rx_msg() yourself.
+     *
+     * @param dev Device context.
+     * @param pin GPIO pin connected to the MCP2515 INT output.
+     * @param ring_size The number of frames the ring can hold.  This
+     * will be rounded up to a power of 2.  Pass 0 to use
+     * MCP2515_RX_RING_SIZE.
+     * @return UPM result.
+     */
+    upm_result_t mcp2515_rx_start(const mcp2515_context dev, int pin,
+                                  unsigned int ring_size);
+
+    /**
+     * Stop interrupt driven reception.  The ISR is removed and the RX
+     * interrupts are disabled.  Any frames remaining in the ring can
+     * still be retrieved with mcp2515_rx_dequeue().
+     *
+     * @param dev Device context.
+     */
+    void mcp2515_rx_stop(const mcp2515_context dev);
+
+    /**
+     * Retrieve the oldest frame from the receive ring.  Only one
+     * thread should be retrieving frames at a time.
+     *
+     * @param dev Device context.
+     * @param frame A pointer to a MCP2515_FRAME_T in which the frame
+     * will be stored.
+     * @param timeout_ms The maximum number of milliseconds to wait
+     * for a frame.  0 means don't wait, a negative value means wait
+     * forever (or until mcp2515_rx_stop() is called).
+     * @return UPM_SUCCESS if a frame was returned,
+     * UPM_ERROR_TIMED_OUT if no frame was available, or
+     * UPM_ERROR_NO_RESOURCES if reception was never started.
+     */
+    upm_result_t mcp2515_rx_dequeue(const mcp2515_context dev,
+                                    MCP2515_FRAME_T *frame, int timeout_ms);
+
+    /**
+     * Return the number of frames waiting in the receive ring.
+     *
+     * @param dev Device context.
+     * @return The number of frames waiting.
+     */
+    unsigned int mcp2515_rx_pending(const mcp2515_context dev);
+
+    /**
+     * Return the number of frames dropped because the receive ring
+     * was full.  This is reset by mcp2515_rx_start().
+     *
+     * @param dev Device context.
+     * @return The number of frames dropped.
+     */
+    uint32_t mcp2515_rx_ring_overflows(const mcp2515_context dev);
+
+    /**
+     * Return the number of times the receive ISR found an RX buffer
+     * overflow flag (EFLG RX0OVR/RX1OVR) set, meaning the device
+     * itself lost at least one frame because it could not be drained
+     * fast enough.  This is reset by mcp2515_rx_start().
+     *
+     * @param dev Device context.
+     * @return The number of device overflows detected.
+     */
+    uint32_t mcp2515_rx_device_overflows(const mcp2515_context dev);
+
+    /**
+     * Compute acceptance masks and filters that let the given set of
+     * CAN ids through while rejecting as much other traffic as
+     * possible.  Up to 6 ids are matched exactly.  For larger sets
+     * the ids are split between the two RX buffers and each mask is
+     * widened just enough for that buffer's filters to cover its ids,
+     * so some unwanted ids may still be accepted (see the accepted
+     * member of the plan).  Use mcp2515_apply_filter_plan() to
+     * program the result into the device.
+     *
+     * @param ids An array of CAN ids.
+     * @param count The number of ids in the array.
+     * @param ext True if the ids are extended (29 bit), false for
+     * standard (11 bit).
+     * @param plan A pointer to a MCP2515_FILTER_PLAN_T in which the
+     * computed masks and filters will be stored.
+     * @return UPM result.
+     */
+    upm_result_t mcp2515_plan_filters(const int *ids, unsigned int count,
+                                      bool ext, MCP2515_FILTER_PLAN_T *plan);
+
+    /**
+     * Program the masks and filters from a plan computed by
+     * mcp2515_plan_filters() and enable filtering on both RX
+     * buffers.  The device is temporarily placed in CONFIG mode, and
+     * then returned to the operating mode it was in.
+     *
+     * @param dev Device context.
+     * @param plan A pointer to the plan to apply.
+     * @return UPM result.
+     */
+    upm_result_t mcp2515_apply_filter_plan(const mcp2515_context dev,
+                                           const MCP2515_FILTER_PLAN_T *plan);
+
     /**
      * Set the interrupt enables register.
      *
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "mcp2515.h"
 
@@ -265,6 +266,19 @@ namespace upm {
             return m_message.id;
         }
 
+        /**
+         * This method returns the time at which a received message
+         * was read from the device.  It will only be valid after a
+         * successful completion of rxDequeue().
+         *
+         * @return Timestamp of the last dequeued message in
+         * microseconds (CLOCK_MONOTONIC).
+         */
+        uint64_t msgGetTimestamp()
+        {
+            return m_timestamp;
+        }
+
         /**
          * This method returns the RTR flag of a received message.  It will
          * only be valid after a successful completion of rxGetMsg().
@@ -344,6 +358,83 @@ namespace upm {
          */
         void uninstallISR();
 
+        /**
+         * Start interrupt driven reception.  An ISR is installed on
+         * the given pin which drains both RX buffers into a
+         * timestamped ring on every interrupt.  Use rxDequeue() to
+         * retrieve the frames.  This replaces any ISR installed with
+         * installISR(), and getRXMsg() should not be used while it is
+         * running.
+         *
+         * @param pin GPIO pin connected to the MCP2515 INT output.
+         * @param ringSize The number of frames the ring can hold,
+         * rounded up to a power of 2.  Default is
+         * MCP2515_RX_RING_SIZE.
+         */
+        void startRX(int pin, unsigned int ringSize=MCP2515_RX_RING_SIZE);
+
+        /**
+         * Stop interrupt driven reception.  Frames remaining in the
+         * ring can still be retrieved with rxDequeue().
+         */
+        void stopRX();
+
+        /**
+         * Retrieve the oldest frame from the receive ring.  The
+         * message is stored within the class, and can be accessed
+         * with the msgGet*() methods.
+         *
+         * @param timeoutMs The maximum number of milliseconds to wait
+         * for a frame.  0 means don't wait, a negative value means
+         * wait forever (or until stopRX() is called).
+         * @return True if a frame was retrieved, false otherwise.
+         */
+        bool rxDequeue(int timeoutMs);
+
+        /**
+         * Return the number of frames waiting in the receive ring.
+         *
+         * @return The number of frames waiting.
+         */
+        unsigned int rxPending();
+
+        /**
+         * Return the number of frames dropped because the receive
+         * ring was full.
+         *
+         * @return The number of frames dropped.
+         */
+        uint32_t getRXRingOverflows();
+
+        /**
+         * Return the number of times the receive ISR found an RX
+         * buffer overflow flag set on the device.
+         *
+         * @return The number of device overflows detected.
+         */
+        uint32_t getRXDeviceOverflows();
+
+        /**
+         * Compute acceptance masks and filters that let the given
+         * CAN ids through while rejecting as much other traffic as
+         * possible.  Up to 6 ids are matched exactly.  See
+         * mcp2515_plan_filters() for details.
+         *
+         * @param ids A vector of CAN ids.
+         * @param ext True if the ids are extended, false for standard.
+         * @return The computed MCP2515_FILTER_PLAN_T.
+         */
+        MCP2515_FILTER_PLAN_T planFilters(std::vector<int> ids, bool ext);
+
+        /**
+         * Program the masks and filters from a plan computed by
+         * planFilters() and enable filtering on both RX buffers.
+         * The device is temporarily placed in CONFIG mode.
+         *
+         * @param plan The plan to apply.
+         */
+        void applyFilterPlan(const MCP2515_FILTER_PLAN_T &plan);
+
         /**
          * Set the interrupt enables register.
          *
@@ -437,6 +528,9 @@ namespace upm {
         // simplify SWIG accesses.
         MCP2515_MSG_T m_message;
 
+        // timestamp of the last message retrieved with rxDequeue()
+        uint64_t m_timestamp;
+
         /**
          * Perform a bus read.  This function is exposed here for those
          * users wishing to perform their own low level accesses.  This is
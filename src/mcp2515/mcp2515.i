@@ -14,6 +14,7 @@ JAVA_ADD_INSTALLISR_PIN(upm::MCP2515)
 
 /* BEGIN Common SWIG syntax ------------------------------------------------- */
 %include "../carrays_uint8_t.i"
+%include "../upm_vectortypes.i"
 %pointer_functions(float, floatp);
 
 %{
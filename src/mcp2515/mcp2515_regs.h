@@ -98,6 +98,26 @@ extern "C" {
         MCP2515_PKT_T pkt;
     } MCP2515_MSG_T;
 
+    // A received message as stored in the interrupt driven receive
+    // ring, along with the time (in microseconds, CLOCK_MONOTONIC) at
+    // which it was pulled from the device.
+    typedef struct {
+        MCP2515_MSG_T msg;
+        uint64_t timestamp;
+    } MCP2515_FRAME_T;
+
+    // A set of acceptance masks and filters computed from a list of
+    // CAN ids.  Mask 0 and filters 0-1 apply to RXB0, mask 1 and
+    // filters 2-5 apply to RXB1.
+    typedef struct {
+        bool ext;
+        int masks[2];
+        int filters[6];
+        // upper bound on the number of distinct ids that will be
+        // accepted by the device using this plan
+        uint64_t accepted;
+    } MCP2515_FILTER_PLAN_T;
+
     // Registers
     typedef enum {
         // 5 RX filters, each composed of SIDH, SIDL, EID8, EID0.  We
@@ -162,7 +182,7 @@ extern "C" {
         MCP2515_REG_CANINTE              = 0x2b, // intr enables
         MCP2515_REG_CANINTF              = 0x2c, // intr flags
 
-        MCP2515_REG_EFLG                 = 0x2a, // error flags
+        MCP2515_REG_EFLG                 = 0x2d, // error flags
 
         // Start of the buffer reg ranges for tx and rx buffers.
         // There are 3 transmit buffers and 2 rx buffers.  You can
@@ -597,7 +617,8 @@ extern "C" {
 
         MCP2515_SIDL_EXIDE                  = 0x08,
 
-        // 0x10 reserved
+        MCP2515_SIDL_SRR                    = 0x10, // std remote frame
+                                                    // (RX buffers only)
 
         MCP2515_SIDL_SID0                   = 0x20,
         MCP2515_SIDL_SID1                   = 0x40,
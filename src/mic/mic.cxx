@@ -42,9 +42,21 @@ Microphone::Microphone(int micPin) {
                                     ": mraa_aio_init() failed, invalid pin?");
         return;
       }
+
+    if ( !(m_capture = aiocapture_init_aio(m_micCtx)) )
+      {
+        mraa_aio_close(m_micCtx);
+        throw std::runtime_error(std::string(__FUNCTION__) +
+                                 ": aiocapture_init_aio() failed");
+        return;
+      }
+
+    memset(&m_timing, 0, sizeof(m_timing));
 }
 
 Microphone::~Microphone() {
+    aiocapture_close(m_capture);
+
     // close analog input
     mraa_result_t error;
     error = mraa_aio_close(m_micCtx);
@@ -56,8 +68,6 @@ Microphone::~Microphone() {
 int
 Microphone::getSampledWindow (unsigned int freqMS, int numberOfSamples,
                             uint16_t * buffer) {
-    int sampleIdx = 0;
-
     // must have freq
     if (!freqMS) {
         return 0;
@@ -68,16 +78,16 @@ Microphone::getSampledWindow (unsigned int freqMS, int numberOfSamples,
         return 0;
     }
 
-    while (sampleIdx < numberOfSamples) {
-        int x = mraa_aio_read (m_micCtx);
-        if (x == -1) {
-            return 0;
-        }
-        buffer[sampleIdx++] = x;
-        usleep(freqMS * 1000);
+    if (numberOfSamples <= 0) {
+        return 0;
+    }
+
+    if (aiocapture_capture(m_capture, freqMS * 1000, buffer,
+                           numberOfSamples, &m_timing)) {
+        return 0;
     }
 
-    return sampleIdx;
+    return numberOfSamples;
 }
 
 int
@@ -27,6 +27,8 @@
 #include <mraa/gpio.h>
 #include <mraa/aio.h>
 
+#include <aiocapture.h>
+
 struct thresholdContext {
     long averageReading;
     unsigned long runningAverage;
@@ -74,9 +76,11 @@ class Microphone {
 
         /**
          * Gets samples from the microphone according to the provided window and
-         * number of samples
+         * number of samples.  The samples are taken by a capture thread
+         * against absolute deadlines, so the spacing does not drift with
+         * the time taken by each read.
          *
-         * @param freqMS Time between each sample (in microseconds)
+         * @param freqMS Time between each sample (in milliseconds)
          * @param numberOfSamples Number of sample to sample for this window
          * @param buffer Buffer with sampled data
          */
@@ -101,8 +105,31 @@ class Microphone {
          */
         void printGraph (thresholdContext* ctx);
 
+        /**
+         * Returns the sample rate achieved by the last call to
+         * getSampledWindow()
+         *
+         * @return The sample rate in Hz
+         */
+        float getSampleRate () {
+            return m_timing.rate;
+        }
+
+        /**
+         * Returns the timing jitter of the samples taken by the last call
+         * to getSampledWindow()
+         *
+         * @return The standard deviation of the sample times, in
+         * microseconds
+         */
+        float getJitter () {
+            return m_timing.jitter;
+        }
+
     private:
         mraa_aio_context    m_micCtx;
+        aiocapture_context  m_capture;
+        AIOCAPTURE_TIMING_T m_timing;
 };
 
 }
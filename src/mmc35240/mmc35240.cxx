@@ -60,6 +60,8 @@ MMC35240::MMC35240(int device)
                                     ": mraa_iio_init() failed, invalid device?");
         return;
     }
+    m_capture = new IIOCapture(device);
+    m_chan[0] = m_chan[1] = m_chan[2] = -1;
     m_scale = 1;
     m_iio_device_num = device;
     sprintf(trigger, "hrtimer-mmc35240-hr-dev%d", device);
@@ -94,6 +96,7 @@ MMC35240::~MMC35240()
         free(m_filter.history_sum);
         m_filter.history_sum = NULL;
     }
+    delete m_capture;
     if (m_iio)
         mraa_iio_close(m_iio);
 }
@@ -101,7 +104,7 @@ MMC35240::~MMC35240()
 void
 MMC35240::installISR(void (*isr)(char*, void*), void* arg)
 {
-    mraa_iio_trigger_buffer(m_iio, isr, arg);
+    m_capture->installHandler(isr, arg);
 }
 
 int64_t
@@ -157,19 +160,15 @@ MMC35240::getChannelValue(unsigned char* input, mraa_iio_channel* chan)
 }
 
 bool
-MMC35240::enableBuffer(int length)
+MMC35240::enableBuffer(int length, int watermark)
 {
-    mraa_iio_write_int(m_iio, "buffer/length", length);
-    // enable must be last step, else will have error in writing above config
-    mraa_iio_write_int(m_iio, "buffer/enable", 1);
-    return true;
+    return m_capture->enableBuffer(length, watermark);
 }
 
 bool
 MMC35240::disableBuffer()
 {
-    mraa_iio_write_int(m_iio, "buffer/enable", 0);
-    return true;
+    return m_capture->disableBuffer();
 }
 
 bool
@@ -194,26 +193,31 @@ MMC35240::enable3AxisChannel()
     char trigger[64];
     sprintf(trigger, "mmc35240-hr-dev%d", m_iio_device_num);
 
-    mraa_iio_write_string(m_iio, "trigger/current_trigger", trigger);
-    mraa_iio_write_int(m_iio, "scan_elements/in_magn_x_en", 1);
-    mraa_iio_write_int(m_iio, "scan_elements/in_magn_y_en", 1);
-    mraa_iio_write_int(m_iio, "scan_elements/in_magn_z_en", 1);
+    m_capture->setTrigger(trigger);
+    m_capture->enableChannel("in_magn_x");
+    m_capture->enableChannel("in_magn_y");
+    m_capture->enableChannel("in_magn_z");
 
     // need update channel data size after enable
-    mraa_iio_update_channels(m_iio);
-    return true;
+    if (!m_capture->updateChannels())
+        return false;
+
+    m_chan[0] = m_capture->getChannelIndex("in_magn_x");
+    m_chan[1] = m_capture->getChannelIndex("in_magn_y");
+    m_chan[2] = m_capture->getChannelIndex("in_magn_z");
+
+    return m_chan[0] >= 0 && m_chan[1] >= 0 && m_chan[2] >= 0;
 }
 
 void
 MMC35240::extract3Axis(char* data, float* x, float* y, float* z)
 {
-    mraa_iio_channel* channels = mraa_iio_get_channels(m_iio);
     float tmp[3];
     int64_t iio_x, iio_y, iio_z;
 
-    iio_x = getChannelValue((unsigned char*) (data), &channels[0]);
-    iio_y = getChannelValue((unsigned char*) (data + 4), &channels[1]);
-    iio_z = getChannelValue((unsigned char*) (data + 8), &channels[2]);
+    iio_x = m_capture->getChannelValue(data, m_chan[0]);
+    iio_y = m_capture->getChannelValue(data, m_chan[1]);
+    iio_z = m_capture->getChannelValue(data, m_chan[2]);
 
     // Raw data is magnetic field along axis x, y, and z. Units after application of scale are Gauss
     *x = CONVERT_GAUSS_TO_MICROTESLA(iio_x * m_scale);
@@ -234,6 +238,37 @@ MMC35240::extract3Axis(char* data, float* x, float* y, float* z)
     denoise_average(x, y, z);
 }
 
+int64_t
+MMC35240::getTimestamp(char* data)
+{
+    return m_capture->getTimestamp(data);
+}
+
+int
+MMC35240::readSamples(float* xyz, int64_t* timestamps, int count, int timeoutMs)
+{
+    int got = 0;
+    int avail = m_capture->waitScans(timeoutMs);
+
+    if (avail > 0) {
+        for (int i = 0; i < avail && got < count; i++, got++) {
+            char* data = m_capture->getScan(i);
+            extract3Axis(data, &xyz[got * 3], &xyz[got * 3 + 1], &xyz[got * 3 + 2]);
+            if (timestamps)
+                timestamps[got] = m_capture->getTimestamp(data);
+        }
+        m_capture->consumeScans(got);
+    }
+
+    return got;
+}
+
+int
+MMC35240::getFd()
+{
+    return m_capture->getFd();
+}
+
 int
 MMC35240::getCalibratedLevel()
 {
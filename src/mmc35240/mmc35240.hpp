@@ -28,6 +28,8 @@
 #include <string>
 #include <mraa/iio.h>
 
+#include "iiocapture.hpp"
+
 // Adopt
 // https://android.googlesource.com/platform/frameworks/native/+/refs/heads/master/services/sensorservice/mat.h
 #include "mat.h"
@@ -118,10 +120,12 @@ class MMC35240
     int64_t getChannelValue(unsigned char* input, mraa_iio_channel* chan);
 
     /**
-     * Enable trigger buffer
+     * Enable trigger buffer.
      * @param length buffer length in integer
+     * @param watermark number of samples the kernel buffers before
+     * delivering them, 1 delivers every sample as it arrives
      */
-    bool enableBuffer(int length);
+    bool enableBuffer(int length, int watermark = 1);
 
     /**
      * Disable trigger buffer
@@ -158,6 +162,36 @@ class MMC35240
      */
     void extract3Axis(char* data, float* x, float* y, float* z);
 
+    /**
+     * Returns the timestamp of a sample taken by the kernel, when the
+     * device has a timestamp scan element.
+     * @param data Enabled channel data
+     * @return Timestamp in nanoseconds, or 0 if not available
+     */
+    int64_t getTimestamp(char* data);
+
+    /**
+     * Read buffered samples, as an alternative to installISR().
+     * This waits for samples, then returns as many as are available,
+     * up to count, processed as with extract3Axis().
+     * @param xyz Array of 3 * count floats to store the x, y, and z
+     * axis of each sample
+     * @param timestamps Array of count timestamps in nanoseconds, or
+     * NULL if not needed
+     * @param count Maximum number of samples
+     * @param timeoutMs Time to wait in milliseconds, -1 to wait forever
+     * @return Number of samples read, 0 on timeout
+     */
+    int readSamples(float* xyz, int64_t* timestamps, int count, int timeoutMs = -1);
+
+    /**
+     * Returns a file descriptor that becomes readable when buffered
+     * samples are available, for use with poll(), select() or epoll
+     * along with readSamples().
+     * @return File descriptor
+     */
+    int getFd();
+
     /**
      * Get calibrated level
      */
@@ -200,6 +234,8 @@ class MMC35240
     void denoise_average(float* x, float* y, float* z);
 
     mraa_iio_context m_iio;
+    IIOCapture* m_capture;
+    int m_chan[3];              // x, y, z positions in a scan
     int m_iio_device_num;
     float m_sampling_frequency; // sampling frequency
     bool m_mount_matrix_exist;  // is mount matrix exist
@@ -0,0 +1,578 @@
+/*
+ * Author: agent <agent@local>
+ * Copyright (c) 2026 agent.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "modbusbus.hpp"
+
+using namespace upm;
+using namespace std;
+
+// one bus per serial port
+static map<string, ModbusBus *> s_buses;
+static pthread_mutex_t s_busesLock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t modbusbus_now_us()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+ModbusBus *ModbusBus::instance(std::string device, int baud, int bits,
+                               char parity, int stopBits)
+{
+  ModbusBus *bus = 0;
+
+  pthread_mutex_lock(&s_busesLock);
+
+  map<string, ModbusBus *>::iterator it = s_buses.find(device);
+  if (it != s_buses.end())
+    {
+      bus = it->second;
+      if (bus->m_baud != baud || bus->m_bits != bits ||
+          bus->m_parity != parity || bus->m_stopBits != stopBits)
+        {
+          pthread_mutex_unlock(&s_busesLock);
+          throw std::out_of_range(std::string(__FUNCTION__) + ": " + device
+                                  + " is already open with different "
+                                  + "line settings");
+        }
+    }
+  else
+    {
+      try
+        {
+          bus = new ModbusBus(device, baud, bits, parity, stopBits);
+        }
+      catch (...)
+        {
+          pthread_mutex_unlock(&s_busesLock);
+          throw;
+        }
+      s_buses[device] = bus;
+    }
+
+  pthread_mutex_unlock(&s_busesLock);
+
+  return bus;
+}
+
+ModbusBus::ModbusBus(std::string device, int baud, int bits, char parity,
+                     int stopBits) :
+  m_mbContext(0), m_device(device), m_baud(baud), m_bits(bits),
+  m_parity(parity), m_stopBits(stopBits), m_lastFrameEnd(0),
+  m_nextPollID(0)
+{
+  // check some of the parameters
+  if (baud <= 0)
+    {
+      throw std::out_of_range(std::string(__FUNCTION__) +
+                              ": baud must be positive");
+    }
+
+  if (!(bits == 7 || bits == 8))
+    {
+      throw std::out_of_range(std::string(__FUNCTION__) +
+                              ": bits must be 7 or 8");
+    }
+
+  if (!(parity == 'N' || parity == 'E' || parity == 'O'))
+    {
+      throw std::out_of_range(std::string(__FUNCTION__) +
+                              ": parity must be 'N', 'O', or 'E'");
+    }
+
+  if (!(stopBits == 1 || stopBits == 2))
+    {
+      throw std::out_of_range(std::string(__FUNCTION__) +
+                              ": stopBits must be 1 or 2");
+    }
+
+  // MODBUS RTU frames are separated by 3.5 characters of silence, a
+  // character being 11 bits.  Above 19200 baud a fixed 1750us is
+  // used.
+  if (baud > 19200)
+    m_interFrameUs = 1750;
+  else
+    m_interFrameUs = (int)((3.5 * 11 * 1000000) / baud + 0.5);
+
+  // now, open/init the device and modbus context
+
+  if (!(m_mbContext = modbus_new_rtu(device.c_str(), baud, parity, bits,
+                                     stopBits)))
+    {
+      throw std::runtime_error(std::string(__FUNCTION__) +
+                               ": modbus_new_rtu() failed");
+    }
+
+  // set the serial mode
+  modbus_rtu_set_serial_mode(m_mbContext, MODBUS_RTU_RS232);
+
+  // now connect..
+  if (modbus_connect(m_mbContext))
+    {
+      modbus_free(m_mbContext);
+      throw std::runtime_error(std::string(__FUNCTION__) +
+                               ": modbus_connect() failed");
+    }
+
+  modbus_get_response_timeout(m_mbContext, &m_defaultTimeoutSec,
+                              &m_defaultTimeoutUsec);
+
+  pthread_mutex_init(&m_lock, NULL);
+}
+
+ModbusBus::~ModbusBus()
+{
+  modbus_close(m_mbContext);
+  modbus_free(m_mbContext);
+  pthread_mutex_destroy(&m_lock);
+}
+
+void ModbusBus::attach(int slave)
+{
+  pthread_mutex_lock(&m_lock);
+
+  map<int, SLAVE_T>::iterator it = m_slaves.find(slave);
+  if (it == m_slaves.end())
+    {
+      SLAVE_T s = {};
+      s.refs = 1;
+      m_slaves[slave] = s;
+    }
+  else
+    it->second.refs++;
+
+  pthread_mutex_unlock(&m_lock);
+}
+
+void ModbusBus::detach(int slave)
+{
+  bool last = false;
+
+  // hold the registry lock so that instance() cannot hand out this
+  // bus while it is being deleted
+  pthread_mutex_lock(&s_busesLock);
+  pthread_mutex_lock(&m_lock);
+
+  map<int, SLAVE_T>::iterator it = m_slaves.find(slave);
+  if (it != m_slaves.end() && --it->second.refs <= 0)
+    {
+      m_slaves.erase(it);
+
+      map<int, POLL_T>::iterator p = m_polls.begin();
+      while (p != m_polls.end())
+        {
+          if (p->second.slave == slave)
+            m_polls.erase(p++);
+          else
+            ++p;
+        }
+
+      last = m_slaves.empty();
+    }
+
+  pthread_mutex_unlock(&m_lock);
+
+  if (last)
+    {
+      s_buses.erase(m_device);
+      delete this;
+    }
+
+  pthread_mutex_unlock(&s_busesLock);
+}
+
+int ModbusBus::transact(OPS_T op, int slave, int reg, int len, void *buf)
+{
+  // observe the inter-frame silence since the end of the last frame
+  uint64_t now = modbusbus_now_us();
+  uint64_t quiet = m_lastFrameEnd + m_interFrameUs;
+  if (now < quiet)
+    usleep(quiet - now);
+
+  SLAVE_T *s = 0;
+  map<int, SLAVE_T>::iterator it = m_slaves.find(slave);
+  if (it != m_slaves.end())
+    s = &it->second;
+
+  if (s && s->timeoutMs > 0)
+    modbus_set_response_timeout(m_mbContext, s->timeoutMs / 1000,
+                                (s->timeoutMs % 1000) * 1000);
+  else
+    modbus_set_response_timeout(m_mbContext, m_defaultTimeoutSec,
+                                m_defaultTimeoutUsec);
+
+  int rv = -1;
+  if (modbus_set_slave(m_mbContext, slave) == 0)
+    {
+      switch (op)
+        {
+        case OP_READ_HOLDING:
+          rv = modbus_read_registers(m_mbContext, reg, len, (uint16_t *)buf);
+          break;
+
+        case OP_READ_INPUT:
+          rv = modbus_read_input_registers(m_mbContext, reg, len,
+                                           (uint16_t *)buf);
+          break;
+
+        case OP_WRITE_HOLDING:
+          rv = modbus_write_register(m_mbContext, reg, len);
+          break;
+
+        case OP_READ_COILS:
+          rv = modbus_read_bits(m_mbContext, reg, len, (uint8_t *)buf);
+          break;
+
+        case OP_WRITE_COIL:
+          rv = modbus_write_bit(m_mbContext, reg, len);
+          break;
+
+        case OP_REPORT_SLAVE_ID:
+          rv = modbus_report_slave_id(m_mbContext, len, (uint8_t *)buf);
+          break;
+        }
+    }
+
+  int err = errno;
+  m_lastFrameEnd = modbusbus_now_us();
+
+  if (s)
+    {
+      s->stats.requests++;
+
+      if (rv < 0)
+        {
+          s->stats.failures++;
+          if (err == ETIMEDOUT)
+            s->stats.timeouts++;
+          s->stats.consecutiveFailures++;
+
+          // back off exponentially, starting at the minimum
+          uint32_t backoff = MODBUS_BUS_BACKOFF_MIN_MS;
+          for (uint32_t i = 1; i < s->stats.consecutiveFailures &&
+                 backoff < MODBUS_BUS_BACKOFF_MAX_MS; i++)
+            backoff *= 2;
+          s->stats.backoffMs = min(backoff, (uint32_t)MODBUS_BUS_BACKOFF_MAX_MS);
+          s->retryAt = m_lastFrameEnd + (uint64_t)s->stats.backoffMs * 1000;
+        }
+      else
+        {
+          s->stats.consecutiveFailures = 0;
+          s->stats.backoffMs = 0;
+          s->retryAt = 0;
+        }
+    }
+
+  errno = err;
+  return rv;
+}
+
+int ModbusBus::readHoldingRegs(int slave, int reg, int len, uint16_t *buf)
+{
+  pthread_mutex_lock(&m_lock);
+  int rv = transact(OP_READ_HOLDING, slave, reg, len, buf);
+  int err = errno;
+  pthread_mutex_unlock(&m_lock);
+
+  errno = err;
+  return rv;
+}
+
+int ModbusBus::readInputRegs(int slave, int reg, int len, uint16_t *buf)
+{
+  pthread_mutex_lock(&m_lock);
+  int rv = transact(OP_READ_INPUT, slave, reg, len, buf);
+  int err = errno;
+  pthread_mutex_unlock(&m_lock);
+
+  errno = err;
+  return rv;
+}
+
+int ModbusBus::writeHoldingReg(int slave, int reg, int value)
+{
+  pthread_mutex_lock(&m_lock);
+  int rv = transact(OP_WRITE_HOLDING, slave, reg, value, 0);
+  int err = errno;
+  pthread_mutex_unlock(&m_lock);
+
+  errno = err;
+  return rv;
+}
+
+int ModbusBus::readCoils(int slave, int reg, int numBits, uint8_t *buf)
+{
+  pthread_mutex_lock(&m_lock);
+  int rv = transact(OP_READ_COILS, slave, reg, numBits, buf);
+  int err = errno;
+  pthread_mutex_unlock(&m_lock);
+
+  errno = err;
+  return rv;
+}
+
+int ModbusBus::writeCoil(int slave, int reg, bool value)
+{
+  pthread_mutex_lock(&m_lock);
+  int rv = transact(OP_WRITE_COIL, slave, reg, (value) ? TRUE : FALSE, 0);
+  int err = errno;
+  pthread_mutex_unlock(&m_lock);
+
+  errno = err;
+  return rv;
+}
+
+int ModbusBus::reportSlaveID(int slave, int maxLen, uint8_t *buf)
+{
+  pthread_mutex_lock(&m_lock);
+  int rv = transact(OP_REPORT_SLAVE_ID, slave, 0, maxLen, buf);
+  int err = errno;
+  pthread_mutex_unlock(&m_lock);
+
+  errno = err;
+  return rv;
+}
+
+void ModbusBus::setResponseTimeout(int slave, int ms)
+{
+  pthread_mutex_lock(&m_lock);
+  map<int, SLAVE_T>::iterator it = m_slaves.find(slave);
+  if (it != m_slaves.end())
+    it->second.timeoutMs = ms;
+  pthread_mutex_unlock(&m_lock);
+}
+
+void ModbusBus::setInterFrameDelay(int us)
+{
+  pthread_mutex_lock(&m_lock);
+  m_interFrameUs = us;
+  pthread_mutex_unlock(&m_lock);
+}
+
+ModbusBus::SLAVE_STATS_T ModbusBus::getStats(int slave)
+{
+  SLAVE_STATS_T stats = {};
+
+  pthread_mutex_lock(&m_lock);
+  map<int, SLAVE_T>::iterator it = m_slaves.find(slave);
+  if (it != m_slaves.end())
+    stats = it->second.stats;
+  pthread_mutex_unlock(&m_lock);
+
+  return stats;
+}
+
+int ModbusBus::addPoll(int slave, REG_TYPES_T type, int reg, int len,
+                       int intervalMs, POLL_HANDLER_T handler, void *arg)
+{
+  if (len <= 0 || len > MODBUS_MAX_READ_REGISTERS)
+    {
+      throw std::out_of_range(std::string(__FUNCTION__) +
+                              ": len must be between 1 and 125");
+    }
+
+  if (intervalMs <= 0 || !handler)
+    {
+      throw std::out_of_range(std::string(__FUNCTION__) +
+                              ": intervalMs must be positive, and handler "
+                              + "must be set");
+    }
+
+  POLL_T p;
+  p.slave = slave;
+  p.type = type;
+  p.reg = reg;
+  p.len = len;
+  p.intervalMs = intervalMs;
+  p.handler = handler;
+  p.arg = arg;
+  // due immediately
+  p.nextDue = 0;
+
+  pthread_mutex_lock(&m_lock);
+
+  if (m_slaves.find(slave) == m_slaves.end())
+    {
+      pthread_mutex_unlock(&m_lock);
+      throw std::out_of_range(std::string(__FUNCTION__) +
+                              ": slave is not attached to this bus");
+    }
+
+  int id = m_nextPollID++;
+  m_polls[id] = p;
+  pthread_mutex_unlock(&m_lock);
+
+  return id;
+}
+
+void ModbusBus::removePoll(int id)
+{
+  pthread_mutex_lock(&m_lock);
+  m_polls.erase(id);
+  pthread_mutex_unlock(&m_lock);
+}
+
+// sort order for the poll scheduler, ranges on the same slave and
+// register type end up next to each other, in register order
+bool ModbusBus::pollOrder(const std::pair<int, POLL_T *> &a,
+                          const std::pair<int, POLL_T *> &b)
+{
+  if (a.second->slave != b.second->slave)
+    return a.second->slave < b.second->slave;
+  if (a.second->type != b.second->type)
+    return a.second->type < b.second->type;
+  return a.second->reg < b.second->reg;
+}
+
+int ModbusBus::poll()
+{
+  // the handlers to call once the bus is unlocked
+  struct RESULT_T {
+    int id;
+    POLL_HANDLER_T handler;
+    void *arg;
+    vector<uint16_t> regs;
+  };
+  vector<RESULT_T> results;
+
+  pthread_mutex_lock(&m_lock);
+
+  uint64_t now = modbusbus_now_us();
+
+  // collect the due polls of slaves that are not backing off
+  vector<pair<int, POLL_T *> > due;
+  for (map<int, POLL_T>::iterator it = m_polls.begin(); it != m_polls.end();
+       ++it)
+    {
+      SLAVE_T &s = m_slaves[it->second.slave];
+      if (now >= it->second.nextDue && now >= s.retryAt)
+        due.push_back(make_pair(it->first, &it->second));
+    }
+
+  sort(due.begin(), due.end(), pollOrder);
+
+  size_t i = 0;
+  while (i < due.size())
+    {
+      POLL_T *first = due[i].second;
+      int start = first->reg;
+      int end = first->reg + first->len;
+
+      // merge the following ranges on the same slave and register type
+      // as long as the gap is small and the read stays legal
+      size_t j = i + 1;
+      while (j < due.size())
+        {
+          POLL_T *p = due[j].second;
+          int pEnd = max(end, p->reg + p->len);
+
+          if (p->slave != first->slave || p->type != first->type ||
+              p->reg > end + MODBUS_BUS_MAX_GAP ||
+              pEnd - start > MODBUS_MAX_READ_REGISTERS)
+            break;
+
+          end = pEnd;
+          j++;
+        }
+
+      // a slave that failed earlier in this pass is backing off now
+      if (now < m_slaves[first->slave].retryAt)
+        {
+          i = j;
+          continue;
+        }
+
+      uint16_t buf[MODBUS_MAX_READ_REGISTERS];
+      int rv = transact((first->type == REGS_INPUT) ? OP_READ_INPUT
+                        : OP_READ_HOLDING, first->slave, start, end - start,
+                        buf);
+
+      for (size_t k = i; k < j; k++)
+        {
+          POLL_T *p = due[k].second;
+
+          // keep to the schedule, unless we have fallen behind
+          p->nextDue += (uint64_t)p->intervalMs * 1000;
+          if (p->nextDue < now)
+            p->nextDue = now + (uint64_t)p->intervalMs * 1000;
+
+          if (rv == end - start)
+            {
+              RESULT_T r;
+              r.id = due[k].first;
+              r.handler = p->handler;
+              r.arg = p->arg;
+              r.regs.assign(buf + (p->reg - start),
+                            buf + (p->reg - start) + p->len);
+              results.push_back(r);
+            }
+        }
+
+      i = j;
+    }
+
+  // work out when the next poll is due
+  int wait = -1;
+  now = modbusbus_now_us();
+  for (map<int, POLL_T>::iterator it = m_polls.begin(); it != m_polls.end();
+       ++it)
+    {
+      uint64_t when = max(it->second.nextDue,
+                          m_slaves[it->second.slave].retryAt);
+      int ms = (when > now) ? (int)((when - now + 999) / 1000) : 0;
+
+      if (wait < 0 || ms < wait)
+        wait = ms;
+    }
+
+  pthread_mutex_unlock(&m_lock);
+
+  for (size_t k = 0; k < results.size(); k++)
+    results[k].handler(&results[k].regs[0], results[k].regs.size(),
+                       results[k].arg);
+
+  return wait;
+}
+
+void ModbusBus::setDebug(bool enable)
+{
+  pthread_mutex_lock(&m_lock);
+
+  if (enable)
+    modbus_set_debug(m_mbContext, 1);
+  else
+    modbus_set_debug(m_mbContext, 0);
+
+  pthread_mutex_unlock(&m_lock);
+}
@@ -0,0 +1,367 @@
+/*
+ * Author: agent <agent@local>
+ * Copyright (c) 2026 agent.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <map>
+#include <utility>
+
+#include <modbus/modbus.h>
+
+// minimum and maximum time a failing slave is skipped by the poll
+// scheduler, doubling with each consecutive failure
+#define MODBUS_BUS_BACKOFF_MIN_MS 1000
+#define MODBUS_BUS_BACKOFF_MAX_MS 60000
+
+// largest run of unrequested registers the poll scheduler will read
+// to merge two requests into one transaction
+#define MODBUS_BUS_MAX_GAP 8
+
+namespace upm {
+
+  /**
+   * @brief Shared MODBUS RTU bus
+   * @defgroup modbusbus libupm-modbusbus
+   * @ingroup uart
+   */
+
+  /**
+   * @library modbusbus
+   * @comname Shared MODBUS RTU Bus
+   * @con uart
+   *
+   * @brief UPM API for a MODBUS RTU serial line shared by several devices
+   *
+   * This class owns the libmodbus context of a serial port so that
+   * several UPM MODBUS drivers (such as T3311, HWXPXX and H803X) can
+   * talk to devices on the same RS-485 line.  There is one instance
+   * per serial port, obtained with instance().  Drivers attach() with
+   * their slave address, and every transaction selects the slave,
+   * applies that slave's response timeout and waits out the 3.5
+   * character inter-frame silence required by MODBUS RTU before it is
+   * sent.
+   *
+   * In addition to direct register access, the bus has a poll
+   * scheduler.  Register ranges are added with addPoll(), each with
+   * its own interval.  Every call to poll() reads the ranges that are
+   * due, merging adjacent or nearby ranges on the same slave into a
+   * single transaction, and hands each range its data.  A slave that
+   * fails is skipped with an exponential backoff so that one dead
+   * device does not stall the rest of the line.  Per-slave statistics
+   * are available with getStats().
+   *
+   * All methods are thread safe, transactions are serialized.
+   */
+  class ModbusBus {
+  public:
+
+    /**
+     * Register types that can be polled
+     */
+    typedef enum {
+      REGS_HOLDING                  = 0,
+      REGS_INPUT                    = 1
+    } REG_TYPES_T;
+
+    /**
+     * Per-slave transaction statistics
+     */
+    typedef struct {
+      // total transactions attempted
+      uint32_t requests;
+      // transactions that failed for any reason, including timeouts
+      uint32_t failures;
+      // transactions that timed out
+      uint32_t timeouts;
+      // failures since the last successful transaction
+      uint32_t consecutiveFailures;
+      // current poll backoff in milliseconds, 0 when not backing off
+      uint32_t backoffMs;
+    } SLAVE_STATS_T;
+
+    /**
+     * Handler for a completed poll.  regs points to len registers,
+     * starting at the register passed to addPoll().  It is only
+     * called on success, from the thread calling poll(), with the bus
+     * unlocked.
+     */
+    typedef void (*POLL_HANDLER_T)(const uint16_t *regs, int len, void *arg);
+
+    /**
+     * Get the bus for a serial port, opening the port if this is the
+     * first request for it.  All devices on the port must use the same
+     * line settings.
+     *
+     * @param device Path to the serial interface (/dev/ttyUSB0, etc)
+     * @param baud The baud rate
+     * @param bits The number of bits per byte, 7 or 8
+     * @param parity One of 'N', 'E', or 'O'
+     * @param stopBits The number of stop bits, 1 or 2
+     * @return Pointer to the bus for this port
+     * @throws std::out_of_range on bad parameters, or if the port is
+     * already open with different settings
+     * @throws std::runtime_error if the port cannot be opened
+     */
+    static ModbusBus *instance(std::string device, int baud=19200, int bits=8,
+                               char parity='N', int stopBits=1);
+
+    /**
+     * Attach a slave to the bus.  The bus stays open until every
+     * attach() has been matched by a detach().  A slave address may be
+     * attached more than once.
+     *
+     * @param slave The slave address, 1-247
+     */
+    void attach(int slave);
+
+    /**
+     * Detach a slave from the bus.  When the last attachment of a slave
+     * goes away its polls are removed.  When the last slave goes away,
+     * the port is closed and this instance is deleted.
+     *
+     * @param slave The slave address passed to attach()
+     */
+    void detach(int slave);
+
+    /**
+     * Read holding registers from a slave.
+     *
+     * @param slave The slave address
+     * @param reg The first register
+     * @param len The number of registers
+     * @param buf The buffer to store the registers in
+     * @return The number of registers read, or -1 on error, with errno
+     * set as by libmodbus
+     */
+    int readHoldingRegs(int slave, int reg, int len, uint16_t *buf);
+
+    /**
+     * Read input registers from a slave.
+     *
+     * @param slave The slave address
+     * @param reg The first register
+     * @param len The number of registers
+     * @param buf The buffer to store the registers in
+     * @return The number of registers read, or -1 on error, with errno
+     * set as by libmodbus
+     */
+    int readInputRegs(int slave, int reg, int len, uint16_t *buf);
+
+    /**
+     * Write a holding register on a slave.
+     *
+     * @param slave The slave address
+     * @param reg The register
+     * @param value The value to write
+     * @return 1 on success, or -1 on error, with errno set as by
+     * libmodbus
+     */
+    int writeHoldingReg(int slave, int reg, int value);
+
+    /**
+     * Read coils from a slave.
+     *
+     * @param slave The slave address
+     * @param reg The first coil
+     * @param numBits The number of coils
+     * @param buf The buffer to store the coils in, one per byte
+     * @return The number of coils read, or -1 on error, with errno set
+     * as by libmodbus
+     */
+    int readCoils(int slave, int reg, int numBits, uint8_t *buf);
+
+    /**
+     * Write a coil on a slave.
+     *
+     * @param slave The slave address
+     * @param reg The coil
+     * @param value The value to write
+     * @return 1 on success, or -1 on error, with errno set as by
+     * libmodbus
+     */
+    int writeCoil(int slave, int reg, bool value);
+
+    /**
+     * Send a Report Slave ID request to a slave.
+     *
+     * @param slave The slave address
+     * @param maxLen The size of buf
+     * @param buf The buffer to store the response in
+     * @return The number of bytes received, or -1 on error, with errno
+     * set as by libmodbus
+     */
+    int reportSlaveID(int slave, int maxLen, uint8_t *buf);
+
+    /**
+     * Set how long to wait for a response from a slave.  The default
+     * is the libmodbus default of 500ms.
+     *
+     * @param slave The slave address
+     * @param ms The response timeout in milliseconds
+     */
+    void setResponseTimeout(int slave, int ms);
+
+    /**
+     * Override the silent interval observed before each frame.  It
+     * defaults to 3.5 characters at the bus baud rate, or 1750us above
+     * 19200 baud, as specified by MODBUS RTU.
+     *
+     * @param us The interval in microseconds
+     */
+    void setInterFrameDelay(int us);
+
+    /**
+     * Get the transaction statistics of a slave.
+     *
+     * @param slave The slave address
+     * @return The statistics, all zero for an unknown slave
+     */
+    SLAVE_STATS_T getStats(int slave);
+
+    /**
+     * Add a register range to the poll scheduler.
+     *
+     * @param slave The slave address
+     * @param type The register type
+     * @param reg The first register
+     * @param len The number of registers, at most 125
+     * @param intervalMs How often to read the range, in milliseconds
+     * @param handler Called with the registers after each successful
+     * read
+     * @param arg Passed to the handler
+     * @return An id for removePoll()
+     * @throws std::out_of_range on bad parameters, or if the slave is
+     * not attached
+     */
+    int addPoll(int slave, REG_TYPES_T type, int reg, int len,
+                int intervalMs, POLL_HANDLER_T handler, void *arg);
+
+    /**
+     * Remove a register range from the poll scheduler.
+     *
+     * @param id The id returned by addPoll()
+     */
+    void removePoll(int id);
+
+    /**
+     * Read every poll that is due, then call the handlers of the ones
+     * that succeeded.  Call this in a loop, sleeping for the returned
+     * time in between.  Drivers with scheduled polls should be
+     * destroyed from the thread calling poll().
+     *
+     * @return Milliseconds until the next poll is due, or -1 if there
+     * are no polls
+     */
+    int poll();
+
+    /**
+     * Enable or disable libmodbus debugging output for the bus.
+     *
+     * @param enable true to enable debugging, false otherwise
+     */
+    void setDebug(bool enable);
+
+    /**
+     * Get the serial port of this bus.
+     *
+     * @return The path passed to instance()
+     */
+    std::string getDevice()
+    {
+      return m_device;
+    };
+
+  protected:
+    ModbusBus(std::string device, int baud, int bits, char parity,
+              int stopBits);
+    virtual ~ModbusBus();
+
+    typedef enum {
+      OP_READ_HOLDING               = 0,
+      OP_READ_INPUT,
+      OP_WRITE_HOLDING,
+      OP_READ_COILS,
+      OP_WRITE_COIL,
+      OP_REPORT_SLAVE_ID
+    } OPS_T;
+
+    typedef struct {
+      int refs;
+      // response timeout, 0 for the libmodbus default
+      int timeoutMs;
+      // the poll scheduler skips this slave until then (us)
+      uint64_t retryAt;
+      SLAVE_STATS_T stats;
+    } SLAVE_T;
+
+    typedef struct {
+      int slave;
+      REG_TYPES_T type;
+      int reg;
+      int len;
+      int intervalMs;
+      POLL_HANDLER_T handler;
+      void *arg;
+      // when the poll is next due (us)
+      uint64_t nextDue;
+    } POLL_T;
+
+    static bool pollOrder(const std::pair<int, POLL_T *> &a,
+                          const std::pair<int, POLL_T *> &b);
+
+    // run a transaction, the bus lock must be held
+    int transact(OPS_T op, int slave, int reg, int len, void *buf);
+
+    modbus_t *m_mbContext;
+
+    std::string m_device;
+    int m_baud;
+    int m_bits;
+    char m_parity;
+    int m_stopBits;
+
+    // the bus lock, serializing transactions and protecting the maps
+    pthread_mutex_t m_lock;
+
+    // silent interval before each frame, and when the last one ended
+    int m_interFrameUs;
+    uint64_t m_lastFrameEnd;
+
+    // the libmodbus default response timeout
+    uint32_t m_defaultTimeoutSec;
+    uint32_t m_defaultTimeoutUsec;
+
+    std::map<int, SLAVE_T> m_slaves;
+    std::map<int, POLL_T> m_polls;
+    int m_nextPollID;
+
+  private:
+    /* Disable implicit copy and assignment operators */
+    ModbusBus(const ModbusBus&) = delete;
+    ModbusBus &operator=(const ModbusBus&) = delete;
+  };
+}
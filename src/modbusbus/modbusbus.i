@@ -0,0 +1,14 @@
+%include "../common_top.i"
+
+/* BEGIN Java syntax  ------------------------------------------------------- */
+#ifdef SWIGJAVA
+JAVA_JNI_LOADLIBRARY(javaupm_modbusbus)
+#endif
+/* END Java syntax */
+
+/* BEGIN Common SWIG syntax ------------------------------------------------- */
+%{
+#include "modbusbus.hpp"
+%}
+%include "modbusbus.hpp"
+/* END Common SWIG syntax */
@@ -24,6 +24,7 @@
 
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 #include "nmea_gps.h"
 
@@ -38,20 +39,25 @@
 
 #define UBLOX6_I2C_BYTE_NONE                    0xff // read if no data avail
 
-// static helpers for i2c reading
-static uint8_t readReg(const nmea_gps_context dev, uint8_t reg)
-{
-  assert(dev != NULL);
-  assert(dev->i2c != NULL);
+// how much nmea_gps_update() reads at a time
+#define NMEA_GPS_READ_CHUNK                     1024
 
-  int rv;
-  if ((rv = mraa_i2c_read_byte_data(dev->i2c, reg)) < 0)
-    printf("%s: mraa_i2c_read_byte_data() failed.\n", __FUNCTION__);
+// sentence parser states
+#define NMEA_PARSE_IDLE                         0
+#define NMEA_PARSE_DATA                         1
+#define NMEA_PARSE_CSUM_HI                      2
+#define NMEA_PARSE_CSUM_LO                      3
 
-  // This will return 0xff on errors, which is invalid NMEA data anyway.
-  return (uint8_t)rv;
-}
+// sentence types the parser decodes
+#define NMEA_SENTENCE_OTHER                     0
+#define NMEA_SENTENCE_GGA                       1
+#define NMEA_SENTENCE_RMC                       2
+#define NMEA_SENTENCE_GSA                       3
+#define NMEA_SENTENCE_GSV                       4
+
+#define NMEA_KNOTS_TO_MPS                       0.514444f
 
+// static helpers for i2c reading
 static int readRegs(const nmea_gps_context dev, uint8_t reg,
                     uint8_t *buffer, int len)
 {
@@ -67,6 +73,31 @@ static int readRegs(const nmea_gps_context dev, uint8_t reg,
   return rv;
 }
 
+// Number of bytes waiting in the ublox DDC buffer, read as one two
+// byte burst.  Returns 0 when empty, -1 on error.
+static int ubloxBytesAvail(const nmea_gps_context dev)
+{
+  uint8_t buf[2];
+
+  if (readRegs(dev, UBLOX6_I2C_BYTES_AVAIL_H, buf, 2) != 2)
+    return -1;
+
+  uint16_t total = (buf[0] << 8) | buf[1];
+  // 0xffff means read errors
+  if (total == 0xffff)
+    return -1;
+
+  return total;
+}
+
+static uint64_t nmea_gps_now_us()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 // uart init
 nmea_gps_context nmea_gps_init(unsigned int uart, unsigned int baudrate,
                                int enable_pin)
@@ -214,9 +245,16 @@ int nmea_gps_read(const nmea_gps_context dev, char *buffer, size_t len)
   // i2c ublox
   if (dev->i2c)
     {
-      int rv;
+      // read only what the device has buffered, in a single burst
+      int rv = ubloxBytesAvail(dev);
+      if (rv <= 0)
+        return rv;
+
+      if ((size_t)rv > len)
+        rv = len;
+
       if ((rv = readRegs(dev, UBLOX6_I2C_BYTE_STREAM, (uint8_t *)buffer,
-                         len)) < 0)
+                         rv)) < 0)
         return rv;
 
       // now we need to go through the bytes returned, and stop
@@ -262,17 +300,10 @@ bool nmea_gps_data_available(const nmea_gps_context dev, unsigned int millis)
   if (dev->i2c)
     {
       // here millis is ignored
-      uint8_t h, l;
-
-      h = readReg(dev, UBLOX6_I2C_BYTES_AVAIL_H);
-      l = readReg(dev, UBLOX6_I2C_BYTES_AVAIL_L);
-
-      uint16_t total = (h << 8) | l;
-      // 0 means no data available, 0xffff means read errors
-      if (total == 0x0000 || total == 0xffff)
-        return false;
-      else
+      if (ubloxBytesAvail(dev) > 0)
         return true;
+      else
+        return false;
     }
 
   // uart
@@ -298,3 +329,337 @@ upm_result_t nmea_gps_set_baudrate(const nmea_gps_context dev,
 
   return UPM_SUCCESS;
 }
+
+// sentence parser helpers
+
+static int hex_value(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+
+  return -1;
+}
+
+// locale independent decimal conversion, NMEA always uses '.'
+static double field_to_double(const char *s)
+{
+  double val = 0.0;
+  double scale = 0.1;
+  bool neg = false;
+
+  if (*s == '-')
+    {
+      neg = true;
+      s++;
+    }
+
+  for (; *s >= '0' && *s <= '9'; s++)
+    val = val * 10.0 + (*s - '0');
+
+  if (*s == '.')
+    for (s++; *s >= '0' && *s <= '9'; s++, scale *= 0.1)
+      val += (*s - '0') * scale;
+
+  return (neg) ? -val : val;
+}
+
+static int field_to_int(const char *s)
+{
+  int val = 0;
+
+  for (; *s >= '0' && *s <= '9'; s++)
+    val = val * 10 + (*s - '0');
+
+  return val;
+}
+
+// [d]ddmm.mmmm to decimal degrees
+static double field_to_degrees(const char *s)
+{
+  double val = field_to_double(s);
+  int deg = (int)(val / 100.0);
+
+  return deg + (val - deg * 100.0) / 60.0;
+}
+
+// hhmmss.sss
+static void field_to_time(nmea_gps_fix *fix, const char *s, int len)
+{
+  if (len < 6)
+    return;
+
+  fix->hours = (s[0] - '0') * 10 + (s[1] - '0');
+  fix->minutes = (s[2] - '0') * 10 + (s[3] - '0');
+  fix->seconds = (float)field_to_double(s + 4);
+}
+
+// publish the work fix, readers retry while the sequence is odd or
+// has changed under them
+static void publish_fix(const nmea_gps_context dev)
+{
+  uint32_t seq = dev->fix_seq;
+
+  __atomic_store_n(&dev->fix_seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  dev->fix = dev->work;
+  __atomic_store_n(&dev->fix_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// decode the field that just ended into the work fix
+static void end_field(const nmea_gps_context dev)
+{
+  // truncated fields are not decoded
+  if (dev->field_len > NMEA_GPS_MAX_FIELD)
+    return;
+
+  const char *f = dev->field_buf;
+  int len = dev->field_len;
+  nmea_gps_fix *fix = &dev->work;
+
+  dev->field_buf[len] = 0;
+
+  // the address field, a two character talker followed by the
+  // sentence formatter
+  if (dev->field == 0)
+    {
+      if (len == 5 && f[0] != 'P')
+        {
+          if (!strcmp(f + 2, "GGA"))
+            dev->sentence_type = NMEA_SENTENCE_GGA;
+          else if (!strcmp(f + 2, "RMC"))
+            dev->sentence_type = NMEA_SENTENCE_RMC;
+          else if (!strcmp(f + 2, "GSA"))
+            dev->sentence_type = NMEA_SENTENCE_GSA;
+          else if (!strcmp(f + 2, "GSV"))
+            dev->sentence_type = NMEA_SENTENCE_GSV;
+        }
+      return;
+    }
+
+  // empty fields keep the last reported value
+  if (len == 0)
+    return;
+
+  switch (dev->sentence_type)
+    {
+    case NMEA_SENTENCE_GGA:
+      switch (dev->field)
+        {
+        case 1: field_to_time(fix, f, len); break;
+        case 2: fix->latitude = field_to_degrees(f); break;
+        case 3: if (f[0] == 'S') fix->latitude = -fix->latitude; break;
+        case 4: fix->longitude = field_to_degrees(f); break;
+        case 5: if (f[0] == 'W') fix->longitude = -fix->longitude; break;
+        case 6: fix->quality = field_to_int(f); break;
+        case 7: fix->satellitesUsed = field_to_int(f); break;
+        case 8: fix->hdop = (float)field_to_double(f); break;
+        case 9: fix->altitude = (float)field_to_double(f); break;
+        }
+      break;
+
+    case NMEA_SENTENCE_RMC:
+      switch (dev->field)
+        {
+        case 1: field_to_time(fix, f, len); break;
+        case 2: fix->valid = (f[0] == 'A'); break;
+        case 3: fix->latitude = field_to_degrees(f); break;
+        case 4: if (f[0] == 'S') fix->latitude = -fix->latitude; break;
+        case 5: fix->longitude = field_to_degrees(f); break;
+        case 6: if (f[0] == 'W') fix->longitude = -fix->longitude; break;
+        case 7:
+          fix->speed = (float)field_to_double(f) * NMEA_KNOTS_TO_MPS;
+          break;
+        case 8: fix->course = (float)field_to_double(f); break;
+        case 9:
+          // ddmmyy
+          if (len == 6)
+            {
+              fix->day = (f[0] - '0') * 10 + (f[1] - '0');
+              fix->month = (f[2] - '0') * 10 + (f[3] - '0');
+              fix->year = 2000 + (f[4] - '0') * 10 + (f[5] - '0');
+            }
+          break;
+        }
+      break;
+
+    case NMEA_SENTENCE_GSA:
+      switch (dev->field)
+        {
+        case 2: fix->fixType = field_to_int(f); break;
+        case 15: fix->pdop = (float)field_to_double(f); break;
+        case 16: fix->hdop = (float)field_to_double(f); break;
+        case 17: fix->vdop = (float)field_to_double(f); break;
+        }
+      break;
+
+    case NMEA_SENTENCE_GSV:
+      if (dev->field == 3)
+        fix->satellitesInView = field_to_int(f);
+      break;
+    }
+}
+
+// drop the current sentence, counting it as an error
+static void abort_sentence(const nmea_gps_context dev)
+{
+  dev->parse_state = NMEA_PARSE_IDLE;
+  dev->work = dev->fix;
+  dev->work.errors++;
+  publish_fix(dev);
+}
+
+// returns 1 if c completed a decoded sentence
+static int parse_byte(const nmea_gps_context dev, char c, uint64_t now)
+{
+  // a '$' always starts a new sentence, even in the middle of one
+  if (c == '$')
+    {
+      dev->parse_state = NMEA_PARSE_DATA;
+      dev->sentence_type = NMEA_SENTENCE_OTHER;
+      dev->sentence_len = 1;
+      dev->sentence_time = now;
+      dev->field = 0;
+      dev->field_len = 0;
+      dev->checksum = 0;
+      dev->work = dev->fix;
+      return 0;
+    }
+
+  switch (dev->parse_state)
+    {
+    case NMEA_PARSE_DATA:
+      if (++dev->sentence_len > NMEA_GPS_MAX_SENTENCE || c < 0x20 || c > 0x7e)
+        {
+          // too long, unprintable, or ended without a checksum
+          abort_sentence(dev);
+          return 0;
+        }
+
+      if (c == '*')
+        {
+          end_field(dev);
+          dev->parse_state = NMEA_PARSE_CSUM_HI;
+          return 0;
+        }
+
+      dev->checksum ^= (uint8_t)c;
+
+      if (c == ',')
+        {
+          end_field(dev);
+          dev->field++;
+          dev->field_len = 0;
+          return 0;
+        }
+
+      if (dev->field_len < NMEA_GPS_MAX_FIELD)
+        dev->field_buf[dev->field_len] = c;
+      // keep counting, so that end_field() can see the truncation
+      if (dev->field_len <= NMEA_GPS_MAX_FIELD)
+        dev->field_len++;
+      return 0;
+
+    case NMEA_PARSE_CSUM_HI:
+      if (hex_value(c) < 0)
+        {
+          abort_sentence(dev);
+          return 0;
+        }
+
+      dev->rx_checksum = hex_value(c) << 4;
+      dev->parse_state = NMEA_PARSE_CSUM_LO;
+      return 0;
+
+    case NMEA_PARSE_CSUM_LO:
+      if (hex_value(c) < 0 ||
+          (dev->rx_checksum | hex_value(c)) != dev->checksum)
+        {
+          abort_sentence(dev);
+          return 0;
+        }
+
+      dev->parse_state = NMEA_PARSE_IDLE;
+
+      // sentences we don't decode leave the fix alone
+      if (dev->sentence_type == NMEA_SENTENCE_OTHER)
+        return 0;
+
+      dev->work.sentences++;
+      dev->work.timestamp = dev->sentence_time;
+      publish_fix(dev);
+      return 1;
+
+    default:
+      // waiting for a '$'
+      return 0;
+    }
+}
+
+int nmea_gps_parse(const nmea_gps_context dev, const char *buffer,
+                   size_t len)
+{
+  assert(dev != NULL);
+
+  // every sentence starting in this buffer is stamped with the time
+  // it was handed to us
+  uint64_t now = nmea_gps_now_us();
+  int sentences = 0;
+  size_t i;
+
+  for (i=0; i<len; i++)
+    sentences += parse_byte(dev, buffer[i], now);
+
+  return sentences;
+}
+
+int nmea_gps_update(const nmea_gps_context dev)
+{
+  assert(dev != NULL);
+
+  char buffer[NMEA_GPS_READ_CHUNK];
+  int sentences = 0;
+  int rv;
+
+  // i2c ublox, nmea_gps_read() bursts whatever is buffered
+  if (dev->i2c)
+    {
+      while ((rv = nmea_gps_read(dev, buffer, sizeof(buffer))) > 0)
+        sentences += nmea_gps_parse(dev, buffer, rv);
+
+      return (rv < 0) ? -1 : sentences;
+    }
+
+  // uart
+  while (mraa_uart_data_available(dev->uart, 0))
+    {
+      if ((rv = mraa_uart_read(dev->uart, buffer, sizeof(buffer))) < 0)
+        return -1;
+
+      if (rv == 0)
+        break;
+
+      sentences += nmea_gps_parse(dev, buffer, rv);
+    }
+
+  return sentences;
+}
+
+void nmea_gps_get_fix(const nmea_gps_context dev, nmea_gps_fix *fix)
+{
+  assert(dev != NULL);
+  assert(fix != NULL);
+
+  uint32_t seq1, seq2;
+
+  do
+    {
+      seq1 = __atomic_load_n(&dev->fix_seq, __ATOMIC_ACQUIRE);
+      *fix = dev->fix;
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      seq2 = __atomic_load_n(&dev->fix_seq, __ATOMIC_RELAXED);
+    } while ((seq1 & 1) || seq1 != seq2);
+}
@@ -95,3 +95,28 @@ bool NMEAGPS::dataAvailable(unsigned int millis)
 {
   return nmea_gps_data_available(m_nmea_gps, millis);
 }
+
+int NMEAGPS::update()
+{
+  int rv;
+
+  if ((rv = nmea_gps_update(m_nmea_gps)) < 0)
+    throw std::runtime_error(string(__FUNCTION__)
+                             + ": nmea_gps_update() failed");
+
+  return rv;
+}
+
+int NMEAGPS::parse(std::string buffer)
+{
+  return nmea_gps_parse(m_nmea_gps, buffer.data(), buffer.size());
+}
+
+nmea_gps_fix NMEAGPS::getFix()
+{
+  nmea_gps_fix fix;
+
+  nmea_gps_get_fix(m_nmea_gps, &fix);
+
+  return fix;
+}
@@ -30,6 +30,8 @@
 #include "mraa/i2c.h"
 #include "mraa/gpio.h"
 
+#include "nmea_gps_fix.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -45,6 +47,13 @@ extern "C" {
    * @include nmea_gps_i2c.c
    */
   
+  // longest sentence accepted by the parser, "$" through the checksum
+  // (82 bytes including CR/LF per NMEA 0183, with some headroom for
+  // proprietary sentences)
+#define NMEA_GPS_MAX_SENTENCE   96
+  // longest single field the parser needs to decode
+#define NMEA_GPS_MAX_FIELD      15
+
   /**
    * Device context
    */
@@ -52,6 +61,23 @@ extern "C" {
     mraa_uart_context        uart;
     mraa_gpio_context        gpio_en;
     mraa_i2c_context         i2c;
+
+    // sentence parser state
+    int                      parse_state;
+    int                      sentence_type;
+    int                      sentence_len;
+    int                      field;
+    int                      field_len;
+    char                     field_buf[NMEA_GPS_MAX_FIELD + 1];
+    uint8_t                  checksum;
+    uint8_t                  rx_checksum;
+    uint64_t                 sentence_time;
+
+    // fix being assembled from the current sentence, and the latest
+    // published fix guarded by a sequence counter
+    nmea_gps_fix             work;
+    nmea_gps_fix             fix;
+    uint32_t                 fix_seq;
   } *nmea_gps_context;
   
   /**
@@ -83,7 +109,9 @@ extern "C" {
   void nmea_gps_close(nmea_gps_context dev);
 
   /**
-   * Read character data from the device.
+   * Read character data from the device.  For UBLOX I2C devices, only
+   * the bytes the device has buffered (up to len) are read, in a
+   * single burst.
    *
    * @param dev sensor context
    * @param buffer The character buffer to read data into.
@@ -140,6 +168,42 @@ extern "C" {
   bool nmea_gps_data_available(const nmea_gps_context dev,
                                unsigned int millis);
 
+  /**
+   * Feed NMEA data to the sentence parser.  Bytes are consumed as they
+   * arrive, without buffering whole lines, so data may be split
+   * anywhere.  Checksums are validated as the sentence is parsed, and
+   * GGA, RMC, GSA and GSV sentences with a good checksum (from any
+   * talker) are folded into the fix returned by nmea_gps_get_fix().
+   *
+   * @param dev sensor context
+   * @param buffer The character data to parse.
+   * @param len The number of bytes in buffer.
+   * @return The number of sentences accepted
+   */
+  int nmea_gps_parse(const nmea_gps_context dev, const char *buffer,
+                     size_t len);
+
+  /**
+   * Read all data currently available from the device and feed it to
+   * the sentence parser.  This does not wait for data.  For UBLOX I2C
+   * devices, the data is read in as few bursts as possible.  Call
+   * this from a single thread.
+   *
+   * @param dev sensor context
+   * @return The number of sentences accepted, or -1 on a read error
+   */
+  int nmea_gps_update(const nmea_gps_context dev);
+
+  /**
+   * Get the latest fix assembled by the sentence parser.  This does
+   * not block or take a lock, and is safe to call from any thread
+   * while another thread is parsing.
+   *
+   * @param dev sensor context
+   * @param fix The structure to copy the fix into.
+   */
+  void nmea_gps_get_fix(const nmea_gps_context dev, nmea_gps_fix *fix);
+
 #ifdef __cplusplus
 }
 #endif
@@ -141,6 +141,34 @@ namespace upm {
      */
     bool dataAvailable(unsigned int millis);
 
+    /**
+     * Read all data currently available from the device and feed it
+     * to the NMEA sentence parser.  This does not wait for data.  GGA,
+     * RMC, GSA and GSV sentences with a good checksum are folded into
+     * the fix returned by getFix().  Call this from a single thread.
+     *
+     * @return The number of sentences accepted.
+     */
+    int update();
+
+    /**
+     * Feed NMEA data obtained elsewhere (for instance from readStr())
+     * to the sentence parser, instead of calling update().
+     *
+     * @param buffer The data to parse.
+     * @return The number of sentences accepted.
+     */
+    int parse(std::string buffer);
+
+    /**
+     * Get the latest fix assembled by the sentence parser.  This does
+     * not block or take a lock, and is safe to call from any thread
+     * while another thread calls update().
+     *
+     * @return The latest fix.
+     */
+    nmea_gps_fix getFix();
+
   protected:
     // nmeaGPS device context
     nmea_gps_context m_nmea_gps;
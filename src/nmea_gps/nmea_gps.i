@@ -10,5 +10,6 @@ JAVA_JNI_LOADLIBRARY(javaupm_nmea_gps)
 %{
 #include "nmea_gps.hpp"
 %}
+%include "nmea_gps_fix.h"
 %include "nmea_gps.hpp"
 /* END Common SWIG syntax */
@@ -0,0 +1,83 @@
+/*
+ * Author: agent <agent@local>
+ * Copyright (c) 2026 agent.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+  // This is the latest fix as assembled by the nmea_gps sentence
+  // parser from GGA, RMC, GSA and GSV sentences.  Fields keep their
+  // last reported value until a sentence updates them.
+  typedef struct
+  {
+    // UTC date and time (RMC date, GGA/RMC time)
+    int year;
+    int month;
+    int day;
+    int hours;
+    int minutes;
+    float seconds;
+
+    // position in decimal degrees, negative for S/W, and altitude
+    // above mean sea level in meters
+    double latitude;
+    double longitude;
+    float altitude;
+
+    // speed over ground in meters per second, and true course in
+    // degrees
+    float speed;
+    float course;
+
+    // GGA fix quality (0 = invalid, 1 = GPS, 2 = DGPS, ...), GSA fix
+    // type (1 = none, 2 = 2D, 3 = 3D), and RMC status (1 = valid)
+    int quality;
+    int fixType;
+    int valid;
+
+    // satellites used in the fix (GGA) and in view (GSV)
+    int satellitesUsed;
+    int satellitesInView;
+
+    // dilution of precision (GSA, HDOP also from GGA)
+    float pdop;
+    float hdop;
+    float vdop;
+
+    // CLOCK_MONOTONIC time in microseconds at which the sentence that
+    // last updated this fix was received
+    uint64_t timestamp;
+
+    // sentences accepted, and sentences dropped for a bad checksum
+    // or length
+    unsigned int sentences;
+    unsigned int errors;
+  } nmea_gps_fix;
+
+#ifdef __cplusplus
+}
+#endif
@@ -28,6 +28,8 @@
 
 #include <unistd.h>
 #include <math.h>
+#include <time.h>
+#include <errno.h>
 #include <iostream>
 #include <string>
 #include <stdexcept>
@@ -39,6 +41,12 @@ using namespace std;
 
 
 #define PN532_PACKBUFFSIZ 64
+
+// status byte reads before readData() gives up waiting for RDY
+#define PN532_READY_RETRIES 10
+
+// InListPassiveTarget response timeout used by the tag poller (ms)
+#define PN532_POLL_TIMEOUT 500
 static uint8_t pn532_packetbuffer[PN532_PACKBUFFSIZ];
 
 static uint8_t pn532ack[] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
@@ -55,6 +63,24 @@ PN532::PN532(int irq, int reset, int bus, uint8_t address):
   m_isrInstalled = false;
   m_irqRcvd = false;
 
+  m_pollRunning = false;
+  m_pollFunc = NULL;
+  m_pollArg = NULL;
+  m_pollInterval = 0;
+  m_pollRemoveMisses = 2;
+  m_pollCount = 0;
+
+  pthread_condattr_t condAttrib;
+  pthread_condattr_init(&condAttrib);
+  pthread_condattr_setclock(&condAttrib, CLOCK_MONOTONIC);
+
+  pthread_mutex_init(&m_irqLock, NULL);
+  pthread_cond_init(&m_irqCond, &condAttrib);
+  pthread_mutex_init(&m_pollLock, NULL);
+  pthread_cond_init(&m_pollCond, &condAttrib);
+
+  pthread_condattr_destroy(&condAttrib);
+
   memset(m_uid, 0, 7);
   memset(m_key, 0, 6);
 
@@ -76,8 +102,15 @@ PN532::PN532(int irq, int reset, int bus, uint8_t address):
 
 PN532::~PN532()
 {
+  stopTagPolling();
+
   if (m_isrInstalled)
     m_gpioIRQ.isrExit();
+
+  pthread_cond_destroy(&m_pollCond);
+  pthread_mutex_destroy(&m_pollLock);
+  pthread_cond_destroy(&m_irqCond);
+  pthread_mutex_destroy(&m_irqLock);
 }
 
 bool PN532::init()
@@ -1412,14 +1445,15 @@ bool PN532::readAck()
 /**************************************************************************/
 bool PN532::isReady()
 {
+  bool ready;
+
   // ALWAYS clear the m_irqRcvd flag if set.
-  if (m_irqRcvd)
-    {
-      m_irqRcvd = false;
-      return true;
-    }
+  pthread_mutex_lock(&m_irqLock);
+  ready = m_irqRcvd;
+  m_irqRcvd = false;
+  pthread_mutex_unlock(&m_irqLock);
 
-  return false;
+  return ready;
 }
 
 /**************************************************************************/
@@ -1431,20 +1465,32 @@ bool PN532::isReady()
 /**************************************************************************/
 bool PN532::waitForReady(uint16_t timeout)
 {
-  uint16_t timer = 0;
-  while(!isReady())
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout / 1000;
+  deadline.tv_nsec += (timeout % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000)
     {
-      if (timeout != 0)
-        {
-          timer += 10;
-          if (timer > timeout)
-            {
-              return false;
-            }
-        }
-      usleep(10000);
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
     }
-  return true;
+
+  // sleep until dataReadyISR() signals, a timeout of 0 waits forever
+  pthread_mutex_lock(&m_irqLock);
+  while (!m_irqRcvd)
+    {
+      if (timeout == 0)
+        pthread_cond_wait(&m_irqCond, &m_irqLock);
+      else if (pthread_cond_timedwait(&m_irqCond, &m_irqLock, &deadline)
+               == ETIMEDOUT)
+        break;
+    }
+
+  bool ready = m_irqRcvd;
+  m_irqRcvd = false;
+  pthread_mutex_unlock(&m_irqLock);
+
+  return ready;
 }
 
 /**************************************************************************/
@@ -1461,9 +1507,19 @@ void PN532::readData(uint8_t* buff, uint8_t n)
   int rv;
 
   memset(buf, 0, n+2);
-  usleep(2000); 
 
-  rv = m_i2c.read(buf, n + 2);
+  // callers wait for the IRQ first, so the response is normally
+  // there already.  The first byte is the RDY status, retry briefly
+  // if a stale interrupt woke us early.
+  for (int tries = 0; ; tries++)
+    {
+      rv = m_i2c.read(buf, n + 2);
+
+      if (rv <= 0 || (buf[0] & 0x01) || tries >= PN532_READY_RETRIES)
+        break;
+
+      usleep(1000);
+    }
 
   if (m_pn532Debug)
     {
@@ -1500,8 +1556,6 @@ void PN532::writeCommand(uint8_t* cmd, uint8_t cmdlen)
 
   cmdlen++;
 
-  usleep(2000);     // 2ms max in case board needs to wake up
-
   // command + packet wrapper
   uint8_t buf[cmdlen + 8];
   memset(buf, 0, cmdlen + 8);
@@ -1532,9 +1586,16 @@ void PN532::writeCommand(uint8_t* cmd, uint8_t cmdlen)
 
   if (m_i2c.write(buf, cmdlen + 8 - 1) != mraa::SUCCESS)
     {
-      throw std::runtime_error(std::string(__FUNCTION__) +
-                               ": mraa_i2c_write() failed");
-      return;
+      // the board may have been asleep, give it 2ms to wake up and
+      // try once more
+      usleep(2000);
+
+      if (m_i2c.write(buf, cmdlen + 8 - 1) != mraa::SUCCESS)
+        {
+          throw std::runtime_error(std::string(__FUNCTION__) +
+                                   ": mraa_i2c_write() failed");
+          return;
+        }
     }
 
   if (m_pn532Debug)
@@ -1552,11 +1613,16 @@ void PN532::dataReadyISR(void *ctx)
 
   // if debugging is enabled, indicate when an interrupt occurred, and
   // a previously triggered interrupt was still set.
+  pthread_mutex_lock(&This->m_irqLock);
+
   if (This->m_pn532Debug)
     if (This->m_irqRcvd)
       cerr << __FUNCTION__ << ": INFO: Unhandled IRQ detected." << endl;
 
   This->m_irqRcvd = true;
+  pthread_cond_signal(&This->m_irqCond);
+
+  pthread_mutex_unlock(&This->m_irqLock);
 }
 
 PN532::TAG_TYPE_T PN532::tagType()
@@ -1571,3 +1637,288 @@ PN532::TAG_TYPE_T PN532::tagType()
   else
     return TAG_TYPE_UNKNOWN;
 }
+
+int PN532::listPassiveTargets(TAG_INFO_T *tags, int max)
+{
+  if (max > MAX_POLL_TAGS)
+    max = MAX_POLL_TAGS;
+
+  pn532_packetbuffer[0] = CMD_INLISTPASSIVETARGET;
+  pn532_packetbuffer[1] = max;
+  pn532_packetbuffer[2] = BAUD_MIFARE_ISO14443A;
+
+  if (!sendCommandCheckAck(pn532_packetbuffer, 3, PN532_POLL_TIMEOUT))
+    return -1;
+
+  if (!waitForReady(PN532_POLL_TIMEOUT))
+    {
+      if (m_pn532Debug)
+        cerr << __FUNCTION__ << ": IRQ Timeout" << endl;
+
+      return -1;
+    }
+
+  readData(pn532_packetbuffer, sizeof(pn532_packetbuffer));
+
+  if (pn532_packetbuffer[0] != 0 || pn532_packetbuffer[1] != 0 ||
+      pn532_packetbuffer[2] != 0xff ||
+      pn532_packetbuffer[4] != (uint8_t)(~pn532_packetbuffer[3] + 1) ||
+      pn532_packetbuffer[5] != PN532_PN532TOHOST ||
+      pn532_packetbuffer[6] != RSP_INLISTPASSIVETARGET)
+    {
+      if (m_pn532Debug)
+        cerr << __FUNCTION__ << ": Invalid response frame" << endl;
+
+      return -1;
+    }
+
+  // LEN covers TFI onwards, so the data ends at 5 + LEN
+  int end = 5 + pn532_packetbuffer[3];
+  if (end > PN532_PACKBUFFSIZ)
+    end = PN532_PACKBUFFSIZ;
+
+  /* Each ISO14443A target is reported as:
+
+     Tg, SENS_RES (2), SEL_RES, NFCIDLength, NFCID, [ATS]
+
+     ATS is only present for ISO14443-4 capable targets (SEL_RES bit
+     5), its first byte is its own length.                          */
+
+  int count = 0;
+  int nbTg = pn532_packetbuffer[7];
+  int idx = 8;
+
+  for (int i = 0; i < nbTg && count < max; i++)
+    {
+      if (idx + 5 > end)
+        break;
+
+      uint8_t sak = pn532_packetbuffer[idx + 3];
+      uint8_t uidLen = pn532_packetbuffer[idx + 4];
+
+      if (uidLen > sizeof(tags[count].uid) || idx + 5 + uidLen > end)
+        break;
+
+      tags[count].atqa = (pn532_packetbuffer[idx + 1] << 8) |
+        pn532_packetbuffer[idx + 2];
+      tags[count].sak = sak;
+      tags[count].uidLen = uidLen;
+      memcpy(tags[count].uid, &pn532_packetbuffer[idx + 5], uidLen);
+      count++;
+
+      idx += 5 + uidLen;
+
+      if ((sak & 0x20) && idx < end)
+        idx += pn532_packetbuffer[idx];
+    }
+
+  return count;
+}
+
+void PN532::pollUpdate(const TAG_INFO_T *found, int count)
+{
+  TAG_INFO_T events[MAX_POLL_TAGS * 2];
+  TAG_EVENT_T types[MAX_POLL_TAGS * 2];
+  int nEvents = 0;
+  bool seen[MAX_POLL_TAGS];
+
+  for (int i = 0; i < count; i++)
+    seen[i] = false;
+
+  pthread_mutex_lock(&m_pollLock);
+
+  // age the tags we know about, dropping those gone long enough
+  for (int i = 0; i < m_pollCount; )
+    {
+      bool present = false;
+
+      for (int j = 0; j < count; j++)
+        {
+          if (found[j].uidLen == m_pollTags[i].uidLen &&
+              !memcmp(found[j].uid, m_pollTags[i].uid, found[j].uidLen))
+            {
+              present = true;
+              seen[j] = true;
+              break;
+            }
+        }
+
+      if (present)
+        m_pollMisses[i] = 0;
+      else if (++m_pollMisses[i] >= m_pollRemoveMisses)
+        {
+          types[nEvents] = TAG_EVENT_REMOVED;
+          events[nEvents++] = m_pollTags[i];
+
+          for (int k = i; k < m_pollCount - 1; k++)
+            {
+              m_pollTags[k] = m_pollTags[k + 1];
+              m_pollMisses[k] = m_pollMisses[k + 1];
+            }
+          m_pollCount--;
+          continue;
+        }
+
+      i++;
+    }
+
+  // then add the new arrivals
+  for (int j = 0; j < count; j++)
+    {
+      if (seen[j] || m_pollCount >= MAX_POLL_TAGS)
+        continue;
+
+      m_pollTags[m_pollCount] = found[j];
+      m_pollMisses[m_pollCount] = 0;
+      m_pollCount++;
+
+      types[nEvents] = TAG_EVENT_ARRIVED;
+      events[nEvents++] = found[j];
+    }
+
+  TAG_EVENT_FUNC_T func = m_pollFunc;
+  void *arg = m_pollArg;
+
+  pthread_mutex_unlock(&m_pollLock);
+
+  for (int i = 0; i < nEvents; i++)
+    func(types[i], &events[i], arg);
+}
+
+void *PN532::pollThread(void *ctx)
+{
+  upm::PN532 *This = (upm::PN532 *)ctx;
+  TAG_INFO_T found[MAX_POLL_TAGS];
+
+  pthread_mutex_lock(&This->m_pollLock);
+
+  while (This->m_pollRunning)
+    {
+      pthread_mutex_unlock(&This->m_pollLock);
+
+      int count;
+
+      // a failed bus write throws, which must not escape the thread
+      try
+        {
+          count = This->listPassiveTargets(found, MAX_POLL_TAGS);
+        }
+      catch (std::runtime_error& e)
+        {
+          cerr << __FUNCTION__ << ": " << e.what() << endl;
+          count = -1;
+        }
+
+      // on a transport error we know nothing, so leave the state alone
+      if (count >= 0)
+        This->pollUpdate(found, count);
+
+      pthread_mutex_lock(&This->m_pollLock);
+
+      if (This->m_pollRunning && This->m_pollInterval)
+        {
+          struct timespec deadline;
+          clock_gettime(CLOCK_MONOTONIC, &deadline);
+          deadline.tv_sec += This->m_pollInterval / 1000;
+          deadline.tv_nsec += (This->m_pollInterval % 1000) * 1000000;
+          if (deadline.tv_nsec >= 1000000000)
+            {
+              deadline.tv_sec++;
+              deadline.tv_nsec -= 1000000000;
+            }
+
+          pthread_cond_timedwait(&This->m_pollCond, &This->m_pollLock,
+                                 &deadline);
+        }
+    }
+
+  pthread_mutex_unlock(&This->m_pollLock);
+
+  return NULL;
+}
+
+bool PN532::startTagPolling(TAG_EVENT_FUNC_T func, void *arg,
+                            uint16_t intervalMs, int removeMisses)
+{
+  if (!func)
+    throw std::invalid_argument(std::string(__FUNCTION__) +
+                                ": func must not be NULL");
+
+  if (!m_isrInstalled)
+    {
+      cerr << __FUNCTION__ << ": init() must be called first" << endl;
+      return false;
+    }
+
+  stopTagPolling();
+
+  // report an empty field after a single activation attempt instead
+  // of waiting for a tag
+  if (!setPassiveActivationRetries(0x01))
+    {
+      cerr << __FUNCTION__ << ": setPassiveActivationRetries() failed"
+           << endl;
+      return false;
+    }
+
+  pthread_mutex_lock(&m_pollLock);
+
+  m_pollFunc = func;
+  m_pollArg = arg;
+  m_pollInterval = intervalMs;
+  m_pollRemoveMisses = (removeMisses < 1) ? 1 : removeMisses;
+  m_pollCount = 0;
+  m_pollRunning = true;
+
+  if (pthread_create(&m_pollThread, NULL, pollThread, this))
+    {
+      m_pollRunning = false;
+      pthread_mutex_unlock(&m_pollLock);
+      throw std::runtime_error(std::string(__FUNCTION__) +
+                               ": pthread_create() failed");
+    }
+
+  pthread_mutex_unlock(&m_pollLock);
+
+  return true;
+}
+
+void PN532::stopTagPolling()
+{
+  pthread_mutex_lock(&m_pollLock);
+
+  if (!m_pollRunning)
+    {
+      pthread_mutex_unlock(&m_pollLock);
+      return;
+    }
+
+  m_pollRunning = false;
+  pthread_cond_signal(&m_pollCond);
+
+  pthread_mutex_unlock(&m_pollLock);
+
+  pthread_join(m_pollThread, NULL);
+
+  m_pollCount = 0;
+
+  // back to the default of retrying forever.  This is also called
+  // from the destructor, so a bus error is only logged.
+  try
+    {
+      setPassiveActivationRetries(0xFF);
+    }
+  catch (std::runtime_error& e)
+    {
+      cerr << __FUNCTION__ << ": " << e.what() << endl;
+    }
+}
+
+int PN532::tagsPresent()
+{
+  pthread_mutex_lock(&m_pollLock);
+  int count = m_pollCount;
+  pthread_mutex_unlock(&m_pollLock);
+
+  return count;
+}
@@ -31,6 +31,7 @@
 
 #include <string.h>
 #include <string>
+#include <pthread.h>
 #include <mraa/common.hpp>
 #include <mraa/i2c.hpp>
 
@@ -195,6 +196,34 @@ namespace upm {
       TAG_TYPE_NFC2                       = 2 /* ultralight or NTAG2XX */
     } TAG_TYPE_T;
 
+    // maximum number of targets tracked at once by the tag poller
+    static const int MAX_POLL_TAGS = 2;
+
+    /**
+     * Tag poller events
+     */
+    typedef enum {
+      TAG_EVENT_ARRIVED                   = 0,
+      TAG_EVENT_REMOVED                   = 1
+    } TAG_EVENT_T;
+
+    /**
+     * An ISO14443A target seen by the tag poller
+     */
+    typedef struct {
+      uint8_t  uid[10];     // up to 10 bytes (triple size)
+      uint8_t  uidLen;
+      uint16_t atqa;        // SENS_RES
+      uint8_t  sak;         // SEL_RES
+    } TAG_INFO_T;
+
+    /**
+     * Tag poller event handler.  It is called from the poller thread
+     * when a tag enters or leaves the field.
+     */
+    typedef void (*TAG_EVENT_FUNC_T)(TAG_EVENT_T event,
+                                     const TAG_INFO_T *tag, void *arg);
+
     /**
      * pn532 constructor
      *
@@ -468,6 +497,41 @@ namespace upm {
      */
     TAG_TYPE_T tagType();
 
+    /**
+     * Start polling for ISO14443A tags in a background thread.  Each
+     * cycle lists up to MAX_POLL_TAGS targets with
+     * InListPassiveTarget, with MxRtyPassiveActivation set so an
+     * empty field is reported right away.  func is called with
+     * TAG_EVENT_ARRIVED when a new UID shows up and with
+     * TAG_EVENT_REMOVED once a UID has been missing for removeMisses
+     * cycles in a row.  No other commands may be issued while
+     * polling.  init() must have been called.
+     *
+     * @param func The event handler
+     * @param arg User argument passed to the handler
+     * @param intervalMs Milliseconds to pause between cycles
+     * @param removeMisses Number of cycles a tag must be missing
+     * before it is reported removed
+     * @return true if polling was started
+     */
+    bool startTagPolling(TAG_EVENT_FUNC_T func, void *arg = NULL,
+                         uint16_t intervalMs = 0, int removeMisses = 2);
+
+    /**
+     * Stop the tag poller and restore the default
+     * MxRtyPassiveActivation.  No removal events are sent for tags
+     * still present.
+     */
+    void stopTagPolling();
+
+    /**
+     * Return the number of tags the poller currently considers
+     * present.
+     *
+     * @return the number of tags present
+     */
+    int tagsPresent();
+
   protected:
     mraa::Gpio m_gpioIRQ;
     mraa::Gpio m_gpioReset;
@@ -479,11 +543,35 @@ namespace upm {
     void readData(uint8_t* buff, uint8_t n);
     void writeCommand(uint8_t* cmd, uint8_t cmdlen);
 
+    // list up to max ISO14443A targets, returns the number found or
+    // -1 on error
+    int listPassiveTargets(TAG_INFO_T *tags, int max);
+
   private:
     static void dataReadyISR(void *ctx);
     bool m_isrInstalled;
     volatile bool m_irqRcvd;
 
+    // the ISR signals m_irqCond, so waitForReady() doesn't poll
+    pthread_mutex_t m_irqLock;
+    pthread_cond_t m_irqCond;
+
+    // tag poller
+    static void *pollThread(void *ctx);
+    void pollUpdate(const TAG_INFO_T *found, int count);
+
+    pthread_t m_pollThread;
+    bool m_pollRunning;
+    pthread_mutex_t m_pollLock;
+    pthread_cond_t m_pollCond;
+    TAG_EVENT_FUNC_T m_pollFunc;
+    void *m_pollArg;
+    uint16_t m_pollInterval;
+    int m_pollRemoveMisses;
+    TAG_INFO_T m_pollTags[MAX_POLL_TAGS];
+    int m_pollMisses[MAX_POLL_TAGS];
+    int m_pollCount;
+
     uint8_t m_addr;
 
     uint8_t m_uid[7];       // ISO14443A uid
@@ -31,6 +31,8 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 
 #include <upm_math.h>
 #include <upm_utilities.h>
@@ -42,6 +44,8 @@
 static uint32_t ppd42ns_pulse_in(const ppd42ns_context dev,
                                  bool high_low_value);
 double pcs2ugm3 (double concentration_pcs);
+static ppd42ns_dust_data ppd42ns_compute(unsigned int low_pulse_occupancy,
+                                         double ratio);
 
 ppd42ns_context ppd42ns_init(int pin)
 {
@@ -51,7 +55,8 @@ ppd42ns_context ppd42ns_init(int pin)
     if (!dev)
         return NULL;
 
-    dev->gpio = NULL;
+    memset((void *)dev, 0, sizeof(struct _ppd42ns_context));
+    pthread_mutex_init(&dev->lock, NULL);
 
     // make sure MRAA is initialized
     int mraa_rv;
@@ -80,9 +85,12 @@ void ppd42ns_close(ppd42ns_context dev)
 {
     assert(dev != NULL);
 
+    ppd42ns_stop_sampler(dev);
+
     if (dev->gpio)
         mraa_gpio_close(dev->gpio);
 
+    pthread_mutex_destroy(&dev->lock);
     free(dev);
 }
 
@@ -90,8 +98,6 @@ ppd42ns_dust_data ppd42ns_get_data(const ppd42ns_context dev)
 {
     assert(dev != NULL);
 
-    ppd42ns_dust_data data;
-
     // in ms, 30 seconds
     const unsigned int pulse_check_time = 30000;
     // loop timer
@@ -110,6 +116,14 @@ ppd42ns_dust_data ppd42ns_get_data(const ppd42ns_context dev)
     double ratio = (float)low_pulse_occupancy
         / ((float)pulse_check_time * 10.0);
 
+    return ppd42ns_compute(low_pulse_occupancy, ratio);
+}
+
+static ppd42ns_dust_data ppd42ns_compute(unsigned int low_pulse_occupancy,
+                                         double ratio)
+{
+    ppd42ns_dust_data data;
+
      // using spec sheet curve
     double concentration = (1.1 * pow(ratio,3)) - (3.8 * pow(ratio, 2))
         + (520 * ratio) + 0.62;
@@ -123,6 +137,175 @@ ppd42ns_dust_data ppd42ns_get_data(const ppd42ns_context dev)
     return data;
 }
 
+// current CLOCK_MONOTONIC time in us
+static uint64_t ppd42ns_now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// add a low pulse from start to end to the buckets of the seconds it
+// spans.  Must be called with the lock held.
+static void ppd42ns_add_low(const ppd42ns_context dev, uint64_t start,
+                            uint64_t end)
+{
+    while (start < end)
+    {
+        uint64_t sec = start / 1000000;
+        uint64_t boundary = (sec + 1) * 1000000;
+        uint64_t stop = (end < boundary) ? end : boundary;
+        unsigned int slot = sec % dev->windowSecs;
+
+        if (dev->bucketSecs[slot] != sec)
+        {
+            // stale bucket from a previous window
+            dev->bucketSecs[slot] = sec;
+            dev->buckets[slot] = 0;
+        }
+        dev->buckets[slot] += (uint32_t)(stop - start);
+
+        start = stop;
+    }
+}
+
+static void ppd42ns_edge_isr(void *arg)
+{
+    ppd42ns_context dev = (ppd42ns_context)arg;
+    uint64_t now = ppd42ns_now_us();
+    bool low = !mraa_gpio_read(dev->gpio);
+
+    pthread_mutex_lock(&dev->lock);
+    if (low && !dev->isLow)
+    {
+        dev->lowStart = now;
+        dev->isLow = true;
+    }
+    else if (!low && dev->isLow)
+    {
+        ppd42ns_add_low(dev, dev->lowStart, now);
+        dev->isLow = false;
+    }
+    pthread_mutex_unlock(&dev->lock);
+}
+
+upm_result_t ppd42ns_start_sampler(const ppd42ns_context dev,
+                                   unsigned int window_secs)
+{
+    assert(dev != NULL);
+
+    if (!window_secs)
+        return UPM_ERROR_INVALID_PARAMETER;
+
+    ppd42ns_stop_sampler(dev);
+
+    uint32_t *buckets = (uint32_t *)calloc(window_secs, sizeof(uint32_t));
+    uint64_t *bucketSecs = (uint64_t *)calloc(window_secs, sizeof(uint64_t));
+    if (!buckets || !bucketSecs)
+    {
+        printf("%s: calloc() failed\n", __FUNCTION__);
+        free(buckets);
+        free(bucketSecs);
+        return UPM_ERROR_NO_RESOURCES;
+    }
+
+    pthread_mutex_lock(&dev->lock);
+    dev->buckets = buckets;
+    dev->bucketSecs = bucketSecs;
+    dev->windowSecs = window_secs;
+    dev->startTime = ppd42ns_now_us();
+    dev->lowStart = dev->startTime;
+    dev->isLow = !mraa_gpio_read(dev->gpio);
+    pthread_mutex_unlock(&dev->lock);
+
+    if (mraa_gpio_isr(dev->gpio, MRAA_GPIO_EDGE_BOTH, ppd42ns_edge_isr, dev)
+        != MRAA_SUCCESS)
+    {
+        printf("%s: mraa_gpio_isr() failed\n", __FUNCTION__);
+        pthread_mutex_lock(&dev->lock);
+        free(dev->buckets);
+        free(dev->bucketSecs);
+        dev->buckets = NULL;
+        dev->bucketSecs = NULL;
+        pthread_mutex_unlock(&dev->lock);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+
+    dev->samplerRunning = true;
+
+    return UPM_SUCCESS;
+}
+
+void ppd42ns_stop_sampler(const ppd42ns_context dev)
+{
+    assert(dev != NULL);
+
+    if (!dev->samplerRunning)
+        return;
+
+    mraa_gpio_isr_exit(dev->gpio);
+    dev->samplerRunning = false;
+
+    pthread_mutex_lock(&dev->lock);
+    free(dev->buckets);
+    free(dev->bucketSecs);
+    dev->buckets = NULL;
+    dev->bucketSecs = NULL;
+    pthread_mutex_unlock(&dev->lock);
+}
+
+ppd42ns_dust_data ppd42ns_get_sampler_data(const ppd42ns_context dev)
+{
+    assert(dev != NULL);
+
+    if (!dev->samplerRunning)
+    {
+        printf("%s: sampler not running\n", __FUNCTION__);
+        return ppd42ns_compute(0, 0.0);
+    }
+
+    uint64_t now = ppd42ns_now_us();
+    uint64_t nowSec = now / 1000000;
+    uint64_t low_pulse_occupancy = 0;
+    uint64_t windowStart;
+
+    pthread_mutex_lock(&dev->lock);
+
+    // count a pulse still in progress up to now
+    if (dev->isLow)
+    {
+        ppd42ns_add_low(dev, dev->lowStart, now);
+        dev->lowStart = now;
+    }
+
+    // the window spans the current second and the windowSecs - 1
+    // before it
+    uint64_t firstSec = (nowSec + 1 > dev->windowSecs)
+        ? nowSec + 1 - dev->windowSecs : 0;
+    unsigned int i;
+    for (i=0; i<dev->windowSecs; i++)
+    {
+        if (dev->bucketSecs[i] >= firstSec && dev->bucketSecs[i] <= nowSec)
+            low_pulse_occupancy += dev->buckets[i];
+    }
+
+    windowStart = firstSec * 1000000;
+    if (windowStart < dev->startTime)
+        windowStart = dev->startTime;
+
+    pthread_mutex_unlock(&dev->lock);
+
+    // in ms
+    double window = (double)(now - windowStart) / 1000.0;
+    if (window <= 0.0)
+        return ppd42ns_compute(0, 0.0);
+
+    // Integer percentage 0=>100
+    double ratio = (double)low_pulse_occupancy / (window * 10.0);
+
+    return ppd42ns_compute((unsigned int)low_pulse_occupancy, ratio);
+}
+
 
 // Mimicking Arduino's pulseIn function
 // return how long it takes a pin to go from HIGH to LOW or LOW to HIGH
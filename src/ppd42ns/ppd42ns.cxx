@@ -49,3 +49,19 @@ ppd42ns_dust_data PPD42NS::getData()
     return ppd42ns_get_data(m_ppd42ns);
 }
 
+void PPD42NS::startSampler(unsigned int windowSecs)
+{
+    if (ppd42ns_start_sampler(m_ppd42ns, windowSecs))
+        throw std::runtime_error(std::string(__FUNCTION__) +
+                                    ": ppd42ns_start_sampler() failed");
+}
+
+void PPD42NS::stopSampler()
+{
+    ppd42ns_stop_sampler(m_ppd42ns);
+}
+
+ppd42ns_dust_data PPD42NS::getSamplerData()
+{
+    return ppd42ns_get_sampler_data(m_ppd42ns);
+}
@@ -29,6 +29,8 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <upm.h>
 
 #include <mraa/gpio.h>
@@ -52,6 +54,19 @@ extern "C" {
     typedef struct _ppd42ns_context {
         mraa_gpio_context gpio;
 
+        // background sampler.  Low pulse time is accumulated per
+        // second (in us) by an edge ISR into windowSecs buckets.
+        bool              samplerRunning;
+        pthread_mutex_t   lock;
+        unsigned int      windowSecs;
+        uint32_t         *buckets;
+        // the second (CLOCK_MONOTONIC) each bucket accumulates
+        uint64_t         *bucketSecs;
+        // sampler start time, and start of the current low pulse
+        // (CLOCK_MONOTONIC, in us)
+        uint64_t          startTime;
+        uint64_t          lowStart;
+        bool              isLow;
     } *ppd42ns_context;
 
     /**
@@ -77,6 +92,37 @@ extern "C" {
      */
     ppd42ns_dust_data ppd42ns_get_data(const ppd42ns_context dev);
 
+    /**
+     * Start the background sampler.  The low pulse time is measured
+     * by an interrupt handler on the sensor pin, and accumulated over
+     * a sliding window, so that ppd42ns_get_sampler_data() can return
+     * the current concentration at any time without blocking.
+     *
+     * @param dev Device context.
+     * @param window_secs The length of the sliding window in seconds.
+     * The spec sheet suggests 30.
+     * @return UPM result.
+     */
+    upm_result_t ppd42ns_start_sampler(const ppd42ns_context dev,
+                                       unsigned int window_secs);
+
+    /**
+     * Stop the background sampler.
+     *
+     * @param dev Device context.
+     */
+    void ppd42ns_stop_sampler(const ppd42ns_context dev);
+
+    /**
+     * Get the dust concentration over the sampler's sliding window.
+     * Until the sampler has run for a full window, the time since it
+     * was started is used.
+     *
+     * @param dev Device context.
+     * @return ppd42ns_dust_data Contains data from the dust sensor
+     */
+    ppd42ns_dust_data ppd42ns_get_sampler_data(const ppd42ns_context dev);
+
 #ifdef __cplusplus
 }
 #endif
@@ -74,6 +74,27 @@ namespace upm {
          */
         ppd42ns_dust_data getData();
 
+        /**
+         * Starts the background sampler, which measures the low pulse
+         * time with an interrupt handler over a sliding window
+         *
+         * @param windowSecs Length of the sliding window in seconds
+         */
+        void startSampler(unsigned int windowSecs = 30);
+
+        /**
+         * Stops the background sampler
+         */
+        void stopSampler();
+
+        /**
+         * Returns the dust concentration over the sampler's sliding
+         * window, without blocking
+         *
+         * @return struct ppd42ns_dust_data Contains data from the dust sensor
+         */
+        ppd42ns_dust_data getSamplerData();
+
     private:
         /* Disable implicit copy and assignment operators */
         PPD42NS(const PPD42NS&) = delete;
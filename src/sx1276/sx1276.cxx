@@ -23,6 +23,8 @@
  */
 
 #include <unistd.h>
+#include <time.h>
+#include <errno.h>
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
@@ -76,6 +78,31 @@ SX1276::SX1276(uint8_t chipRev, int bus, int cs, int resetPin, int dio0,
   m_gpioDIO1(dio1), m_gpioDIO2(dio2), m_gpioDIO3(dio3), m_gpioDIO4(dio4),
   m_gpioDIO5(dio5)
 {
+  // the interrupt handlers use these, so set them up first
+  pthread_condattr_t condAttrib;
+  pthread_condattr_init(&condAttrib);
+  pthread_condattr_setclock(&condAttrib, CLOCK_MONOTONIC);
+
+  pthread_mutex_init(&m_eventLock, NULL);
+  pthread_cond_init(&m_eventCond, &condAttrib);
+  pthread_mutex_init(&m_rxqWaitLock, NULL);
+  pthread_cond_init(&m_rxqCond, &condAttrib);
+  pthread_mutex_init(&m_txLock, NULL);
+  pthread_cond_init(&m_txCond, NULL);
+  pthread_mutex_init(&m_opLock, NULL);
+
+  pthread_condattr_destroy(&condAttrib);
+
+  m_rxqMask = 0;
+  m_rxqHead = 0;
+  m_rxqTail = 0;
+  m_rxDropped = 0;
+  m_rxContinuous = false;
+  m_savedLoraRxContinuous = false;
+  m_savedFskRxContinuous = false;
+  m_txThreadRunning = false;
+  m_txExit = false;
+
   m_spi.mode(mraa::SPI_MODE0);
   m_spi.frequency(10000000); // 10Mhz, if supported
 
@@ -159,6 +186,25 @@ SX1276::SX1276(uint8_t chipRev, int bus, int cs, int resetPin, int dio0,
 
 SX1276::~SX1276()
 {
+  __atomic_store_n(&m_rxContinuous, false, __ATOMIC_RELEASE);
+
+  if (m_txThreadRunning)
+    {
+      pthread_mutex_lock(&m_txLock);
+      m_txExit = true;
+      pthread_cond_signal(&m_txCond);
+      pthread_mutex_unlock(&m_txLock);
+
+      pthread_join(m_txThread, NULL);
+    }
+
+  pthread_mutex_destroy(&m_opLock);
+  pthread_cond_destroy(&m_txCond);
+  pthread_mutex_destroy(&m_txLock);
+  pthread_cond_destroy(&m_rxqCond);
+  pthread_mutex_destroy(&m_rxqWaitLock);
+  pthread_cond_destroy(&m_eventCond);
+  pthread_mutex_destroy(&m_eventLock);
   pthread_mutex_destroy(&m_intrLock);
 }
 
@@ -1254,24 +1300,21 @@ SX1276::RADIO_EVENT_T SX1276::setTx(int timeout)
     }
 
   m_settings.state = STATE_TX_RUNNING;
-  m_radioEvent = REVENT_EXEC;
+  setRadioEvent(REVENT_EXEC);
 
   setOpMode(MODE_TxMode);
 
-  initClock();
-  while ((getMillis() < static_cast<uint32_t>(timeout)) && m_radioEvent == REVENT_EXEC)
-    usleep(100);
+  return waitRadioEvent((timeout > 0) ? timeout : 0);
+}
 
-  if (m_radioEvent == REVENT_EXEC)
-    {
-      // timeout
-      m_radioEvent = REVENT_TIMEOUT;
-    }
+SX1276::RADIO_EVENT_T SX1276::setRx(uint32_t timeout)
+{
+  startRx();
 
-  return m_radioEvent;
+  return waitRadioEvent(timeout);
 }
 
-SX1276::RADIO_EVENT_T SX1276::setRx(uint32_t timeout)
+void SX1276::startRx()
 {
   bool rxContinuous = false;
   uint8_t reg = 0;
@@ -1463,7 +1506,7 @@ SX1276::RADIO_EVENT_T SX1276::setRx(uint32_t timeout)
   memset(m_rxBuffer, 0, FIFO_SIZE);
 
   m_settings.state = STATE_RX_RUNNING;
-  m_radioEvent = REVENT_EXEC;
+  setRadioEvent(REVENT_EXEC);
 
   if (m_settings.modem == MODEM_FSK)
     {
@@ -1495,18 +1538,6 @@ SX1276::RADIO_EVENT_T SX1276::setRx(uint32_t timeout)
           setOpMode(MODE_LOR_RxSingle);
         }
     }
-
-  initClock();
-  while ((getMillis() < timeout) && m_radioEvent == REVENT_EXEC)
-    usleep(100);
-
-  if (m_radioEvent == REVENT_EXEC)
-    {
-      // timeout
-      m_radioEvent = REVENT_TIMEOUT;
-    }
-
-  return m_radioEvent;
 }
 
 
@@ -1617,7 +1648,7 @@ void SX1276::onDio0Irq(void *ctx)
 
                   // RxError radio event
                   //                  cerr << __FUNCTION__ << ": RxError crc/sync timeout" << endl;
-                  This->m_radioEvent = REVENT_ERROR;
+                  This->setRadioEvent(REVENT_ERROR);
 
                   This->m_settings.fskPacketHandler.PreambleDetected = false;
                   This->m_settings.fskPacketHandler.SyncWordDetected = false;
@@ -1678,7 +1709,8 @@ void SX1276::onDio0Irq(void *ctx)
           // RxDone radio event
           This->m_rxRSSI = This->m_settings.fskPacketHandler.RssiValue;
           This->m_rxLen = This->m_settings.fskPacketHandler.Size;
-          This->m_radioEvent = REVENT_DONE;
+          This->rxPush(This->m_rxLen, This->m_rxRSSI, 0);
+          This->setRadioEvent(REVENT_DONE);
           // cerr << __FUNCTION__ << ": FSK RxDone" << endl;
           // fprintf(stderr, "### %s: RX(%d): %s\n", 
           //         __FUNCTION__, 
@@ -1713,7 +1745,7 @@ void SX1276::onDio0Irq(void *ctx)
                   }
                 // RxError radio event
                 // cerr << __FUNCTION__ << ": RxError (payload crc error)" << endl;
-                This->m_radioEvent = REVENT_ERROR;
+                This->setRadioEvent(REVENT_ERROR);
 
                 break;
               }
@@ -1773,6 +1805,10 @@ void SX1276::onDio0Irq(void *ctx)
             // cerr << "LORA MAXPAYLOAD = " 
             //      <<  (int)This->readReg(LOR_RegMaxPayloadLength) << endl;
 
+            // in continuous mode each packet lands after the last
+            // one, so start reading where this one was written
+            This->writeReg(LOR_RegFifoAddrPtr,
+                           This->readReg(LOR_RegFifoRxCurrentAddr));
             This->readFifo(This->m_rxBuffer, 
                            This->m_settings.loraPacketHandler.Size);
 
@@ -1787,10 +1823,11 @@ void SX1276::onDio0Irq(void *ctx)
             // bytes regardless of the packet size I sent.  Something
             // is wrong here.
             //            cerr << __FUNCTION__ << ": RxDone (LORA)" << endl;
-            This->m_rxRSSI = (int)rssi;
+            This->m_rxRSSI = This->m_settings.loraPacketHandler.RssiValue;
             This->m_rxSNR = (int)snr;
             This->m_rxLen = This->m_settings.loraPacketHandler.Size;
-            This->m_radioEvent = REVENT_DONE;
+            This->rxPush(This->m_rxLen, This->m_rxRSSI, This->m_rxSNR);
+            This->setRadioEvent(REVENT_DONE);
             // if (This->m_settings.state == STATE_RX_RUNNING)
             //   fprintf(stderr, "### %s: snr = %d rssi = %d RX(%d): %s\n", 
             //           __FUNCTION__, 
@@ -1829,7 +1866,7 @@ void SX1276::onDio0Irq(void *ctx)
           This->m_settings.state = STATE_IDLE;
 
           // TxDone radio event
-          This->m_radioEvent = REVENT_DONE;
+          This->setRadioEvent(REVENT_DONE);
           //          cerr << __FUNCTION__ << ": TxDone" << endl;
 
           break;
@@ -1903,7 +1940,7 @@ void SX1276::onDio1Irq(void *ctx)
           This->m_settings.state = STATE_IDLE;
           // RxError (LORA timeout) radio events
           //          cerr << __FUNCTION__ << ": RxTimeout (LORA)" << endl;
-          This->m_radioEvent = REVENT_TIMEOUT;
+          This->setRadioEvent(REVENT_TIMEOUT);
 
           break;
 
@@ -2158,4 +2195,308 @@ uint32_t SX1276::getMillis()
   return elapse;
 }
 
+void SX1276::setRadioEvent(RADIO_EVENT_T event)
+{
+  pthread_mutex_lock(&m_eventLock);
+  m_radioEvent = event;
+  pthread_cond_broadcast(&m_eventCond);
+  pthread_mutex_unlock(&m_eventLock);
+}
+
+SX1276::RADIO_EVENT_T SX1276::waitRadioEvent(uint32_t timeout)
+{
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout / 1000;
+  deadline.tv_nsec += (timeout % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000)
+    {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+    }
+
+  pthread_mutex_lock(&m_eventLock);
+
+  while (m_radioEvent == REVENT_EXEC)
+    {
+      if (pthread_cond_timedwait(&m_eventCond, &m_eventLock, &deadline)
+          == ETIMEDOUT)
+        break;
+    }
+
+  if (m_radioEvent == REVENT_EXEC)
+    {
+      // timeout
+      m_radioEvent = REVENT_TIMEOUT;
+    }
+
+  RADIO_EVENT_T event = m_radioEvent;
+
+  pthread_mutex_unlock(&m_eventLock);
+
+  return event;
+}
+
+// called from the DIO0 handler with m_intrLock held, so there is
+// only ever one producer
+void SX1276::rxPush(int len, int rssi, int snr)
+{
+  if (!__atomic_load_n(&m_rxContinuous, __ATOMIC_ACQUIRE))
+    return;
+
+  uint32_t tail = __atomic_load_n(&m_rxqTail, __ATOMIC_RELAXED);
+  uint32_t head = __atomic_load_n(&m_rxqHead, __ATOMIC_ACQUIRE);
+
+  if (tail - head > m_rxqMask)
+    {
+      __atomic_add_fetch(&m_rxDropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+
+  RX_PACKET_T *pkt = &m_rxQueue[tail & m_rxqMask];
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  if (len > FIFO_SIZE)
+    len = FIFO_SIZE;
+  memcpy(pkt->data, m_rxBuffer, len);
+  pkt->len = len;
+  pkt->rssi = rssi;
+  pkt->snr = snr;
+  pkt->timestamp = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+  __atomic_store_n(&m_rxqTail, tail + 1, __ATOMIC_RELEASE);
+
+  pthread_mutex_lock(&m_rxqWaitLock);
+  pthread_cond_signal(&m_rxqCond);
+  pthread_mutex_unlock(&m_rxqWaitLock);
+}
+
+void SX1276::startRxContinuous(int depth)
+{
+  if (depth < 1)
+    throw std::out_of_range(string(__FUNCTION__) +
+                            ": depth must be at least 1");
+
+  uint32_t size = 1;
+  while (size < (uint32_t)depth)
+    size <<= 1;
+
+  pthread_mutex_lock(&m_opLock);
+
+  // make sure the handlers stop pushing before the queue changes
+  lockIntrs();
+  __atomic_store_n(&m_rxContinuous, false, __ATOMIC_RELEASE);
+  unlockIntrs();
+
+  // and that no consumer is looking at it
+  pthread_mutex_lock(&m_rxqWaitLock);
+  m_rxQueue.resize(size);
+  m_rxqMask = size - 1;
+  __atomic_store_n(&m_rxqHead, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&m_rxqTail, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&m_rxDropped, 0, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&m_rxqWaitLock);
+
+  m_savedLoraRxContinuous = m_settings.loraSettings.RxContinuous;
+  m_savedFskRxContinuous = m_settings.fskSettings.RxContinuous;
+  m_settings.loraSettings.RxContinuous = true;
+  m_settings.fskSettings.RxContinuous = true;
+
+  __atomic_store_n(&m_rxContinuous, true, __ATOMIC_RELEASE);
+
+  startRx();
+
+  pthread_mutex_unlock(&m_opLock);
+}
+
+void SX1276::stopRxContinuous()
+{
+  pthread_mutex_lock(&m_opLock);
+
+  if (__atomic_load_n(&m_rxContinuous, __ATOMIC_ACQUIRE))
+    {
+      lockIntrs();
+      __atomic_store_n(&m_rxContinuous, false, __ATOMIC_RELEASE);
+      unlockIntrs();
+
+      setStandby();
+
+      m_settings.loraSettings.RxContinuous = m_savedLoraRxContinuous;
+      m_settings.fskSettings.RxContinuous = m_savedFskRxContinuous;
+    }
+
+  pthread_mutex_unlock(&m_opLock);
+}
+
+bool SX1276::rxDequeue(RX_PACKET_T *pkt, int timeout)
+{
+  if (!pkt)
+    throw std::invalid_argument(string(__FUNCTION__) +
+                                ": pkt must not be NULL");
+
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  if (timeout > 0)
+    {
+      deadline.tv_sec += timeout / 1000;
+      deadline.tv_nsec += (timeout % 1000) * 1000000;
+      if (deadline.tv_nsec >= 1000000000)
+        {
+          deadline.tv_sec++;
+          deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+  pthread_mutex_lock(&m_rxqWaitLock);
+
+  uint32_t head = __atomic_load_n(&m_rxqHead, __ATOMIC_RELAXED);
+
+  while (__atomic_load_n(&m_rxqTail, __ATOMIC_ACQUIRE) == head)
+    {
+      if (timeout == 0)
+        {
+          pthread_mutex_unlock(&m_rxqWaitLock);
+          return false;
+        }
+
+      if (timeout < 0)
+        pthread_cond_wait(&m_rxqCond, &m_rxqWaitLock);
+      else if (pthread_cond_timedwait(&m_rxqCond, &m_rxqWaitLock,
+                                      &deadline) == ETIMEDOUT
+               && __atomic_load_n(&m_rxqTail, __ATOMIC_ACQUIRE) == head)
+        {
+          pthread_mutex_unlock(&m_rxqWaitLock);
+          return false;
+        }
+    }
+
+  *pkt = m_rxQueue[head & m_rxqMask];
+  __atomic_store_n(&m_rxqHead, head + 1, __ATOMIC_RELEASE);
+
+  pthread_mutex_unlock(&m_rxqWaitLock);
+
+  return true;
+}
+
+int SX1276::rxPending()
+{
+  return (int)(__atomic_load_n(&m_rxqTail, __ATOMIC_ACQUIRE) -
+               __atomic_load_n(&m_rxqHead, __ATOMIC_ACQUIRE));
+}
+
+uint32_t SX1276::getRxDropped()
+{
+  return __atomic_load_n(&m_rxDropped, __ATOMIC_RELAXED);
+}
+
+void SX1276::txEnqueue(const uint8_t *buffer, uint8_t size, int timeout,
+                       TX_DONE_FUNC_T func, void *arg)
+{
+  TX_REQUEST_T req;
+
+  memcpy(req.buffer, buffer, size);
+  req.size = size;
+  req.timeout = timeout;
+  req.func = func;
+  req.arg = arg;
+
+  pthread_mutex_lock(&m_txLock);
+
+  if (m_txQueue.size() >= TX_QUEUE_DEPTH)
+    {
+      pthread_mutex_unlock(&m_txLock);
+      throw std::runtime_error(string(__FUNCTION__) +
+                               ": transmit queue full");
+    }
+
+  if (!m_txThreadRunning)
+    {
+      if (pthread_create(&m_txThread, NULL, txThread, this))
+        {
+          pthread_mutex_unlock(&m_txLock);
+          throw std::runtime_error(string(__FUNCTION__) +
+                                   ": pthread_create() failed");
+        }
+      m_txThreadRunning = true;
+    }
+
+  m_txQueue.push_back(req);
+  pthread_cond_signal(&m_txCond);
+
+  pthread_mutex_unlock(&m_txLock);
+}
+
+void SX1276::txEnqueueStr(string buffer, int timeout,
+                          TX_DONE_FUNC_T func, void *arg)
+{
+  if (buffer.size() > (FIFO_SIZE - 1))
+    throw std::range_error(string(__FUNCTION__) +
+                           ": buffer size must be less than 256");
+
+  // pad like sendStr() does
+  while (buffer.size() < 64)
+    buffer.push_back(0);
+
+  txEnqueue((const uint8_t *)buffer.data(), buffer.size(), timeout,
+            func, arg);
+}
+
+int SX1276::txPending()
+{
+  pthread_mutex_lock(&m_txLock);
+  int pending = m_txQueue.size();
+  pthread_mutex_unlock(&m_txLock);
+
+  return pending;
+}
 
+void *SX1276::txThread(void *ctx)
+{
+  upm::SX1276 *This = (upm::SX1276 *)ctx;
+
+  for (;;)
+    {
+      pthread_mutex_lock(&This->m_txLock);
+      while (This->m_txQueue.empty() && !This->m_txExit)
+        pthread_cond_wait(&This->m_txCond, &This->m_txLock);
+
+      if (This->m_txExit)
+        {
+          pthread_mutex_unlock(&This->m_txLock);
+          break;
+        }
+
+      // leave it queued while sending so txPending() counts it
+      TX_REQUEST_T req = This->m_txQueue.front();
+      pthread_mutex_unlock(&This->m_txLock);
+
+      pthread_mutex_lock(&This->m_opLock);
+
+      // leave receive mode, but not in the middle of handling a packet
+      if (__atomic_load_n(&This->m_rxContinuous, __ATOMIC_ACQUIRE))
+        {
+          This->lockIntrs();
+          This->setStandby();
+          This->unlockIntrs();
+        }
+
+      RADIO_EVENT_T event = This->send(req.buffer, req.size, req.timeout);
+
+      // go back to listening
+      if (__atomic_load_n(&This->m_rxContinuous, __ATOMIC_ACQUIRE))
+        This->startRx();
+
+      pthread_mutex_unlock(&This->m_opLock);
+
+      pthread_mutex_lock(&This->m_txLock);
+      This->m_txQueue.pop_front();
+      pthread_mutex_unlock(&This->m_txLock);
+
+      if (req.func)
+        req.func(event, req.arg);
+    }
+
+  return NULL;
+}
@@ -31,6 +31,8 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <deque>
 
 #include <sys/time.h>
 #include <sys/select.h>
@@ -132,6 +134,31 @@ namespace upm {
       REVENT_TIMEOUT                         // timed out
     } RADIO_EVENT_T;
 
+    // default depth of the continuous receive queue
+    static const int RX_QUEUE_DEPTH = 16;
+
+    // maximum number of packets waiting in the transmit queue
+    static const int TX_QUEUE_DEPTH = 16;
+
+    /**
+     * A packet received in continuous receive mode.  RSSI (in dBm) and SNR
+     * (LoRa only) are those of this packet.  The timestamp is the
+     * CLOCK_MONOTONIC time of the RxDone interrupt in microseconds.
+     */
+    typedef struct {
+      uint8_t  data[FIFO_SIZE];
+      int      len;
+      int      rssi;
+      int      snr;
+      uint64_t timestamp;
+    } RX_PACKET_T;
+
+    /**
+     * Transmit completion handler for txEnqueue().  It is called
+     * from the transmit thread with the result of the transmit.
+     */
+    typedef void (*TX_DONE_FUNC_T)(RADIO_EVENT_T event, void *arg);
+
     /**
      * SX1276 registers
      *
@@ -1875,6 +1902,96 @@ namespace upm {
       return m_rxLen;
     };
 
+    /**
+     * Start continuous receive.  The radio stays in receive mode, and
+     * each packet received is placed, with its RSSI, SNR and a
+     * timestamp, into a queue by the DIO interrupt handlers.  Packets
+     * are retrieved with rxDequeue().  When the queue is full, new
+     * packets are dropped and counted (see getRxDropped()).  Any
+     * packets left from a previous run are discarded.
+     *
+     * The receive configuration set with setRxConfig() is used, with
+     * rxContinuous forced on until stopRxContinuous() is called.
+     * Transmits queued with txEnqueue() briefly interrupt receive and
+     * re-arm it afterwards.  Do not call setRx() or send() while
+     * continuous receive is running.
+     *
+     * @param depth The number of packets the queue can hold.  This is
+     * rounded up to a power of 2.
+     */
+    void startRxContinuous(int depth = RX_QUEUE_DEPTH);
+
+    /**
+     * Stop continuous receive and place the radio in standby.
+     * Packets still queued can be retrieved with rxDequeue().
+     */
+    void stopRxContinuous();
+
+    /**
+     * Retrieve the oldest packet received in continuous receive mode.
+     * Only one thread should dequeue at a time.
+     *
+     * @param pkt Pointer to a RX_PACKET_T to fill in
+     * @param timeout The number of milliseconds to wait for a packet.
+     * 0 returns immediately, a negative value waits forever.
+     * @return true if a packet was returned, false on timeout
+     */
+    bool rxDequeue(RX_PACKET_T *pkt, int timeout);
+
+    /**
+     * Return the number of packets waiting in the receive queue.
+     *
+     * @return the number of queued packets
+     */
+    int rxPending();
+
+    /**
+     * Return the number of packets dropped because the receive queue
+     * was full.
+     *
+     * @return the number of dropped packets
+     */
+    uint32_t getRxDropped();
+
+    /**
+     * Queue a buffer for transmission and return immediately.
+     * Packets are sent in order by a transmit thread, each as if by
+     * send().  If continuous receive is running, it is re-armed after
+     * each transmit.
+     *
+     * @param buffer The buffer to send
+     * @param size The size of the buffer
+     * @param timeout The transmit timeout in milliseconds
+     * @param func Function called when the transmit completes, or
+     * NULL.
+     * @param arg Argument passed to func
+     * @throws std::runtime_error if the queue is full
+     */
+    void txEnqueue(const uint8_t *buffer, uint8_t size, int timeout,
+                   TX_DONE_FUNC_T func = NULL, void *arg = NULL);
+
+    /**
+     * Queue a string for transmission and return immediately.  Like
+     * sendStr(), strings shorter than 64 bytes are padded with 0s.
+     *
+     * @param buffer The string to send
+     * @param timeout The transmit timeout in milliseconds
+     * @param func Function called when the transmit completes, or
+     * NULL.
+     * @param arg Argument passed to func
+     * @throws std::runtime_error if the queue is full
+     */
+    void txEnqueueStr(std::string buffer, int timeout,
+                      TX_DONE_FUNC_T func = NULL, void *arg = NULL);
+
+    /**
+     * Return the number of packets waiting in the transmit queue,
+     * including one being sent.
+     *
+     * @return the number of queued packets
+     */
+    int txPending();
+
 
   protected:
     // I/O
@@ -2023,8 +2140,56 @@ namespace upm {
     void lockIntrs() { pthread_mutex_lock(&m_intrLock); };
     void unlockIntrs() { pthread_mutex_unlock(&m_intrLock); };
 
-    // current radio event status
+    // current radio event status.  Updates from the interrupt
+    // handlers go through setRadioEvent() so waiters wake up.
     volatile RADIO_EVENT_T m_radioEvent;
+    pthread_mutex_t m_eventLock;
+    pthread_cond_t m_eventCond;
+
+    void setRadioEvent(RADIO_EVENT_T event);
+    RADIO_EVENT_T waitRadioEvent(uint32_t timeout);
+
+    // arm the receiver without waiting for a result
+    void startRx();
+
+    // continuous receive queue.  The interrupt handlers are the only
+    // producer (they are serialized by m_intrLock), rxDequeue() the
+    // only consumer.  m_rxqWaitLock/m_rxqCond are only used to wake
+    // a waiting consumer.
+    std::vector<RX_PACKET_T> m_rxQueue;
+    uint32_t m_rxqMask;
+    uint32_t m_rxqHead;
+    uint32_t m_rxqTail;
+    uint32_t m_rxDropped;
+    bool m_rxContinuous;
+    bool m_savedLoraRxContinuous;
+    bool m_savedFskRxContinuous;
+    pthread_mutex_t m_rxqWaitLock;
+    pthread_cond_t m_rxqCond;
+
+    void rxPush(int len, int rssi, int snr);
+
+    // transmit queue, serviced by m_txThread
+    typedef struct {
+      uint8_t buffer[FIFO_SIZE];
+      uint8_t size;
+      int timeout;
+      TX_DONE_FUNC_T func;
+      void *arg;
+    } TX_REQUEST_T;
+
+    std::deque<TX_REQUEST_T> m_txQueue;
+    pthread_t m_txThread;
+    bool m_txThreadRunning;
+    bool m_txExit;
+    pthread_mutex_t m_txLock;
+    pthread_cond_t m_txCond;
+
+    // serializes radio operations between the transmit thread and
+    // continuous receive start/stop
+    pthread_mutex_t m_opLock;
+
+    static void *txThread(void *ctx);
 
     // timer support
     struct timeval m_startTime;
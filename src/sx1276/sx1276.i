@@ -7,6 +7,7 @@
 
 %ignore getRxBuffer();
 %ignore send(uint8_t *buffer, uint8_t size, int txTimeout);
+%ignore txEnqueue(const uint8_t *buffer, uint8_t size, int timeout, TX_DONE_FUNC_T func, void *arg);
 
 JAVA_JNI_LOADLIBRARY(javaupm_sx1276)
 #endif
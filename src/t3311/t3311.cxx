@@ -53,7 +53,7 @@ static uint8_t bcd2dec(uint8_t bcd)
 
 T3311::T3311(std::string device, int address, int baud, int bits, char parity,
              int stopBits) :
-  m_mbContext(0)
+  m_bus(0), m_pollID(-1)
 {
   // check some of the parameters
   if (!(bits == 7 || bits == 8))
@@ -84,111 +84,96 @@ T3311::T3311(std::string device, int address, int baud, int bits, char parity,
   m_specificEnthalpy = 0.0;
 
   // addresses are only 8bits wide
-  address &= 0xff;
+  m_slave = address & 0xff;
 
-  // now, open/init the device and modbus context
+  // now, get the bus for this port and attach to it
+  m_bus = ModbusBus::instance(device, baud, bits, parity, stopBits);
+  m_bus->attach(m_slave);
 
-  if (!(m_mbContext = modbus_new_rtu(device.c_str(), baud, parity, bits,
-                                     stopBits)))
+  // the bus attachment is ours until the constructor returns, so
+  // release it if anything after this point fails
+  try
     {
-      throw std::runtime_error(std::string(__FUNCTION__) +
-                               ": modbus_new_rtu() failed");
-    }
-
-  // set the slave address of the device we want to talk to
-  if (modbus_set_slave(m_mbContext, address))
-    {
-      throw std::runtime_error(std::string(__FUNCTION__) +
-                               ": modbus_set_slave() failed");
-    }
-
-  // set the serial mode
-  modbus_rtu_set_serial_mode(m_mbContext, MODBUS_RTU_RS232);
-
-  // now connect..
-  if (modbus_connect(m_mbContext))
-    {
-      throw std::runtime_error(std::string(__FUNCTION__) +
-                               ": modbus_connect() failed");
-    }
-
-  // This is a bit of a hack.  The device uses bus power, which isn't
-  // provided unless the device has been opened and accessed.  As a
-  // result, register reads will usually fail the first time the
-  // device is accessed after a power cycle.  Here, we read the
-  // temperature value (which will most likely fail), then sleep,
-  // allowing the sensor to "boot".  The datasheet says it takes at
-  // about 2 seconds to boot, we will wait for 5.
-  uint16_t tmp;
-  modbus_read_input_registers(m_mbContext, REG_TEMPERATURE, 1, &tmp);
-
-  // sleep for 5 seconds to give time for device to powerup and boot
-  sleep(5);
-
-  // turn off debugging
-  setDebug(false);
-
-  // now read the UNIT_SETTING reg to see what units we are getting
-  // our temperature data in.
-  tmp = readInputReg(REG_UNIT_SETTINGS);
-  if (tmp & 0x0001)
-    m_isCelsius = false;
-  else
-    m_isCelsius = true;
+      // This is a bit of a hack.  The device uses bus power, which isn't
+      // provided unless the device has been opened and accessed.  As a
+      // result, register reads will usually fail the first time the
+      // device is accessed after a power cycle.  Here, we read the
+      // temperature value (which will most likely fail), then sleep,
+      // allowing the sensor to "boot".  The datasheet says it takes at
+      // about 2 seconds to boot, we will wait for 5.
+      uint16_t tmp;
+      m_bus->readInputRegs(m_slave, REG_TEMPERATURE, 1, &tmp);
+
+      // sleep for 5 seconds to give time for device to powerup and boot
+      sleep(5);
+
+      // turn off debugging
+      setDebug(false);
+
+      // now read the UNIT_SETTING reg to see what units we are getting
+      // our temperature data in.
+      tmp = readInputReg(REG_UNIT_SETTINGS);
+      if (tmp & 0x0001)
+        m_isCelsius = false;
+      else
+        m_isCelsius = true;
 
-  // read in the the FW_LO register (BCD encoded) and convert
-  tmp = readInputReg(REG_FW_LO);
+      // read in the the FW_LO register (BCD encoded) and convert
+      tmp = readInputReg(REG_FW_LO);
 
-  // HI byte (major)
-  m_fwRevHi = (tmp >> 8) & 0xff;
-  m_fwRevHi = bcd2dec(m_fwRevHi);
+      // HI byte (major)
+      m_fwRevHi = (tmp >> 8) & 0xff;
+      m_fwRevHi = bcd2dec(m_fwRevHi);
 
-  // LO byte (minor)
-  m_fwRevLo = (tmp & 0xff);
-  m_fwRevLo = bcd2dec(m_fwRevLo);
+      // LO byte (minor)
+      m_fwRevLo = (tmp & 0xff);
+      m_fwRevLo = bcd2dec(m_fwRevLo);
 
-  if (m_fwRevHi >= 2 && m_fwRevLo >= 44)
-    m_isExtendedDataAvailable = true;
-  else
-    m_isExtendedDataAvailable = false;
+      if (m_fwRevHi >= 2 && m_fwRevLo >= 44)
+        m_isExtendedDataAvailable = true;
+      else
+        m_isExtendedDataAvailable = false;
 
-  // now get the serial number (BCD encoded 4-byte value, which we
-  // will pack into a string)
-  stringstream preformat;
-  uint8_t b;
-  // LO (but really HI)
-  tmp = readInputReg(REG_SERIAL_LO);
-  b = bcd2dec((tmp & 0xff00) >> 8);
-  preformat << int(b);
+      // now get the serial number (BCD encoded 4-byte value, which we
+      // will pack into a string)
+      stringstream preformat;
+      uint8_t b;
+      // LO (but really HI)
+      tmp = readInputReg(REG_SERIAL_LO);
+      b = bcd2dec((tmp & 0xff00) >> 8);
+      preformat << int(b);
 
-  b = bcd2dec(tmp & 0x00ff);
-  preformat << int(b);
+      b = bcd2dec(tmp & 0x00ff);
+      preformat << int(b);
 
-  // HI (but really LO)
-  tmp = readInputReg(REG_SERIAL_HI);
+      // HI (but really LO)
+      tmp = readInputReg(REG_SERIAL_HI);
 
-  b = bcd2dec((tmp & 0xff00) >> 8);
-  preformat << int(b);
-  b = bcd2dec(tmp & 0x00ff);
-  preformat << int(b);
+      b = bcd2dec((tmp & 0xff00) >> 8);
+      preformat << int(b);
+      b = bcd2dec(tmp & 0x00ff);
+      preformat << int(b);
 
-  m_serialNumber = preformat.str();
+      m_serialNumber = preformat.str();
+    }
+  catch (...)
+    {
+      m_bus->detach(m_slave);
+      throw;
+    }
 }
 
 T3311::~T3311()
 {
-  if (m_mbContext)
-    {
-      modbus_close(m_mbContext);
-      modbus_free(m_mbContext);
-    }
+  unschedule();
+  m_bus->detach(m_slave);
 }
 
 uint16_t T3311::readInputReg(int reg)
 {
   uint16_t val;
 
-  if (modbus_read_input_registers(m_mbContext, reg, 1, &val) <= 0)
+  if (m_bus->readInputRegs(m_slave, reg, 1, &val) <= 0)
     {
       throw std::runtime_error(std::string(__FUNCTION__) +
                                ": modbus_read_input_registers() failed");
@@ -201,7 +186,7 @@ int T3311::readInputRegs(int reg, int len, uint16_t *buf)
 {
   int rv;
 
-  if ((rv = modbus_read_input_registers(m_mbContext, reg, len, buf)) < 0)
+  if ((rv = m_bus->readInputRegs(m_slave, reg, len, buf)) < 0)
     {
       throw std::runtime_error(std::string(__FUNCTION__) +
                                ": modbus_read_input_registers() failed");
@@ -222,6 +207,34 @@ void T3311::update()
                                ": read less than the expected 9 registers");
     }
 
+  decode(data);
+}
+
+void T3311::schedule(int intervalMs)
+{
+  unschedule();
+
+  // the same 9 registers update() reads
+  m_pollID = m_bus->addPoll(m_slave, ModbusBus::REGS_INPUT, REG_TEMPERATURE,
+                            9, intervalMs, pollHandler, this);
+}
+
+void T3311::unschedule()
+{
+  if (m_pollID >= 0)
+    {
+      m_bus->removePoll(m_pollID);
+      m_pollID = -1;
+    }
+}
+
+void T3311::pollHandler(const uint16_t *regs, int len, void *arg)
+{
+  ((T3311 *)arg)->decode(regs);
+}
+
+void T3311::decode(const uint16_t *data)
+{
   // temperature first, we always store as C
   float tmpF = float((int16_t)data[0]) / 10.0;
   if (m_isCelsius)
@@ -301,8 +314,5 @@ void T3311::setDebug(bool enable)
 {
   m_debugging = enable;
 
-  if (enable)
-    modbus_set_debug(m_mbContext, 1);
-  else
-    modbus_set_debug(m_mbContext, 0);
+  m_bus->setDebug(enable);
 }
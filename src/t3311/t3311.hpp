@@ -25,7 +25,7 @@
 
 #include <string>
 
-#include <modbus/modbus.h>
+#include "modbusbus.hpp"
 
 namespace upm {
 
@@ -57,6 +57,11 @@ namespace upm {
    * accessing this device -- you must use a full serial RS232
    * interface connected via USB.
    *
+   * Devices on the same serial port share a ModbusBus, so several
+   * T3311s (and other UPM MODBUS devices) can be used on one line.
+   * Instead of calling update(), schedule() lets ModbusBus::poll()
+   * refresh the values on its own timetable.
+   *
    * @snippet t3311.cxx Interesting
    */
 
@@ -139,6 +144,31 @@ namespace upm {
      */
     void update();
 
+    /**
+     * Have the shared bus refresh the values every intervalMs
+     * milliseconds, instead of calling update().  The values are
+     * refreshed from ModbusBus::poll(), which must be called
+     * regularly on the bus returned by getBus().
+     *
+     * @param intervalMs How often to read the sensor, in milliseconds
+     */
+    void schedule(int intervalMs);
+
+    /**
+     * Stop refreshing the values from the shared bus.
+     */
+    void unschedule();
+
+    /**
+     * Get the shared bus this device is attached to.
+     *
+     * @return The bus for the serial port of this device
+     */
+    ModbusBus *getBus()
+    {
+      return m_bus;
+    };
+
     /**
      * Get the current temperature.  update() must have been called
      * prior to calling this method.
@@ -267,7 +297,7 @@ namespace upm {
 
     /**
      * Enable or disable debugging output.  This primarily enables and
-     * disables libmodbus debugging output.
+     * disables libmodbus debugging output, for the whole bus.
      *
      * @param enable true to enable debugging, false otherwise
      */
@@ -277,8 +307,14 @@ namespace upm {
     uint16_t readInputReg(int reg);
     int readInputRegs(int reg, int len, uint16_t *buf);
 
-    // MODBUS context
-    modbus_t *m_mbContext;
+    // decode the 9 registers starting at REG_TEMPERATURE
+    void decode(const uint16_t *data);
+    static void pollHandler(const uint16_t *regs, int len, void *arg);
+
+    // shared MODBUS bus, our slave address and scheduled poll id
+    ModbusBus *m_bus;
+    int m_slave;
+    int m_pollID;
 
     // is the device reporting in C or F?
     bool m_isCelsius;
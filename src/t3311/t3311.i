@@ -13,7 +13,9 @@ JAVA_JNI_LOADLIBRARY(javaupm_t3311)
 %pointer_functions(float, floatp);
 
 %{
+#include "modbusbus.hpp"
 #include "t3311.hpp"
 %}
+%include "modbusbus.hpp"
 %include "t3311.hpp"
 /* END Common SWIG syntax */
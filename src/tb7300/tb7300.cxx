@@ -59,6 +59,10 @@ TB7300::TB7300(uint32_t targetDeviceObjectID) :
 
   // room temperature only
   m_temperature = 0.0;
+
+  // read by update()
+  addPoint(OBJECT_ANALOG_VALUE, AV_Room_Temperature);
+  addPoint(OBJECT_BINARY_VALUE, BV_Temperature_Scale);
 }
 
 TB7300::~TB7300()
@@ -67,13 +71,14 @@ TB7300::~TB7300()
 
 void TB7300::update()
 {
-  if (!m_isTempInitialized)
-    {
-      // this will update internals so conversions work properly
-      getTemperatureScale();
-    }
+  updatePoints();
+
+  // the scale is read along with the temperature, so they always
+  // agree, even just after a scale change.
+  m_isTempInitialized = true;
+  m_isCelsius = !getPointBoolean(OBJECT_BINARY_VALUE, BV_Temperature_Scale);
 
-  float tmpF = getAnalogValue(AV_Room_Temperature);
+  float tmpF = getPointReal(OBJECT_ANALOG_VALUE, AV_Room_Temperature);
 
   if (m_isCelsius)
     m_temperature = tmpF;
@@ -209,11 +209,15 @@ namespace upm {
     ~TB7300();
 
     /**
-     * Read current temperature from the sensor and update internal
-     * stored value.  This method must be called prior to querying the
-     * temperature.  All other values in the device must be queried
-     * directly via the appropriate BACNETUTIL::get*() methods
-     * depending on the object of interest.
+     * Read current temperature and temperature scale from the sensor
+     * and update internal stored values.  This method must be called
+     * prior to querying the temperature.  Both are read in a single
+     * BACnet ReadPropertyMultiple request, along with any other
+     * points added with BACNETUTIL::addPoint(), so that many values
+     * can be refreshed in one pass and then retrieved with the
+     * BACNETUTIL::getPoint*() methods.  All other values in the
+     * device must be queried directly via the appropriate
+     * BACNETUTIL::get*() methods depending on the object of interest.
      */
     void update();
 
@@ -24,6 +24,7 @@
 
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 #include "uartat.h"
 
@@ -37,6 +38,16 @@
 // milliseconds
 #define UARTAT_DEFAULT_RESP_DELAY   (250)
 
+// milliseconds the engine thread waits for data before checking for
+// command timeouts and shutdown
+#define UARTAT_ENGINE_POLL_MS       (20)
+
+// bytes requested per engine read
+#define UARTAT_ENGINE_READ_CHUNK    (256)
+
+// internal line classification, not a result
+#define UARTAT_RESULT_NONE          (-1)
+
 static uartat_context _uartat_preinit()
 {
     // make sure MRAA is initialized
@@ -58,6 +69,9 @@ static uartat_context _uartat_preinit()
 
     dev->cmd_resp_wait_ms = UARTAT_DEFAULT_RESP_DELAY;
 
+    pthread_mutex_init(&dev->engine_lock, NULL);
+    pthread_cond_init(&dev->engine_cond, NULL);
+
     return dev;
 }
 
@@ -129,9 +143,14 @@ void uartat_close(uartat_context dev)
 {
     assert(dev != NULL);
 
+    uartat_engine_stop(dev);
+
     if (dev->uart)
         mraa_uart_stop(dev->uart);
 
+    pthread_cond_destroy(&dev->engine_cond);
+    pthread_mutex_destroy(&dev->engine_lock);
+
     free(dev);
 }
 
@@ -231,6 +250,10 @@ void uartat_drain(const uartat_context dev)
 {
     assert(dev != NULL);
 
+    // the engine thread consumes everything itself
+    if (uartat_engine_running(dev))
+        return;
+
     char resp[UARTAT_MAX_BUFFER];
     int rv;
     while (uartat_data_available(dev, 0))
@@ -254,6 +277,25 @@ int uartat_command_with_response(const uartat_context dev,
     assert(dev != NULL);
     assert(cmd != NULL);
 
+    if (uartat_engine_running(dev))
+    {
+        if (resp && resp_len > 1)
+        {
+            if (uartat_command_sync(dev, cmd, NULL, dev->cmd_resp_wait_ms,
+                                    resp, resp_len) == UARTAT_RESULT_ABORTED)
+                return -1;
+
+            return strlen(resp);
+        }
+
+        // nobody is waiting on the response, so don't wait either
+        if (uartat_command_submit(dev, cmd, NULL, dev->cmd_resp_wait_ms,
+                                  NULL, NULL))
+            return -1;
+
+        return 0;
+    }
+
     uartat_drain(dev);
     if (uartat_write(dev, cmd, strlen(cmd)) < 0)
     {
@@ -311,6 +353,10 @@ bool uartat_command_waitfor(const uartat_context dev, const char *cmd,
     assert(resp_len > 0);
     assert(wait_string != NULL);
 
+    if (uartat_engine_running(dev))
+        return (uartat_command_sync(dev, cmd, wait_string, millis,
+                                    resp, resp_len) == UARTAT_RESULT_CUSTOM);
+
     uartat_drain(dev);
     if (uartat_write(dev, cmd, strlen(cmd)) < 0)
     {
@@ -410,3 +456,539 @@ void uartat_filter_cr(const uartat_context dev, bool enable)
 
     dev->filter_cr = enable;
 }
+
+// current CLOCK_MONOTONIC time in us
+static uint64_t uartat_now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// append a line and a '\n' to a 0 terminated buffer of size len,
+// truncating if needed
+static void uartat_append_line(char *buf, size_t *used, size_t len,
+                               const char *line)
+{
+    size_t n = strlen(line);
+
+    if (*used + 1 >= len)
+        return;
+
+    if (n > len - *used - 2)
+        n = len - *used - 2;
+
+    memcpy(&buf[*used], line, n);
+    *used += n;
+    buf[(*used)++] = '\n';
+    buf[*used] = 0;
+}
+
+// classify a line as a final result of pending command p
+static int uartat_final_result(const uartat_pending_t *p, const char *line)
+{
+    // the caller's own final string wins, so waiting for "OK" or a
+    // string inside an error line behaves as requested
+    if (p->final_str[0] && strstr(line, p->final_str))
+        return UARTAT_RESULT_CUSTOM;
+
+    if (!strcmp(line, "OK"))
+        return UARTAT_RESULT_OK;
+
+    if (!strncmp(line, "CONNECT", 7))
+        return UARTAT_RESULT_CONNECT;
+
+    if (!strcmp(line, "ERROR") || !strncmp(line, "+CME ERROR:", 11)
+        || !strncmp(line, "+CMS ERROR:", 11) || !strcmp(line, "NO CARRIER")
+        || !strcmp(line, "BUSY") || !strcmp(line, "NO ANSWER")
+        || !strcmp(line, "NO DIALTONE"))
+        return UARTAT_RESULT_ERROR;
+
+    return UARTAT_RESULT_NONE;
+}
+
+// length of the command text without trailing CR/LF
+static size_t uartat_cmd_len(const char *cmd)
+{
+    size_t n = strlen(cmd);
+
+    while (n && (cmd[n - 1] == '\r' || cmd[n - 1] == '\n'))
+        n--;
+
+    return n;
+}
+
+// is line the echo of cmd (ATE1)?
+static bool uartat_is_echo(const char *cmd, const char *line)
+{
+    size_t n = uartat_cmd_len(cmd);
+
+    return (n && strlen(line) == n && !strncmp(cmd, line, n));
+}
+
+// does line carry the information prefix of cmd, eg. "+CSQ:" for
+// "AT+CSQ" or "+CREG:" for "AT+CREG?"
+static bool uartat_is_info(const char *cmd, const char *line)
+{
+    if (strncasecmp(cmd, "AT", 2) || (cmd[2] != '+' && cmd[2] != '#'
+                                      && cmd[2] != '$' && cmd[2] != '^'))
+        return false;
+
+    cmd += 2;
+
+    size_t n = 0;
+    while (cmd[n] && cmd[n] != '=' && cmd[n] != '?' && cmd[n] != '\r'
+           && cmd[n] != ';')
+        n++;
+
+    return (n > 1 && !strncmp(cmd, line, n) && line[n] == ':');
+}
+
+// write the head of the queue if it hasn't been.  Must be called with
+// the lock held.
+static void uartat_engine_send(const uartat_context dev)
+{
+    if (!dev->pend_count || dev->pend_sent)
+        return;
+
+    uartat_pending_t *p = &dev->pending[dev->pend_head];
+
+    // a failed write is reported through the command timeout
+    if (uartat_write(dev, p->cmd, strlen(p->cmd)) < 0)
+        printf("%s: uartat_write failed\n", __FUNCTION__);
+
+    dev->pend_sent = true;
+    dev->pend_deadline_us = uartat_now_us()
+        + (uint64_t)p->timeout_ms * 1000;
+}
+
+// remove the head of the queue into done and send the next command.
+// Must be called with the lock held.
+static void uartat_engine_pop(const uartat_context dev,
+                              uartat_pending_t *done)
+{
+    *done = dev->pending[dev->pend_head];
+
+    dev->pend_head = (dev->pend_head + 1) % UARTAT_MAX_PENDING;
+    dev->pend_count--;
+    dev->pend_sent = false;
+
+    uartat_engine_send(dev);
+}
+
+// handle one received line.  Handlers are called without the lock.
+static void uartat_engine_line(const uartat_context dev, const char *line)
+{
+    uartat_pending_t done;
+    int result = UARTAT_RESULT_NONE;
+    uartat_urc_handler_t urc = NULL;
+    void *urc_arg = NULL;
+
+    pthread_mutex_lock(&dev->engine_lock);
+
+    uartat_pending_t *p = NULL;
+    if (dev->pend_count && dev->pend_sent)
+        p = &dev->pending[dev->pend_head];
+
+    if (p && uartat_is_echo(p->cmd, line))
+    {
+        pthread_mutex_unlock(&dev->engine_lock);
+        return;
+    }
+
+    if (p && (result = uartat_final_result(p, line)) != UARTAT_RESULT_NONE)
+    {
+        uartat_engine_pop(dev, &done);
+    }
+    else if (p && uartat_is_info(p->cmd, line))
+    {
+        uartat_append_line(p->resp, &p->resp_len, UARTAT_MAX_RESP, line);
+    }
+    else
+    {
+        for (int i = 0; i < UARTAT_MAX_URC; i++)
+        {
+            if (dev->urcs[i].handler && !strncmp(line, dev->urcs[i].prefix,
+                                                 strlen(dev->urcs[i].prefix)))
+            {
+                urc = dev->urcs[i].handler;
+                urc_arg = dev->urcs[i].arg;
+                break;
+            }
+        }
+
+        if (!urc && p)
+            uartat_append_line(p->resp, &p->resp_len, UARTAT_MAX_RESP, line);
+    }
+
+    pthread_mutex_unlock(&dev->engine_lock);
+
+    if (result != UARTAT_RESULT_NONE && done.handler)
+        done.handler((UARTAT_RESULT_T)result, line, done.resp, done.arg);
+
+    if (urc)
+        urc(line, urc_arg);
+}
+
+// complete the command in flight if its deadline has passed
+static void uartat_engine_check_timeout(const uartat_context dev)
+{
+    uartat_pending_t done;
+    bool expired = false;
+
+    pthread_mutex_lock(&dev->engine_lock);
+
+    if (dev->pend_count && dev->pend_sent
+        && uartat_now_us() >= dev->pend_deadline_us)
+    {
+        uartat_engine_pop(dev, &done);
+        expired = true;
+    }
+
+    pthread_mutex_unlock(&dev->engine_lock);
+
+    if (expired && done.handler)
+        done.handler(UARTAT_RESULT_TIMEOUT, "", done.resp, done.arg);
+}
+
+// does the partial line complete the command in flight, eg. a "> "
+// prompt that is never followed by a line terminator?
+static bool uartat_engine_prompt(const uartat_context dev)
+{
+    bool rv = false;
+
+    pthread_mutex_lock(&dev->engine_lock);
+
+    if (dev->pend_count && dev->pend_sent)
+    {
+        const uartat_pending_t *p = &dev->pending[dev->pend_head];
+        rv = (p->final_str[0] && !strcmp(dev->line, p->final_str));
+    }
+
+    pthread_mutex_unlock(&dev->engine_lock);
+
+    return rv;
+}
+
+static void *uartat_engine_thread(void *ctx)
+{
+    uartat_context dev = (uartat_context)ctx;
+    char buf[UARTAT_ENGINE_READ_CHUNK];
+
+    while (__atomic_load_n(&dev->engine_running, __ATOMIC_ACQUIRE))
+    {
+        if (mraa_uart_data_available(dev->uart, UARTAT_ENGINE_POLL_MS))
+        {
+            int rv = mraa_uart_read(dev->uart, buf, sizeof(buf));
+
+            if (rv < 0)
+            {
+                printf("%s: read failed\n", __FUNCTION__);
+                upm_delay_ms(UARTAT_ENGINE_POLL_MS);
+            }
+
+            for (int i = 0; i < rv; i++)
+            {
+                if (buf[i] == '\r' || buf[i] == '\n')
+                {
+                    if (dev->line_len)
+                    {
+                        dev->line[dev->line_len] = 0;
+                        dev->line_len = 0;
+                        uartat_engine_line(dev, dev->line);
+                    }
+                }
+                else if (dev->line_len < UARTAT_MAX_LINE - 1)
+                {
+                    dev->line[dev->line_len++] = buf[i];
+                }
+            }
+
+            if (dev->line_len)
+            {
+                dev->line[dev->line_len] = 0;
+                if (uartat_engine_prompt(dev))
+                {
+                    dev->line_len = 0;
+                    uartat_engine_line(dev, dev->line);
+                }
+            }
+        }
+
+        uartat_engine_check_timeout(dev);
+    }
+
+    return NULL;
+}
+
+upm_result_t uartat_engine_start(const uartat_context dev)
+{
+    assert(dev != NULL);
+
+    if (uartat_engine_running(dev))
+        return UPM_SUCCESS;
+
+    // anything already buffered belongs to nobody
+    uartat_drain(dev);
+    dev->line_len = 0;
+
+    __atomic_store_n(&dev->engine_running, true, __ATOMIC_RELEASE);
+
+    if (pthread_create(&dev->engine_thread, NULL, uartat_engine_thread, dev))
+    {
+        printf("%s: pthread_create() failed.\n", __FUNCTION__);
+        __atomic_store_n(&dev->engine_running, false, __ATOMIC_RELEASE);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+
+    return UPM_SUCCESS;
+}
+
+void uartat_engine_stop(const uartat_context dev)
+{
+    assert(dev != NULL);
+
+    if (!uartat_engine_running(dev))
+        return;
+
+    // cleared under the lock, so no submit can queue a command after
+    // the queue is drained below
+    pthread_mutex_lock(&dev->engine_lock);
+    __atomic_store_n(&dev->engine_running, false, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&dev->engine_lock);
+
+    pthread_join(dev->engine_thread, NULL);
+
+    // fail whatever is left, one at a time so handlers run unlocked
+    for (;;)
+    {
+        uartat_pending_t done;
+
+        pthread_mutex_lock(&dev->engine_lock);
+        if (!dev->pend_count)
+        {
+            pthread_mutex_unlock(&dev->engine_lock);
+            break;
+        }
+
+        done = dev->pending[dev->pend_head];
+        dev->pend_head = (dev->pend_head + 1) % UARTAT_MAX_PENDING;
+        dev->pend_count--;
+        dev->pend_sent = false;
+        pthread_mutex_unlock(&dev->engine_lock);
+
+        if (done.handler)
+            done.handler(UARTAT_RESULT_ABORTED, "", done.resp, done.arg);
+    }
+}
+
+bool uartat_engine_running(const uartat_context dev)
+{
+    assert(dev != NULL);
+
+    return __atomic_load_n(&dev->engine_running, __ATOMIC_ACQUIRE);
+}
+
+upm_result_t uartat_command_submit(const uartat_context dev,
+                                   const char *cmd,
+                                   const char *final_str,
+                                   unsigned int timeout_ms,
+                                   uartat_result_handler_t handler,
+                                   void *arg)
+{
+    assert(dev != NULL);
+    assert(cmd != NULL);
+
+    if (strlen(cmd) >= UARTAT_MAX_CMD
+        || (final_str && strlen(final_str) >= UARTAT_MAX_MATCH))
+    {
+        printf("%s: command or final string too long\n", __FUNCTION__);
+        return UPM_ERROR_INVALID_SIZE;
+    }
+
+    if (!uartat_engine_running(dev))
+    {
+        printf("%s: AT engine not running\n", __FUNCTION__);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+
+    pthread_mutex_lock(&dev->engine_lock);
+
+    // check again, the engine may have been stopped meanwhile
+    if (!uartat_engine_running(dev))
+    {
+        pthread_mutex_unlock(&dev->engine_lock);
+        printf("%s: AT engine not running\n", __FUNCTION__);
+        return UPM_ERROR_OPERATION_FAILED;
+    }
+
+    if (dev->pend_count >= UARTAT_MAX_PENDING)
+    {
+        pthread_mutex_unlock(&dev->engine_lock);
+        printf("%s: command queue full\n", __FUNCTION__);
+        return UPM_ERROR_NO_RESOURCES;
+    }
+
+    uartat_pending_t *p = &dev->pending[(dev->pend_head + dev->pend_count)
+                                        % UARTAT_MAX_PENDING];
+
+    strcpy(p->cmd, cmd);
+    strcpy(p->final_str, (final_str) ? final_str : "");
+    p->resp[0] = 0;
+    p->resp_len = 0;
+    p->timeout_ms = timeout_ms;
+    p->handler = handler;
+    p->arg = arg;
+
+    dev->pend_count++;
+    uartat_engine_send(dev);
+
+    pthread_mutex_unlock(&dev->engine_lock);
+
+    return UPM_SUCCESS;
+}
+
+// state shared between uartat_command_sync() and its handler
+typedef struct {
+    uartat_context dev;
+    bool done;
+    UARTAT_RESULT_T result;
+    char *resp;
+    size_t resp_len;
+} uartat_waiter_t;
+
+static void uartat_sync_handler(UARTAT_RESULT_T result,
+                                const char *final_line,
+                                const char *resp, void *arg)
+{
+    uartat_waiter_t *w = (uartat_waiter_t *)arg;
+
+    pthread_mutex_lock(&w->dev->engine_lock);
+
+    if (w->resp)
+    {
+        size_t used = 0;
+        size_t n = strlen(resp);
+
+        if (n > w->resp_len - 1)
+            n = w->resp_len - 1;
+
+        memcpy(w->resp, resp, n);
+        w->resp[n] = 0;
+        used = n;
+
+        if (final_line[0])
+            uartat_append_line(w->resp, &used, w->resp_len, final_line);
+    }
+
+    w->result = result;
+    w->done = true;
+    pthread_cond_broadcast(&w->dev->engine_cond);
+
+    pthread_mutex_unlock(&w->dev->engine_lock);
+}
+
+UARTAT_RESULT_T uartat_command_sync(const uartat_context dev,
+                                    const char *cmd,
+                                    const char *final_str,
+                                    unsigned int timeout_ms,
+                                    char *resp, size_t resp_len)
+{
+    assert(dev != NULL);
+    assert(cmd != NULL);
+
+    uartat_waiter_t w;
+    w.dev = dev;
+    w.done = false;
+    w.result = UARTAT_RESULT_ABORTED;
+    w.resp = (resp && resp_len) ? resp : NULL;
+    w.resp_len = resp_len;
+
+    if (w.resp)
+        w.resp[0] = 0;
+
+    // the engine thread can't wait on itself
+    if (uartat_engine_running(dev)
+        && pthread_equal(pthread_self(), dev->engine_thread))
+    {
+        printf("%s: called from an engine handler\n", __FUNCTION__);
+        return UARTAT_RESULT_ABORTED;
+    }
+
+    if (uartat_command_submit(dev, cmd, final_str, timeout_ms,
+                              uartat_sync_handler, &w))
+        return UARTAT_RESULT_ABORTED;
+
+    // every queued command completes, by timeout or abort at worst
+    pthread_mutex_lock(&dev->engine_lock);
+    while (!w.done)
+        pthread_cond_wait(&dev->engine_cond, &dev->engine_lock);
+    pthread_mutex_unlock(&dev->engine_lock);
+
+    return w.result;
+}
+
+upm_result_t uartat_urc_register(const uartat_context dev,
+                                 const char *prefix,
+                                 uartat_urc_handler_t handler,
+                                 void *arg)
+{
+    assert(dev != NULL);
+    assert(prefix != NULL);
+    assert(handler != NULL);
+
+    if (!prefix[0] || strlen(prefix) >= UARTAT_MAX_MATCH)
+    {
+        printf("%s: invalid prefix\n", __FUNCTION__);
+        return UPM_ERROR_INVALID_SIZE;
+    }
+
+    pthread_mutex_lock(&dev->engine_lock);
+
+    int slot = -1;
+    for (int i = 0; i < UARTAT_MAX_URC; i++)
+    {
+        if (dev->urcs[i].handler && !strcmp(dev->urcs[i].prefix, prefix))
+        {
+            slot = i;
+            break;
+        }
+        if (!dev->urcs[i].handler && slot < 0)
+            slot = i;
+    }
+
+    if (slot < 0)
+    {
+        pthread_mutex_unlock(&dev->engine_lock);
+        printf("%s: URC registry full\n", __FUNCTION__);
+        return UPM_ERROR_NO_RESOURCES;
+    }
+
+    strcpy(dev->urcs[slot].prefix, prefix);
+    dev->urcs[slot].handler = handler;
+    dev->urcs[slot].arg = arg;
+
+    pthread_mutex_unlock(&dev->engine_lock);
+
+    return UPM_SUCCESS;
+}
+
+void uartat_urc_unregister(const uartat_context dev, const char *prefix)
+{
+    assert(dev != NULL);
+    assert(prefix != NULL);
+
+    pthread_mutex_lock(&dev->engine_lock);
+
+    for (int i = 0; i < UARTAT_MAX_URC; i++)
+    {
+        if (dev->urcs[i].handler && !strcmp(dev->urcs[i].prefix, prefix))
+        {
+            dev->urcs[i].handler = NULL;
+            dev->urcs[i].arg = NULL;
+            dev->urcs[i].prefix[0] = 0;
+        }
+    }
+
+    pthread_mutex_unlock(&dev->engine_lock);
+}
@@ -171,3 +171,76 @@ void UARTAT::filterCR(bool enable)
 {
     uartat_filter_cr(m_uartat, enable);
 }
+
+void UARTAT::startEngine()
+{
+    if (uartat_engine_start(m_uartat))
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": uartat_engine_start() failed");
+}
+
+void UARTAT::stopEngine()
+{
+    uartat_engine_stop(m_uartat);
+}
+
+bool UARTAT::engineRunning()
+{
+    return uartat_engine_running(m_uartat);
+}
+
+static void _result_proxy(UARTAT_RESULT_T result, const char *final_line,
+                          const char *resp, void *arg)
+{
+    ((ResultHandler *)arg)->run(result, string(final_line), string(resp));
+}
+
+void UARTAT::submit(const string cmd, ResultHandler *handler,
+                    const string finalStr, unsigned int timeoutMs)
+{
+    if (uartat_command_submit(m_uartat, cmd.c_str(),
+                              (finalStr.empty()) ? NULL : finalStr.c_str(),
+                              timeoutMs, (handler) ? _result_proxy : NULL,
+                              handler))
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": uartat_command_submit() failed");
+}
+
+string UARTAT::commandSync(const string cmd, const string finalStr,
+                           unsigned int timeoutMs, size_t respLen)
+{
+    char buffer[respLen + 1];
+
+    UARTAT_RESULT_T rv = uartat_command_sync(m_uartat, cmd.c_str(),
+                                             (finalStr.empty()) ? NULL
+                                             : finalStr.c_str(),
+                                             timeoutMs, buffer,
+                                             respLen + 1);
+
+    if (rv == UARTAT_RESULT_TIMEOUT || rv == UARTAT_RESULT_ABORTED)
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": uartat_command_sync() failed");
+
+    return string(buffer);
+}
+
+static void _urc_proxy(const char *line, void *arg)
+{
+    ((URCHandler *)arg)->run(string(line));
+}
+
+void UARTAT::registerURC(const string prefix, URCHandler *handler)
+{
+    if (!handler)
+        throw std::invalid_argument(string(__FUNCTION__)
+                                    + ": handler must not be NULL");
+
+    if (uartat_urc_register(m_uartat, prefix.c_str(), _urc_proxy, handler))
+        throw std::runtime_error(string(__FUNCTION__)
+                                 + ": uartat_urc_register() failed");
+}
+
+void UARTAT::unregisterURC(const string prefix)
+{
+    uartat_urc_unregister(m_uartat, prefix.c_str());
+}
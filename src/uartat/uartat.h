@@ -27,6 +27,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <pthread.h>
 
 #include <upm.h>
 #include <mraa/uart.h>
@@ -44,6 +45,42 @@ extern "C" {
      *
      */
 
+// maximum number of commands queued in the AT engine
+#define UARTAT_MAX_PENDING     (16)
+// maximum number of registered URC handlers
+#define UARTAT_MAX_URC         (16)
+// maximum length of a queued command, including the trailing 0
+#define UARTAT_MAX_CMD         (256)
+// maximum length of a custom final result string or URC prefix
+#define UARTAT_MAX_MATCH       (32)
+// maximum size of the intermediate response kept per command
+#define UARTAT_MAX_RESP        (1024)
+// maximum length of a received line, longer lines are truncated
+#define UARTAT_MAX_LINE        (512)
+
+    /**
+     * A command queued in the AT engine
+     */
+    typedef struct _uartat_pending {
+        char cmd[UARTAT_MAX_CMD];
+        // caller supplied final result string, "" if none
+        char final_str[UARTAT_MAX_MATCH];
+        char resp[UARTAT_MAX_RESP];
+        size_t resp_len;
+        unsigned int timeout_ms;
+        uartat_result_handler_t handler;
+        void *arg;
+    } uartat_pending_t;
+
+    /**
+     * A registered unsolicited result code handler
+     */
+    typedef struct _uartat_urc {
+        char prefix[UARTAT_MAX_MATCH];
+        uartat_urc_handler_t handler;
+        void *arg;
+    } uartat_urc_t;
+
     /**
      * Device context
      */
@@ -56,6 +93,25 @@ extern "C" {
 
         // filter carriage returns (CR) out of responses?
         bool filter_cr;
+
+        // AT engine.  The reader thread owns the UART while running.
+        pthread_t engine_thread;
+        bool engine_running;
+        pthread_mutex_t engine_lock;
+        pthread_cond_t engine_cond;
+
+        // command queue, the head is the command in flight once sent
+        uartat_pending_t pending[UARTAT_MAX_PENDING];
+        unsigned int pend_head;
+        unsigned int pend_count;
+        bool pend_sent;
+        uint64_t pend_deadline_us;
+
+        uartat_urc_t urcs[UARTAT_MAX_URC];
+
+        // line being framed by the reader thread
+        char line[UARTAT_MAX_LINE];
+        size_t line_len;
     } *uartat_context;
 
     /**
@@ -277,6 +333,120 @@ extern "C" {
      */
     void uartat_filter_cr(const uartat_context dev, bool enable);
 
+    /**
+     * Start the AT engine.  A reader thread takes over the UART,
+     * framing received data into lines.  Lines are matched against
+     * the command in flight (echo, intermediate response, final
+     * result) and the registered URC handlers.  Commands are queued
+     * with uartat_command_submit() and are written back to back as
+     * each final result arrives, rather than after a fixed delay.
+     *
+     * While the engine is running, uartat_command_with_response(),
+     * uartat_command() and uartat_command_waitfor() are routed
+     * through the queue and uartat_drain() does nothing.  Do not
+     * call uartat_read() or uartat_command_mode() while it runs.
+     * The engine expects verbose result codes (ATV1).
+     *
+     * @param dev Device context
+     * @return UPM result
+     */
+    upm_result_t uartat_engine_start(const uartat_context dev);
+
+    /**
+     * Stop the AT engine.  Commands still queued complete with
+     * UARTAT_RESULT_ABORTED.
+     *
+     * @param dev Device context
+     */
+    void uartat_engine_stop(const uartat_context dev);
+
+    /**
+     * Determine whether the AT engine is running.
+     *
+     * @param dev Device context
+     * @return true if the engine is running, false otherwise
+     */
+    bool uartat_engine_running(const uartat_context dev);
+
+    /**
+     * Queue an AT command in the engine and return immediately.  The
+     * command is written as soon as every command queued before it
+     * has completed.  It completes on OK, CONNECT, ERROR, +CME ERROR,
+     * +CMS ERROR, NO CARRIER, BUSY, NO ANSWER or NO DIALTONE, on a
+     * line containing final_str if one is given, or when timeout_ms
+     * elapses after it was written.  A partial line equal to
+     * final_str also completes it, so prompts like "> " work.
+     *
+     * @param dev Device context
+     * @param cmd The AT command to send, including the "AT" prefix
+     * and a terminating carriage return ("\r").
+     * @param final_str An additional final result string, or NULL.
+     * @param timeout_ms Milliseconds to wait for a final result.
+     * @param handler Called from the engine thread on completion, or
+     * NULL to ignore the result.
+     * @param arg User argument passed to the handler.
+     * @return UPM result.  UPM_ERROR_NO_RESOURCES is returned when
+     * the queue is full.
+     */
+    upm_result_t uartat_command_submit(const uartat_context dev,
+                                       const char *cmd,
+                                       const char *final_str,
+                                       unsigned int timeout_ms,
+                                       uartat_result_handler_t handler,
+                                       void *arg);
+
+    /**
+     * Queue an AT command in the engine and wait for it to complete.
+     * This must not be called from a result or URC handler.
+     *
+     * @param dev Device context
+     * @param cmd The AT command to send, including the "AT" prefix
+     * and a terminating carriage return ("\r").
+     * @param final_str An additional final result string, or NULL.
+     * @param timeout_ms Milliseconds to wait for a final result.
+     * @param resp A buffer for the intermediate response lines
+     * followed by the final result line, each '\n' terminated, or
+     * NULL.  The buffer is 0 terminated.
+     * @param resp_len The length of the supplied response buffer.
+     * @return The command result.  UARTAT_RESULT_ABORTED is returned
+     * if the command could not be queued.
+     */
+    UARTAT_RESULT_T uartat_command_sync(const uartat_context dev,
+                                        const char *cmd,
+                                        const char *final_str,
+                                        unsigned int timeout_ms,
+                                        char *resp, size_t resp_len);
+
+    /**
+     * Register a handler for unsolicited result codes (URCs) starting
+     * with prefix, eg. "+CREG:" or "RING".  Registering an existing
+     * prefix replaces its handler.  Lines starting with the
+     * information prefix of the command in flight (eg. "+CREG" for
+     * "AT+CREG?") go to that command instead.  Other lines that match
+     * no handler are added to the response of the command in flight,
+     * or dropped if there is none.
+     *
+     * @param dev Device context
+     * @param prefix The line prefix to match.
+     * @param handler Called from the engine thread for each matching
+     * line.
+     * @param arg User argument passed to the handler.
+     * @return UPM result.  UPM_ERROR_NO_RESOURCES is returned when
+     * the registry is full.
+     */
+    upm_result_t uartat_urc_register(const uartat_context dev,
+                                     const char *prefix,
+                                     uartat_urc_handler_t handler,
+                                     void *arg);
+
+    /**
+     * Remove the handler registered for prefix.
+     *
+     * @param dev Device context
+     * @param prefix The line prefix given at registration.
+     */
+    void uartat_urc_unregister(const uartat_context dev, const char *prefix);
+
 #ifdef __cplusplus
 }
 #endif
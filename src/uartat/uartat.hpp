@@ -29,6 +29,31 @@
 #include "uartat.h"
 
 namespace upm {
+    /* Callback class for unsolicited result codes delivered by the
+     * AT engine */
+    class URCHandler {
+    public:
+        virtual ~URCHandler() { }
+        /* Default run method, called from the engine thread for each
+         * line matching the prefix this handler was registered for.
+         * Override this method */
+        virtual void run(std::string line)
+        { std::cout << "URC: " << line << std::endl; }
+    };
+
+    /* Callback class for commands queued with UARTAT::submit() */
+    class ResultHandler {
+    public:
+        virtual ~ResultHandler() { }
+        /* Default run method, called from the engine thread when the
+         * command completes.  finalLine is empty on timeout or abort,
+         * resp holds the intermediate response lines.
+         * Override this method */
+        virtual void run(UARTAT_RESULT_T result, std::string finalLine,
+                         std::string resp)
+        { std::cout << "Result " << result << ": " << finalLine << std::endl; }
+    };
+
     /**
      * @brief Generic AT Command Based UART Modem Library
      * @defgroup uartat libupm-uartat
@@ -253,6 +278,90 @@ namespace upm {
          */
         void filterCR(bool enable);
 
+        /**
+         * Start the AT engine.  A reader thread takes over the UART and
+         * frames received data into lines, which complete queued
+         * commands or go to the registered URC handlers.  While it
+         * runs, commandWithResponse(), command() and commandWaitFor()
+         * are routed through the command queue.  Do not use readStr()
+         * or commandMode() while it runs.  The engine expects verbose
+         * result codes (ATV1).
+         *
+         * @throws std::runtime_error if the thread can't be started
+         */
+        void startEngine();
+
+        /**
+         * Stop the AT engine.  Commands still queued complete with
+         * UARTAT_RESULT_ABORTED.
+         */
+        void stopEngine();
+
+        /**
+         * Determine whether the AT engine is running.
+         *
+         * @return true if the engine is running, false otherwise
+         */
+        bool engineRunning();
+
+        /**
+         * Queue an AT command in the engine and return immediately.
+         * It is written once every command queued before it has
+         * completed, and completes on a standard final result code,
+         * on a line containing finalStr, or on timeout.
+         *
+         * @param cmd The AT command to send, including the "AT" prefix
+         * and a terminating carriage return ("\r").
+         * @param handler Called from the engine thread on completion.
+         * It must stay valid until then.  If NULL, the result is
+         * ignored.
+         * @param finalStr An additional final result string, eg. "> "
+         * @param timeoutMs Milliseconds to wait for a final result
+         * @throws std::runtime_error if the command can't be queued
+         */
+        void submit(const std::string cmd, ResultHandler *handler = NULL,
+                    const std::string finalStr = "",
+                    unsigned int timeoutMs = 1000);
+
+        /**
+         * Queue an AT command in the engine and wait for it to
+         * complete.  This must not be called from a handler.
+         *
+         * @param cmd The AT command to send, including the "AT" prefix
+         * and a terminating carriage return ("\r").
+         * @param finalStr An additional final result string, eg. "> "
+         * @param timeoutMs Milliseconds to wait for a final result
+         * @param respLen The maximum number of response characters
+         * to return.
+         * @return The intermediate response lines followed by the
+         * final result line, each LF terminated.
+         * @throws std::runtime_error on timeout or if the command
+         * can't be queued
+         */
+        std::string commandSync(const std::string cmd,
+                                const std::string finalStr = "",
+                                unsigned int timeoutMs = 1000,
+                                size_t respLen = 1024);
+
+        /**
+         * Register a handler for unsolicited result codes starting
+         * with prefix, eg. "+CREG:" or "RING".  Registering an
+         * existing prefix replaces its handler.
+         *
+         * @param prefix The line prefix to match
+         * @param handler Called from the engine thread for each
+         * matching line.  It must stay valid until unregistered.
+         * @throws std::runtime_error if the registry is full
+         */
+        void registerURC(const std::string prefix, URCHandler *handler);
+
+        /**
+         * Remove the handler registered for prefix.
+         *
+         * @param prefix The line prefix given at registration
+         */
+        void unregisterURC(const std::string prefix);
+
     protected:
         // uartat device context
         uartat_context m_uartat;
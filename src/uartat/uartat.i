@@ -2,10 +2,24 @@
 
 /* BEGIN Java syntax  ------------------------------------------------------- */
 #ifdef SWIGJAVA
+#ifndef ANDROID
+%module(directors="1", threads="1") javaupm_uartat
+%feature("director") upm::URCHandler;
+%feature("director") upm::ResultHandler;
+#endif
 JAVA_JNI_LOADLIBRARY(javaupm_uartat)
 #endif
 /* END Java syntax */
 
+/* BEGIN Python syntax  ----------------------------------------------------- */
+#ifdef SWIGPYTHON
+%module(directors="1", threads="1") pyupm_uartat
+
+%feature("director") upm::URCHandler;
+%feature("director") upm::ResultHandler;
+#endif
+/* END Python syntax */
+
 /* BEGIN Common SWIG syntax ------------------------------------------------- */
 %{
 #include "uartat_defs.h"
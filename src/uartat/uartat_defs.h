@@ -49,6 +49,29 @@ extern "C" {
         UARTAT_RESPONSE_CODE_NO_ANSWER     = 8
     } UARTAT_RESPONSE_CODE_T;
 
+    // completion status of a command issued through the AT engine
+    typedef enum {
+        UARTAT_RESULT_OK                   = 0,
+        UARTAT_RESULT_CONNECT,             // CONNECT (data mode)
+        UARTAT_RESULT_ERROR,               // ERROR, +CME/+CMS ERROR,
+                                           // NO CARRIER, BUSY, etc
+        UARTAT_RESULT_CUSTOM,              // caller supplied final string
+        UARTAT_RESULT_TIMEOUT,             // no final result in time
+        UARTAT_RESULT_ABORTED              // engine stopped first
+    } UARTAT_RESULT_T;
+
+    // called from the engine thread when a queued command completes.
+    // final_line is the final result line ("" on timeout or abort),
+    // resp holds the intermediate response lines, each '\n' terminated.
+    typedef void (*uartat_result_handler_t)(UARTAT_RESULT_T result,
+                                            const char *final_line,
+                                            const char *resp,
+                                            void *arg);
+
+    // called from the engine thread for each unsolicited result code
+    // line matching a registered prefix
+    typedef void (*uartat_urc_handler_t)(const char *line, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,6 +28,12 @@
 #include <stdio.h>
 #include <math.h>
 #include <string.h>
+#include <poll.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
 
 #include "vcap.hpp"
 
@@ -44,14 +50,35 @@ VCAP::VCAP(string videoDev) :
   memset(&m_format, 0, sizeof(struct v4l2_format));
   
   m_debugging = false;
-  m_bufferLen = 0;
   m_videoDevice = videoDev;
+
+  m_streaming = false;
+  m_heldIndex = -1;
+  m_lastSequence = 0;
+  m_framesCaptured = 0;
+  m_framesDropped = 0;
+  m_frameFunc = NULL;
+  m_frameArg = NULL;
+
+  pthread_condattr_t condAttrib;
+  pthread_condattr_init(&condAttrib);
+  pthread_condattr_setclock(&condAttrib, CLOCK_MONOTONIC);
+
+  pthread_mutex_init(&m_frameLock, NULL);
+  pthread_cond_init(&m_frameCond, &condAttrib);
+
+  pthread_condattr_destroy(&condAttrib);
+
   setJPGQuality(VCAP_DEFAULT_JPEG_QUALITY);
 
   // try to open the video device, and set a default format.
   if (!initVideoDevice())
-    throw std::runtime_error(std::string(__FUNCTION__) +
-                             ": initVideoDevice() failed");
+    {
+      pthread_cond_destroy(&m_frameCond);
+      pthread_mutex_destroy(&m_frameLock);
+      throw std::runtime_error(std::string(__FUNCTION__) +
+                               ": initVideoDevice() failed");
+    }
 
   m_height = 0;
   m_width = 0;
@@ -60,12 +87,16 @@ VCAP::VCAP(string videoDev) :
 
 VCAP::~VCAP()
 {
+  stopStreaming();
   releaseBuffer();
 
   if (m_fd >= 0)
     close(m_fd);
 
   m_fd = -1;
+
+  pthread_cond_destroy(&m_frameCond);
+  pthread_mutex_destroy(&m_frameLock);
 }
 
 bool VCAP::initVideoDevice()
@@ -141,6 +172,7 @@ bool VCAP::checkCapabilities()
 bool VCAP::setResolution(int width, int height)
 {
   // in case we already created one
+  stopStreaming();
   releaseBuffer();
 
   m_width = width;
@@ -207,6 +239,10 @@ bool VCAP::setResolution(int width, int height)
       m_height = m_format.fmt.pix.height;
     }
 
+  // some drivers leave this unset for packed formats
+  if (static_cast<int>(m_format.fmt.pix.bytesperline) < (m_width * 2))
+    m_format.fmt.pix.bytesperline = m_width * 2;
+
   // now alloc the buffers here
   if (!allocBuffer())
     return false;
@@ -214,13 +250,14 @@ bool VCAP::setResolution(int width, int height)
   return true;
 }
  
-bool VCAP::allocBuffer()
+bool VCAP::allocBuffer(unsigned int count)
 {
   struct v4l2_requestbuffers rb;
   memset(&rb, 0, sizeof(rb));
 
-  // we just want one buffer, and we only support mmap().
-  rb.count = 1;
+  // we only support mmap().  A single buffer is enough for one-shot
+  // captures, streaming wants a ring of them.
+  rb.count = count;
   rb.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
   rb.memory = V4L2_MEMORY_MMAP;
  
@@ -237,48 +274,69 @@ bool VCAP::allocBuffer()
       
       return false;
     }
- 
-  // get the buffer and mmap it
-  struct v4l2_buffer mbuf;
-  memset(&mbuf, 0, sizeof(mbuf));
 
-  mbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-  mbuf.memory = V4L2_MEMORY_MMAP;
-  mbuf.index = 0;
-
-  if (xioctl(m_fd, VIDIOC_QUERYBUF, &mbuf) < 0)
+  if (rb.count < 1)
     {
-      cerr << __FUNCTION__ << ": ioctl(VIDIOC_QUERYBUF) failed: "
-           << strerror(errno) << endl;
+      cerr << __FUNCTION__ << ": driver did not allocate any buffers"
+           << endl;
       return false;
     }
- 
-  // map it
-  m_buffer = (unsigned char *)mmap(NULL, mbuf.length, 
-                                   PROT_READ | PROT_WRITE, MAP_SHARED, 
-                                   m_fd, mbuf.m.offset);
 
-  if (m_buffer == MAP_FAILED)
+  if (m_debugging && rb.count != count)
+    cerr << __FUNCTION__ << ": Requested " << count << " buffers, driver "
+         << "allocated " << rb.count << endl;
+
+  // get the buffers and mmap them
+  for (unsigned int i = 0; i < rb.count; i++)
     {
-      cerr << __FUNCTION__ << ": mmap() failed: "
-           << strerror(errno) << endl;
-      return false;
+      struct v4l2_buffer mbuf;
+      memset(&mbuf, 0, sizeof(mbuf));
+
+      mbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      mbuf.memory = V4L2_MEMORY_MMAP;
+      mbuf.index = i;
+
+      if (xioctl(m_fd, VIDIOC_QUERYBUF, &mbuf) < 0)
+        {
+          cerr << __FUNCTION__ << ": ioctl(VIDIOC_QUERYBUF) failed: "
+               << strerror(errno) << endl;
+          releaseBuffer();
+          return false;
+        }
+ 
+      // map it
+      buffer_t buf;
+      buf.start = (unsigned char *)mmap(NULL, mbuf.length,
+                                        PROT_READ | PROT_WRITE, MAP_SHARED,
+                                        m_fd, mbuf.m.offset);
+
+      if (buf.start == MAP_FAILED)
+        {
+          cerr << __FUNCTION__ << ": mmap() failed: "
+               << strerror(errno) << endl;
+          releaseBuffer();
+          return false;
+        }
+
+      // we'll need this when unmapping
+      buf.length = mbuf.length;
+      m_buffers.push_back(buf);
     }
 
-  // we'll need this when unmapping
-  m_bufferLen = mbuf.length;
-  
+  m_buffer = m_buffers[0].start;
+
   return true;
 }
 
 void VCAP::releaseBuffer()
 {
   // first unmap any buffers
-  if (m_buffer)
-    munmap(m_buffer, m_bufferLen);
+  for (size_t i = 0; i < m_buffers.size(); i++)
+    munmap(m_buffers[i].start, m_buffers[i].length);
 
+  m_buffers.clear();
   m_buffer = 0;
-  m_bufferLen = 0;
+  m_heldIndex = -1;
 
   // then, tell the kernel driver to free any allocated buffer(s)...
   struct v4l2_requestbuffers rb;
@@ -298,25 +356,109 @@ void VCAP::releaseBuffer()
   m_imageCaptured = false;
 }
 
+// Split a row of YUYV pixels into its luma samples.  width must be
+// even, as it always is for YUYV.
+static void splitLuma(const unsigned char *yuyv, unsigned char *y, int width)
+{
+  int x = 0;
+
+#if defined(__SSE2__)
+  const __m128i mask = _mm_set1_epi16(0x00ff);
+
+  // 16 pixels (32 bytes) at a time: the luma samples are the even
+  // bytes, so mask them into 16 bit lanes and pack them back down.
+  for (; x + 16 <= width; x += 16)
+    {
+      __m128i a = _mm_loadu_si128((const __m128i *)(yuyv + (x * 2)));
+      __m128i b = _mm_loadu_si128((const __m128i *)(yuyv + (x * 2) + 16));
+
+      _mm_storeu_si128((__m128i *)(y + x),
+                       _mm_packus_epi16(_mm_and_si128(a, mask),
+                                        _mm_and_si128(b, mask)));
+    }
+#endif
 
-bool VCAP::YUYV2JPEG(FILE *file)
+  for (; x < width; x++)
+    y[x] = yuyv[x * 2];
+}
+
+// Split two rows of YUYV pixels into their chroma samples, averaging
+// the rows to produce the vertically subsampled Cb and Cr rows of a
+// 4:2:0 image.
+static void splitChroma(const unsigned char *row0, const unsigned char *row1,
+                        unsigned char *cb, unsigned char *cr, int width)
+{
+  int x = 0;
+
+#if defined(__SSE2__)
+  const __m128i mask = _mm_set1_epi16(0x00ff);
+
+  // 16 pixels (8 Cb/Cr pairs) at a time
+  for (; x + 16 <= width; x += 16)
+    {
+      __m128i a = _mm_avg_epu8(
+        _mm_loadu_si128((const __m128i *)(row0 + (x * 2))),
+        _mm_loadu_si128((const __m128i *)(row1 + (x * 2))));
+      __m128i b = _mm_avg_epu8(
+        _mm_loadu_si128((const __m128i *)(row0 + (x * 2) + 16)),
+        _mm_loadu_si128((const __m128i *)(row1 + (x * 2) + 16)));
+
+      // the odd bytes are Cb, Cr, Cb, Cr...
+      __m128i uv = _mm_packus_epi16(_mm_srli_epi16(a, 8),
+                                    _mm_srli_epi16(b, 8));
+      __m128i u = _mm_packus_epi16(_mm_and_si128(uv, mask),
+                                   _mm_setzero_si128());
+      __m128i v = _mm_packus_epi16(_mm_srli_epi16(uv, 8),
+                                   _mm_setzero_si128());
+
+      _mm_storel_epi64((__m128i *)(cb + (x / 2)), u);
+      _mm_storel_epi64((__m128i *)(cr + (x / 2)), v);
+    }
+#endif
+
+  // same rounding as _mm_avg_epu8()
+  for (; x < width; x += 2)
+    {
+      const unsigned char *p0 = row0 + (x * 2);
+      const unsigned char *p1 = row1 + (x * 2);
+
+      cb[x / 2] = (p0[1] + p1[1] + 1) >> 1;
+      cr[x / 2] = (p0[3] + p1[3] + 1) >> 1;
+    }
+}
+
+// YUYV is already YCbCr, so rather than converting to RGB, only to
+// have libjpeg convert it straight back, we split the samples into
+// planes and hand them to libjpeg as raw 4:2:0 data.  This also skips
+// libjpeg's own downsampling.
+bool VCAP::YUYV2JPEG(FILE *file, const unsigned char *yuyv, int bytesPerLine)
 {
   struct jpeg_compress_struct jpgInfo;
   struct jpeg_error_mgr jerr;
-  JSAMPROW row_pointer[1];
-  unsigned char *row_buffer = NULL;
-  unsigned char *yuyv = NULL;
-  int z;
 
-  row_buffer = (unsigned char *)calloc(m_width * 3, 1);
-  if (!row_buffer)
+  // libjpeg reads whole blocks, so pad the rows out to a multiple of
+  // the MCU width (16 luma pixels)
+  int lumaWidth = ((m_width + 15) / 16) * 16;
+  int chromaWidth = lumaWidth / 2;
+
+  // one MCU row: 16 luma rows and 8 rows each of Cb and Cr
+  unsigned char *planes = (unsigned char *)malloc((lumaWidth * 16)
+                                                  + (chromaWidth * 8 * 2));
+  if (!planes)
     {
-      cerr << __FUNCTION__ << ": allocation of line buffer failed."
+      cerr << __FUNCTION__ << ": allocation of plane buffers failed."
            << endl;
       return false;
     }
 
-  yuyv = m_buffer;
+  unsigned char *yPlane = planes;
+  unsigned char *cbPlane = yPlane + (lumaWidth * 16);
+  unsigned char *crPlane = cbPlane + (chromaWidth * 8);
+
+  JSAMPROW yRows[16];
+  JSAMPROW cbRows[8];
+  JSAMPROW crRows[8];
+  JSAMPARRAY data[3] = { yRows, cbRows, crRows };
 
   jpgInfo.err = jpeg_std_error(&jerr);
   jpeg_create_compress(&jpgInfo);
@@ -325,57 +467,66 @@ bool VCAP::YUYV2JPEG(FILE *file)
   jpgInfo.image_width = m_width;
   jpgInfo.image_height = m_height;
 
-  // components R, G, B
+  // components Y, Cb, Cr
   jpgInfo.input_components = 3;
-  jpgInfo.in_color_space = JCS_RGB;
+  jpgInfo.in_color_space = JCS_YCbCr;
 
   jpeg_set_defaults(&jpgInfo);
   jpeg_set_quality(&jpgInfo, m_jpgQuality, TRUE);
 
-  jpeg_start_compress(&jpgInfo, TRUE);
+  jpgInfo.raw_data_in = TRUE;
+  jpgInfo.comp_info[0].h_samp_factor = 2;
+  jpgInfo.comp_info[0].v_samp_factor = 2;
+  jpgInfo.comp_info[1].h_samp_factor = 1;
+  jpgInfo.comp_info[1].v_samp_factor = 1;
+  jpgInfo.comp_info[2].h_samp_factor = 1;
+  jpgInfo.comp_info[2].v_samp_factor = 1;
 
-  z = 0;
+  jpeg_start_compress(&jpgInfo, TRUE);
 
   while (jpgInfo.next_scanline < jpgInfo.image_height)
     {
-      int x;
-      unsigned char *ptr = row_buffer;
-      
-      for (x = 0; x < m_width; x++)
+      int row = jpgInfo.next_scanline;
+
+      for (int i = 0; i < 16; i++)
         {
-          int r, g, b;
-          int y, u, v;
-          
-          if (!z)
-            y = yuyv[0] << 8;
-          else
-            y = yuyv[2] << 8;
-          u = yuyv[1] - 128;
-          v = yuyv[3] - 128;
-          
-          r = (y + (359 * v)) >> 8;
-          g = (y - (88 * u) - (183 * v)) >> 8;
-          b = (y + (454 * u)) >> 8;
-          
-          *(ptr++) = CLAMP(r, 0, 255);
-          *(ptr++) = CLAMP(g, 0, 255);
-          *(ptr++) = CLAMP(b, 0, 255);
-          
-          if (z++)
-            {
-              z = 0;
-              yuyv += 4;
-            }
+          // replicate the last row to fill out the final MCU row
+          int srcRow = ((row + i) < m_height) ? (row + i) : (m_height - 1);
+          unsigned char *dst = yPlane + (i * lumaWidth);
+
+          splitLuma(yuyv + (srcRow * bytesPerLine), dst, m_width);
+          memset(dst + m_width, dst[m_width - 1], lumaWidth - m_width);
+          yRows[i] = dst;
         }
-      
-      row_pointer[0] = row_buffer;
-      jpeg_write_scanlines(&jpgInfo, row_pointer, 1);
+
+      for (int i = 0; i < 8; i++)
+        {
+          int srcRow0 = row + (i * 2);
+          int srcRow1 = srcRow0 + 1;
+          if (srcRow0 >= m_height)
+            srcRow0 = m_height - 1;
+          if (srcRow1 >= m_height)
+            srcRow1 = m_height - 1;
+
+          unsigned char *cb = cbPlane + (i * chromaWidth);
+          unsigned char *cr = crPlane + (i * chromaWidth);
+          int used = m_width / 2;
+
+          splitChroma(yuyv + (srcRow0 * bytesPerLine),
+                      yuyv + (srcRow1 * bytesPerLine), cb, cr, m_width);
+          memset(cb + used, cb[used - 1], chromaWidth - used);
+          memset(cr + used, cr[used - 1], chromaWidth - used);
+          cbRows[i] = cb;
+          crRows[i] = cr;
+        }
+
+      jpeg_write_raw_data(&jpgInfo, data, 16);
     }
 
   jpeg_finish_compress(&jpgInfo);
   jpeg_destroy_compress(&jpgInfo);
 
-  free(row_buffer);
+  free(planes);
 
   return true;
 }
@@ -404,14 +555,48 @@ bool VCAP::saveImage(string filename)
            << strerror(errno) << endl;
       return false;
     }
-  
-  YUYV2JPEG(file);
+
+  // while streaming, this keeps the capture thread from returning the
+  // buffer to the driver while we encode it
+  pthread_mutex_lock(&m_frameLock);
+  bool rv = YUYV2JPEG(file, m_buffer, m_format.fmt.pix.bytesperline);
+  pthread_mutex_unlock(&m_frameLock);
+
   fclose(file);
 
-  if (m_debugging)
+  if (m_debugging && rv)
     cerr << __FUNCTION__ << ": Saved image to " << filename << endl;
 
-  return true;
+  return rv;
+}
+
+bool VCAP::saveFrame(const VCAP_FRAME_T *frame, string filename)
+{
+  if (!frame || !frame->data)
+    throw std::invalid_argument(std::string(__FUNCTION__) +
+                                ": frame is NULL");
+
+  if (frame->width != m_width || frame->height != m_height)
+    throw std::invalid_argument(std::string(__FUNCTION__) +
+                                ": frame does not match the current "
+                                + "resolution");
+
+  FILE *file;
+  if ((file = fopen(filename.c_str(), "wb")) == NULL)
+    {
+      cerr << __FUNCTION__ << ": fopen() failed: "
+           << strerror(errno) << endl;
+      return false;
+    }
+
+  bool rv = YUYV2JPEG(file, frame->data, frame->bytesPerLine);
+  fclose(file);
+
+  if (m_debugging && rv)
+    cerr << __FUNCTION__ << ": Saved frame " << frame->sequence << " to "
+         << filename << endl;
+
+  return rv;
 }
 
 bool VCAP::captureImage()
@@ -425,6 +610,24 @@ bool VCAP::captureImage()
                                  ": setResolution() failed");
     }
 
+  // while streaming, just wait for the next frame to arrive
+  if (m_streaming)
+    {
+      pthread_mutex_lock(&m_frameLock);
+      unsigned int count = m_framesCaptured;
+      pthread_mutex_unlock(&m_frameLock);
+
+      return waitForFrame(count, 5000);
+    }
+
+  // one-shot captures use a single buffer
+  if (m_buffers.size() != 1)
+    {
+      releaseBuffer();
+      if (!allocBuffer(1))
+        return false;
+    }
+
   // we basically just call doCaptureImage() twice - once to grab and
   // discard the first frame (which is usually a remnent of a previous
   // capture), and another to grab the real frame we are interesed in.
@@ -518,6 +721,256 @@ bool VCAP::doCaptureImage()
   return true;
 }
 
+bool VCAP::startStreaming(unsigned int numBuffers)
+{
+  if (m_streaming)
+    return true;
+
+  if (numBuffers < 2)
+    throw std::invalid_argument(std::string(__FUNCTION__) +
+                                ": numBuffers must be at least 2");
+
+  // make sure a resolution was specified.  If not, set the default
+  if (m_width == 0 || m_height == 0)
+    {
+      if (!setResolution(VCAP_DEFAULT_WIDTH, VCAP_DEFAULT_HEIGHT))
+        throw std::runtime_error(std::string(__FUNCTION__) +
+                                 ": setResolution() failed");
+    }
+
+  releaseBuffer();
+  if (!allocBuffer(numBuffers))
+    return false;
+
+  // queue all of the buffers
+  for (unsigned int i = 0; i < m_buffers.size(); i++)
+    {
+      struct v4l2_buffer buf;
+      memset(&buf, 0, sizeof(buf));
+
+      buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      buf.memory = V4L2_MEMORY_MMAP;
+      buf.index = i;
+
+      if (xioctl(m_fd, VIDIOC_QBUF, &buf) < 0)
+        {
+          cerr << __FUNCTION__ << ": ioctl(VIDIOC_QBUF) failed: "
+               << strerror(errno) << endl;
+          return false;
+        }
+    }
+
+  int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (xioctl(m_fd, VIDIOC_STREAMON, &type) < 0)
+    {
+      cerr << __FUNCTION__ << ": ioctl(VIDIOC_STREAMON) failed: "
+           << strerror(errno) << endl;
+      return false;
+    }
+
+  m_heldIndex = -1;
+  m_lastSequence = 0;
+  m_framesCaptured = 0;
+  m_framesDropped = 0;
+
+  __atomic_store_n(&m_streaming, true, __ATOMIC_RELEASE);
+
+  if (pthread_create(&m_streamThread, NULL, streamThread, this))
+    {
+      __atomic_store_n(&m_streaming, false, __ATOMIC_RELEASE);
+      xioctl(m_fd, VIDIOC_STREAMOFF, &type);
+      cerr << __FUNCTION__ << ": pthread_create() failed" << endl;
+      return false;
+    }
+
+  return true;
+}
+
+void VCAP::stopStreaming()
+{
+  if (!__atomic_load_n(&m_streaming, __ATOMIC_ACQUIRE))
+    return;
+
+  // wake up anyone in captureImage() so they notice
+  pthread_mutex_lock(&m_frameLock);
+  __atomic_store_n(&m_streaming, false, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&m_frameCond);
+  pthread_mutex_unlock(&m_frameLock);
+
+  pthread_join(m_streamThread, NULL);
+
+  // this dequeues every buffer, but they remain mapped, so the last
+  // frame we held is still available to saveImage()
+  int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (xioctl(m_fd, VIDIOC_STREAMOFF, &type) < 0)
+    {
+      cerr << __FUNCTION__ << ": ioctl(VIDIOC_STREAMOFF) failed: "
+           << strerror(errno) << endl;
+    }
+
+  m_heldIndex = -1;
+}
+
+void VCAP::setFrameHandler(VCAP_FRAME_FUNC_T func, void *arg)
+{
+  pthread_mutex_lock(&m_frameLock);
+  m_frameFunc = func;
+  m_frameArg = arg;
+  pthread_mutex_unlock(&m_frameLock);
+}
+
+unsigned int VCAP::getFramesCaptured()
+{
+  pthread_mutex_lock(&m_frameLock);
+  unsigned int rv = m_framesCaptured;
+  pthread_mutex_unlock(&m_frameLock);
+
+  return rv;
+}
+
+unsigned int VCAP::getFramesDropped()
+{
+  pthread_mutex_lock(&m_frameLock);
+  unsigned int rv = m_framesDropped;
+  pthread_mutex_unlock(&m_frameLock);
+
+  return rv;
+}
+
+bool VCAP::waitForFrame(unsigned int lastCount, int timeoutMs)
+{
+  struct timespec abstime;
+  clock_gettime(CLOCK_MONOTONIC, &abstime);
+  abstime.tv_sec += timeoutMs / 1000;
+  abstime.tv_nsec += (timeoutMs % 1000) * 1000000;
+  if (abstime.tv_nsec >= 1000000000)
+    {
+      abstime.tv_sec++;
+      abstime.tv_nsec -= 1000000000;
+    }
+
+  bool rv = true;
+
+  pthread_mutex_lock(&m_frameLock);
+  while (m_framesCaptured == lastCount)
+    {
+      if (!__atomic_load_n(&m_streaming, __ATOMIC_ACQUIRE))
+        {
+          rv = false;
+          break;
+        }
+
+      if (pthread_cond_timedwait(&m_frameCond, &m_frameLock, &abstime)
+          == ETIMEDOUT)
+        {
+          cerr << __FUNCTION__ << ": timed out waiting for frame" << endl;
+          rv = false;
+          break;
+        }
+    }
+  pthread_mutex_unlock(&m_frameLock);
+
+  return rv;
+}
+
+void *VCAP::streamThread(void *ctx)
+{
+  VCAP *This = (VCAP *)ctx;
+
+  while (__atomic_load_n(&This->m_streaming, __ATOMIC_ACQUIRE))
+    {
+      // wake up periodically to check whether we should stop
+      struct pollfd pfd;
+      pfd.fd = This->m_fd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+
+      int rv = poll(&pfd, 1, 100);
+      if (rv < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          cerr << __FUNCTION__ << ": poll() failed: "
+               << strerror(errno) << endl;
+          break;
+        }
+
+      if (!rv)
+        continue;
+
+      struct v4l2_buffer buf;
+      memset(&buf, 0, sizeof(buf));
+      buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+      buf.memory = V4L2_MEMORY_MMAP;
+
+      if (This->xioctl(This->m_fd, VIDIOC_DQBUF, &buf) < 0)
+        {
+          if (errno == EAGAIN)
+            continue;
+
+          cerr << __FUNCTION__ << ": ioctl(VIDIOC_DQBUF) failed: "
+               << strerror(errno) << endl;
+          break;
+        }
+
+      VCAP_FRAME_T frame;
+      frame.data = This->m_buffers[buf.index].start;
+      frame.length = buf.bytesused;
+      frame.width = This->m_width;
+      frame.height = This->m_height;
+      frame.bytesPerLine = This->m_format.fmt.pix.bytesperline;
+      frame.sequence = buf.sequence;
+      frame.timestamp = ((uint64_t)buf.timestamp.tv_sec * 1000000)
+        + buf.timestamp.tv_usec;
+
+      // the frame handler runs without the lock held, so that a slow
+      // handler does not also hold up saveImage()
+      pthread_mutex_lock(&This->m_frameLock);
+      VCAP_FRAME_FUNC_T func = This->m_frameFunc;
+      void *arg = This->m_frameArg;
+      pthread_mutex_unlock(&This->m_frameLock);
+
+      if (func)
+        func(&frame, arg);
+
+      // make this the current image, and give the previous one back
+      // to the driver
+      pthread_mutex_lock(&This->m_frameLock);
+
+      if (This->m_framesCaptured
+          && buf.sequence > This->m_lastSequence + 1)
+        This->m_framesDropped += buf.sequence - This->m_lastSequence - 1;
+      This->m_lastSequence = buf.sequence;
+      This->m_framesCaptured++;
+
+      int prev = This->m_heldIndex;
+      This->m_heldIndex = buf.index;
+      This->m_buffer = This->m_buffers[buf.index].start;
+      This->m_imageCaptured = true;
+
+      pthread_cond_broadcast(&This->m_frameCond);
+      pthread_mutex_unlock(&This->m_frameLock);
+
+      if (prev >= 0)
+        {
+          memset(&buf, 0, sizeof(buf));
+          buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+          buf.memory = V4L2_MEMORY_MMAP;
+          buf.index = prev;
+
+          if (This->xioctl(This->m_fd, VIDIOC_QBUF, &buf) < 0)
+            {
+              cerr << __FUNCTION__ << ": ioctl(VIDIOC_QBUF) failed: "
+                   << strerror(errno) << endl;
+              break;
+            }
+        }
+    }
+
+  return NULL;
+}
+
  void VCAP::setJPGQuality(unsigned int qual)
  {
    m_jpgQuality = CLAMP(qual, 0, 100);
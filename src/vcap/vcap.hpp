@@ -25,8 +25,11 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
 
+#include <stdint.h>
 #include <errno.h>
+#include <pthread.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
@@ -38,8 +41,32 @@
 #define VCAP_DEFAULT_WIDTH 640
 #define VCAP_DEFAULT_HEIGHT 480
 #define VCAP_DEFAULT_JPEG_QUALITY 99
+#define VCAP_DEFAULT_STREAM_BUFFERS 4
 
 namespace upm {
+
+  /**
+   * A frame delivered while streaming.  The data points directly
+   * into the driver's mmapped buffer, and is only valid for the
+   * duration of the frame callback.
+   */
+  typedef struct {
+    // YUYV pixel data
+    const unsigned char *data;
+    // number of valid bytes in data
+    size_t length;
+    int width;
+    int height;
+    // bytes from the start of one line to the start of the next
+    int bytesPerLine;
+    // driver frame sequence number
+    uint32_t sequence;
+    // driver capture time in microseconds
+    uint64_t timestamp;
+  } VCAP_FRAME_T;
+
+  typedef void (*VCAP_FRAME_FUNC_T)(const VCAP_FRAME_T *frame, void *arg);
+
     /**
      * @brief Video Frame Capture and JPEG Image Save Library
      *
@@ -66,6 +93,12 @@ namespace upm {
      * encompass most video cameras out there.  It has been tested
      * with a few off the shelf cameras without any problems.
      *
+     * For continuous capture, startStreaming() queues a ring of
+     * mmapped buffers and dequeues frames on a capture thread.  Each
+     * frame can be handed to a callback installed with
+     * setFrameHandler(), and captureImage()/saveImage() then work on
+     * the most recent frame without restarting the stream.
+     *
      * @snippet vcap.cxx Interesting
      */
 
@@ -157,6 +190,77 @@ namespace upm {
       return m_jpgQuality;
     };
 
+    /**
+     * Start continuous capture.  A ring of numBuffers mmapped buffers
+     * is queued to the driver, and a capture thread dequeues each
+     * completed frame, passes it to the frame handler (if any), and
+     * keeps it as the current image until the next frame arrives.
+     * If no resolution has been set, the default is used.
+     *
+     * @param numBuffers The number of buffers to request from the
+     * driver.  The driver may allocate more.  Default is
+     * VCAP_DEFAULT_STREAM_BUFFERS.
+     * @return true if the operation succeeded, false otherwise.
+     */
+    bool startStreaming(unsigned int numBuffers=VCAP_DEFAULT_STREAM_BUFFERS);
+
+    /**
+     * Stop continuous capture.  The last frame captured remains
+     * available to saveImage().
+     */
+    void stopStreaming();
+
+    /**
+     * Return whether continuous capture is running.
+     *
+     * @return true if streaming, false otherwise.
+     */
+    bool isStreaming() const
+    {
+      return m_streaming;
+    };
+
+    /**
+     * Install a function to be called from the capture thread for
+     * every frame received while streaming.  The frame handler should
+     * return quickly: while it runs, the buffer it was given cannot
+     * be returned to the driver.  Pass NULL to remove the handler.
+     *
+     * @param func The function to call.
+     * @param arg An argument passed to the function.
+     */
+    void setFrameHandler(VCAP_FRAME_FUNC_T func, void *arg);
+
+    /**
+     * Save a frame, such as the one passed to a frame handler, to a
+     * file in JPEG format.  The file will be overwritten if it
+     * already exists.
+     *
+     * @param frame The frame to save.
+     * @param filename The name of the file in which to store the image.
+     * @return true if the operation succeeded, false otherwise.
+     */
+    bool saveFrame(const VCAP_FRAME_T *frame,
+                   std::string filename=VCAP_DEFAULT_OUTPUTFILE);
+
+    /**
+     * Return the number of frames received since streaming was
+     * started.
+     *
+     * @return The number of frames received.
+     */
+    unsigned int getFramesCaptured();
+
+    /**
+     * Return the number of frames the driver dropped since streaming
+     * was started, as indicated by gaps in the frame sequence
+     * numbers.  This happens when all buffers are held by the
+     * application, for example by a slow frame handler.
+     *
+     * @return The number of frames dropped.
+     */
+    unsigned int getFramesDropped();
+
     /**
      * Enable or disable debugging output.
      *
@@ -174,11 +278,11 @@ namespace upm {
     // make sure device is streamable, supports mmap and capture
     bool checkCapabilities();
 
-    // read the mmapped buffer in YUYV format and create a jpeg image
-    bool YUYV2JPEG(FILE *file);
+    // read a buffer in YUYV format and create a jpeg image
+    bool YUYV2JPEG(FILE *file, const unsigned char *yuyv, int bytesPerLine);
 
     // buffer management
-    bool allocBuffer();
+    bool allocBuffer(unsigned int count=1);
     void releaseBuffer();
 
     // does the actual capture
@@ -197,9 +301,15 @@ namespace upm {
     struct v4l2_capability m_caps;
     struct v4l2_format m_format;
 
-    // our mmaped buffer
+    // our mmaped buffers
+    struct buffer_t {
+      unsigned char *start;
+      size_t length;
+    };
+    std::vector<buffer_t> m_buffers;
+
+    // the buffer holding the current image
     unsigned char *m_buffer;
-    size_t m_bufferLen;
 
     // the resolution and quality
     int m_width;
@@ -211,5 +321,28 @@ namespace upm {
 
     // are we debugging?
     bool m_debugging;
+
+    // streaming state.  m_heldIndex is the buffer we have dequeued
+    // and kept as the current image, -1 if none.
+    bool m_streaming;
+    pthread_t m_streamThread;
+    int m_heldIndex;
+    uint32_t m_lastSequence;
+    unsigned int m_framesCaptured;
+    unsigned int m_framesDropped;
+
+    VCAP_FRAME_FUNC_T m_frameFunc;
+    void *m_frameArg;
+
+    // protects the current image while streaming
+    pthread_mutex_t m_frameLock;
+    pthread_cond_t m_frameCond;
+
+    static void *streamThread(void *ctx);
+    bool waitForFrame(unsigned int lastCount, int timeoutMs);
+
+    // disable copying, the object owns mmapped buffers and a thread
+    VCAP(const VCAP&) = delete;
+    VCAP &operator=(const VCAP&) = delete;
   };
 }